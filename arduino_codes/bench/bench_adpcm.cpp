@@ -0,0 +1,106 @@
+// IMA-ADPCM: SNR contra o caminho cru (>> 14) no som cardíaco de referência,
+// independência entre blocos e ciclos por bloco do codificador.
+// Uso: bench_adpcm [blocos]
+
+#include <cmath>
+
+#include "bench_common.h"
+#include "core/biquad.h"
+#include "core/ima_adpcm.h"
+#include "core/sample_kernels.h"
+
+static double snrDb(const std::vector<int16_t> &ref, const std::vector<int16_t> &test) {
+    double sig = 0.0, err = 0.0;
+    for (size_t i = 0; i < ref.size(); i++) {
+        double d = (double)ref[i] - (double)test[i];
+        sig += (double)ref[i] * ref[i];
+        err += d * d;
+    }
+    return err == 0.0 ? INFINITY : 10.0 * std::log10(sig / err);
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    const size_t n = bench::BLOCK_SAMPLES;
+    bool ok = true;
+
+    std::vector<int32_t> raw = bench::makeI2SInput();
+    const size_t input_blocks = raw.size() / n;
+    const size_t total = input_blocks * n;
+
+    // Referências: caminho cru atual e saída do banco de filtros
+    std::vector<int16_t> shifted(total), wideband(total);
+    stetho::shiftBlock(raw.data(), shifted.data(), total);
+    stetho::FilterBank bank(bench::SAMPLE_RATE);
+    for (size_t b = 0; b < total; b += n) bank.process(&raw[b], &wideband[b], n);
+
+    uint8_t packet[stetho::adpcm::encodedSize(bench::BLOCK_SAMPLES)];
+    std::printf("bloco de %zu amostras: %zu bytes PCM -> %zu bytes ADPCM (%.2f:1)\n", n,
+                n * sizeof(int16_t), sizeof(packet), (double)(n * sizeof(int16_t)) / sizeof(packet));
+
+    struct Case {
+        const char *name;
+        const std::vector<int16_t> *ref;
+    } cases[] = {{"cardíaco, caminho >> 14", &shifted}, {"cardíaco, wideband", &wideband}};
+
+    for (const Case &c : cases) {
+        stetho::AdpcmEncoder enc;
+        std::vector<int16_t> decoded(total);
+        std::vector<std::vector<uint8_t>> packets;
+        for (size_t b = 0; b < total; b += n) {
+            size_t len = enc.encode(&(*c.ref)[b], n, packet);
+            packets.emplace_back(packet, packet + len);
+            if (stetho::adpcmDecode(packet, len, &decoded[b], n) != (int)n) ok = false;
+        }
+        std::printf("%-28s SNR %.1f dB\n", c.name, snrDb(*c.ref, decoded));
+
+        // Perde um pacote a cada 7: os seguintes devem decodificar igual
+        std::vector<int16_t> lossy(total, 0);
+        for (size_t b = 0; b < packets.size(); b++) {
+            if (b % 7 == 3) continue;
+            stetho::adpcmDecode(packets[b].data(), packets[b].size(), &lossy[b * n], n);
+            if (std::memcmp(&lossy[b * n], &decoded[b * n], n * sizeof(int16_t)) != 0) ok = false;
+        }
+    }
+
+    // Blocos de tamanho ímpar e par decodificam o número certo de amostras
+    for (size_t len_in : {1u, 2u, 3u, 249u, 250u}) {
+        stetho::AdpcmEncoder enc;
+        size_t len = enc.encode(shifted.data(), len_in, packet);
+        int16_t out[bench::BLOCK_SAMPLES];
+        if (len != stetho::adpcm::encodedSize(len_in) ||
+            stetho::adpcmDecode(packet, len, out, n) != (int)len_in || out[0] != shifted[0]) {
+            std::printf("FALHA: bloco de %zu amostras\n", len_in);
+            ok = false;
+        }
+    }
+
+    bench::printHeader("IMA-ADPCM vs caminho cru (bloco de 250 amostras)");
+    int16_t out[bench::BLOCK_SAMPLES];
+    bench::Result r = bench::timeBlocks(n, blocks, [&](size_t b) {
+        stetho::shiftBlock(&raw[(b % input_blocks) * n], out, n);
+        bench::doNotOptimize(out);
+    });
+    bench::printResult("cru >> 14", r);
+
+    stetho::AdpcmEncoder enc;
+    r = bench::timeBlocks(n, blocks, [&](size_t b) {
+        enc.encode(&shifted[(b % input_blocks) * n], n, packet);
+        bench::doNotOptimize(packet);
+    });
+    bench::printResult("ADPCM codificação", r);
+
+    enc.reset();
+    size_t len = enc.encode(shifted.data(), n, packet);
+    r = bench::timeBlocks(n, blocks, [&](size_t) {
+        stetho::adpcmDecode(packet, len, out, n);
+        bench::doNotOptimize(out);
+    });
+    bench::printResult("ADPCM decodificação", r);
+
+    if (!ok) {
+        std::printf("\nFALHA: decodificação ADPCM inconsistente\n");
+        return 1;
+    }
+    return 0;
+}
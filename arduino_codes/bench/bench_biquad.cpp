@@ -0,0 +1,130 @@
+// Banco de biquads: confere a resposta em frequência de cada preset contra o
+// projeto, mede a descontinuidade na troca de modo e o custo por bloco.
+// Uso: bench_biquad [blocos]
+
+#include <cmath>
+
+#include "bench_common.h"
+#include "core/biquad.h"
+
+// Ganho medido (dB) de um seno de 'f' Hz atravessando o banco no modo dado
+static double measureGainDb(stetho::FilterMode mode, double f) {
+    const double fs = bench::SAMPLE_RATE;
+    const double amplitude = 8000.0; // em LSB da saída de 16 bits
+    const size_t settle = (size_t)(1.5 * fs);
+    const size_t measure = (size_t)(std::ceil(2.0 * f) / f * fs); // número inteiro de ciclos
+    const size_t n = bench::BLOCK_SAMPLES;
+
+    stetho::FilterBank bank(fs, mode);
+    int32_t in[bench::BLOCK_SAMPLES];
+    int16_t out[bench::BLOCK_SAMPLES];
+    double in_energy = 0.0, out_energy = 0.0;
+    for (size_t start = 0; start < settle + measure; start += n) {
+        for (size_t i = 0; i < n; i++) {
+            double v = amplitude * std::sin(2.0 * M_PI * f * (double)(start + i) / fs);
+            in[i] = (int32_t)std::lround(v * (1 << stetho::I2S_TO_INT16_SHIFT));
+        }
+        bank.process(in, out, n);
+        for (size_t i = 0; i < n; i++) {
+            size_t k = start + i;
+            if (k < settle || k >= settle + measure) continue;
+            double v = (double)in[i] / (1 << stetho::I2S_TO_INT16_SHIFT);
+            in_energy += v * v;
+            out_energy += (double)out[i] * out[i];
+        }
+    }
+    return 10.0 * std::log10((out_energy + 1e-9) / in_energy);
+}
+
+static bool checkResponse(stetho::FilterMode mode) {
+    const stetho::FilterPreset &p = stetho::filterPreset(mode);
+    stetho::FilterBank bank(bench::SAMPLE_RATE, mode);
+    const double freqs[] = {5, 10, 20, 40, 60, 100, 150, 200, 300, 500,
+                            800, 1000, 1500, 2000, 3000, 5000, 8000};
+    bool ok = true;
+
+    std::printf("\n-- %s (%.0f Hz - %.0f Hz) --\n", p.name, p.low_hz, p.high_hz);
+    std::printf("%10s %12s %12s %10s\n", "Hz", "projeto dB", "medido dB", "");
+    for (double f : freqs) {
+        double design = 20.0 * std::log10(bank.designMagnitude(mode, f));
+        double measured = measureGainDb(mode, f);
+        // Acima de -50 dB o medido deve seguir o projeto; abaixo disso o
+        // ruído de quantização de 16 bits domina e só exigimos a atenuação.
+        bool pass = design > -50.0 ? std::fabs(measured - design) <= 0.5 : measured < -45.0;
+        ok = ok && pass;
+        std::printf("%10.0f %12.2f %12.2f %10s\n", f, design, measured, pass ? "ok" : "FALHA");
+    }
+
+    // Especificação: ~0 dB no centro (geométrico) e ~-3 dB nas bordas
+    double center = std::sqrt(p.low_hz * p.high_hz);
+    double g_center = 20.0 * std::log10(bank.designMagnitude(mode, center));
+    double g_low = 20.0 * std::log10(bank.designMagnitude(mode, p.low_hz));
+    double g_high = 20.0 * std::log10(bank.designMagnitude(mode, p.high_hz));
+    bool spec = std::fabs(g_center) < 0.5 && std::fabs(g_low + 3.0) < 1.0 &&
+                std::fabs(g_high + 3.0) < 1.0;
+    std::printf("centro %.0f Hz: %.2f dB, bordas: %.2f / %.2f dB %s\n", center, g_center, g_low,
+                g_high, spec ? "ok" : "FALHA");
+    return ok && spec;
+}
+
+// Maior salto entre amostras vizinhas na fronteira de troca e fora dela
+static void measureSwitchGlitch() {
+    const size_t n = bench::BLOCK_SAMPLES;
+    std::vector<int32_t> input = bench::makeI2SInput();
+    stetho::FilterBank bank(bench::SAMPLE_RATE, stetho::FilterMode::Wideband);
+    std::vector<int16_t> out(input.size());
+    int max_boundary = 0, max_other = 0;
+    int16_t prev = 0;
+    for (size_t b = 0; b + n <= input.size(); b += n) {
+        size_t block = b / n;
+        bool switching = block > 0 && block % 20 == 0;
+        if (switching) bank.requestMode((stetho::FilterMode)((block / 20) % stetho::FILTER_MODE_COUNT));
+        bank.process(&input[b], &out[b], n);
+        for (size_t i = 0; i < n; i++) {
+            int jump = std::abs((int)out[b + i] - (int)prev);
+            prev = out[b + i];
+            if (block < 4) continue; // partida do filtro
+            if (switching) max_boundary = std::max(max_boundary, jump);
+            else max_other = std::max(max_other, jump);
+        }
+    }
+    std::printf("\ntroca de modo: maior salto no bloco de troca %d LSB, nos demais %d LSB\n",
+                max_boundary, max_other);
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    const size_t n = bench::BLOCK_SAMPLES;
+
+    bool ok = true;
+    for (size_t m = 0; m < stetho::FILTER_MODE_COUNT; m++) ok = checkResponse((stetho::FilterMode)m) && ok;
+    measureSwitchGlitch();
+
+    std::vector<int32_t> input = bench::makeI2SInput();
+    const size_t input_blocks = input.size() / n;
+    int16_t out[bench::BLOCK_SAMPLES];
+
+    bench::printHeader("banco de biquads (4 seções DF2T)");
+    for (size_t m = 0; m < stetho::FILTER_MODE_COUNT; m++) {
+        stetho::FilterBank bank(bench::SAMPLE_RATE, (stetho::FilterMode)m);
+        bench::Result r = bench::timeBlocks(n, blocks, [&](size_t b) {
+            bank.process(&input[(b % input_blocks) * n], out, n);
+            bench::doNotOptimize(out);
+        });
+        bench::printResult(stetho::filterPreset((stetho::FilterMode)m).name, r);
+    }
+
+    stetho::FilterBank bank(bench::SAMPLE_RATE);
+    bench::Result r = bench::timeBlocks(n, blocks, [&](size_t b) {
+        bank.requestMode((stetho::FilterMode)(b % stetho::FILTER_MODE_COUNT));
+        bank.process(&input[(b % input_blocks) * n], out, n);
+        bench::doNotOptimize(out);
+    });
+    bench::printResult("troca a cada bloco", r);
+
+    if (!ok) {
+        std::printf("\nFALHA: resposta em frequência fora do projeto\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,289 @@
+// Ponto flutuante em bloco (core/block_float.h) de ponta a ponta: pipeline
+// do current.cpp (banco de biquads + decimação) com BlockScaling ->
+// Packetizer -> Reassembler -> expandBlock no receptor, comparado com a
+// saída do mesmo banco na escala larga, sem quantizar. Confere:
+//  - o expoente no cabeçalho do quadro (ida e volta, e g = 0 nos quadros antigos);
+//  - erro de no máximo meio LSB do expoente de cada amostra, sem saturar,
+//    com sinal fraco (pulmão) e forte (que satura o >> 14 fixo);
+//  - a 4 kHz, que a troca de expoente com o histórico do FIR reescalado não
+//    deixa degrau: o sinal reconstruído bate com o caminho fixo;
+//  - quanto custa por bloco e quanto da carga útil se perde com os pacotes
+//    curtos que cada troca de expoente provoca.
+//
+// Uso: bench_block_float [blocos]
+
+#include "bench_common.h"
+#include "core/biquad.h"
+#include "core/block_float.h"
+#include "core/frame.h"
+#include "core/packetizer.h"
+#include "core/pipeline.h"
+#include "core/reassembler.h"
+#include "core/resampler.h"
+
+using stetho::FilterMode;
+using stetho::OutputRate;
+using stetho::ScalingMode;
+
+constexpr size_t N = bench::BLOCK_SAMPLES;
+constexpr uint16_t MTU = 247;
+constexpr int ROUNDS = 3;
+// Pelo menos tantos bits a mais que o >> 14 no sinal fraco
+constexpr double MIN_BITS_GAINED = 4.0;
+// Degrau máximo (LSB da escala fixa) na emenda com a decimação
+constexpr double MAX_SEAM_LSB = 2.0;
+
+static const char *modeName(ScalingMode m) {
+    return m == ScalingMode::Fixed ? "fixo (>> 14)" : m == ScalingMode::BlockFloat ? "bloco (BFP)" : "AGC";
+}
+
+struct Capture {
+    stetho::Decimator dec;
+    stetho::CapturePipeline<stetho::FilterBank, stetho::Decimated, stetho::BlockScaling> pipe;
+    Capture(OutputRate rate, ScalingMode mode) : dec(rate), pipe(bench::SAMPLE_RATE, FilterMode::Wideband, dec) {
+        pipe.scaling().requestMode(mode);
+    }
+};
+
+// Receptor: guarda as amostras já de volta na escala larga
+struct WideSink : stetho::ReassemblerSink {
+    std::vector<int32_t> wide;
+    std::vector<int8_t> gains;
+    int gain_exp = 0;
+    size_t gap_samples = 0;
+    void onGain(uint64_t, int g) override { gain_exp = g; }
+    void onSamples(uint64_t, const int16_t *s, size_t n, bool gap) override {
+        if (gap) gap_samples += n;
+        const size_t at = wide.size();
+        wide.resize(at + n);
+        stetho::expandBlock(s, n, gain_exp, &wide[at]);
+        gains.insert(gains.end(), n, (int8_t)gain_exp);
+    }
+};
+
+//================================================================
+// --- CABEÇALHO ---
+//================================================================
+static bool headerRoundTrip() {
+    bool ok = true;
+    for (int g = stetho::GAIN_EXP_MIN; g <= stetho::GAIN_EXP_MAX; g++) {
+        for (uint8_t flags : {(uint8_t)0, stetho::FRAME_FLAG_DISCONTINUITY}) {
+            stetho::FrameHeader h, back;
+            h.seq = 0xBEEF;
+            h.first_sample = 123456;
+            h.timestamp_us = 789;
+            h.codec = stetho::StreamCodec::Rice;
+            h.flags = flags;
+            h.gain_exp = (int8_t)g;
+            uint8_t buf[stetho::FRAME_HEADER_SIZE];
+            stetho::writeFrameHeader(h, buf);
+            ok &= stetho::readFrameHeader(buf, sizeof(buf), back) && back.gain_exp == g && back.flags == flags &&
+                  back.codec == h.codec && back.seq == h.seq && back.first_sample == h.first_sample;
+        }
+    }
+    // Quadro de antes do expoente: bits altos do byte 10 zerados -> g = 0
+    stetho::FrameHeader h, back;
+    h.flags = stetho::FRAME_FLAG_DISCONTINUITY;
+    uint8_t buf[stetho::FRAME_HEADER_SIZE];
+    stetho::writeFrameHeader(h, buf);
+    ok &= stetho::readFrameHeader(buf, sizeof(buf), back) && back.gain_exp == 0;
+    std::printf("cabeçalho: expoentes %d..%d ida e volta: %s\n", stetho::GAIN_EXP_MIN, stetho::GAIN_EXP_MAX,
+                ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+//================================================================
+// --- PRECISÃO A 20 kHz, PELO ENLACE ---
+//================================================================
+struct Accuracy {
+    bool exact_gains = true;  // expoentes recebidos = os do pipeline
+    size_t over_half_lsb = 0; // erro acima de meio LSB do expoente
+    size_t saturated = 0;     // amostras no limite do int16
+    size_t gain_changes = 0;
+    double snr_db = 0.0;
+    double efficiency = 0.0;
+    double packets_per_s = 0.0;
+};
+
+static Accuracy runLink(const std::vector<int32_t> &input, ScalingMode mode) {
+    Capture cap(OutputRate::Hz20000, mode);
+    stetho::FilterBank wide_bank(bench::SAMPLE_RATE, FilterMode::Wideband);
+    stetho::Packetizer pk;
+    pk.configure(MTU, stetho::StreamCodec::Pcm16, true, 20000);
+    WideSink sink;
+    stetho::Reassembler reasm(sink);
+    uint8_t packet[stetho::Packetizer::MAX_PAYLOAD];
+    size_t len = 0;
+
+    std::vector<int32_t> ref;
+    std::vector<int8_t> ref_gains;
+    Accuracy acc;
+    int32_t dma[N], wide[N];
+    int16_t out[N + 1];
+    int last_g = 0;
+    for (size_t blk = 0; blk + N <= input.size(); blk += N) {
+        std::memcpy(dma, &input[blk], sizeof(dma));
+        std::memcpy(wide, &input[blk], sizeof(wide));
+        const size_t n = cap.pipe.process(dma, out, N);
+        wide_bank.widenInPlace(wide, N);
+        const int g = cap.pipe.scaling().gainExp();
+        if (g != last_g) acc.gain_changes++;
+        last_g = g;
+        for (size_t i = 0; i < n; i++) acc.saturated += out[i] == 32767 || out[i] == -32768;
+        ref.insert(ref.end(), wide, wide + n);
+        ref_gains.insert(ref_gains.end(), n, (int8_t)g);
+        pk.push(out, n, (uint32_t)blk, (uint32_t)(blk * 50), g);
+        while (pk.nextPacket(packet, len)) reasm.push(packet, len);
+    }
+    while (pk.flush(packet, len)) reasm.push(packet, len);
+    reasm.flush();
+
+    acc.exact_gains = sink.wide.size() == ref.size() && sink.gap_samples == 0 && sink.gains == ref_gains;
+    double err = 0.0, sig = 0.0;
+    for (size_t i = 0; i < ref.size() && i < sink.wide.size(); i++) {
+        const double e = (double)sink.wide[i] - (double)ref[i];
+        const double half_lsb = (double)(1 << (stetho::BFP_WIDE_BITS - sink.gains[i])) / 2.0;
+        // O >> 14 fixo trunca: lá vale um LSB inteiro
+        const double limit = mode == ScalingMode::Fixed ? 2.0 * half_lsb : half_lsb;
+        acc.over_half_lsb += std::fabs(e) > limit;
+        err += e * e;
+        sig += (double)ref[i] * ref[i];
+    }
+    acc.snr_db = err > 0.0 ? 10.0 * std::log10(sig / err) : INFINITY;
+    acc.efficiency = pk.stats().efficiency();
+    acc.packets_per_s = (double)pk.stats().packets / ((double)ref.size() / bench::SAMPLE_RATE);
+    return acc;
+}
+
+static bool accuracy(const char *title, const std::vector<int32_t> &input, bool expect_fixed_saturation,
+                     double &fixed_snr, double &bfp_snr) {
+    std::printf("\n== %s (20000 Hz, Pcm16, MTU %u) ==\n", title, MTU);
+    std::printf("%-16s %10s %8s %10s %12s %10s %10s\n", "escala", "SNR (dB)", "bits", "saturadas", "> meio LSB",
+                "trocas/s", "carga útil");
+    bool ok = true;
+    for (ScalingMode mode : {ScalingMode::Fixed, ScalingMode::BlockFloat, ScalingMode::Agc}) {
+        const Accuracy a = runLink(input, mode);
+        const double seconds = (double)input.size() / bench::SAMPLE_RATE;
+        std::printf("%-16s %10.1f %8.1f %10zu %12zu %10.1f %9.1f%%\n", modeName(mode), a.snr_db,
+                    (a.snr_db - 1.76) / 6.02, a.saturated, a.over_half_lsb, (double)a.gain_changes / seconds,
+                    100.0 * a.efficiency);
+        ok &= a.exact_gains;
+        if (mode == ScalingMode::Fixed) {
+            fixed_snr = a.snr_db;
+            // Só o fixo pode saturar, e só no sinal forte
+            if (!expect_fixed_saturation) ok &= a.saturated == 0 && a.over_half_lsb == 0;
+            if (expect_fixed_saturation) ok &= a.saturated > 0;
+        } else {
+            if (mode == ScalingMode::BlockFloat) bfp_snr = a.snr_db;
+            ok &= a.over_half_lsb == 0;
+        }
+    }
+    std::printf("expoentes recebidos iguais aos enviados, erro <= meio LSB: %s\n", ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+//================================================================
+// --- EMENDA COM A DECIMAÇÃO (4 kHz) ---
+//================================================================
+// Nível alternando entre forte e 30 dB abaixo a cada meio segundo força o
+// expoente a subir e descer com o FIR cheio de amostras do expoente antigo
+static std::vector<int32_t> makeSteppedInput(size_t n) {
+    std::vector<double> x = bench::makeHeartSignal(n);
+    for (size_t i = 0; i < n; i++) {
+        if ((i / (size_t)(bench::SAMPLE_RATE / 2)) % 2) x[i] *= 0.03;
+    }
+    return bench::toI2SWords(x);
+}
+
+static bool seam(const std::vector<int32_t> &input, OutputRate rate) {
+    bool ok = true;
+    for (ScalingMode mode : {ScalingMode::BlockFloat, ScalingMode::Agc}) {
+        Capture fixed(rate, ScalingMode::Fixed), scaled(rate, mode);
+        int32_t dma[N];
+        int16_t a[N + 1], b[N + 1];
+        double worst = 0.0;
+        size_t total = 0, changes = 0;
+        int last_g = 0;
+        for (size_t blk = 0; blk + N <= input.size(); blk += N) {
+            std::memcpy(dma, &input[blk], sizeof(dma));
+            const size_t na = fixed.pipe.process(dma, a, N);
+            std::memcpy(dma, &input[blk], sizeof(dma));
+            const size_t nb = scaled.pipe.process(dma, b, N);
+            const int g = scaled.pipe.scaling().gainExp();
+            changes += g != last_g;
+            last_g = g;
+            if (na != nb) ok = false;
+            for (size_t i = 0; i < na && i < nb; i++) {
+                const double legacy = std::ldexp((double)b[i], -g);
+                worst = std::max(worst, std::fabs(legacy - (double)a[i]));
+            }
+            total += na;
+        }
+        const bool pass = total > 0 && worst <= MAX_SEAM_LSB;
+        std::printf("emenda %u Hz, %-12s: %zu trocas de expoente, maior diferença para o fixo %.2f LSB %s\n",
+                    stetho::outputRateRatio(rate).hz, modeName(mode), changes, worst, pass ? "ok" : "FALHOU");
+        ok &= pass;
+    }
+    return ok;
+}
+
+//================================================================
+// --- CUSTO POR BLOCO ---
+//================================================================
+static bench::Result timeMode(const std::vector<int32_t> &input, OutputRate rate, ScalingMode mode, size_t blocks) {
+    Capture cap(rate, mode);
+    const size_t total_blocks = input.size() / N;
+    int32_t dma[N];
+    int16_t slot[N + 1];
+    size_t out = 0;
+    bench::Result r = bench::timeBlocks(N, blocks, [&](size_t blk) {
+        std::memcpy(dma, &input[(blk % total_blocks) * N], sizeof(dma));
+        out += cap.pipe.process(dma, slot, N);
+        bench::doNotOptimize(slot);
+    });
+    bench::doNotOptimize(out);
+    return r;
+}
+
+static void cost(const std::vector<int32_t> &input, size_t blocks) {
+    for (OutputRate rate : {OutputRate::Hz20000, OutputRate::Hz4000}) {
+        char title[64];
+        std::snprintf(title, sizeof(title), "captura por bloco (%u Hz)", stetho::outputRateRatio(rate).hz);
+        bench::printHeader(title);
+        bench::Result best[3]{};
+        for (int round = 0; round < ROUNDS; round++) {
+            for (int m = 0; m < 3; m++) {
+                const bench::Result r = timeMode(input, rate, (ScalingMode)m, blocks);
+                if (round == 0 || r.ns_per_block < best[m].ns_per_block) best[m] = r;
+            }
+        }
+        for (int m = 0; m < 3; m++) bench::printResult(modeName((ScalingMode)m), best[m]);
+    }
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv, 20000);
+    const std::vector<double> heart = bench::makeHeartSignal(80000);
+    // Pulmão/ausculta fraca: fundo de escala 4x menor que o padrão
+    const std::vector<int32_t> quiet = bench::toI2SWords(heart, 0.25 / 4.0);
+    // Forte: passa dos 16 bits depois do >> 14
+    const std::vector<int32_t> loud = bench::toI2SWords(heart, 1.5);
+    bool ok = headerRoundTrip();
+
+    double fixed_snr = 0.0, bfp_snr = 0.0, unused = 0.0;
+    ok &= accuracy("sinal fraco", quiet, false, fixed_snr, bfp_snr);
+    const double gained = (bfp_snr - fixed_snr) / 6.02;
+    const bool enough = gained >= MIN_BITS_GAINED;
+    std::printf("bits a mais que o fixo no sinal fraco: %.1f (mínimo %.0f) %s\n", gained, MIN_BITS_GAINED,
+                enough ? "ok" : "FALHOU");
+    ok &= enough;
+    ok &= accuracy("sinal forte", loud, true, unused, unused);
+
+    std::printf("\n");
+    ok &= seam(makeSteppedInput(80000), OutputRate::Hz4000);
+
+    cost(bench::makeI2SInput(), blocks);
+
+    std::printf("\n%s\n", ok ? "OK" : "FALHOU");
+    return ok ? 0 : 1;
+}
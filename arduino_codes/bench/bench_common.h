@@ -0,0 +1,155 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//================================================================
+// --- UTILITÁRIOS DOS BENCHMARKS DE HOST ---
+//================================================================
+// Todos os benchmarks usam a mesma entrada sintética e o mesmo formato de
+// saída, para que kernels novos possam ser comparados com os atuais.
+
+namespace bench {
+
+// Mesmos valores dos firmwares (I2S_SAMPLE_RATE / I2S_BUFFER_SAMPLES)
+constexpr double SAMPLE_RATE = 20000.0;
+constexpr size_t BLOCK_SAMPLES = 250;
+
+// Impede que o compilador elimine um resultado que não é usado
+template <typename T>
+inline void doNotOptimize(const T &value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+inline void clobberMemory() { asm volatile("" : : : "memory"); }
+
+// Contador de ciclos do host: TSC no x86 (frequência nominal), 0 onde não há
+inline uint64_t cycleCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct Result {
+    double ns_per_block;
+    double samples_per_sec;
+    double cycles_per_block;
+};
+
+// Número de blocos por medição. Pode ser trocado pelo primeiro argumento.
+inline size_t blocksFromArgs(int argc, char **argv, size_t default_blocks = 40000) {
+    if (argc > 1) {
+        long v = std::strtol(argv[1], nullptr, 10);
+        if (v > 0) return (size_t)v;
+    }
+    return default_blocks;
+}
+
+// Mede fn(bloco) chamado 'blocks' vezes, após um aquecimento curto
+template <typename Fn>
+Result timeBlocks(size_t block_samples, size_t blocks, Fn &&fn) {
+    size_t warmup = blocks / 10 + 1;
+    for (size_t b = 0; b < warmup; b++) fn(b);
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t c0 = cycleCounter();
+    for (size_t b = 0; b < blocks; b++) {
+        fn(b);
+        clobberMemory();
+    }
+    uint64_t c1 = cycleCounter();
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    Result r;
+    r.ns_per_block = ns / (double)blocks;
+    r.samples_per_sec = (double)block_samples * (double)blocks / (ns * 1e-9);
+    r.cycles_per_block = (double)(c1 - c0) / (double)blocks;
+    return r;
+}
+
+inline void printHeader(const char *title) {
+    std::printf("\n== %s ==\n", title);
+    std::printf("%-32s %14s %14s %16s %12s\n", "variante", "ns/bloco", "ciclos/bloco",
+                "amostras/s", "x tempo real");
+}
+
+inline void printResult(const char *name, const Result &r) {
+    std::printf("%-32s %14.1f %14.0f %16.0f %12.1f\n", name, r.ns_per_block, r.cycles_per_block,
+                r.samples_per_sec, r.samples_per_sec / SAMPLE_RATE);
+}
+
+// Gerador pseudoaleatório determinístico (xorshift32)
+struct Rng {
+    uint32_t state;
+    explicit Rng(uint32_t seed = 0x2545F491u) : state(seed ? seed : 1u) {}
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    // Uniforme em [-1, 1)
+    double uniform() { return (double)next() / 2147483648.0 - 1.0; }
+};
+
+// Som cardíaco sintético em [-1, 1]: S1 e S2 como senoides amortecidas a
+// 75 bpm, ruído respiratório leve e um offset DC, como no microfone real.
+inline std::vector<double> makeHeartSignal(size_t n, double fs = SAMPLE_RATE,
+                                           uint32_t seed = 1) {
+    std::vector<double> x(n);
+    Rng rng(seed);
+    const double kPi = 3.14159265358979323846;
+    const double period = 0.8; // 75 bpm
+    const double s2_delay = 0.30;
+    for (size_t i = 0; i < n; i++) {
+        double t = (double)i / fs;
+        double tb = std::fmod(t, period);
+        double v = 0.0;
+        if (tb < 0.12) {
+            v += 0.55 * std::exp(-tb * 35.0) * std::sin(2 * kPi * 45.0 * tb);
+            v += 0.25 * std::exp(-tb * 45.0) * std::sin(2 * kPi * 90.0 * tb);
+        }
+        double t2 = tb - s2_delay;
+        if (t2 >= 0.0 && t2 < 0.09) {
+            v += 0.40 * std::exp(-t2 * 50.0) * std::sin(2 * kPi * 110.0 * t2);
+            v += 0.15 * std::exp(-t2 * 60.0) * std::sin(2 * kPi * 180.0 * t2);
+        }
+        v += 0.01 * rng.uniform();
+        v += 0.02; // offset DC
+        x[i] = v;
+    }
+    return x;
+}
+
+// Converte para palavras I2S de 32 bits como o INMP441 entrega: 24 bits
+// úteis alinhados à esquerda. 'gain' é o fundo de escala em relação a 2^31.
+inline std::vector<int32_t> toI2SWords(const std::vector<double> &x, double gain = 0.25) {
+    std::vector<int32_t> out(x.size());
+    for (size_t i = 0; i < x.size(); i++) {
+        double v = x[i] * gain * 2147483647.0;
+        if (v > 2147483647.0) v = 2147483647.0;
+        if (v < -2147483648.0) v = -2147483648.0;
+        out[i] = (int32_t)((uint32_t)(int32_t)v & 0xFFFFFF00u);
+    }
+    return out;
+}
+
+// Entrada padrão: 4 s do som cardíaco sintético em palavras I2S
+inline std::vector<int32_t> makeI2SInput(size_t n = 80000, uint32_t seed = 1) {
+    return toI2SWords(makeHeartSignal(n, SAMPLE_RATE, seed));
+}
+
+} // namespace bench
@@ -0,0 +1,95 @@
+// Benchmark e verificação do passa-baixa em ponto fixo contra os filtros em
+// float atuais e contra uma referência em double.
+// Uso: bench_fixed_lowpass [blocos]
+
+#include <cmath>
+
+#include "bench_common.h"
+#include "core/fixed_lowpass.h"
+#include "core/sample_kernels.h"
+
+// Mesma estrutura do kernel em ponto fixo, calculada em double
+static std::vector<int16_t> referenceLowPass(const std::vector<int32_t> &in, double alpha) {
+    std::vector<int16_t> out(in.size());
+    double y = 0.0;
+    for (size_t i = 0; i < in.size(); i++) {
+        y += alpha * ((double)in[i] - y);
+        double v = std::floor(y / 16384.0);
+        if (v > 32767.0) v = 32767.0;
+        if (v < -32768.0) v = -32768.0;
+        out[i] = (int16_t)v;
+    }
+    return out;
+}
+
+template <typename Filter>
+static int maxAbsError(Filter &filter, const std::vector<int32_t> &in,
+                       const std::vector<int16_t> &ref) {
+    const size_t n = bench::BLOCK_SAMPLES;
+    int16_t out[bench::BLOCK_SAMPLES];
+    int max_err = 0;
+    for (size_t b = 0; b + n <= in.size(); b += n) {
+        filter.process(&in[b], out, n);
+        for (size_t i = 0; i < n; i++) {
+            int err = std::abs((int)out[i] - (int)ref[b + i]);
+            if (err > max_err) max_err = err;
+        }
+    }
+    return max_err;
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    const size_t n = bench::BLOCK_SAMPLES;
+
+    // Ganho alto de propósito: parte dos picos satura a saída de 16 bits
+    std::vector<int32_t> input = bench::toI2SWords(bench::makeHeartSignal(80000), 0.6);
+    const size_t input_blocks = input.size() / n;
+    int16_t out[bench::BLOCK_SAMPLES];
+    bool ok = true;
+
+    for (float alpha : {0.05f, 0.25f}) {
+        std::vector<int16_t> ref = referenceLowPass(input, alpha);
+
+        stetho::FixedLowPass fixed(alpha);
+        int fixed_err = maxAbsError(fixed, input, ref);
+        stetho::RawLowPass raw(alpha);
+        int float_err = maxAbsError(raw, input, ref);
+
+        std::printf("\nalpha=%.2f  erro máx. vs double: ponto fixo %d LSB (tolerância %d), "
+                    "float atual %d LSB (sem saturação)\n",
+                    alpha, fixed_err, stetho::FixedLowPass::TOLERANCE_LSB, float_err);
+        if (fixed_err > stetho::FixedLowPass::TOLERANCE_LSB) ok = false;
+
+        char title[64];
+        std::snprintf(title, sizeof(title), "passa-baixa alpha=%.2f", alpha);
+        bench::printHeader(title);
+
+        stetho::ClampedLowPass clamped(alpha);
+        bench::Result r = bench::timeBlocks(n, blocks, [&](size_t b) {
+            clamped.process(&input[(b % input_blocks) * n], out, n);
+            bench::doNotOptimize(out);
+        });
+        bench::printResult("float clamp (with_filter)", r);
+
+        raw.reset();
+        r = bench::timeBlocks(n, blocks, [&](size_t b) {
+            raw.process(&input[(b % input_blocks) * n], out, n);
+            bench::doNotOptimize(out);
+        });
+        bench::printResult("float raw (current)", r);
+
+        fixed.reset();
+        r = bench::timeBlocks(n, blocks, [&](size_t b) {
+            fixed.process(&input[(b % input_blocks) * n], out, n);
+            bench::doNotOptimize(out);
+        });
+        bench::printResult("Q31/Q15 ponto fixo", r);
+    }
+
+    if (!ok) {
+        std::printf("\nFALHA: kernel em ponto fixo fora da tolerância\n");
+        return 1;
+    }
+    return 0;
+}
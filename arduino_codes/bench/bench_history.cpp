@@ -0,0 +1,246 @@
+// Histórico pré-gatilho: volta do anel, leitura concorrente com o produtor
+// sobrescrevendo (seqlock), passagem rajada -> ao vivo sem buracos nem
+// repetições e a vazão de drenagem da rajada (ler + decodificar + empacotar).
+// Uso: bench_history [blocos]
+
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <thread>
+
+#include "bench_common.h"
+#include "core/biquad.h"
+#include "core/history_ring.h"
+#include "core/packetizer.h"
+#include "core/reassembler.h"
+
+using stetho::HistoryFormat;
+using stetho::HistoryRing;
+
+static const char *formatName(HistoryFormat fmt) { return fmt == HistoryFormat::Pcm16 ? "pcm16" : "adpcm"; }
+
+// Volta do anel com blocos de tamanhos variados e um salto no índice
+static bool testWraparound(const std::vector<int16_t> &x, HistoryFormat fmt) {
+    const size_t slots = 12;
+    std::vector<uint8_t> mem(slots * HistoryRing::slotSize(fmt));
+    HistoryRing ring(mem.data(), mem.size(), fmt);
+    bool ok = ring.slots() == slots;
+
+    const size_t sizes[] = {250, 50, 125, 313, 7};
+    const uint32_t JUMP = 500;
+    uint32_t index = 0, jump_at = 0;
+    size_t pos = 0, b = 0;
+    while (pos + 313 <= x.size() / 2) {
+        const size_t n = sizes[b++ % 5];
+        // Descarte simulado de JUMP amostras perto do fim (dentro do que o anel guarda)
+        if (pos > x.size() / 2 - 1500 && jump_at == 0) {
+            index += JUMP;
+            jump_at = index;
+        }
+        ring.write(&x[pos], n, index, index * 50);
+        pos += n;
+        index += (uint32_t)n;
+    }
+    // Só os slots - 1 mais recentes são garantidos
+    ok = ok && ring.newest() - ring.oldest() == slots - 1;
+    HistoryRing::Chunk c;
+    // O slot sobrescrito e o que ainda não existe não podem ser lidos
+    ok = ok && !ring.read(ring.newest() - slots - 1, c) && !ring.read(ring.newest(), c);
+
+    double sig = 0, err = 0;
+    uint32_t expect_first = 0;
+    size_t jumps = 0;
+    for (uint64_t k = ring.oldest(); k < ring.newest(); k++) {
+        if (!ring.read(k, c)) return false;
+        if (k > ring.oldest() && c.first_sample != expect_first) {
+            // Só o salto, e ele fecha o slot anterior mais cedo
+            jumps++;
+            if (c.first_sample != jump_at || expect_first != jump_at - JUMP) ok = false;
+        }
+        expect_first = c.first_sample + c.count;
+        const size_t src = c.first_sample >= jump_at ? c.first_sample - JUMP : c.first_sample;
+        for (size_t i = 0; i < c.count; i++) {
+            const double d = (double)c.samples[i] - x[src + i];
+            sig += (double)x[src + i] * x[src + i];
+            err += d * d;
+        }
+    }
+    ok = ok && jumps == 1;
+    ok = ok && ring.committedEnd() == expect_first;
+    const double snr = err == 0 ? INFINITY : 10 * std::log10(sig / err);
+    ok = ok && (fmt == HistoryFormat::Pcm16 ? err == 0 : snr > 30);
+
+    ring.clear();
+    ok = ok && ring.oldest() == ring.newest();
+    std::printf("volta do anel (%s): %zu slots, SNR %.1f dB, %s\n", formatName(fmt), slots, snr, ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+// Produtor e leitor em threads: toda leitura aceita tem que estar íntegra
+static bool testConcurrentReads() {
+    const size_t slots = 8;
+    std::vector<uint8_t> mem(slots * HistoryRing::slotSize(HistoryFormat::Pcm16));
+    HistoryRing ring(mem.data(), mem.size(), HistoryFormat::Pcm16);
+    std::atomic<bool> done(false);
+    const uint32_t total = 4000000;
+
+    std::thread producer([&] {
+        int16_t block[100];
+        for (uint32_t idx = 0; idx < total; idx += 100) {
+            for (int i = 0; i < 100; i++) block[i] = (int16_t)((idx + i) * 7);
+            ring.write(block, 100, idx, 0);
+            if ((idx / 100) % 64 == 0) std::this_thread::yield();
+        }
+        done.store(true);
+    });
+
+    size_t accepted = 0, rejected = 0, corrupt = 0;
+    HistoryRing::Chunk c;
+    while (!done.load()) {
+        // Lê sempre o mais antigo: o que o produtor está para sobrescrever
+        const uint64_t k = ring.oldest();
+        if (ring.read(k, c)) {
+            accepted++;
+            for (size_t i = 0; i < c.count; i++)
+                if (c.samples[i] != (int16_t)((c.first_sample + i) * 7)) {
+                    corrupt++;
+                    break;
+                }
+        } else {
+            rejected++;
+        }
+    }
+    producer.join();
+    const bool ok = corrupt == 0 && accepted > 0;
+    std::printf("leitura concorrente: %zu aceitas, %zu rejeitadas, %zu corrompidas, %s\n", accepted, rejected,
+                corrupt, ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+struct CollectSink : stetho::ReassemblerSink {
+    std::vector<int16_t> samples;
+    uint64_t first = 0;
+    size_t gap_samples = 0;
+    void onSamples(uint64_t index, const int16_t *s, size_t n, bool gap) override {
+        if (samples.empty()) first = index;
+        samples.insert(samples.end(), s, s + n);
+        if (gap) gap_samples += n;
+    }
+};
+
+struct LiveBlock {
+    uint32_t first;
+    std::vector<int16_t> samples;
+};
+
+// Passagem rajada -> ao vivo, como na tarefa de envio: a cada bloco
+// capturado a rajada manda 'speedup' vezes mais amostras do histórico
+static bool testBackfill(const std::vector<int16_t> &x, size_t block, size_t speedup) {
+    std::vector<uint8_t> mem(HistoryRing::bytesFor(2, 20000, HistoryFormat::Pcm16));
+    HistoryRing ring(mem.data(), mem.size(), HistoryFormat::Pcm16);
+    stetho::Packetizer pk;
+    pk.configure(247, stetho::StreamCodec::Pcm16, true, 20000);
+    CollectSink sink;
+    stetho::Reassembler reasm(sink);
+    uint8_t packet[stetho::Packetizer::MAX_PAYLOAD];
+    size_t len;
+
+    std::deque<LiveBlock> live; // fila entre captura e envio (16 blocos)
+    size_t overflow = 0, max_live = 0;
+    stetho::BackfillCursor cursor;
+    HistoryRing::Chunk c;
+    const size_t connect_at = x.size() / 2;
+    bool connected = false;
+
+    for (size_t pos = 0; pos + block <= x.size(); pos += block) {
+        ring.write(&x[pos], block, (uint32_t)pos, (uint32_t)pos * 50);
+        if (connected) {
+            if (live.size() == 16) overflow++;
+            else live.push_back({(uint32_t)pos, std::vector<int16_t>(x.begin() + pos, x.begin() + pos + block)});
+        }
+        if (!connected && pos >= connect_at) {
+            connected = true;
+            cursor.start(ring);
+        }
+        if (!connected) continue;
+        max_live = std::max(max_live, live.size());
+
+        if (cursor.active()) {
+            size_t budget = speedup * block;
+            while (budget > 0 && cursor.next(ring, c)) {
+                pk.push(c.samples, c.count, c.first_sample, c.timestamp_us);
+                while (pk.nextPacket(packet, len)) reasm.push(packet, len);
+                budget = budget > c.count ? budget - c.count : 0;
+            }
+            while (!live.empty() &&
+                   stetho::BackfillCursor::coveredByHistory(ring, live.front().first, live.front().samples.size()))
+                live.pop_front();
+            if (cursor.active()) continue;
+        }
+        while (!live.empty()) {
+            const LiveBlock &lb = live.front();
+            const size_t skip = cursor.liveSkip(lb.first, lb.samples.size());
+            if (skip < lb.samples.size())
+                pk.push(lb.samples.data() + skip, lb.samples.size() - skip, lb.first + (uint32_t)skip, 0);
+            live.pop_front();
+        }
+        while (pk.nextPacket(packet, len)) reasm.push(packet, len);
+    }
+    while (pk.flush(packet, len)) reasm.push(packet, len);
+    reasm.flush();
+
+    // Do bloco mais antigo do histórico até o fim, sem buracos nem repetições
+    const size_t first = (size_t)sink.first;
+    const size_t end = x.size() / block * block;
+    bool ok = overflow == 0 && pk.stats().dropped_samples == 0 && sink.gap_samples == 0 && sink.samples.size() == end - first &&
+              std::equal(sink.samples.begin(), sink.samples.end(), x.begin() + first);
+    const double history_s = (double)(connect_at - first) / 20000.0;
+    std::printf("rajada %zux, blocos de %3zu: %.2f s de histórico, fila máx %zu/16, %s\n", speedup, block,
+                history_s, max_live, ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    bool ok = true;
+
+    std::vector<int32_t> raw = bench::makeI2SInput(200000);
+    std::vector<int16_t> x(raw.size());
+    stetho::FilterBank bank(bench::SAMPLE_RATE);
+    for (size_t b = 0; b + bench::BLOCK_SAMPLES <= raw.size(); b += bench::BLOCK_SAMPLES)
+        bank.process(&raw[b], &x[b], bench::BLOCK_SAMPLES);
+
+    ok &= testWraparound(x, HistoryFormat::Pcm16);
+    ok &= testWraparound(x, HistoryFormat::ImaAdpcm);
+    ok &= testConcurrentReads();
+    for (size_t speedup : {2, 4, 8})
+        for (size_t block : {250, 50}) ok &= testBackfill(x, block, speedup);
+
+    // Memória de 5 s de histórico a 20 kHz em cada formato
+    for (HistoryFormat fmt : {HistoryFormat::Pcm16, HistoryFormat::ImaAdpcm})
+        std::printf("5 s a 20 kHz em %s: %zu bytes\n", formatName(fmt), HistoryRing::bytesFor(5, 20000, fmt));
+
+    // Vazão da rajada: ler + decodificar um slot e empacotar (MTU 517, Pcm16 com quadro)
+    bench::printHeader("rajada do histórico (por slot de 256 amostras)");
+    for (HistoryFormat fmt : {HistoryFormat::Pcm16, HistoryFormat::ImaAdpcm}) {
+        std::vector<uint8_t> mem(HistoryRing::bytesFor(5, 20000, fmt));
+        HistoryRing ring(mem.data(), mem.size(), fmt);
+        for (size_t pos = 0; pos + 250 <= x.size(); pos += 250) ring.write(&x[pos], 250, (uint32_t)pos, 0);
+        stetho::Packetizer pk;
+        pk.configure(517, stetho::StreamCodec::Pcm16, true, 20000);
+        uint8_t packet[stetho::Packetizer::MAX_PAYLOAD];
+        size_t len;
+        HistoryRing::Chunk c;
+        const uint64_t oldest = ring.oldest(), span = ring.newest() - oldest;
+        bench::Result r = bench::timeBlocks(HistoryRing::CHUNK_SAMPLES, blocks, [&](size_t b) {
+            if (ring.read(oldest + b % span, c)) {
+                pk.push(c.samples, c.count, (uint32_t)(b * HistoryRing::CHUNK_SAMPLES), 0);
+                while (pk.nextPacket(packet, len)) bench::doNotOptimize(packet[0]);
+            }
+        });
+        bench::printResult(formatName(fmt), r);
+    }
+
+    std::printf("\n%s\n", ok ? "histórico ok" : "FALHA no histórico");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+// Benchmark dos kernels de amostra dos três firmwares atuais.
+// Uso: bench_kernels [blocos]
+
+#include "bench_common.h"
+#include "core/sample_kernels.h"
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    const size_t n = bench::BLOCK_SAMPLES;
+
+    std::vector<int32_t> input = bench::makeI2SInput();
+    const size_t input_blocks = input.size() / n;
+    int16_t out[bench::BLOCK_SAMPLES];
+
+    std::printf("entrada: %zu amostras, bloco de %zu amostras (%.1f ms a %.0f Hz)\n",
+                input.size(), n, 1000.0 * n / bench::SAMPLE_RATE, bench::SAMPLE_RATE);
+    bench::printHeader("kernels de amostra (bloco I2S_BUFFER_SAMPLES)");
+
+    bench::Result r = bench::timeBlocks(n, blocks, [&](size_t b) {
+        stetho::shiftBlock(&input[(b % input_blocks) * n], out, n);
+        bench::doNotOptimize(out);
+    });
+    bench::printResult("shift (without_filter)", r);
+
+    stetho::ClampedLowPass clamped(0.05f);
+    r = bench::timeBlocks(n, blocks, [&](size_t b) {
+        clamped.process(&input[(b % input_blocks) * n], out, n);
+        bench::doNotOptimize(out);
+    });
+    bench::printResult("float clamp a=0.05 (with_filter)", r);
+
+    stetho::RawLowPass raw(0.25f);
+    r = bench::timeBlocks(n, blocks, [&](size_t b) {
+        raw.process(&input[(b % input_blocks) * n], out, n);
+        bench::doNotOptimize(out);
+    });
+    bench::printResult("float raw a=0.25 (current)", r);
+
+    return 0;
+}
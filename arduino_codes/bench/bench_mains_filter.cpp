@@ -0,0 +1,224 @@
+// Bloqueio de DC + cancelador do zumbido da rede (core/mains_filter.h) com
+// som cardíaco sintético somado a um offset DC e ao zumbido de 50/60 Hz com 3
+// harmônicas, fora da nominal e derivando. Confere:
+//  - o offset sai e o passa-baixa (o antigo current_with_filter) deixa de saturar;
+//  - a rejeição do zumbido depois da convergência (saída com zumbido menos a
+//    saída do mesmo som sem zumbido);
+//  - que o som cardíaco sem zumbido passa quase intacto;
+//  - que a frequência estimada segue a da rede;
+// e mede os ciclos por bloco do condicionamento e do pipeline com e sem ele.
+//
+// Uso: bench_mains_filter [blocos]
+
+#include "bench_common.h"
+#include "core/mains_filter.h"
+#include "core/pipeline.h"
+
+constexpr size_t N = bench::BLOCK_SAMPLES;
+constexpr double FS = bench::SAMPLE_RATE;
+constexpr double SECONDS = 10.0;
+// Trecho final em que a convergência já aconteceu
+constexpr double SETTLED_SECONDS = 4.0;
+// Fundo de escala do som cardíaco, do offset do microfone e do zumbido
+constexpr double HEART_GAIN = 0.25;
+constexpr double DC_OFFSET = 0.2;
+constexpr double HUM_AMPLITUDE = 0.02;
+constexpr double HUM_HARMONICS[stetho::MAINS_HARMONICS] = {1.0, 0.5, 0.3, 0.2};
+
+constexpr double MIN_REJECTION_DB = 30.0;
+constexpr double MIN_HEART_SNR_DB = 30.0;
+constexpr double MAX_FREQ_ERROR_HZ = 0.05;
+constexpr double MAX_IDLE_DRIFT_HZ = 0.1;
+
+// Zumbido com a frequência indo de f0 a f1 ao longo do sinal, fase contínua
+static std::vector<double> makeHum(size_t n, double f0, double f1) {
+    std::vector<double> hum(n);
+    double phase = 0.3;
+    for (size_t i = 0; i < n; i++) {
+        const double f = f0 + (f1 - f0) * (double)i / (double)n;
+        double v = 0.0;
+        for (size_t k = 0; k < stetho::MAINS_HARMONICS; k++)
+            v += HUM_HARMONICS[k] * std::cos((double)(k + 1) * phase + 0.7 * (double)k);
+        hum[i] = HUM_AMPLITUDE * v;
+        phase += 2.0 * M_PI * f / FS;
+    }
+    return hum;
+}
+
+static std::vector<double> makeHeart(size_t n) {
+    std::vector<double> x = bench::makeHeartSignal(n);
+    for (double &v : x) v *= HEART_GAIN;
+    return x;
+}
+
+struct Output {
+    std::vector<double> y; // escala do >> 14
+    double freq_hz = 0.0;
+    int32_t dc_offset = 0;
+};
+
+// Soma as partes em palavras I2S e filtra em blocos como a tarefa de captura
+template <int MAINS_HZ>
+static Output runFilter(const std::vector<double> &heart, const std::vector<double> *hum, double dc) {
+    stetho::MainsConditioning<MAINS_HZ> filter(FS);
+    std::vector<double> x(heart.size());
+    for (size_t i = 0; i < x.size(); i++) x[i] = heart[i] + dc + (hum ? (*hum)[i] : 0.0);
+    std::vector<int32_t> words = bench::toI2SWords(x, 1.0);
+    Output out;
+    out.y.resize(words.size());
+    for (size_t blk = 0; blk + N <= words.size(); blk += N) {
+        filter.process(&words[blk], N);
+        for (size_t i = 0; i < N; i++) out.y[blk + i] = (double)words[blk + i] / (1 << stetho::I2S_TO_INT16_SHIFT);
+    }
+    out.freq_hz = filter.frequency();
+    out.dc_offset = filter.dcOffset();
+    return out;
+}
+
+// Energia de 'a - b' contra a de 'ref' no trecho final, em dB
+static double ratioDb(const std::vector<double> &ref, const std::vector<double> &a, const std::vector<double> &b) {
+    const size_t from = ref.size() - (size_t)(SETTLED_SECONDS * FS);
+    double num = 0.0, den = 0.0;
+    for (size_t i = from; i < ref.size(); i++) {
+        num += ref[i] * ref[i];
+        const double d = a[i] - b[i];
+        den += d * d;
+    }
+    return den > 0.0 ? 10.0 * std::log10(num / den) : INFINITY;
+}
+
+static std::vector<double> toInt16Scale(const std::vector<double> &x) {
+    std::vector<double> y(x.size());
+    const double s = 2147483648.0 / (1 << stetho::I2S_TO_INT16_SHIFT);
+    for (size_t i = 0; i < x.size(); i++) y[i] = x[i] * s;
+    return y;
+}
+
+//================================================================
+// --- REJEIÇÃO E RASTREIO ---
+//================================================================
+template <int MAINS_HZ>
+static bool hum(const char *title, double f0, double f1) {
+    const size_t n = (size_t)(SECONDS * FS);
+    const std::vector<double> heart = makeHeart(n);
+    const std::vector<double> hum = makeHum(n, f0, f1);
+    const Output with = runFilter<MAINS_HZ>(heart, &hum, DC_OFFSET);
+    const Output without = runFilter<MAINS_HZ>(heart, nullptr, DC_OFFSET);
+
+    const double rejection = ratioDb(toInt16Scale(hum), with.y, without.y);
+    const double freq_error = std::fabs(with.freq_hz - f1);
+    const bool ok = rejection >= MIN_REJECTION_DB && freq_error <= MAX_FREQ_ERROR_HZ;
+    std::printf("%-38s rejeição %5.1f dB, rede %.3f Hz estimada %.3f Hz %s\n", title, rejection, f1, with.freq_hz,
+                ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+//================================================================
+// --- SOM CARDÍACO E OFFSET DC ---
+//================================================================
+static bool heartAndDc() {
+    const size_t n = (size_t)(SECONDS * FS);
+    const std::vector<double> heart = makeHeart(n);
+    const Output out = runFilter<60>(heart, nullptr, DC_OFFSET);
+
+    // Referência: o mesmo som só com o bloqueio de DC, que também tira a
+    // média do próprio makeHeartSignal; a diferença é o que o cancelador mexeu
+    std::vector<double> ref(n);
+    {
+        const std::vector<int32_t> words = bench::toI2SWords(heart, 1.0);
+        int64_t dc = (int64_t)words[0] << stetho::DC_BLOCK_SHIFT;
+        for (size_t i = 0; i < n; i++) {
+            dc += words[i] - (dc >> stetho::DC_BLOCK_SHIFT);
+            ref[i] = (double)(words[i] - (dc >> stetho::DC_BLOCK_SHIFT)) / (1 << stetho::I2S_TO_INT16_SHIFT);
+        }
+    }
+    const double snr = ratioDb(ref, ref, out.y);
+
+    double residual_dc = 0.0;
+    const size_t from = n - (size_t)(SETTLED_SECONDS * FS);
+    for (size_t i = from; i < n; i++) residual_dc += out.y[i];
+    residual_dc /= (double)(n - from);
+    const double drift = std::fabs(out.freq_hz - 60.0);
+
+    // O passa-baixa do antigo current_with_filter satura com o offset e deixa de saturar sem ele
+    std::vector<double> x(n);
+    for (size_t i = 0; i < n; i++) x[i] = heart[i] + DC_OFFSET;
+    size_t sat_before = 0, sat_after = 0;
+    for (int conditioned = 0; conditioned < 2; conditioned++) {
+        std::vector<int32_t> words = bench::toI2SWords(x, 1.0);
+        stetho::MainsConditioning<60> filter(FS);
+        stetho::LowPassFrontEnd front;
+        int16_t pcm[N];
+        for (size_t blk = 0; blk + N <= n; blk += N) {
+            if (conditioned) filter.process(&words[blk], N);
+            front.process(&words[blk], pcm, N);
+            for (size_t i = 0; i < N; i++) (conditioned ? sat_after : sat_before) += pcm[i] == 32767 || pcm[i] == -32768;
+        }
+    }
+
+    const bool ok = snr >= MIN_HEART_SNR_DB && std::fabs(residual_dc) < 1.0 && drift <= MAX_IDLE_DRIFT_HZ &&
+                    sat_before > 0 && sat_after == 0;
+    std::printf("som cardíaco sem zumbido: SNR %.1f dB, DC residual %.2f LSB (offset %.0f LSB), "
+                "frequência parada em %.3f Hz\n",
+                snr, residual_dc, DC_OFFSET * 2147483648.0 / (1 << stetho::I2S_TO_INT16_SHIFT), out.freq_hz);
+    std::printf("passa-baixa (with_filter) com offset: %zu amostras saturadas, %zu com o bloqueio de DC %s\n",
+                sat_before, sat_after, ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+//================================================================
+// --- CUSTO POR BLOCO ---
+//================================================================
+template <class P>
+static bench::Result timePath(P &path, const std::vector<int32_t> &input, size_t blocks) {
+    const size_t total_blocks = input.size() / N;
+    int32_t dma[N];
+    int16_t slot[N + 1];
+    size_t out = 0;
+    bench::Result r = bench::timeBlocks(N, blocks, [&](size_t blk) {
+        std::memcpy(dma, &input[(blk % total_blocks) * N], sizeof(dma));
+        out += path(dma, slot);
+        bench::doNotOptimize(slot);
+    });
+    bench::doNotOptimize(out);
+    return r;
+}
+
+static void cost(size_t blocks) {
+    std::vector<double> x = makeHeart(80000);
+    const std::vector<double> h = makeHum(x.size(), 60.3, 60.3);
+    for (size_t i = 0; i < x.size(); i++) x[i] += h[i] + DC_OFFSET;
+    const std::vector<int32_t> input = bench::toI2SWords(x, 1.0);
+
+    bench::printHeader("condicionamento por bloco (20000 Hz)");
+    stetho::MainsConditioning<60> filter(FS);
+    auto only = [&](int32_t *dma, int16_t *) {
+        filter.process(dma, N);
+        return N;
+    };
+    stetho::CapturePipeline<stetho::BiquadFrontEnd, stetho::FixedRate> plain(FS, stetho::FilterMode::Heart);
+    auto without = [&](int32_t *dma, int16_t *slot) { return plain.process(dma, slot, N); };
+    stetho::CapturePipeline<stetho::BiquadFrontEnd, stetho::FixedRate, stetho::FixedScaling,
+                            stetho::MainsConditioning<60>>
+        conditioned(FS, stetho::FilterMode::Heart);
+    auto with = [&](int32_t *dma, int16_t *slot) { return conditioned.process(dma, slot, N); };
+
+    bench::printResult("DC + rede (4 harmônicas)", timePath(only, input, blocks));
+    bench::printResult("biquads", timePath(without, input, blocks));
+    bench::printResult("DC + rede + biquads", timePath(with, input, blocks));
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    bool ok = true;
+
+    ok &= heartAndDc();
+    ok &= hum<60>("60 Hz nominal, rede em 60,4 Hz", 60.4, 60.4);
+    ok &= hum<60>("60 Hz, deriva 59,9 -> 60,05 Hz", 59.9, 60.05);
+    ok &= hum<50>("50 Hz nominal, deriva 50,2 -> 50,1 Hz", 50.2, 50.1);
+
+    cost(blocks);
+
+    std::printf("\n%s\n", ok ? "OK" : "FALHOU");
+    return ok ? 0 : 1;
+}
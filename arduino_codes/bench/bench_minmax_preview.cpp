@@ -0,0 +1,219 @@
+// Prévia min/max do gráfico ao vivo: confere os pares contra o
+// downsampleData do SkiaLineChart (pico por balde) e contra um min/max
+// escalar, e mede o custo por bloco do gerador.
+//
+// Uso: bench_minmax_preview [blocos]
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "bench_common.h"
+#include "core/biquad.h"
+#include "core/minmax_preview.h"
+
+using stetho::MinMaxPreview;
+
+// Porte direto do downsampleData de src/components/SkiaLineChart: em cada
+// balde fica a amostra de maior módulo (a primeira, em caso de empate)
+static std::vector<int16_t> downsampleData(const std::vector<int16_t> &data, size_t target) {
+    if (data.size() <= target || target == 0) return data;
+    std::vector<int16_t> out;
+    const double bucket_size = (double)data.size() / (double)target;
+    for (size_t i = 0; i < target; i++) {
+        const size_t start = (size_t)(i * bucket_size), end = (size_t)((i + 1) * bucket_size);
+        if (end <= start) continue;
+        int16_t peak = data[start];
+        for (size_t j = start + 1; j < end; j++)
+            if (std::abs(data[j]) > std::abs(peak)) peak = data[j];
+        out.push_back(peak);
+    }
+    return out;
+}
+
+struct Pair {
+    int16_t lo, hi;
+};
+
+// Passa o stream em pedaços de tamanhos variados e junta os pares de todas
+// as notificações, conferindo o índice de cada uma
+static bool collect(MinMaxPreview &pv, const std::vector<int16_t> &x, uint32_t first, const size_t *chunks,
+                    size_t nchunks, std::vector<Pair> &pairs, std::vector<uint32_t> &starts) {
+    uint8_t packet[stetho::PREVIEW_HEADER + MinMaxPreview::MAX_PAIRS * stetho::PREVIEW_PAIR_BYTES];
+    size_t pos = 0, c = 0;
+    while (pos < x.size()) {
+        const size_t n = std::min(chunks[c++ % nchunks], x.size() - pos);
+        size_t done = 0;
+        while (done < n) {
+            done += pv.feed(&x[pos + done], n - done, first + (uint32_t)(pos + done));
+            if (pv.hasPacket()) {
+                const size_t len = pv.takePacket(packet);
+                if (packet[0] != stetho::PREVIEW_VERSION || stetho::getLe16(packet + 2) != pv.bucket()) return false;
+                starts.push_back(stetho::getLe32(packet + 4));
+                for (size_t p = stetho::PREVIEW_HEADER; p < len; p += stetho::PREVIEW_PAIR_BYTES)
+                    pairs.push_back({(int16_t)stetho::getLe16(packet + p), (int16_t)stetho::getLe16(packet + p + 2)});
+            }
+        }
+        pos += n;
+    }
+    return true;
+}
+
+static bool testAgainstPeakPicking(const std::vector<int16_t> &x) {
+    // Janela de 1 s a 20 kHz em 400 pares/s, como o gráfico com 400 pontos
+    const std::vector<int16_t> window(x.begin(), x.begin() + 20000);
+    const std::vector<int16_t> peaks = downsampleData(window, 400);
+
+    MinMaxPreview pv;
+    pv.configure(50, 40);
+    std::vector<Pair> pairs;
+    std::vector<uint32_t> starts;
+    const size_t chunks[] = {250};
+    bool ok = collect(pv, window, 0, chunks, 1, pairs, starts) && pairs.size() == peaks.size();
+    size_t covered = 0;
+    for (size_t i = 0; ok && i < pairs.size(); i++) {
+        const Pair &p = pairs[i];
+        const bool is_extreme = peaks[i] == p.lo || peaks[i] == p.hi;
+        const bool same_abs = std::abs(peaks[i]) == std::max(std::abs(p.lo), std::abs(p.hi));
+        if (is_extreme && same_abs) covered++;
+        else ok = false;
+    }
+    std::printf("pico do downsampleData (20.000 -> 400) entre os extremos: %zu/%zu %s\n", covered, peaks.size(),
+                ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+static bool testChunking(const std::vector<int16_t> &x) {
+    bool ok = true;
+    const size_t chunk_sets[][4] = {{250, 250, 250, 250}, {1, 7, 33, 250}, {333, 17, 1000, 3}};
+    for (size_t bucket : {1, 10, 50, 64}) {
+        for (const auto &chunks : chunk_sets) {
+            MinMaxPreview pv;
+            pv.configure(bucket, 13);
+            std::vector<Pair> pairs;
+            std::vector<uint32_t> starts;
+            ok &= collect(pv, x, 777, chunks, 4, pairs, starts);
+            // Os pares que não completam a última notificação ficam pendentes
+            ok &= pairs.size() == x.size() / bucket / 13 * 13;
+            for (size_t i = 0; ok && i < pairs.size(); i++) {
+                const auto mm = std::minmax_element(x.begin() + i * bucket, x.begin() + (i + 1) * bucket);
+                ok = pairs[i].lo == *mm.first && pairs[i].hi == *mm.second;
+            }
+            for (size_t i = 0; ok && i < starts.size(); i++) ok = starts[i] == 777 + i * 13 * bucket;
+        }
+    }
+
+    // Salto de índice no meio de um par: os pares completos saem, o incompleto se perde
+    MinMaxPreview pv;
+    pv.configure(50, 40);
+    uint8_t packet[stetho::PREVIEW_HEADER + MinMaxPreview::MAX_PAIRS * stetho::PREVIEW_PAIR_BYTES];
+    size_t used = pv.feed(x.data(), 120, 0); // 2 pares + 20 amostras
+    ok &= used == 120 && !pv.hasPacket();
+    ok &= pv.feed(x.data() + 120, 100, 5000) == 0 && pv.hasPacket();
+    ok &= pv.takePacket(packet) == stetho::PREVIEW_HEADER + 2 * stetho::PREVIEW_PAIR_BYTES &&
+          stetho::getLe32(packet + 4) == 0;
+    for (size_t done = 0; done < 2000;) {
+        done += pv.feed(x.data() + done, 2000 - done, 5000 + (uint32_t)done);
+        if (pv.hasPacket()) {
+            pv.takePacket(packet);
+            ok &= stetho::getLe32(packet + 4) == 5000;
+            break;
+        }
+    }
+    std::printf("pedaços variados, baldes de 1 a 64 e saltos de índice: %s\n", ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+// Pares pedidos acima do limite: a notificação cheia cabe no buffer de pacote do firmware
+static bool testMaxPairs(const std::vector<int16_t> &x) {
+    MinMaxPreview pv;
+    pv.configure(4, 100000);
+    bool ok = pv.pairsPerPacket() == MinMaxPreview::MAX_PAIRS;
+    constexpr uint8_t GUARD = 0xA5;
+    uint8_t packet[stetho::Packetizer::MAX_PAYLOAD + 16];
+    std::memset(packet, GUARD, sizeof(packet));
+    size_t len = 0;
+    for (size_t done = 0; done < x.size() && len == 0;) {
+        done += pv.feed(x.data() + done, x.size() - done, (uint32_t)done);
+        if (pv.hasPacket()) len = pv.takePacket(packet);
+    }
+    ok &= len == stetho::PREVIEW_HEADER + MinMaxPreview::MAX_PAIRS * stetho::PREVIEW_PAIR_BYTES &&
+          len <= stetho::Packetizer::MAX_PAYLOAD;
+    for (size_t i = stetho::Packetizer::MAX_PAYLOAD; i < sizeof(packet); i++) ok &= packet[i] == GUARD;
+    std::printf("máximo de pares por notificação (%zu, %zu bytes): %s\n", MinMaxPreview::MAX_PAIRS, len,
+                ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+// Referência de custo: min/max amostra a amostra com desvios
+struct ScalarPreview {
+    size_t bucket = 50, fill = 0;
+    int16_t lo = 0, hi = 0;
+    std::vector<Pair> out;
+    void push(const int16_t *x, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            if (fill == 0) lo = hi = x[i];
+            if (x[i] < lo) lo = x[i];
+            if (x[i] > hi) hi = x[i];
+            if (++fill == bucket) {
+                out.push_back({lo, hi});
+                fill = 0;
+            }
+        }
+    }
+};
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    bool ok = true;
+
+    std::vector<int32_t> raw = bench::makeI2SInput(200000);
+    std::vector<int16_t> x(raw.size());
+    stetho::FilterBank bank(bench::SAMPLE_RATE, stetho::FilterMode::Heart);
+    for (size_t b = 0; b + bench::BLOCK_SAMPLES <= raw.size(); b += bench::BLOCK_SAMPLES)
+        bank.process(&raw[b], &x[b], bench::BLOCK_SAMPLES);
+
+    ok &= testAgainstPeakPicking(x);
+    ok &= testChunking(x);
+    ok &= testMaxPairs(x);
+
+    const size_t total_blocks = x.size() / bench::BLOCK_SAMPLES;
+    bench::printHeader("prévia min/max (400 pares/s a 20 kHz)");
+    {
+        ScalarPreview sp;
+        bench::Result r = bench::timeBlocks(bench::BLOCK_SAMPLES, blocks, [&](size_t b) {
+            sp.push(&x[(b % total_blocks) * bench::BLOCK_SAMPLES], bench::BLOCK_SAMPLES);
+            if (sp.out.size() > 4096) sp.out.clear();
+        });
+        bench::printResult("escalar (amostra a amostra)", r);
+    }
+    {
+        MinMaxPreview pv;
+        pv.configure(50, 40);
+        uint8_t packet[stetho::PREVIEW_HEADER + MinMaxPreview::MAX_PAIRS * stetho::PREVIEW_PAIR_BYTES];
+        uint32_t index = 0;
+        bench::Result r = bench::timeBlocks(bench::BLOCK_SAMPLES, blocks, [&](size_t b) {
+            const int16_t *blk = &x[(b % total_blocks) * bench::BLOCK_SAMPLES];
+            for (size_t done = 0; done < bench::BLOCK_SAMPLES;) {
+                done += pv.feed(blk + done, bench::BLOCK_SAMPLES - done, index + (uint32_t)done);
+                if (pv.hasPacket()) bench::doNotOptimize(pv.takePacket(packet));
+            }
+            index += bench::BLOCK_SAMPLES;
+        });
+        bench::printResult("MinMaxPreview (por balde)", r);
+    }
+    {
+        // O que o app faz hoje a cada redesenho: 20.000 amostras -> 400 pontos
+        const std::vector<int16_t> window(x.begin(), x.begin() + 20000);
+        bench::Result r = bench::timeBlocks(20000, blocks / 80 + 1, [&](size_t) {
+            bench::doNotOptimize(downsampleData(window, 400));
+        });
+        std::printf("%-32s %14.1f ns por redesenho (1 s de janela)\n", "downsampleData no app", r.ns_per_block);
+    }
+
+    // Banda da característica: 400 pares/s em notificações de 40 pares
+    const double bytes_per_s = 10.0 * (stetho::PREVIEW_HEADER + 40 * stetho::PREVIEW_PAIR_BYTES);
+    std::printf("prévia a 400 pares/s: %.0f bytes/s (áudio Pcm16 a 20 kHz: 40000 bytes/s)\n", bytes_per_s);
+
+    std::printf("\n%s\n", ok ? "OK" : "FALHOU");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+// Cancelador de ruído ambiente com dois microfones (core/noise_canceller.h)
+// sobre gravações sintéticas misturadas: som cardíaco no peito mais um ruído
+// ambiente modulado (conversa/ventilador: passa-faixa com envelope de 3,3 Hz)
+// que chega ao peito por um caminho FIR curto, e o mesmo ruído no microfone de
+// fora com um ruído próprio. Confere:
+//  - a atenuação do ambiente depois da convergência, em três níveis;
+//  - o tempo até a atenuação passar de CONVERGED_DB (ou chegar a
+//    CONVERGED_MARGIN_DB da final, com o ambiente fraco);
+//  - que o som cardíaco sem ambiente passa quase intacto;
+//  - a ida e volta dos quadros L/R e dos pares intercalados;
+// e mede os ciclos por bloco do cancelador e do pipeline estéreo.
+//
+// Uso: bench_noise_canceller [blocos]
+
+#include "bench_common.h"
+#include "core/noise_canceller.h"
+#include "core/pipeline.h"
+
+constexpr size_t N = bench::BLOCK_SAMPLES;
+constexpr double FS = bench::SAMPLE_RATE;
+constexpr double SECONDS = 10.0;
+// Trecho final em que a convergência já aconteceu
+constexpr double SETTLED_SECONDS = 4.0;
+constexpr double HEART_GAIN = 0.25;
+// Caminho do ambiente até o peito (atraso de 3 amostras e eco curto)
+constexpr size_t PATH_TAPS = 6;
+constexpr double AMBIENT_PATH[PATH_TAPS] = {0.0, 0.0, 0.0, 0.5, 0.3, -0.2};
+// Ruído próprio do microfone de fora, em fundo de escala
+constexpr double REFERENCE_NOISE = 0.0005;
+
+constexpr double CONVERGED_DB = 20.0;
+constexpr double CONVERGED_MARGIN_DB = 3.0;
+constexpr double MAX_CONVERGENCE_SECONDS = 2.0;
+constexpr double MIN_HEART_SNR_DB = 40.0;
+// Escala do >> 14 em fundo de escala
+constexpr double INT16_SCALE = 2147483648.0 / (1 << stetho::I2S_TO_INT16_SHIFT);
+
+struct Recording {
+    std::vector<double> heart;   // parte cardíaca do peito
+    std::vector<double> coupled; // parte do ambiente no peito
+    std::vector<int32_t> chest;
+    std::vector<int32_t> outside;
+};
+
+static Recording makeRecording(size_t n, double ambient) {
+    Recording r;
+    r.heart = bench::makeHeartSignal(n);
+    bench::Rng rng(7);
+    std::vector<double> a(n), outside(n), chest(n);
+    double lp = 0.0, prev = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        const double t = (double)i / FS;
+        double env = 0.5 + 0.5 * std::sin(2.0 * M_PI * 3.3 * t);
+        env *= env;
+        lp += 0.3 * (rng.uniform() - lp);
+        const double band = lp - prev;
+        prev = lp;
+        a[i] = 3.0 * ambient * env * band;
+    }
+    r.coupled.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        double c = 0.0;
+        for (size_t k = 0; k < PATH_TAPS && k <= i; k++) c += AMBIENT_PATH[k] * a[i - k];
+        r.coupled[i] = c;
+        // Sem o offset do makeHeartSignal: o bloqueio de DC roda antes na captura
+        r.heart[i] = HEART_GAIN * (r.heart[i] - 0.02);
+        chest[i] = r.heart[i] + c;
+        outside[i] = a[i] + REFERENCE_NOISE * rng.uniform();
+    }
+    r.chest = bench::toI2SWords(chest, 1.0);
+    r.outside = bench::toI2SWords(outside, 1.0);
+    return r;
+}
+
+// Cancela em blocos como a tarefa de captura; a saída fica em r.chest
+static void runCanceller(Recording &r) {
+    stetho::NoiseCanceller canceller;
+    for (size_t blk = 0; blk + N <= r.chest.size(); blk += N) canceller.process(&r.chest[blk], &r.outside[blk], N);
+}
+
+// Ambiente no peito contra o que sobrou dele na saída, em [from, to), em dB
+static double attenuationDb(const Recording &r, size_t from, size_t to) {
+    double num = 0.0, den = 0.0;
+    for (size_t i = from; i < to; i++) {
+        const double c = r.coupled[i] * INT16_SCALE;
+        num += c * c;
+        const double e = (double)r.chest[i] / (1 << stetho::I2S_TO_INT16_SHIFT) - r.heart[i] * INT16_SCALE;
+        den += e * e;
+    }
+    return den > 0.0 ? 10.0 * std::log10(num / den) : INFINITY;
+}
+
+//================================================================
+// --- ATENUAÇÃO E CONVERGÊNCIA ---
+//================================================================
+static bool attenuation(const char *title, double ambient, double min_db) {
+    const size_t n = (size_t)(SECONDS * FS);
+    Recording r = makeRecording(n, ambient);
+    runCanceller(r);
+    const double settled = attenuationDb(r, n - (size_t)(SETTLED_SECONDS * FS), n);
+
+    // Primeira janela de 0,25 s acima do limiar
+    const double target = std::fmin(CONVERGED_DB, settled - CONVERGED_MARGIN_DB);
+    const size_t window = (size_t)(0.25 * FS);
+    double converged_s = INFINITY;
+    for (size_t from = 0; from + window <= n; from += window) {
+        if (attenuationDb(r, from, from + window) >= target) {
+            converged_s = (double)(from + window) / FS;
+            break;
+        }
+    }
+    const bool ok = settled >= min_db && converged_s <= MAX_CONVERGENCE_SECONDS;
+    std::printf("%-34s atenuação %5.1f dB (mín %.0f), %.1f dB em %.2f s %s\n", title, settled, min_db, target,
+                converged_s, ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+//================================================================
+// --- SOM CARDÍACO SEM AMBIENTE ---
+//================================================================
+// Só o ruído próprio do microfone de fora: os pesos não podem aprender o
+// som cardíaco, que não está na referência
+static bool heartOnly() {
+    const size_t n = (size_t)(SECONDS * FS);
+    Recording r = makeRecording(n, 0.0);
+    std::vector<int32_t> before = r.chest;
+    runCanceller(r);
+    double num = 0.0, den = 0.0;
+    for (size_t i = n - (size_t)(SETTLED_SECONDS * FS); i < n; i++) {
+        const double x = (double)before[i], d = (double)r.chest[i] - x;
+        num += x * x;
+        den += d * d;
+    }
+    const double snr = den > 0.0 ? 10.0 * std::log10(num / den) : INFINITY;
+    const bool ok = snr >= MIN_HEART_SNR_DB;
+    std::printf("%-34s SNR %5.1f dB (mín %.0f) %s\n", "som cardíaco sem ambiente", snr, MIN_HEART_SNR_DB,
+                ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+//================================================================
+// --- QUADROS L/R E PARES INTERCALADOS ---
+//================================================================
+static bool interleaving() {
+    constexpr size_t n = N;
+    int32_t frames[2 * n], right[n];
+    for (size_t i = 0; i < 2 * n; i++) frames[i] = (int32_t)(i * 2654435761u);
+    int32_t expected[2 * n];
+    std::memcpy(expected, frames, sizeof(frames));
+    stetho::deinterleaveFrames(frames, right, n);
+    bool ok = true;
+    for (size_t i = 0; i < n; i++) ok &= frames[i] == expected[2 * i] && right[i] == expected[2 * i + 1];
+
+    int16_t buf[2 * n], b[n];
+    for (size_t i = 0; i < n; i++) {
+        buf[i] = (int16_t)(i * 3);
+        b[i] = (int16_t)(-(int)i);
+    }
+    stetho::interleavePairs(buf, b, n);
+    for (size_t i = 0; i < n; i++) ok &= buf[2 * i] == (int16_t)(i * 3) && buf[2 * i + 1] == (int16_t)(-(int)i);
+    std::printf("%-34s %s\n", "quadros L/R e pares intercalados", ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+//================================================================
+// --- CUSTO POR BLOCO ---
+//================================================================
+static void cost(size_t blocks) {
+    const size_t n = 80000;
+    const Recording r = makeRecording(n, 0.05);
+    std::vector<int32_t> frames(2 * n);
+    for (size_t i = 0; i < n; i++) {
+        frames[2 * i] = r.chest[i];
+        frames[2 * i + 1] = r.outside[i];
+    }
+    const size_t total_blocks = n / N;
+
+    bench::printHeader("cancelador por bloco (20000 Hz)");
+    {
+        stetho::NoiseCanceller canceller;
+        int32_t chest[N];
+        bench::Result res = bench::timeBlocks(N, blocks, [&](size_t blk) {
+            const size_t at = (blk % total_blocks) * N;
+            std::memcpy(chest, &r.chest[at], sizeof(chest));
+            canceller.process(chest, &r.outside[at], N);
+            bench::doNotOptimize(chest);
+        });
+        bench::printResult("NLMS 32 coeficientes", res);
+    }
+
+    using Mains = stetho::MainsConditioning<60>;
+    stetho::CapturePipeline<stetho::BiquadFrontEnd, stetho::FixedRate, stetho::FixedScaling, Mains> mono(
+        FS, stetho::FilterMode::Heart);
+    stetho::CapturePipeline<stetho::BiquadFrontEnd, stetho::FixedRate, stetho::FixedScaling,
+                            stetho::DualMicConditioning<Mains>>
+        stereo(FS, stetho::FilterMode::Heart);
+    int32_t dma[2 * N];
+    int16_t slot[N + 1];
+    size_t out = 0;
+    bench::Result res = bench::timeBlocks(N, blocks, [&](size_t blk) {
+        std::memcpy(dma, &r.chest[(blk % total_blocks) * N], N * sizeof(int32_t));
+        out += mono.process(dma, slot, N);
+        bench::doNotOptimize(slot);
+    });
+    bench::printResult("DC + rede + biquads (1 mic)", res);
+    for (stetho::StereoMode mode : {stetho::StereoMode::Bypass, stetho::StereoMode::Cancel}) {
+        stereo.conditioning().requestMode(mode);
+        res = bench::timeBlocks(N, blocks, [&](size_t blk) {
+            std::memcpy(dma, &frames[(blk % total_blocks) * 2 * N], sizeof(dma));
+            out += stereo.process(dma, slot, N);
+            bench::doNotOptimize(slot);
+        });
+        bench::printResult(mode == stetho::StereoMode::Cancel ? "2 mics + NLMS + biquads" : "2 mics sem NLMS + biquads",
+                           res);
+    }
+    bench::doNotOptimize(out);
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    bool ok = true;
+
+    ok &= attenuation("ambiente forte (0,2)", 0.2, 30.0);
+    ok &= attenuation("ambiente moderado (0,05)", 0.05, 25.0);
+    ok &= attenuation("ambiente fraco (0,01)", 0.01, 12.0);
+    ok &= heartOnly();
+    ok &= interleaving();
+
+    cost(blocks);
+
+    std::printf("\n%s\n", ok ? "OK" : "FALHOU");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+// Empacotador ciente do MTU: para cada MTU, codec e taxa de saída confere
+// que nenhuma notificação passa de MTU - 3 bytes, que os pacotes cheios de
+// Pcm16/ADPCM ocupam o payload inteiro e que o stream remontado (com e sem
+// blocos descartados no dispositivo) é o original. Reporta pacotes/s,
+// eficiência do payload e o custo de push + pacotes por bloco.
+// Uso: bench_packetizer [blocos]
+
+#include "bench_common.h"
+#include "core/biquad.h"
+#include "core/packetizer.h"
+#include "core/reassembler.h"
+
+struct CollectSink : stetho::ReassemblerSink {
+    std::vector<int16_t> samples;
+    size_t gap_samples = 0;
+    void onSamples(uint64_t, const int16_t *s, size_t n, bool gap) override {
+        samples.insert(samples.end(), s, s + n);
+        if (gap) gap_samples += n;
+    }
+};
+
+struct RunResult {
+    bool ok = true;
+    size_t packets = 0;
+    double efficiency = 0.0;
+    size_t discontinuities = 0;
+};
+
+// Alimenta o empacotador com blocos de 'block' amostras e remonta os quadros;
+// 'drop_every' > 0 descarta um bloco a cada 'drop_every' (fila cheia no dispositivo)
+static RunResult run(const std::vector<int16_t> &x, uint16_t mtu, stetho::StreamCodec codec, bool framed,
+                     size_t block, size_t drop_every) {
+    RunResult res;
+    stetho::Packetizer pk;
+    pk.configure(mtu, codec, framed, 20000);
+    CollectSink sink;
+    stetho::Reassembler reasm(sink);
+    std::vector<uint8_t> concat;
+    std::vector<int16_t> expected;
+    const size_t cap = (size_t)mtu - stetho::Packetizer::ATT_OVERHEAD;
+    // Pacote cheio exato: ADPCM sempre; Pcm16 quando o payload é par
+    const size_t payload_cap = pk.payloadCapacity();
+    const bool exact = codec == stetho::StreamCodec::ImaAdpcm ||
+                       (codec == stetho::StreamCodec::Pcm16 && payload_cap % 2 == 0);
+
+    uint8_t packet[stetho::Packetizer::MAX_PAYLOAD];
+    size_t len = 0;
+    auto take = [&](bool full) {
+        res.packets++;
+        if (len > cap) res.ok = false;
+        // Antes de uma descontinuidade o pacote sai curto de propósito
+        if (full && exact && !drop_every && len != cap && payload_cap / 2 <= stetho::Packetizer::MAX_PACKET_SAMPLES) res.ok = false;
+        if (framed) {
+            stetho::FrameHeader h;
+            if (stetho::readFrameHeader(packet, len, h) && (h.flags & stetho::FRAME_FLAG_DISCONTINUITY))
+                res.discontinuities++;
+            reasm.push(packet, len);
+        } else {
+            concat.insert(concat.end(), packet, packet + len);
+        }
+    };
+
+    size_t blocks = 0;
+    for (size_t b = 0; b + block <= x.size(); b += block, blocks++) {
+        if (drop_every && blocks % drop_every == drop_every - 1) {
+            expected.insert(expected.end(), block, 0);
+            continue;
+        }
+        expected.insert(expected.end(), x.begin() + b, x.begin() + b + block);
+        pk.push(&x[b], block, (uint32_t)b, (uint32_t)(b * 50));
+        while (pk.nextPacket(packet, len)) take(true);
+    }
+    while (pk.flush(packet, len)) take(false);
+    reasm.flush();
+    // O último bloco descartado não aparece no receptor
+    while (!expected.empty() && drop_every && blocks % drop_every == 0 && expected.size() > sink.samples.size())
+        expected.pop_back();
+
+    if (framed) {
+        if (codec == stetho::StreamCodec::ImaAdpcm) {
+            res.ok = res.ok && sink.samples.size() == expected.size();
+        } else {
+            res.ok = res.ok && sink.samples == expected;
+        }
+        size_t dropped = drop_every ? (blocks / drop_every) * block : 0;
+        if (drop_every && blocks % drop_every == 0) dropped -= block;
+        res.ok = res.ok && sink.gap_samples == dropped;
+        if (drop_every && res.discontinuities == 0) res.ok = false;
+    } else if (codec == stetho::StreamCodec::Pcm16) {
+        // Stream legado: a concatenação das notificações é o stream original
+        std::vector<int16_t> got(concat.size() / 2);
+        for (size_t i = 0; i < got.size(); i++) got[i] = (int16_t)stetho::getLe16(&concat[2 * i]);
+        res.ok = res.ok && got == expected;
+    }
+    res.efficiency = pk.stats().efficiency();
+    if (pk.stats().dropped_samples != 0) res.ok = false;
+    return res;
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    bool ok = true;
+
+    std::vector<int32_t> raw = bench::makeI2SInput();
+    std::vector<int16_t> x(raw.size());
+    stetho::FilterBank bank(bench::SAMPLE_RATE, stetho::FilterMode::Heart);
+    for (size_t b = 0; b + bench::BLOCK_SAMPLES <= raw.size(); b += bench::BLOCK_SAMPLES)
+        bank.process(&raw[b], &x[b], bench::BLOCK_SAMPLES);
+    const double seconds = (double)x.size() / bench::SAMPLE_RATE;
+
+    const uint16_t mtus[] = {23, 27, 64, 158, 185, 247, 251, 512, 517};
+    const stetho::StreamCodec codecs[] = {stetho::StreamCodec::Pcm16, stetho::StreamCodec::Rice,
+                                          stetho::StreamCodec::ImaAdpcm};
+    const char *codec_names[] = {"pcm16", "rice", "adpcm"};
+
+    // Stream a 20 kHz em blocos de 250 (como o i2s_read) e de 50 amostras
+    // (4 kHz após a decimação), que precisam ser coalescidos
+    std::printf("%-5s %-6s %-9s %10s %10s %10s %s\n", "MTU", "codec", "quadros", "pacotes/s", "eficiência",
+                "bloco 50", "resultado");
+    for (uint16_t mtu : mtus) {
+        for (size_t c = 0; c < 3; c++) {
+            for (int framed = 0; framed < 2; framed++) {
+                RunResult a = run(x, mtu, codecs[c], framed, 250, 0);
+                RunResult b = run(x, mtu, codecs[c], framed, 50, 0);
+                RunResult d = framed ? run(x, mtu, codecs[c], true, 250, 9) : RunResult();
+                const bool pass = a.ok && b.ok && d.ok;
+                if (!pass) ok = false;
+                std::printf("%-5u %-6s %-9s %10.0f %9.1f%% %9.1f%% %s\n", mtu, codec_names[c],
+                            framed ? "com" : "sem", a.packets / seconds, 100.0 * a.efficiency,
+                            100.0 * b.efficiency, pass ? "ok" : "FALHOU");
+            }
+        }
+    }
+
+    // Custo por bloco de 250 amostras: push + todos os pacotes que ficarem cheios
+    for (uint16_t mtu : {(uint16_t)185, (uint16_t)517}) {
+        char title[64];
+        std::snprintf(title, sizeof(title), "Packetizer, MTU %u, com quadro", mtu);
+        bench::printHeader(title);
+        for (size_t c = 0; c < 3; c++) {
+            stetho::Packetizer pk;
+            pk.configure(mtu, codecs[c], true, 20000);
+            uint8_t packet[stetho::Packetizer::MAX_PAYLOAD];
+            size_t len = 0;
+            const size_t n = bench::BLOCK_SAMPLES;
+            const size_t input_blocks = x.size() / n;
+            bench::Result r = bench::timeBlocks(n, blocks, [&](size_t b) {
+                const size_t off = (b % input_blocks) * n;
+                pk.push(&x[off], n, (uint32_t)(b * n), (uint32_t)(b * 12500));
+                while (pk.nextPacket(packet, len)) bench::doNotOptimize(packet[0]);
+            });
+            bench::printResult(codec_names[c], r);
+        }
+    }
+
+    std::printf("\n%s\n", ok ? "empacotamento ok" : "FALHA no empacotamento");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+// Pipelines compostos (core/pipeline.h) contra o código escrito à mão que
+// cada firmware tinha logo antes da unificação: shiftBlock
+// (current_without_filter.cpp), FixedLowPass (current_with_filter.cpp) e o
+// bloco de captura do current.cpp (banco de biquads + decimação no slot).
+// Confere que as saídas são idênticas bit a bit a esse código, inclusive com
+// sinal forte (saturação e volta do int16), e mede os dois lados alternados,
+// ficando com a melhor de ROUNDS medições de cada. O passa-baixa já estava
+// em ponto fixo ali; a diferença para o float da versão original é medida
+// no bench_fixed_lowpass.
+//
+// Uso: bench_pipeline [blocos]
+
+#include "bench_common.h"
+#include "core/biquad.h"
+#include "core/fixed_lowpass.h"
+#include "core/pipeline.h"
+#include "core/resampler.h"
+#include "core/sample_kernels.h"
+
+using stetho::CapturePipeline;
+using stetho::FilterMode;
+using stetho::OutputRate;
+
+constexpr size_t N = bench::BLOCK_SAMPLES;
+constexpr int ROUNDS = 5;
+// Acima disso o composto é mais lento que o ruído da medição explica
+constexpr double MAX_SLOWDOWN = 1.10;
+
+// --- À mão: o laço de cada firmware antigo ---
+
+struct ManualShift {
+    explicit ManualShift(OutputRate) {}
+    size_t process(int32_t *dma, int16_t *dst, size_t n) {
+        stetho::shiftBlock(dma, dst, n);
+        return n;
+    }
+};
+
+struct ManualLowPass {
+    stetho::FixedLowPass filter{0.05f};
+    explicit ManualLowPass(OutputRate) {}
+    size_t process(int32_t *dma, int16_t *dst, size_t n) {
+        filter.process(dma, dst, n);
+        return n;
+    }
+};
+
+// Laço antigo seguido da decimação, com um buffer intermediário
+template <class Manual>
+struct ManualDecimated {
+    Manual kernel;
+    stetho::Decimator dec;
+    int16_t pcm[N];
+    explicit ManualDecimated(OutputRate rate) : kernel(rate), dec(rate) {}
+    size_t process(int32_t *dma, int16_t *dst, size_t n) {
+        kernel.process(dma, pcm, n);
+        return dec.process(pcm, n, dst);
+    }
+};
+
+// O bloco de captura do current.cpp antes do pipeline
+struct ManualBiquad {
+    stetho::FilterBank bank{bench::SAMPLE_RATE, FilterMode::Heart};
+    stetho::Decimator dec;
+    explicit ManualBiquad(OutputRate rate) : dec(rate) {}
+    size_t process(int32_t *dma, int16_t *dst, size_t n) {
+        if (dec.preparePassthrough()) {
+            bank.process(dma, dst, n);
+            return n;
+        }
+        int16_t *pcm = bank.processInPlace(dma, n);
+        return dec.process(pcm, n, dst);
+    }
+};
+
+// --- Compostos ---
+
+template <class FrontEnd>
+struct FixedPipeline {
+    CapturePipeline<FrontEnd, stetho::FixedRate> pipe{bench::SAMPLE_RATE, FilterMode::Heart};
+    explicit FixedPipeline(OutputRate) {}
+    size_t process(int32_t *dma, int16_t *dst, size_t n) { return pipe.process(dma, dst, n); }
+};
+
+template <class FrontEnd>
+struct DecimatedPipeline {
+    stetho::Decimator dec;
+    CapturePipeline<FrontEnd, stetho::Decimated> pipe{bench::SAMPLE_RATE, FilterMode::Heart, dec};
+    explicit DecimatedPipeline(OutputRate rate) : dec(rate) {}
+    size_t process(int32_t *dma, int16_t *dst, size_t n) { return pipe.process(dma, dst, n); }
+};
+
+// Roda a entrada inteira pelos dois e compara amostra a amostra
+template <class Manual, class Composed>
+static bool sameOutput(const std::vector<int32_t> &input, OutputRate rate) {
+    Manual manual(rate);
+    Composed composed(rate);
+    int32_t dma[N];
+    int16_t a[N + 1], b[N + 1];
+    size_t total = 0;
+    for (size_t blk = 0; blk + N <= input.size(); blk += N) {
+        std::memcpy(dma, &input[blk], sizeof(dma));
+        const size_t na = manual.process(dma, a, N);
+        std::memcpy(dma, &input[blk], sizeof(dma));
+        const size_t nb = composed.process(dma, b, N);
+        if (na != nb || std::memcmp(a, b, na * sizeof(int16_t)) != 0) return false;
+        total += na;
+    }
+    return total > 0;
+}
+
+template <class P>
+static bench::Result timePath(const std::vector<int32_t> &input, OutputRate rate, size_t blocks) {
+    P path(rate);
+    const size_t total_blocks = input.size() / N;
+    // Alinhados: com o endereço da pilha variando a cada execução, o
+    // alinhamento mudava o tempo dos dois lados de formas diferentes
+    alignas(64) int32_t dma[N];
+    alignas(64) int16_t slot[N + 1];
+    size_t out = 0;
+    bench::Result r = bench::timeBlocks(N, blocks, [&](size_t blk) {
+        // Recarrega o "buffer do DMA": os caminhos decimados o destroem
+        std::memcpy(dma, &input[(blk % total_blocks) * N], sizeof(dma));
+        out += path.process(dma, slot, N);
+        bench::doNotOptimize(slot);
+    });
+    bench::doNotOptimize(out);
+    return r;
+}
+
+template <class Manual, class Composed>
+static bool compare(const char *name, const std::vector<int32_t> &normal, const std::vector<int32_t> &loud,
+                    OutputRate rate, size_t blocks) {
+    char title[96];
+    std::snprintf(title, sizeof(title), "%s (%u Hz)", name, stetho::outputRateRatio(rate).hz);
+    bench::printHeader(title);
+
+    const bool same = sameOutput<Manual, Composed>(normal, rate) && sameOutput<Manual, Composed>(loud, rate);
+
+    bench::Result best_manual{}, best_composed{};
+    for (int round = 0; round < ROUNDS; round++) {
+        // Quem roda primeiro troca a cada rodada (cache e frequência quentes)
+        bench::Result m, c;
+        if (round % 2 == 0) {
+            m = timePath<Manual>(normal, rate, blocks);
+            c = timePath<Composed>(normal, rate, blocks);
+        } else {
+            c = timePath<Composed>(normal, rate, blocks);
+            m = timePath<Manual>(normal, rate, blocks);
+        }
+        if (round == 0 || m.ns_per_block < best_manual.ns_per_block) best_manual = m;
+        if (round == 0 || c.ns_per_block < best_composed.ns_per_block) best_composed = c;
+    }
+    bench::printResult("à mão (antes)", best_manual);
+    bench::printResult("composto (pipeline.h)", best_composed);
+
+    const double ratio = best_composed.ns_per_block / best_manual.ns_per_block;
+    const bool fast = ratio <= MAX_SLOWDOWN;
+    std::printf("saídas idênticas: %s, composto/à mão: %.3f %s\n", same ? "ok" : "FALHOU", ratio,
+                fast ? "ok" : "MAIS LENTO");
+    return same && fast;
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    const std::vector<int32_t> normal = bench::makeI2SInput();
+    // Fundo de escala 6x maior: passa dos 16 bits depois do >> 14
+    const std::vector<int32_t> loud = bench::toI2SWords(bench::makeHeartSignal(normal.size()), 1.5);
+    bool ok = true;
+
+    std::printf("%d rodadas alternadas por par, melhor de cada; tolerância %.0f%%\n", ROUNDS,
+                (MAX_SLOWDOWN - 1.0) * 100.0);
+
+    ok &= compare<ManualShift, FixedPipeline<stetho::ShiftFrontEnd>>("shift (without_filter)", normal, loud,
+                                                                    OutputRate::Hz20000, blocks);
+    ok &= compare<ManualLowPass, FixedPipeline<stetho::LowPassFrontEnd>>("passa-baixa Q31 (with_filter)", normal,
+                                                                        loud, OutputRate::Hz20000, blocks);
+    // Os antigos não decimavam; com o firmware único o front-end converte no lugar
+    ok &= compare<ManualDecimated<ManualShift>, DecimatedPipeline<stetho::ShiftFrontEnd>>(
+        "shift + decimação", normal, loud, OutputRate::Hz4000, blocks);
+    ok &= compare<ManualDecimated<ManualLowPass>, DecimatedPipeline<stetho::LowPassFrontEnd>>(
+        "passa-baixa Q31 + decimação", normal, loud, OutputRate::Hz4000, blocks);
+    for (OutputRate rate : {OutputRate::Hz20000, OutputRate::Hz4000}) {
+        ok &= compare<ManualBiquad, DecimatedPipeline<stetho::BiquadFrontEnd>>("biquads + decimação (current)",
+                                                                              normal, loud, rate, blocks);
+    }
+
+    std::printf("\n%s\n", ok ? "OK" : "FALHOU");
+    return ok ? 0 : 1;
+}
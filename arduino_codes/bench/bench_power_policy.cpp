@@ -0,0 +1,258 @@
+// Política de energia da captura (core/power_policy.h) num escalonador
+// simulado: um turno de 8 h de conexões, desconexões e gravações, com a
+// tarefa de energia acordando só nos eventos e no prazo do Linger, como no
+// firmware. Confere:
+//  - as transições do começo do turno, roteirizadas à mão;
+//  - paradas, partidas e tempo parado contra uma referência que olha o
+//    estado a cada milissegundo;
+//  - conexões frias (I2S parado) e quentes no ConnectLatency;
+// e estima a corrente média com valores típicos de datasheet, além de medir
+// o custo do ConnectLatency::firstSample(), que roda a cada pacote de áudio.
+//
+// Uso: bench_power_policy [blocos]
+
+#include "bench_common.h"
+#include "core/power_policy.h"
+
+constexpr uint32_t LINGER_MS = 30000; // IDLE_CAPTURE_SECONDS do current.cpp
+constexpr uint32_t SHIFT_MS = 8u * 3600u * 1000u;
+// Fim do trecho roteirizado; depois dele os pacientes são sorteados
+constexpr uint32_t SCRIPTED_MS = 1800000;
+// Período do laço de polling que a tarefa orientada a eventos substitui
+constexpr uint32_t POLL_MS = 100;
+
+// Latência modelada da conexão até a primeira amostra: quente = a rajada do
+// histórico sai no primeiro evento de conexão; fria = partida do INMP441
+// (datasheet: 85 ms com zeros na saída) mais o primeiro buffer do DMA
+constexpr int64_t WARM_FIRST_SAMPLE_US = 15000;
+constexpr int64_t COLD_FIRST_SAMPLE_US = 85000 + 12500;
+
+// Correntes típicas (datasheets do ESP32 e do INMP441; estimativas, não
+// medidas nesta placa)
+constexpr double CAPTURE_MA = 50.0;         // CPU a 240 MHz com o lock da captura
+constexpr double MIC_MA = 1.4;              // INMP441 com clock
+constexpr double RADIO_CONNECTED_MA = 15.0; // notificações contínuas, média
+constexpr double LIGHT_SLEEP_MA = 0.8;      // light sleep entre anúncios
+constexpr double ADVERTISING_MA = 1.2;      // anúncios, média no tempo
+
+struct Event {
+    uint32_t t_ms;
+    bool connected;
+    bool recording;
+};
+
+struct Transition {
+    uint32_t t_ms;
+    stetho::PowerState state;
+};
+
+// Roteiro do começo do turno e pacientes sorteados até o fim
+static std::vector<Event> makeShift() {
+    std::vector<Event> e = {
+        {300000, true, false},   // primeira conexão, I2S parado desde 30 s (fria)
+        {480000, false, false},  // desconecta...
+        {490000, true, false},   // ...e volta em 10 s, dentro do Linger (quente)
+        {610000, false, false},  // desconecta; para em 640 s
+        {900000, true, false},   // fria
+        {960000, true, true},    // começa a gravar
+        {1020000, false, true},  // o app sai e a gravação continua
+        {1320000, false, false}, // a gravação termina (Linger até 1350 s)
+    };
+    bench::Rng rng(11);
+    for (uint32_t t = SCRIPTED_MS; t < SHIFT_MS - 3600000;) {
+        const uint32_t listen = 60000 + rng.next() % 180000;
+        e.push_back({t, true, false});
+        if (rng.next() % 4 == 0) {
+            // Queda curta no meio da ausculta
+            e.push_back({t + listen / 2, false, false});
+            e.push_back({t + listen / 2 + 2000 + rng.next() % 20000, true, false});
+        }
+        if (rng.next() % 3 == 0) {
+            e.push_back({t + listen, true, true});
+            e.push_back({t + listen + 30000, false, true});
+            t += listen + 30000 + 60000 + rng.next() % 120000;
+            e.push_back({t, false, false});
+        } else {
+            t += listen;
+            e.push_back({t, false, false});
+        }
+        t += 5 * 60000 + rng.next() % (15 * 60000);
+    }
+    return e;
+}
+
+struct Run {
+    std::vector<Transition> transitions;
+    uint32_t stops = 0;
+    uint32_t starts = 0;
+    uint64_t idle_ms = 0;
+    uint64_t connected_ms = 0;
+    uint32_t wakes = 0;
+    uint32_t cold = 0;
+    uint32_t warm = 0;
+};
+
+//================================================================
+// --- ESCALONADOR SIMULADO ---
+//================================================================
+// A tarefa de energia dorme até o próximo evento ou o prazo da política
+static Run runShift(const std::vector<Event> &events, stetho::ConnectLatency &latency) {
+    Run run;
+    stetho::CapturePowerPolicy policy(LINGER_MS, 0);
+    run.transitions.push_back({0, policy.state()});
+    bool connected = false, recording = false;
+    uint32_t now = 0, connected_since = 0;
+    size_t next = 0;
+    while (true) {
+        const uint32_t wait = policy.msUntilDeadline(now);
+        const uint64_t deadline = wait == stetho::CapturePowerPolicy::NO_DEADLINE ? UINT64_MAX : (uint64_t)now + wait;
+        if (next < events.size() && events[next].t_ms <= deadline) {
+            const Event &e = events[next++];
+            now = e.t_ms;
+            if (e.connected && !connected) {
+                connected_since = now;
+                const bool cold = policy.state() == stetho::PowerState::Idle;
+                latency.connected((int64_t)now * 1000, cold);
+                latency.firstSample((int64_t)now * 1000 + (cold ? COLD_FIRST_SAMPLE_US : WARM_FIRST_SAMPLE_US));
+                (cold ? run.cold : run.warm)++;
+            }
+            if (!e.connected && connected) run.connected_ms += now - connected_since;
+            connected = e.connected;
+            recording = e.recording;
+        } else if (deadline < SHIFT_MS) {
+            now = (uint32_t)deadline;
+        } else {
+            break;
+        }
+        run.wakes++;
+        const stetho::PowerState before = policy.state();
+        policy.update(connected, recording, now);
+        if (policy.state() != before) run.transitions.push_back({now, policy.state()});
+    }
+    if (connected) run.connected_ms += SHIFT_MS - connected_since;
+    run.stops = policy.stops();
+    run.starts = policy.starts();
+    run.idle_ms = policy.idleMs(SHIFT_MS);
+    return run;
+}
+
+// Referência por polling de 1 ms: a captura está ligada se há conexão ou
+// gravação, ou se a última vez que houve foi há menos de LINGER_MS (o boot conta)
+static Run runReference(const std::vector<Event> &events) {
+    Run run;
+    bool connected = false, recording = false, on = true;
+    uint32_t last_wanted = 0;
+    size_t next = 0;
+    for (uint32_t t = 0; t < SHIFT_MS; t++) {
+        while (next < events.size() && events[next].t_ms == t) {
+            connected = events[next].connected;
+            recording = events[next].recording;
+            next++;
+        }
+        const bool wanted = connected || recording;
+        if (wanted) last_wanted = t + 1;
+        const bool now_on = wanted || t - last_wanted < LINGER_MS;
+        if (on && !now_on) run.stops++;
+        if (!on && now_on) run.starts++;
+        on = now_on;
+        run.idle_ms += !on;
+        run.connected_ms += connected;
+    }
+    return run;
+}
+
+//================================================================
+// --- TRANSIÇÕES E CONTAGENS ---
+//================================================================
+static bool scripted(const Run &run) {
+    using S = stetho::PowerState;
+    const std::vector<Transition> want = {
+        {0, S::Linger},      {30000, S::Idle},     {300000, S::Active},  {480000, S::Linger}, {490000, S::Active},
+        {610000, S::Linger}, {640000, S::Idle},    {900000, S::Active},  {1320000, S::Linger}, {1350000, S::Idle},
+    };
+    std::vector<Transition> got;
+    for (const Transition &t : run.transitions)
+        if (t.t_ms < SCRIPTED_MS) got.push_back(t);
+    bool ok = got.size() == want.size();
+    for (size_t i = 0; ok && i < want.size(); i++) ok = got[i].t_ms == want[i].t_ms && got[i].state == want[i].state;
+    std::printf("%-40s %zu transições até %u s %s\n", "roteiro do começo do turno", got.size(), SCRIPTED_MS / 1000,
+                ok ? "ok" : "FALHOU");
+    if (!ok) {
+        for (const Transition &t : got) std::printf("  %u ms -> %u\n", t.t_ms, (unsigned)t.state);
+    }
+    return ok;
+}
+
+static bool againstReference(const Run &run, const Run &ref) {
+    const bool ok = run.stops == ref.stops && run.starts == ref.starts && run.idle_ms == ref.idle_ms &&
+                    run.connected_ms == ref.connected_ms;
+    std::printf("%-40s %u paradas, %u partidas, %.1f min parado (referência %u/%u/%.1f) %s\n",
+                "turno de 8 h contra o polling de 1 ms", run.stops, run.starts, run.idle_ms / 60000.0, ref.stops,
+                ref.starts, ref.idle_ms / 60000.0, ok ? "ok" : "FALHOU");
+    std::printf("%-40s %u acordadas (polling de %u ms: %u)\n", "tarefa de energia", run.wakes, POLL_MS,
+                SHIFT_MS / POLL_MS);
+    return ok;
+}
+
+static bool latencyBookkeeping(const Run &run, const stetho::ConnectLatency &latency) {
+    // Toda partida do I2S é uma conexão fria (no turno nenhuma gravação
+    // começa sem central)
+    const bool ok = run.cold == run.starts && run.warm > 0 &&
+                    latency.maxUs(true) == (uint32_t)COLD_FIRST_SAMPLE_US &&
+                    latency.maxUs(false) == (uint32_t)WARM_FIRST_SAMPLE_US;
+    std::printf("%-40s %u frias (máx %.1f ms), %u quentes (máx %.1f ms) %s\n", "conexão -> primeira amostra",
+                run.cold, latency.maxUs(true) / 1000.0, run.warm, latency.maxUs(false) / 1000.0,
+                ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+//================================================================
+// --- CORRENTE ESTIMADA ---
+//================================================================
+static bool current(const Run &run) {
+    const double shift_h = SHIFT_MS / 3600000.0;
+    const double on_h = (SHIFT_MS - run.idle_ms) / 3600000.0;
+    const double idle_h = run.idle_ms / 3600000.0;
+    const double connected_h = run.connected_ms / 3600000.0;
+    const double radio_mah = RADIO_CONNECTED_MA * connected_h + ADVERTISING_MA * (shift_h - connected_h);
+    const double always_mah = (CAPTURE_MA + MIC_MA) * shift_h + radio_mah;
+    const double policy_mah = (CAPTURE_MA + MIC_MA) * on_h + LIGHT_SLEEP_MA * idle_h + radio_mah;
+    std::printf("%-40s conectado %.0f%%, captura ligada %.0f%% do turno\n", "corrente estimada (datasheet)",
+                100.0 * connected_h / shift_h, 100.0 * on_h / shift_h);
+    std::printf("%-40s %.1f mAh (%.1f mA médios)\n", "  captura sempre ligada", always_mah, always_mah / shift_h);
+    std::printf("%-40s %.1f mAh (%.1f mA médios), %.1fx menos\n", "  I2S parado + light sleep", policy_mah,
+                policy_mah / shift_h, always_mah / policy_mah);
+    return policy_mah < always_mah;
+}
+
+//================================================================
+// --- CUSTO NO CAMINHO DO ENVIO ---
+//================================================================
+static void cost(size_t blocks) {
+    bench::printHeader("ConnectLatency por pacote de áudio");
+    stetho::ConnectLatency latency;
+    latency.connected(0, false);
+    int64_t t = 0;
+    bench::Result r = bench::timeBlocks(1, blocks, [&](size_t) { latency.firstSample(t += 1000); });
+    bench::printResult("firstSample() depois da primeira", r);
+    bench::doNotOptimize(latency);
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv, 1000000);
+    const std::vector<Event> events = makeShift();
+    stetho::ConnectLatency latency;
+    const Run run = runShift(events, latency);
+    const Run ref = runReference(events);
+
+    bool ok = true;
+    ok &= scripted(run);
+    ok &= againstReference(run, ref);
+    ok &= latencyBookkeeping(run, latency);
+    ok &= current(run);
+
+    cost(blocks);
+
+    std::printf("\n%s\n", ok ? "OK" : "FALHOU");
+    return ok ? 0 : 1;
+}
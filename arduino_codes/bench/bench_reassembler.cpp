@@ -0,0 +1,212 @@
+// Quadros com sequência/índice/timestamp e remontagem no receptor: simula um
+// transporte com perda, reordenação e duplicação e confere que o stream
+// remontado tem as amostras certas nos índices certos, com silêncio marcado
+// exatamente onde faltaram quadros. Também mede o custo de push por quadro.
+// Uso: bench_reassembler [blocos]
+
+#include <algorithm>
+
+#include "bench_common.h"
+#include "core/biquad.h"
+#include "core/frame.h"
+#include "core/ima_adpcm.h"
+#include "core/reassembler.h"
+#include "core/rice_codec.h"
+
+using Frame = std::vector<uint8_t>;
+
+// Guarda o stream remontado e confere que os índices chegam contíguos
+struct CollectSink : stetho::ReassemblerSink {
+    uint64_t base = 0;
+    bool started = false;
+    bool contiguous = true;
+    std::vector<int16_t> samples;
+    std::vector<uint8_t> gap;
+
+    void onSamples(uint64_t index, const int16_t *s, size_t n, bool is_gap) override {
+        if (!started) {
+            started = true;
+            base = index;
+        }
+        if (index != base + samples.size()) contiguous = false;
+        samples.insert(samples.end(), s, s + n);
+        gap.insert(gap.end(), n, is_gap ? 1 : 0);
+    }
+};
+
+struct Transport {
+    const char *name;
+    double loss;      // probabilidade de perder o quadro
+    double dup;       // probabilidade de entregar uma segunda cópia
+    double reorder;   // probabilidade de atrasar o quadro
+    size_t max_delay; // atraso máximo, em posições
+};
+
+static std::vector<Frame> makeFrames(const std::vector<int16_t> &x, stetho::StreamCodec codec,
+                                     uint32_t first_index) {
+    std::vector<Frame> frames;
+    stetho::AdpcmEncoder adpcm;
+    uint8_t buf[stetho::FRAME_HEADER_SIZE + stetho::rice::maxEncodedSize(bench::BLOCK_SAMPLES)];
+    uint16_t seq = 0;
+    for (size_t b = 0; b + bench::BLOCK_SAMPLES <= x.size(); b += bench::BLOCK_SAMPLES) {
+        stetho::FrameHeader h;
+        h.seq = seq++;
+        h.first_sample = first_index + (uint32_t)b;
+        h.timestamp_us = (uint32_t)(b * 50);
+        h.codec = codec;
+        size_t len = stetho::writeFrameHeader(h, buf);
+        uint8_t *payload = buf + len;
+        switch (codec) {
+        case stetho::StreamCodec::Rice:
+            len += stetho::riceEncode(&x[b], bench::BLOCK_SAMPLES, payload);
+            break;
+        case stetho::StreamCodec::ImaAdpcm:
+            len += adpcm.encode(&x[b], bench::BLOCK_SAMPLES, payload);
+            break;
+        default:
+            for (size_t i = 0; i < bench::BLOCK_SAMPLES; i++) stetho::putLe16(payload + 2 * i, (uint16_t)x[b + i]);
+            len += 2 * bench::BLOCK_SAMPLES;
+            break;
+        }
+        frames.emplace_back(buf, buf + len);
+    }
+    return frames;
+}
+
+// Sorteio com probabilidade p (Rng::uniform é em [-1, 1))
+static bool chance(bench::Rng &rng, double p) { return (rng.uniform() + 1.0) * 0.5 < p; }
+
+// Ordem de chegada: cada cópia recebe um instante de entrega e é ordenada por ele
+static std::vector<size_t> deliver(size_t count, const Transport &t, uint32_t seed,
+                                   std::vector<uint8_t> &received) {
+    bench::Rng rng(seed);
+    std::vector<std::pair<double, size_t>> arrivals;
+    received.assign(count, 0);
+    for (size_t i = 0; i < count; i++) {
+        if (chance(rng, t.loss)) continue;
+        received[i] = 1;
+        double when = (double)i;
+        if (chance(rng, t.reorder)) when += 1 + (double)(rng.next() % t.max_delay);
+        arrivals.push_back({when, i});
+        if (chance(rng, t.dup)) arrivals.push_back({when + 1 + (double)(rng.next() % 4) + 0.5, i});
+    }
+    std::stable_sort(arrivals.begin(), arrivals.end(),
+                     [](const std::pair<double, size_t> &a, const std::pair<double, size_t> &b) {
+                         return a.first < b.first;
+                     });
+    std::vector<size_t> order;
+    for (const auto &a : arrivals) order.push_back(a.second);
+    return order;
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    const size_t n = bench::BLOCK_SAMPLES;
+    bool ok = true;
+
+    std::vector<int32_t> raw = bench::makeI2SInput();
+    std::vector<int16_t> x(raw.size());
+    stetho::FilterBank bank(bench::SAMPLE_RATE);
+    for (size_t b = 0; b + n <= raw.size(); b += n) bank.process(&raw[b], &x[b], n);
+
+    const Transport transports[] = {
+        {"limpo", 0.0, 0.0, 0.0, 1},
+        {"perda 5%", 0.05, 0.0, 0.0, 1},
+        {"reordena 20% + dup 5%", 0.0, 0.05, 0.20, 6},
+        {"perda 3% + reordena + dup", 0.03, 0.05, 0.20, 6},
+        {"atraso além da janela", 0.0, 0.0, 0.05, 30},
+    };
+    const stetho::StreamCodec codecs[] = {stetho::StreamCodec::Pcm16, stetho::StreamCodec::Rice,
+                                          stetho::StreamCodec::ImaAdpcm};
+    const char *codec_names[] = {"pcm16", "rice", "adpcm"};
+    // Começa perto do fim do contador de 32 bits para exercitar a volta
+    const uint32_t first_indices[] = {0, 0xFFFFFFFFu - 20 * (uint32_t)bench::BLOCK_SAMPLES};
+
+    std::printf("%-26s %-6s %8s %6s %6s %6s %10s %s\n", "transporte", "codec", "quadros", "dup",
+                "reord", "buracos", "silêncio", "resultado");
+    for (uint32_t first_index : first_indices) {
+        for (size_t c = 0; c < 3; c++) {
+            std::vector<Frame> frames = makeFrames(x, codecs[c], first_index);
+
+            // Referência: cada quadro decodificado isoladamente
+            std::vector<int16_t> ref(frames.size() * n);
+            for (size_t f = 0; f < frames.size(); f++) {
+                int got = stetho::Reassembler::decodePayload(
+                    codecs[c], frames[f].data() + stetho::FRAME_HEADER_SIZE,
+                    frames[f].size() - stetho::FRAME_HEADER_SIZE, &ref[f * n]);
+                if (got != (int)n) ok = false;
+            }
+
+            for (size_t t = 0; t < sizeof(transports) / sizeof(transports[0]); t++) {
+                std::vector<uint8_t> received;
+                std::vector<size_t> order = deliver(frames.size(), transports[t], 11 + (uint32_t)t, received);
+
+                CollectSink sink;
+                stetho::Reassembler reasm(sink);
+                for (size_t f : order) reasm.push(frames[f].data(), frames[f].size());
+                reasm.flush();
+
+                // O stream vai do primeiro ao último quadro recebido
+                size_t first_rx = 0, last_rx = frames.size() - 1;
+                while (!received[first_rx]) first_rx++;
+                while (!received[last_rx]) last_rx--;
+                // O primeiro quadro a chegar define o início; quadros anteriores a ele são descartados
+                const size_t start_frame = order.empty() ? 0 : order[0];
+                size_t expected_gap = 0;
+                for (size_t f = start_frame; f <= last_rx; f++)
+                    if (!received[f]) expected_gap += n;
+
+                bool pass = sink.contiguous && sink.samples.size() == (last_rx - start_frame + 1) * n;
+                size_t gap_samples = 0;
+                for (size_t i = 0; pass && i < sink.samples.size(); i++) {
+                    const size_t idx = start_frame * n + i;
+                    if (sink.gap[i]) {
+                        gap_samples++;
+                        pass = sink.samples[i] == 0;
+                    } else {
+                        pass = sink.samples[i] == ref[idx];
+                    }
+                }
+                // Sem atraso maior que a janela, o silêncio é exatamente o que se perdeu
+                if (transports[t].max_delay < stetho::Reassembler::REORDER_WINDOW)
+                    pass = pass && gap_samples == expected_gap;
+                pass = pass && reasm.stats().gap_samples == gap_samples;
+                if (!pass) ok = false;
+
+                const stetho::ReassemblerStats &s = reasm.stats();
+                std::printf("%-26s %-6s %8u %6u %6u %6u %10llu %s\n", transports[t].name, codec_names[c],
+                            s.frames, s.duplicates, s.reordered, s.gaps, (unsigned long long)s.gap_samples,
+                            pass ? "ok" : "FALHOU");
+            }
+        }
+    }
+
+    // Custo de push por quadro, no transporte com perda + reordenação + duplicação
+    bench::printHeader("Reassembler::push (perda 3% + reordena + dup)");
+    for (size_t c = 0; c < 3; c++) {
+        std::vector<Frame> frames = makeFrames(x, codecs[c], 0);
+        std::vector<uint8_t> received;
+        std::vector<size_t> order = deliver(frames.size(), transports[3], 99, received);
+
+        struct NullSink : stetho::ReassemblerSink {
+            void onSamples(uint64_t, const int16_t *s, size_t, bool) override { bench::doNotOptimize(s); }
+        } sink;
+        stetho::Reassembler reasm(sink);
+
+        // Cada "bloco" cronometrado é um push; o índice cresce para não virar duplicata
+        std::vector<Frame> work;
+        for (size_t f : order) work.push_back(frames[f]);
+        uint32_t offset = 0;
+        const uint32_t span = (uint32_t)(frames.size() * n);
+        bench::Result r = bench::timeBlocks(n, blocks, [&](size_t b) {
+            Frame &fr = work[b % work.size()];
+            if (b > 0 && b % work.size() == 0) offset += span;
+            stetho::putLe32(fr.data() + 2, stetho::getLe32(frames[order[b % work.size()]].data() + 2) + offset);
+            reasm.push(fr.data(), fr.size());
+        });
+        bench::printResult(codec_names[c], r);
+    }
+
+    std::printf("\n%s\n", ok ? "remontagem ok" : "FALHA na remontagem");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,405 @@
+// Receptor portátil (core/stream_receiver.h) em streams sintéticos longos:
+// um dispositivo que gera os quadros sob demanda, um enlace com perda,
+// duplicação e troca de ordem, reconexões com a rajada do histórico
+// pré-gatilho, e o WAV gravado no disco enquanto chega. Confere:
+//  - o WAV relido do disco: cada amostra é a enviada ou silêncio, e
+//    silêncio só onde algum envio do quadro se perdeu ou ninguém ouvia;
+//  - o cabeçalho corrigido no fim (tamanhos e taxa medida);
+//  - a memória residente constante ao longo de uma hora de stream, contra
+//    o vetor que cresce (o que o app faz hoje);
+//  - a janela sem cópia do gráfico;
+// e mede a vazão do receptor em MB/s e o custo por notificação.
+//
+// Uso: bench_receiver [blocos]
+
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "bench_common.h"
+#include "core/frame.h"
+#include "core/rice_codec.h"
+#include "core/stream_receiver.h"
+
+namespace fs = std::filesystem;
+
+constexpr uint32_t RATE_HZ = 20000;
+constexpr size_t FRAME_SAMPLES = bench::BLOCK_SAMPLES;
+// Taxa medida que o StreamInfo anuncia; o WAV sai com ela arredondada
+constexpr uint32_t MEASURED_RATE_MHZ = 20001200;
+constexpr uint32_t WAV_RATE_HZ = 20001;
+constexpr size_t WINDOW_SAMPLES = 1 << 16; // ~3 s a 20 kHz
+// Crescimento tolerado da memória residente depois do primeiro minuto
+constexpr double MAX_RSS_GROWTH_MB = 1.0;
+
+struct Scenario {
+    const char *title;
+    double seconds;
+    stetho::StreamCodec codec;
+    uint32_t channels;
+    bool scaled;
+    double loss;
+    double reconnect_s; // 0 = sem reconexões
+    double away_s;
+    double backfill_s; // histórico enviado em rajada na reconexão
+};
+
+//================================================================
+// --- DISPOSITIVO SINTÉTICO ---
+//================================================================
+// As amostras são função do índice: a conferência relê o WAV e refaz o
+// sinal sem guardar nada. Nunca zero, para o silêncio ser inequívoco.
+struct Signal {
+    std::vector<int16_t> period;
+    Signal() {
+        const std::vector<double> heart = bench::makeHeartSignal(RATE_HZ);
+        period.resize(heart.size());
+        for (size_t i = 0; i < heart.size(); i++) period[i] = (int16_t)(heart[i] * 8000.0);
+    }
+    int16_t at(uint64_t i) const {
+        int32_t v = period[i % period.size()] + (int32_t)((i * 2654435761u) >> 29) - 4;
+        if (v > 4000) v = 4000;
+        if (v < -4000) v = -4000;
+        return (int16_t)(v == 0 ? 1 : v);
+    }
+};
+
+class Device {
+public:
+    Device(const Scenario &s, const Signal &signal) : s_(s), signal_(signal) {}
+
+    size_t frameSamples() const { return FRAME_SAMPLES * s_.channels; }
+    void newConnection() { seq_ = 0; }
+
+    // Quadro k: amostras [k * frameSamples(), ...) do stream intercalado
+    size_t make(uint64_t k, uint8_t *out) {
+        const size_t n = frameSamples();
+        const uint64_t first = k * n;
+        stetho::FrameHeader h;
+        h.seq = seq_++;
+        h.first_sample = (uint32_t)first;
+        h.timestamp_us = (uint32_t)(first / s_.channels * 1000000 / RATE_HZ);
+        h.codec = s_.codec;
+        h.gain_exp = s_.scaled ? (int8_t)((k / 40) % 4) : 0;
+        int16_t x[2 * FRAME_SAMPLES];
+        for (size_t i = 0; i < n; i++) x[i] = (int16_t)(signal_.at(first + i) * (1 << h.gain_exp));
+        size_t len = stetho::writeFrameHeader(h, out);
+        if (s_.codec == stetho::StreamCodec::Rice) {
+            len += stetho::riceEncode(x, n, out + len);
+        } else {
+            for (size_t i = 0; i < n; i++) stetho::putLe16(out + len + 2 * i, (uint16_t)x[i]);
+            len += 2 * n;
+        }
+        return len;
+    }
+
+private:
+    const Scenario &s_;
+    const Signal &signal_;
+    uint16_t seq_ = 0;
+};
+
+static std::vector<uint8_t> streamInfo(const Scenario &s) {
+    stetho::StreamInfo info;
+    info.codec = s.codec;
+    info.flags = stetho::STREAM_FLAG_FRAMED | (s.scaled ? stetho::STREAM_FLAG_SCALED : 0) |
+                 (s.channels == 2 ? stetho::STREAM_FLAG_STEREO : 0);
+    info.sample_rate_hz = RATE_HZ;
+    info.measured_rate_mhz = MEASURED_RATE_MHZ;
+    std::vector<uint8_t> v(stetho::STREAM_INFO_SIZE);
+    stetho::serializeStreamInfo(info, v.data());
+    return v;
+}
+
+// Memória residente do processo em MB (Linux)
+static double rssMb() {
+    long pages = 0, resident = 0;
+    std::FILE *f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0.0;
+    if (std::fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    std::fclose(f);
+    return (double)resident * (double)sysconf(_SC_PAGESIZE) / 1048576.0;
+}
+
+struct Run {
+    uint64_t frames = 0;
+    uint64_t samples = 0;
+    double receiver_s = 0.0; // só dentro do receptor
+    double rss_first_minute_mb = 0.0;
+    double rss_end_mb = 0.0;
+    std::vector<uint8_t> clean; // todo envio do quadro chegou
+    stetho::ReceiverStats stats;
+};
+
+//================================================================
+// --- ENLACE E RECONEXÕES ---
+//================================================================
+static Run stream(const Scenario &s, const Signal &signal, const std::string &path, stetho::SampleWindow &window) {
+    Run run;
+    Device device(s, signal);
+    const size_t frame_samples = device.frameSamples();
+    run.frames = (uint64_t)(s.seconds * RATE_HZ * s.channels / frame_samples);
+    run.samples = run.frames * frame_samples;
+    run.clean.assign(run.frames, 0);
+    std::vector<uint8_t> sent(run.frames, 0);
+    const std::vector<uint8_t> info = streamInfo(s);
+    const double frame_s = (double)FRAME_SAMPLES / RATE_HZ;
+    const uint64_t minute_frame = (uint64_t)(60.0 / frame_s);
+    const uint64_t backfill_frames = (uint64_t)(s.backfill_s / frame_s);
+
+    std::unique_ptr<stetho::StreamReceiver> rx(new stetho::StreamReceiver(&window));
+    bench::Rng rng(3);
+    uint8_t buf[2][stetho::FRAME_HEADER_SIZE + stetho::rice::maxEncodedSize(2 * FRAME_SAMPLES)];
+    size_t held_len = 0; // quadro atrasado: sai depois do próximo
+    uint64_t held_k = 0;
+    std::chrono::steady_clock::duration in_receiver{};
+    auto timed = [&](auto &&fn) {
+        const auto t0 = std::chrono::steady_clock::now();
+        fn();
+        in_receiver += std::chrono::steady_clock::now() - t0;
+    };
+    auto deliver = [&](uint64_t k, const uint8_t *p, size_t len) {
+        timed([&] { rx->onAudio(p, len); });
+        (void)k;
+    };
+    auto transmit = [&](uint64_t k, bool last) {
+        uint8_t *p = buf[held_len ? 1 : 0];
+        const size_t len = device.make(k, p);
+        const bool first_try = !sent[k];
+        sent[k] = 1;
+        if (!last && (rng.next() % 1000000) < s.loss * 1e6) {
+            run.clean[k] = 0;
+            return;
+        }
+        if (first_try) run.clean[k] = 1;
+        if (!last && held_len == 0 && rng.next() % 100 == 0) {
+            held_len = len;
+            held_k = k;
+            return;
+        }
+        deliver(k, p, len);
+        if (rng.next() % 200 == 0) deliver(k, p, len); // duplicata
+        if (held_len) {
+            deliver(held_k, buf[0], held_len);
+            held_len = 0;
+        }
+    };
+    auto release = [&] {
+        if (held_len) deliver(held_k, buf[0], held_len);
+        held_len = 0;
+    };
+
+    timed([&] {
+        rx->onConnect();
+        rx->onStreamInfo(info.data(), info.size());
+        rx->startWav(path.c_str());
+    });
+    double next_drop = s.reconnect_s > 0 ? s.reconnect_s : INFINITY;
+    for (uint64_t k = 0; k < run.frames; k++) {
+        const double t = (double)k * frame_s;
+        if (t >= next_drop && t + s.away_s < s.seconds - 1.0) {
+            release();
+            timed([&] { rx->onDisconnect(); });
+            // Ninguém ouve: o dispositivo segue capturando para o histórico
+            const uint64_t back = (uint64_t)((t + s.away_s) / frame_s);
+            timed([&] {
+                rx->onConnect();
+                rx->onStreamInfo(info.data(), info.size());
+            });
+            device.newConnection();
+            for (uint64_t b = back > backfill_frames ? back - backfill_frames : 0; b < back; b++) transmit(b, false);
+            k = back;
+            next_drop += s.reconnect_s;
+        }
+        transmit(k, k + 1 == run.frames);
+        if (k == minute_frame) run.rss_first_minute_mb = rssMb();
+    }
+    release();
+    timed([&] { rx->stopWav(); });
+    run.rss_end_mb = rssMb();
+    run.receiver_s = std::chrono::duration<double>(in_receiver).count();
+    run.stats = rx->stats();
+    return run;
+}
+
+//================================================================
+// --- CONFERÊNCIA DO WAV ---
+//================================================================
+static bool checkWav(const Scenario &s, const Signal &signal, const std::string &path, const Run &run,
+                     uint64_t &zeros, uint64_t &wrong) {
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    uint8_t h[stetho::WavWriter::HEADER_SIZE];
+    bool ok = std::fread(h, 1, sizeof(h), f) == sizeof(h);
+    const uint32_t data_bytes = stetho::getLe32(h + 40);
+    ok = ok && std::memcmp(h, "RIFF", 4) == 0 && std::memcmp(h + 8, "WAVEfmt ", 8) == 0 &&
+         stetho::getLe32(h + 4) == data_bytes + 36 && stetho::getLe16(h + 22) == s.channels &&
+         stetho::getLe32(h + 24) == WAV_RATE_HZ && data_bytes == run.samples * 2 &&
+         fs::file_size(path) == sizeof(h) + data_bytes;
+    const size_t frame_samples = FRAME_SAMPLES * s.channels;
+    zeros = wrong = 0;
+    uint8_t chunk[65536];
+    uint64_t p = 0;
+    size_t got;
+    while (ok && (got = std::fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        for (size_t i = 0; i + 1 < got; i += 2, p++) {
+            const int16_t v = (int16_t)stetho::getLe16(chunk + i);
+            const uint64_t k = p / frame_samples;
+            if (v == 0) {
+                zeros++;
+                if (k < run.clean.size() && run.clean[k]) wrong++;
+            } else if (v != signal.at(p)) {
+                wrong++;
+            }
+        }
+    }
+    std::fclose(f);
+    return ok && p == run.samples && wrong == 0 && zeros == run.stats.gap_samples;
+}
+
+static bool scenario(const Scenario &s, const Signal &signal, const fs::path &root) {
+    std::vector<int16_t> storage(2 * WINDOW_SAMPLES);
+    stetho::SampleWindow window(storage.data(), WINDOW_SAMPLES);
+    const std::string path = (root / "rx.wav").string();
+    const Run run = stream(s, signal, path, window);
+    uint64_t zeros = 0, wrong = 0;
+    bool ok = checkWav(s, signal, path, run, zeros, wrong);
+
+    // A janela termina nas últimas amostras do stream, contíguas
+    uint64_t first = 0;
+    const int16_t *last = window.latest(WINDOW_SAMPLES, first);
+    bool window_ok = first == run.samples - WINDOW_SAMPLES && window.intact(first) &&
+                     window.view(first - 1, 2) == nullptr && window.view(first, WINDOW_SAMPLES) == last;
+    for (size_t i = WINDOW_SAMPLES - 1000; i < WINDOW_SAMPLES; i++) window_ok &= last[i] == signal.at(first + i);
+    ok &= window_ok;
+
+    const double in_mb = (double)run.stats.bytes / 1e6, wav_mb = (double)run.samples * 2 / 1e6;
+    const double growth = run.rss_end_mb - run.rss_first_minute_mb;
+    ok &= s.seconds < 120 || growth <= MAX_RSS_GROWTH_MB;
+    std::printf("%s\n", s.title);
+    std::printf("  %u conexões, %llu quadros, %u perdidos no Reassembler, %llu amostras de silêncio, "
+                "%llu repetidas na rajada\n",
+                run.stats.connections, (unsigned long long)run.stats.frames.frames, run.stats.frames.gaps,
+                (unsigned long long)run.stats.gap_samples, (unsigned long long)run.stats.overlap_samples);
+    std::printf("  WAV %.1f MB relido: %llu silêncio, %llu erradas, janela %s\n", wav_mb, (unsigned long long)zeros,
+                (unsigned long long)wrong, window_ok ? "ok" : "FALHOU");
+    std::printf("  receptor: %.2f s para %.0f s de stream (%.0fx tempo real), entrada %.0f MB/s, WAV %.0f MB/s\n",
+                run.receiver_s, s.seconds, s.seconds / run.receiver_s, in_mb / run.receiver_s,
+                wav_mb / run.receiver_s);
+    std::printf("  memória residente: %.1f MB no 1º minuto, %.1f MB no fim (%+.2f MB) %s\n", run.rss_first_minute_mb,
+                run.rss_end_mb, growth, ok ? "ok" : "FALHOU");
+    fs::remove(path);
+    return ok;
+}
+
+// Fora por mais que MAX_FILL_SECONDS: a gravação emenda sem o silêncio
+static bool longDrop(const Signal &signal) {
+    const Scenario s = {"", 0, stetho::StreamCodec::Pcm16, 1, false, 0, 0, 0, 0};
+    Device device(s, signal);
+    std::vector<int16_t> storage(2 * WINDOW_SAMPLES);
+    stetho::SampleWindow window(storage.data(), WINDOW_SAMPLES);
+    std::unique_ptr<stetho::StreamReceiver> rx(new stetho::StreamReceiver(&window));
+    const std::vector<uint8_t> info = streamInfo(s);
+    uint8_t buf[stetho::FRAME_HEADER_SIZE + 2 * FRAME_SAMPLES];
+    const uint64_t ten_s = 10 * RATE_HZ / FRAME_SAMPLES;
+    const uint64_t back = 100 * RATE_HZ / FRAME_SAMPLES;
+    for (uint64_t start : {(uint64_t)0, back}) {
+        rx->onConnect();
+        rx->onStreamInfo(info.data(), info.size());
+        device.newConnection();
+        for (uint64_t k = start; k < start + ten_s; k++) rx->onAudio(buf, device.make(k, buf));
+        rx->onDisconnect();
+    }
+    uint64_t first = 0;
+    const int16_t *last = window.latest(FRAME_SAMPLES, first);
+    const uint64_t device_first = (back + ten_s) * FRAME_SAMPLES - FRAME_SAMPLES;
+    bool ok = rx->stats().jumps == 1 && rx->stats().gap_samples == 0 && rx->position() == 2 * ten_s * FRAME_SAMPLES;
+    for (size_t i = 0; i < FRAME_SAMPLES; i++) ok &= last[i] == signal.at(device_first + i);
+    std::printf("%-40s %u quebra, %.0f s gravados %s\n", "queda de 90 s (acima do MAX_FILL_SECONDS)",
+                rx->stats().jumps, (double)rx->position() / RATE_HZ, ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+//================================================================
+// --- O QUE O APP FAZ HOJE ---
+//================================================================
+// Todas as amostras num vetor que cresce e o arquivo inteiro montado na
+// memória no fim: a memória cresce com a duração
+static void growingArray(const Signal &signal, double seconds) {
+    const double before = rssMb();
+    std::vector<int16_t> all;
+    const size_t n = (size_t)(seconds * RATE_HZ);
+    for (size_t b = 0; b + FRAME_SAMPLES <= n; b += FRAME_SAMPLES) {
+        for (size_t i = 0; i < FRAME_SAMPLES; i++) all.push_back(signal.at(b + i));
+    }
+    std::vector<uint8_t> file(stetho::WavWriter::HEADER_SIZE + all.size() * 2);
+    for (size_t i = 0; i < all.size(); i++) stetho::putLe16(&file[stetho::WavWriter::HEADER_SIZE + 2 * i], (uint16_t)all[i]);
+    const double peak = rssMb();
+    bench::doNotOptimize(file);
+    std::printf("vetor que cresce + arquivo montado no fim (%.0f min): %+.1f MB residentes, %.0f MB por hora\n",
+                seconds / 60.0, peak - before, (peak - before) * 3600.0 / seconds);
+}
+
+//================================================================
+// --- CUSTO POR NOTIFICAÇÃO ---
+//================================================================
+static void cost(size_t blocks, const Signal &signal, const fs::path &root) {
+    bench::printHeader("StreamReceiver::onAudio por notificação (250 amostras)");
+    for (stetho::StreamCodec codec : {stetho::StreamCodec::Pcm16, stetho::StreamCodec::Rice}) {
+        for (bool wav : {false, true}) {
+            const Scenario s = {"", 0, codec, 1, false, 0, 0, 0, 0};
+            Device device(s, signal);
+            std::vector<int16_t> storage(2 * WINDOW_SAMPLES);
+            stetho::SampleWindow window(storage.data(), WINDOW_SAMPLES);
+            std::unique_ptr<stetho::StreamReceiver> rx(new stetho::StreamReceiver(&window));
+            const std::vector<uint8_t> info = streamInfo(s);
+            rx->onConnect();
+            rx->onStreamInfo(info.data(), info.size());
+            const std::string path = (root / "cost.wav").string();
+            if (wav) rx->startWav(path.c_str());
+            // Quadros prontos antes: só o receptor entra na medida
+            std::vector<std::vector<uint8_t>> frames(256);
+            uint8_t buf[stetho::FRAME_HEADER_SIZE + stetho::rice::maxEncodedSize(FRAME_SAMPLES)];
+            uint64_t k = 0;
+            bench::Result r = bench::timeBlocks(FRAME_SAMPLES, blocks, [&](size_t) {
+                std::vector<uint8_t> &f = frames[k % frames.size()];
+                if (k < frames.size()) f.assign(buf, buf + device.make(k, buf));
+                else stetho::putLe32(&f[2], (uint32_t)(k * FRAME_SAMPLES)); // índice novo, mesmo conteúdo
+                rx->onAudio(f.data(), f.size());
+                k++;
+            });
+            rx->stopWav();
+            fs::remove(path);
+            std::string label = codec == stetho::StreamCodec::Rice ? "Rice" : "Pcm16";
+            label += wav ? " + janela + WAV" : " + janela";
+            bench::printResult(label.c_str(), r);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    const fs::path root = fs::temp_directory_path() / ("stetho_bench_rx_" + std::to_string(getpid()));
+    fs::remove_all(root);
+    fs::create_directories(root);
+    const Signal signal;
+    bool ok = true;
+
+    ok &= scenario({"1 h, Pcm16, 1% de perda, reconexão a cada 10 min (5 s fora, 8 s de histórico)", 3600.0,
+                    stetho::StreamCodec::Pcm16, 1, false, 0.01, 600.0, 5.0, 8.0},
+                   signal, root);
+    ok &= scenario({"1 h, Rice, dois canais, expoente de ganho, 0,2% de perda, queda de 30 s sem histórico", 3600.0,
+                    stetho::StreamCodec::Rice, 2, true, 0.002, 1800.0, 30.0, 0.0},
+                   signal, root);
+    ok &= longDrop(signal);
+    growingArray(signal, 600.0);
+
+    cost(blocks, signal, root);
+    fs::remove_all(root);
+
+    std::printf("\n%s\n", ok ? "OK" : "FALHOU");
+    return ok ? 0 : 1;
+}
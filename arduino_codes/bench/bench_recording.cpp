@@ -0,0 +1,238 @@
+// Gravação store-and-forward sobre o stand-in de arquivos do PC: vazão de
+// escrita, leitura sem perdas, busca no índice, recuperação após queda em
+// vários pontos de corte e transferência em massa com retomada.
+// Uso: bench_recording [blocos]
+
+#include <chrono>
+#include <filesystem>
+#include <unistd.h>
+
+#include "bench_common.h"
+#include "core/biquad.h"
+#include "core/bulk_transfer.h"
+#include "core/recording.h"
+#include "file_storage.h"
+
+namespace fs = std::filesystem;
+
+static std::vector<int16_t> heartStream(size_t n) {
+    std::vector<int32_t> raw = bench::makeI2SInput(n);
+    std::vector<int16_t> x(raw.size());
+    stetho::FilterBank bank(bench::SAMPLE_RATE, stetho::FilterMode::Heart);
+    for (size_t b = 0; b + bench::BLOCK_SAMPLES <= raw.size(); b += bench::BLOCK_SAMPLES)
+        bank.process(&raw[b], &x[b], bench::BLOCK_SAMPLES);
+    return x;
+}
+
+static void record(stetho::Storage &storage, uint16_t id, const std::vector<int16_t> &x) {
+    stetho::RecordingWriter writer(storage);
+    writer.begin(id, stetho::RecordingHeader());
+    for (size_t b = 0; b + bench::BLOCK_SAMPLES <= x.size(); b += bench::BLOCK_SAMPLES)
+        writer.write(&x[b], bench::BLOCK_SAMPLES, (uint32_t)b, (uint32_t)(b * 50));
+    writer.end();
+}
+
+// Lê todos os blocos e confere com o começo de 'x'; devolve as amostras lidas ou -1
+static long readAll(stetho::Storage &storage, uint16_t id, const std::vector<int16_t> &x) {
+    stetho::RecordingReader reader(storage);
+    if (!reader.open(id)) return -1;
+    int16_t buf[stetho::RECORDING_CHUNK_SAMPLES];
+    stetho::RecordingChunk c;
+    size_t expected_first = 0;
+    for (uint32_t i = 0; i < reader.chunkCount(); i++) {
+        const int n = reader.readChunk(i, buf, c);
+        if (n < 0 || c.first_sample != expected_first) return -1;
+        if (!std::equal(buf, buf + n, x.begin() + c.first_sample)) return -1;
+        expected_first += (size_t)n;
+    }
+    return (long)expected_first;
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    bool ok = true;
+
+    const fs::path root = fs::temp_directory_path() / ("stetho_bench_rec_" + std::to_string(getpid()));
+    fs::remove_all(root);
+    bench::FileStorage storage(root.string());
+
+    // 1. Ida e volta de 60 s de som cardíaco
+    const std::vector<int16_t> x = heartStream(60 * 20000);
+    record(storage, 1, x);
+    const long read_back = readAll(storage, 1, x);
+    const int32_t bytes = storage.size("/rec/00001.dat");
+    const bool roundtrip = read_back == (long)(x.size() / bench::BLOCK_SAMPLES * bench::BLOCK_SAMPLES);
+    ok &= roundtrip;
+    std::printf("60 s gravados: %d bytes (%.2fx menor que Pcm16), leitura %s\n", bytes,
+                (double)x.size() * 2 / bytes, roundtrip ? "ok" : "FALHOU");
+
+    // 2. Busca no índice: o bloco achado tem que conter a amostra
+    {
+        stetho::RecordingReader reader(storage);
+        reader.open(1);
+        bench::Rng rng(5);
+        bool found_ok = true;
+        const int lookups = 2000;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < lookups; i++) {
+            const uint32_t s = rng.next() % (uint32_t)x.size();
+            const int32_t k = reader.findChunk(s);
+            stetho::RecordingIndexEntry e, next;
+            if (k < 0 || !reader.entry((uint32_t)k, e) || e.first_sample > s) found_ok = false;
+            if (k + 1 < (int32_t)reader.chunkCount() && reader.entry((uint32_t)k + 1, next) && next.first_sample <= s)
+                found_ok = false;
+        }
+        const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        ok &= found_ok;
+        std::printf("busca no índice (%u blocos): %.1f us/busca, %s\n", reader.chunkCount(), us / lookups,
+                    found_ok ? "ok" : "FALHOU");
+    }
+
+    // 3. Recuperação: corta os dados em vários pontos e bagunça o índice
+    {
+        stetho::RecordingReader reader(storage);
+        reader.open(1);
+        std::vector<stetho::RecordingIndexEntry> entries(reader.chunkCount());
+        for (uint32_t i = 0; i < reader.chunkCount(); i++) reader.entry(i, entries[i]);
+
+        bench::Rng rng(9);
+        int cases = 0, passed = 0;
+        for (int t = 0; t < 40; t++) {
+            fs::remove_all(root / "rec" / "00002.dat");
+            fs::remove_all(root / "rec" / "00002.idx");
+            fs::copy_file(root / "rec" / "00001.dat", root / "rec" / "00002.dat");
+            fs::copy_file(root / "rec" / "00001.idx", root / "rec" / "00002.idx");
+
+            // Ponto de corte qualquer nos dados (queda no meio de um append)
+            const uint32_t cut = stetho::RECORDING_HEADER_SIZE + rng.next() % (uint32_t)(bytes - stetho::RECORDING_HEADER_SIZE);
+            storage.truncate("/rec/00002.dat", cut);
+            uint32_t complete = 0;
+            for (const auto &e : entries) {
+                const uint32_t end = (&e == &entries.back()) ? (uint32_t)bytes : (&e + 1)->offset;
+                if (end <= cut) complete++;
+            }
+            // Índice: às vezes atrasado, às vezes inteiro (à frente dos dados), às vezes com lixo
+            switch (t % 3) {
+            case 0: storage.truncate("/rec/00002.idx", (complete / 2) * stetho::RECORDING_INDEX_ENTRY); break;
+            case 1: break;
+            case 2: {
+                const uint8_t junk[5] = {1, 2, 3, 4, 5};
+                storage.truncate("/rec/00002.idx", complete * stetho::RECORDING_INDEX_ENTRY);
+                storage.append("/rec/00002.idx", junk, sizeof(junk));
+                storage.closeAppend();
+                break;
+            }
+            }
+
+            const stetho::RecoveryResult r = stetho::recoverRecording(storage, 2);
+            const long samples = readAll(storage, 2, x);
+            cases++;
+            const bool pass = r.valid && r.chunks == complete && samples == (long)complete * (long)stetho::RECORDING_CHUNK_SAMPLES &&
+                              storage.size("/rec/00002.dat") == (int32_t)(complete ? (complete == entries.size() ? (uint32_t)bytes : entries[complete].offset) : stetho::RECORDING_HEADER_SIZE);
+            if (pass) passed++;
+        }
+
+        // Um byte corrompido no meio: tudo a partir daquele bloco é descartado
+        fs::remove_all(root / "rec" / "00002.dat");
+        fs::remove_all(root / "rec" / "00002.idx");
+        fs::copy_file(root / "rec" / "00001.dat", root / "rec" / "00002.dat");
+        fs::copy_file(root / "rec" / "00001.idx", root / "rec" / "00002.idx");
+        {
+            const uint32_t bad = entries[entries.size() / 2].offset + 40;
+            std::FILE *f = std::fopen((root / "rec" / "00002.dat").c_str(), "r+b");
+            std::fseek(f, bad, SEEK_SET);
+            const int v = std::fgetc(f);
+            std::fseek(f, bad, SEEK_SET);
+            std::fputc(v ^ 0x10, f);
+            std::fclose(f);
+        }
+        const stetho::RecoveryResult r = stetho::recoverRecording(storage, 2);
+        cases++;
+        if (r.chunks == entries.size() / 2 && r.index_rebuilt && readAll(storage, 2, x) >= 0) passed++;
+
+        ok &= passed == cases;
+        std::printf("recuperação após queda: %d/%d casos ok\n", passed, cases);
+    }
+
+    // 4. Transferência em massa: LIST, PULL interrompido e retomado, DELETE
+    {
+        stetho::BulkSender sender(storage);
+        const size_t capacity = 244; // MTU 247
+        uint8_t out[capacity];
+        bool bulk_ok = true;
+
+        const uint8_t list[] = {(uint8_t)stetho::BulkRequest::List};
+        sender.request(list, sizeof(list));
+        size_t entries = 0, len;
+        bool saw_end = false;
+        while ((len = sender.next(out, capacity)) > 0) {
+            if (out[0] == (uint8_t)stetho::BulkResponse::Entry) {
+                entries++;
+                if (stetho::getLe16(out + 1) == 1 && stetho::getLe32(out + 3) != (uint32_t)bytes) bulk_ok = false;
+            }
+            if (out[0] == (uint8_t)stetho::BulkResponse::ListEnd) saw_end = stetho::getLe16(out + 1) == entries;
+        }
+        bulk_ok = bulk_ok && saw_end && entries == 2;
+
+        // PULL cai depois de ~40% e é retomado a partir do que já chegou
+        std::vector<uint8_t> file;
+        size_t notifications = 0;
+        uint8_t pull[7] = {(uint8_t)stetho::BulkRequest::Pull};
+        stetho::putLe16(pull + 1, 1);
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int attempt = 0; attempt < 2; attempt++) {
+            stetho::putLe32(pull + 3, (uint32_t)file.size());
+            sender.request(pull, sizeof(pull));
+            while ((len = sender.next(out, capacity)) > 0) {
+                notifications++;
+                if (out[0] == (uint8_t)stetho::BulkResponse::Data) {
+                    if (stetho::getLe32(out + 3) != file.size()) bulk_ok = false;
+                    file.insert(file.end(), out + stetho::BULK_DATA_HEADER, out + len);
+                    if (attempt == 0 && file.size() > (size_t)bytes * 2 / 5) break; // desconexão
+                } else if (out[0] == (uint8_t)stetho::BulkResponse::PullEnd) {
+                    bulk_ok = bulk_ok && stetho::getLe32(out + 3) == (uint32_t)bytes;
+                }
+            }
+        }
+        const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::vector<uint8_t> original((size_t)bytes);
+        storage.read("/rec/00001.dat", 0, original.data(), original.size());
+        bulk_ok = bulk_ok && file == original;
+
+        // DELETE: recusado durante a gravação da mesma id, depois aceito
+        uint8_t del[3] = {(uint8_t)stetho::BulkRequest::Delete};
+        stetho::putLe16(del + 1, 2);
+        sender.setActiveRecording(true, 2);
+        sender.request(del, sizeof(del));
+        bulk_ok = bulk_ok && sender.next(out, capacity) == 4 && out[3] == (uint8_t)stetho::BulkStatus::Busy;
+        sender.setActiveRecording(false);
+        sender.request(del, sizeof(del));
+        bulk_ok = bulk_ok && sender.next(out, capacity) == 4 && out[3] == (uint8_t)stetho::BulkStatus::Ok &&
+                  storage.size("/rec/00002.dat") < 0;
+
+        ok &= bulk_ok;
+        std::printf("transferência em massa: %zu notificações de até %zu bytes, %.1f MB/s do armazenamento, %s\n",
+                    notifications, capacity, bytes / secs / 1e6, bulk_ok ? "ok" : "FALHOU");
+    }
+
+    // 5. Vazão de escrita: codificação Rice + CRC + append, por bloco de 250 amostras
+    {
+        bench::printHeader("RecordingWriter::write (arquivo no PC)");
+        stetho::RecordingWriter writer(storage);
+        writer.begin(3, stetho::RecordingHeader());
+        const size_t n = bench::BLOCK_SAMPLES;
+        const size_t input_blocks = x.size() / n;
+        bench::Result r = bench::timeBlocks(n, blocks, [&](size_t b) {
+            writer.write(&x[(b % input_blocks) * n], n, (uint32_t)(b * n), 0);
+        });
+        writer.end();
+        bench::printResult("rice + crc + append", r);
+        std::printf("%.2f MB gravados, %.1f MB/s\n", writer.stats().bytes / 1e6,
+                    writer.stats().bytes / (r.ns_per_block * blocks * 1e-9) / 1e6);
+        ok &= writer.stats().errors == 0;
+    }
+
+    fs::remove_all(root);
+    std::printf("\n%s\n", ok ? "gravação ok" : "FALHA na gravação");
+    return ok ? 0 : 1;
+}
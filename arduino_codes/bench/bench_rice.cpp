@@ -0,0 +1,112 @@
+// Codec Rice: ida e volta sem perdas, taxa de compressão e vazão de
+// codificação/decodificação por bloco.
+// Uso: bench_rice [blocos]
+
+#include <string>
+
+#include "bench_common.h"
+#include "core/biquad.h"
+#include "core/rice_codec.h"
+
+struct Signal {
+    std::string name;
+    std::vector<int16_t> samples;
+};
+
+static std::vector<int16_t> filtered(const std::vector<int32_t> &raw, stetho::FilterMode mode) {
+    stetho::FilterBank bank(bench::SAMPLE_RATE, mode);
+    std::vector<int16_t> out(raw.size());
+    for (size_t b = 0; b + bench::BLOCK_SAMPLES <= raw.size(); b += bench::BLOCK_SAMPLES)
+        bank.process(&raw[b], &out[b], bench::BLOCK_SAMPLES);
+    return out;
+}
+
+static std::vector<Signal> makeSignals() {
+    std::vector<Signal> signals;
+    std::vector<int32_t> raw = bench::makeI2SInput();
+    for (size_t m = 0; m < stetho::FILTER_MODE_COUNT; m++) {
+        stetho::FilterMode mode = (stetho::FilterMode)m;
+        signals.push_back({std::string("cardíaco/") + stetho::filterPreset(mode).name, filtered(raw, mode)});
+    }
+
+    std::vector<int16_t> shifted(raw.size());
+    for (size_t i = 0; i < raw.size(); i++) shifted[i] = (int16_t)(raw[i] >> 14);
+    signals.push_back({"cardíaco sem filtro", shifted});
+
+    bench::Rng rng(7);
+    std::vector<int16_t> noise(raw.size()), square(raw.size()), silence(raw.size(), 0);
+    for (size_t i = 0; i < raw.size(); i++) {
+        noise[i] = (int16_t)(rng.next() & 0xFFFF);
+        square[i] = ((i / 40) & 1) ? 32767 : -32768;
+    }
+    signals.push_back({"ruído branco", noise});
+    signals.push_back({"quadrada fundo de escala", square});
+    signals.push_back({"silêncio", silence});
+    return signals;
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    const size_t n = bench::BLOCK_SAMPLES;
+    bool ok = true;
+
+    std::vector<Signal> signals = makeSignals();
+    uint8_t packet[stetho::rice::maxEncodedSize(bench::BLOCK_SAMPLES)];
+    int16_t decoded[bench::BLOCK_SAMPLES];
+
+    std::printf("%-28s %10s %10s %8s %8s\n", "sinal", "bytes PCM", "bytes Rice", "razão", "ida/volta");
+    for (const Signal &s : signals) {
+        size_t pcm_bytes = 0, coded_bytes = 0;
+        bool roundtrip = true;
+        for (size_t b = 0; b + n <= s.samples.size(); b += n) {
+            size_t len = stetho::riceEncode(&s.samples[b], n, packet);
+            int got = stetho::riceDecode(packet, len, decoded, n);
+            if (got != (int)n || std::memcmp(decoded, &s.samples[b], n * sizeof(int16_t)) != 0)
+                roundtrip = false;
+            pcm_bytes += n * sizeof(int16_t);
+            coded_bytes += len;
+        }
+        ok = ok && roundtrip;
+        std::printf("%-28s %10zu %10zu %8.2f %8s\n", s.name.c_str(), pcm_bytes, coded_bytes,
+                    (double)pcm_bytes / (double)coded_bytes, roundtrip ? "ok" : "FALHA");
+    }
+
+    // Tamanhos de bloco irregulares (leituras parciais do I2S)
+    for (size_t len_in : {1u, 2u, 3u, 4u, 17u, 249u}) {
+        const std::vector<int16_t> &x = signals[0].samples;
+        size_t len = stetho::riceEncode(&x[1000], len_in, packet);
+        int got = stetho::riceDecode(packet, len, decoded, n);
+        if (got != (int)len_in || std::memcmp(decoded, &x[1000], len_in * sizeof(int16_t)) != 0) {
+            std::printf("FALHA: ida e volta com bloco de %zu amostras\n", len_in);
+            ok = false;
+        }
+    }
+
+    const std::vector<int16_t> &x = signals[0].samples;
+    const size_t input_blocks = x.size() / n;
+    bench::printHeader("codec Rice (bloco de 250 amostras, cardíaco/wideband)");
+    size_t len = 0;
+    bench::Result r = bench::timeBlocks(n, blocks, [&](size_t b) {
+        len = stetho::riceEncode(&x[(b % input_blocks) * n], n, packet);
+        bench::doNotOptimize(packet);
+    });
+    bench::printResult("codificação", r);
+
+    std::vector<std::vector<uint8_t>> encoded(input_blocks);
+    for (size_t b = 0; b < input_blocks; b++) {
+        len = stetho::riceEncode(&x[b * n], n, packet);
+        encoded[b].assign(packet, packet + len);
+    }
+    r = bench::timeBlocks(n, blocks, [&](size_t b) {
+        const std::vector<uint8_t> &p = encoded[b % input_blocks];
+        stetho::riceDecode(p.data(), p.size(), decoded, n);
+        bench::doNotOptimize(decoded);
+    });
+    bench::printResult("decodificação", r);
+
+    if (!ok) {
+        std::printf("\nFALHA: ida e volta não reproduziu a entrada\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+// Estimador do relógio da amostragem (core/sample_clock.h) contra relógios
+// simulados: o I2S fora da nominal (erro fixo ou derivando com a
+// temperatura) e a ISR com latência aleatória e preempções de vários ms,
+// como a captura vê no ESP32. Confere:
+//  - o erro da taxa estimada, em ppm, depois de estabilizar;
+//  - que o timestamp da reta ajustada não tem o jitter da ISR;
+//  - o offset acumulado contra o verdadeiro;
+//  - a volta do µs de 32 bits e do índice de quadros, e o reset;
+//  - a taxa medida e o offset no StreamInfo, e a leitura do layout antigo;
+// e mede o custo por bloco (update + timestamp).
+//
+// Uso: bench_sample_clock [blocos]
+
+#include <algorithm>
+
+#include "bench_common.h"
+#include "core/sample_clock.h"
+#include "core/stream_format.h"
+
+constexpr uint32_t NOMINAL_HZ = 20000;
+constexpr uint32_t BLOCK = (uint32_t)bench::BLOCK_SAMPLES;
+// Só conta depois disso (o esquecimento tem 30 janelas de 1 s)
+constexpr double SETTLE_S = 60.0;
+
+// Latência da ISR: piso fixo, cauda exponencial e, com probabilidade
+// 'preempt', um atraso de 1 a 8 ms (tarefa de prioridade maior, flash)
+constexpr double ISR_FLOOR_US = 5.0;
+constexpr double ISR_MEAN_US = 20.0;
+
+constexpr double MAX_FITTED_JITTER_US = 10.0;
+constexpr double MAX_OFFSET_ERROR_US = 20.0;
+
+struct Scenario {
+    const char *title;
+    double ppm_start; // erro do relógio do I2S no início e no fim
+    double ppm_end;
+    double seconds;
+    double preempt;
+    uint32_t first_frame; // perto de 2^32 para a volta do índice
+    uint32_t first_us;
+    double max_ppm_error;
+};
+
+struct Outcome {
+    double ppm_error;
+    double raw_jitter_us;   // pico a pico de (medido - verdadeiro)
+    double fitted_jitter_us; // o mesmo para o timestamp da reta
+    double offset_us;
+    double true_offset_us;
+};
+
+static Outcome run(const Scenario &s) {
+    stetho::SampleClockEstimator clock(NOMINAL_HZ);
+    bench::Rng rng(5);
+    const size_t blocks = (size_t)(s.seconds * NOMINAL_HZ / BLOCK);
+    double true_us = 0.0; // instante verdadeiro do fim do bloco desde o início
+    double raw_min = INFINITY, raw_max = -INFINITY, fit_min = INFINITY, fit_max = -INFINITY;
+    double ppm = s.ppm_start;
+    for (size_t b = 0; b < blocks; b++) {
+        ppm = s.ppm_start + (s.ppm_end - s.ppm_start) * (double)b / (double)blocks;
+        const double rate = NOMINAL_HZ * (1.0 + ppm * 1e-6);
+        const double start_us = true_us;
+        true_us += BLOCK * 1e6 / rate;
+        double latency = ISR_FLOOR_US - ISR_MEAN_US * std::log(1.0 - (rng.next() >> 8) / 16777216.0);
+        if ((rng.next() % 1000000) < s.preempt * 1e6) latency += 1000.0 + 7000.0 * (rng.next() % 1000) / 1000.0;
+        // Como a ISR do current.cpp: agora menos o bloco na taxa nominal
+        const uint32_t first_frame = s.first_frame + (uint32_t)(b * BLOCK);
+        const uint32_t measured = s.first_us + (uint32_t)(int64_t)(true_us + latency) - BLOCK * 1000000 / NOMINAL_HZ;
+        clock.update(first_frame, measured);
+        const uint32_t fitted = clock.timestampUs(first_frame, measured);
+        if ((double)b * BLOCK / NOMINAL_HZ < SETTLE_S) continue;
+        const double truth = s.first_us + start_us;
+        // Diferenças em 32 bits, como o app veria depois da volta
+        const double raw_err = (double)(int32_t)(measured - (uint32_t)(int64_t)truth);
+        const double fit_err = (double)(int32_t)(fitted - (uint32_t)(int64_t)truth);
+        raw_min = std::min(raw_min, raw_err);
+        raw_max = std::max(raw_max, raw_err);
+        fit_min = std::min(fit_min, fit_err);
+        fit_max = std::max(fit_max, fit_err);
+    }
+    Outcome o;
+    o.ppm_error = clock.ppm() - ppm;
+    o.raw_jitter_us = raw_max - raw_min;
+    o.fitted_jitter_us = fit_max - fit_min;
+    o.offset_us = clock.offsetUs();
+    // Tempo verdadeiro menos índice / nominal no fim
+    o.true_offset_us = true_us - (double)blocks * BLOCK * 1e6 / NOMINAL_HZ;
+    return o;
+}
+
+//================================================================
+// --- RELÓGIOS SIMULADOS ---
+//================================================================
+static bool scenario(const Scenario &s) {
+    const Outcome o = run(s);
+    const bool ok = std::fabs(o.ppm_error) <= s.max_ppm_error && o.fitted_jitter_us < MAX_FITTED_JITTER_US &&
+                    std::fabs(o.offset_us - o.true_offset_us) <= MAX_OFFSET_ERROR_US;
+    std::printf("%-34s erro %+6.3f ppm (máx %.1f), jitter %6.0f -> %4.1f µs, offset %8.0f µs (real %8.0f) %s\n",
+                s.title, o.ppm_error, s.max_ppm_error, o.raw_jitter_us, o.fitted_jitter_us, o.offset_us,
+                o.true_offset_us, ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+static bool resetAndWarmup() {
+    stetho::SampleClockEstimator clock(NOMINAL_HZ);
+    uint32_t frame = 0, t = 0;
+    bool valid_early = false;
+    auto feed = [&](double seconds, uint32_t jump_us) {
+        t += jump_us;
+        for (size_t b = 0; b < (size_t)(seconds * NOMINAL_HZ / BLOCK); b++) {
+            clock.update(frame, t);
+            valid_early |= clock.valid() && b * BLOCK < (stetho::SampleClockEstimator::MIN_WINDOWS - 1) * NOMINAL_HZ;
+            frame += BLOCK;
+            t += BLOCK * 1000000 / NOMINAL_HZ;
+        }
+    };
+    feed(10.0, 0);
+    const bool valid_before = clock.valid();
+    // O I2S parou 30 s com o índice contínuo: sem reset a taxa sairia errada
+    clock.reset();
+    const bool invalid_after_reset = !clock.valid();
+    feed(10.0, 30000000);
+    const bool ok = valid_before && invalid_after_reset && !valid_early && std::fabs(clock.ppm()) < 0.01 &&
+                    clock.offsetUs() == 0;
+    std::printf("%-34s %s\n", "reset e primeiras janelas", ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+//================================================================
+// --- StreamInfo ---
+//================================================================
+static bool streamInfo() {
+    stetho::StreamInfo info;
+    info.measured_rate_mhz = 20000812;
+    info.clock_offset_us = -1234567;
+    uint8_t buf[stetho::STREAM_INFO_SIZE];
+    const size_t len = stetho::serializeStreamInfo(info, buf);
+    stetho::StreamInfo back, old;
+    old.measured_rate_mhz = 1;
+    old.clock_offset_us = 1;
+    const bool ok = len == stetho::STREAM_INFO_SIZE && stetho::parseStreamInfo(buf, len, back) &&
+                    back.measured_rate_mhz == info.measured_rate_mhz && back.clock_offset_us == info.clock_offset_us &&
+                    // Firmware anterior: só os 10 primeiros bytes, medida zerada
+                    stetho::parseStreamInfo(buf, stetho::STREAM_INFO_BASE_SIZE, old) &&
+                    old.measured_rate_mhz == 0 && old.clock_offset_us == 0 &&
+                    old.sample_rate_hz == info.sample_rate_hz &&
+                    !stetho::parseStreamInfo(buf, stetho::STREAM_INFO_BASE_SIZE - 1, old);
+    std::printf("%-34s %s\n", "StreamInfo com a medida", ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+//================================================================
+// --- CUSTO POR BLOCO ---
+//================================================================
+static void cost(size_t blocks) {
+    bench::printHeader("estimador por bloco (20000 Hz)");
+    stetho::SampleClockEstimator clock(NOMINAL_HZ);
+    bench::Rng rng(9);
+    uint32_t out = 0;
+    bench::Result r = bench::timeBlocks(BLOCK, blocks, [&](size_t b) {
+        const uint32_t frame = (uint32_t)(b * BLOCK);
+        const uint32_t t = (uint32_t)(b * 12500 + 5 + (rng.next() & 31));
+        clock.update(frame, t);
+        out += clock.timestampUs(frame, t);
+    });
+    bench::printResult("update + timestampUs", r);
+    bench::doNotOptimize(out);
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    bool ok = true;
+
+    ok &= scenario({"+40 ppm, ISR com 1% de preempção", 40.0, 40.0, 600.0, 0.01, 0, 0, 0.2});
+    ok &= scenario({"-120 ppm, ISR com 5% de preempção", -120.0, -120.0, 600.0, 0.05, 0, 0, 0.2});
+    ok &= scenario({"deriva térmica 20 -> 35 ppm em 30 min", 20.0, 35.0, 1800.0, 0.01, 0, 0, 1.0});
+    ok &= scenario({"APLL exato, volta do µs e do índice", 0.0, 0.0, 600.0, 0.01, 0xFFFF0000u, 0xFFF00000u, 0.2});
+    ok &= resetAndWarmup();
+    ok &= streamInfo();
+
+    cost(blocks);
+
+    std::printf("\n%s\n", ok ? "OK" : "FALHOU");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,359 @@
+// Gerador de sinais do firmware de bancada: precisão do seno por tabela,
+// ritmo sem deriva contra o vTaskDelay(12) do sine_wave antigo, CRC de
+// referência do PRBS, formas de onda (chirp, impulsos, batimento), comandos
+// de texto e a integridade ponta a ponta gerador -> empacotador -> perdas e
+// reordenação -> remontagem, conferida amostra a amostra. Mede também o
+// custo de gerar um bloco de cada sinal.
+//
+// Uso: bench_signal_generator [blocos]
+
+#include <algorithm>
+#include <cmath>
+
+#include "bench_common.h"
+#include "core/crc32.h"
+#include "core/packetizer.h"
+#include "core/reassembler.h"
+#include "core/signal_generator.h"
+
+using stetho::GeneratorConfig;
+using stetho::SignalGenerator;
+using stetho::SignalKind;
+
+constexpr uint32_t RATE = 20000;
+
+static std::vector<int16_t> generate(const GeneratorConfig &c, size_t n, uint32_t first = 0) {
+    SignalGenerator g;
+    g.configure(c, RATE, first);
+    std::vector<int16_t> x(n);
+    for (size_t done = 0; done < n; done += bench::BLOCK_SAMPLES)
+        g.generate(&x[done], std::min(bench::BLOCK_SAMPLES, n - done));
+    return x;
+}
+
+static size_t risingZeroCrossings(const int16_t *x, size_t n) {
+    size_t count = 0;
+    for (size_t i = 1; i < n; i++)
+        if (x[i - 1] < 0 && x[i] >= 0) count++;
+    return count;
+}
+
+static bool testSine() {
+    const double kPi = 3.14159265358979323846;
+    bench::Rng rng(7);
+    int max_err = 0;
+    for (int i = 0; i < 200000; i++) {
+        const uint32_t phase = rng.next();
+        const double ref = 32767.0 * std::sin(2.0 * kPi * (double)phase / 4294967296.0);
+        const int err = std::abs(stetho::sineFromPhase(phase) - (int)std::lround(ref));
+        max_err = std::max(max_err, err);
+    }
+    // Frequência exata pelo acumulador: 60 Hz = 60 ciclos por segundo, e a
+    // mesma fase começando de qualquer índice
+    GeneratorConfig c;
+    c.tone_hz[0] = 60.0f;
+    const std::vector<int16_t> a = generate(c, 20 * RATE);
+    const std::vector<int16_t> b = generate(c, RATE, 19 * RATE);
+    const size_t cycles = risingZeroCrossings(a.data(), a.size());
+    const bool same = std::equal(b.begin(), b.end(), a.begin() + 19 * RATE);
+    const bool ok = max_err <= 1 && cycles >= 20 * 60 - 1 && cycles <= 20 * 60 && same;
+    std::printf("seno por tabela: erro máx %d LSB, %zu ciclos em 20 s a 60 Hz, fase por índice %s: %s\n", max_err,
+                cycles, same ? "igual" : "diferente", ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+// Uma hora de despertares do esp_timer com atraso aleatório e travadas
+// ocasionais: o ritmo por relógio absoluto fecha exatamente em taxa x tempo
+static bool testPacing() {
+    bench::Rng rng(3);
+    stetho::SamplePacer pacer;
+    pacer.start(1000000, RATE);
+    const int64_t period = 12500, hour = 3600LL * 1000000;
+    uint64_t produced = 0, worst_lag = 0;
+    int64_t now = 0;
+    for (int64_t tick = period; tick <= hour; tick += period) {
+        int64_t late = (int64_t)((rng.uniform() + 1.0) * 1500.0);
+        if (rng.next() % 1000 == 0) late += 40000; // a pilha BLE segurou a tarefa
+        now = std::max(now, 1000000 + tick + late);
+        const uint64_t due = pacer.due(now);
+        worst_lag = std::max(worst_lag, due - produced);
+        produced = due;
+    }
+    produced = pacer.due(1000000 + hour);
+    const bool ok = produced == (uint64_t)RATE * 3600 && pacer.timeOf(RATE) == 2000000;
+    // Antigo: 250 amostras a cada vTaskDelay(12) = 20833 amostras/s
+    const double legacy_rate = 250.0 / 0.012;
+    std::printf("ritmo por esp_timer: %llu amostras em 1 h (erro 0), maior rajada %llu amostras\n",
+                (unsigned long long)produced, (unsigned long long)worst_lag);
+    std::printf("vTaskDelay(12) antigo: %.0f amostras/s (%+.2f%%, %+.0f s de deriva por hora): %s\n", legacy_rate,
+                100.0 * (legacy_rate / RATE - 1.0), 3600.0 * (legacy_rate / RATE - 1.0), ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+static bool testPrbs() {
+    bool ok = stetho::prbsCrc(1, 0, RATE) == stetho::PRBS_REFERENCE_CRC;
+    GeneratorConfig c;
+    c.kind = SignalKind::Prbs;
+    c.seed = 1;
+    std::vector<int16_t> x = generate(c, RATE);
+    std::vector<uint8_t> bytes(2 * x.size());
+    for (size_t i = 0; i < x.size(); i++) stetho::putLe16(&bytes[2 * i], (uint16_t)x[i]);
+    ok &= stetho::crc32(bytes.data(), bytes.size()) == stetho::PRBS_REFERENCE_CRC;
+    // Começando no meio do stream, cada amostra continua sendo prbsSample(semente, índice)
+    c.seed = 0xC0FFEE;
+    x = generate(c, 5000, 0xFFFFF000u);
+    for (size_t i = 0; i < x.size(); i++) ok &= x[i] == stetho::prbsSample(0xC0FFEE, 0xFFFFF000u + (uint32_t)i);
+    // Média e bits usados: ruído branco de 16 bits de verdade
+    double mean = 0;
+    uint16_t ored = 0;
+    for (int16_t v : x) {
+        mean += v;
+        ored |= (uint16_t)v;
+    }
+    mean /= (double)x.size();
+    ok &= std::fabs(mean) < 1500 && ored == 0xFFFF;
+    std::printf("PRBS: CRC de referência 0x%08X, amostras por índice, 16 bits: %s\n", stetho::PRBS_REFERENCE_CRC,
+                ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+static bool testShapes() {
+    bool ok = true;
+    // Chirp linear de 20 a 1000 Hz em 2 s: cruzamentos = (f0 + f1) / 2 x T
+    GeneratorConfig c;
+    c.kind = SignalKind::Chirp;
+    std::vector<int16_t> x = generate(c, 3 * 2 * RATE);
+    for (size_t sweep = 0; sweep < 3; sweep++) {
+        const size_t n = risingZeroCrossings(&x[sweep * 2 * RATE], 2 * RATE);
+        ok &= n + 2 >= 1020 && n <= 1020 + 2;
+    }
+    ok &= std::equal(x.begin(), x.begin() + 2 * RATE, x.begin() + 2 * RATE);
+
+    // Impulsos de 500 ms: exatamente nos múltiplos do período, inclusive
+    // começando no meio do stream
+    c.kind = SignalKind::Impulses;
+    c.impulse_ms = 500.0f;
+    x = generate(c, 5 * RATE, 3333);
+    std::vector<size_t> at;
+    for (size_t i = 0; i < x.size(); i++)
+        if (x[i] != 0) at.push_back(i + 3333);
+    ok &= at.size() == 10;
+    for (size_t k = 0; ok && k < at.size(); k++) ok = at[k] == (k + 1) * 10000 && x[at[k] - 3333] == c.amplitude;
+
+    // Batimento a 72 bpm: um pico por período, no mesmo lugar do ciclo
+    c.kind = SignalKind::Heart;
+    c.heart_bpm = 72;
+    c.amplitude = 32767;
+    x = generate(c, 10 * RATE);
+    const size_t period = RATE * 60 / 72;
+    int16_t peak = 0;
+    for (size_t beat = 0; beat < 10 * RATE / period; beat++) {
+        const auto first = x.begin() + beat * period;
+        const auto pk = std::max_element(first, first + period);
+        ok &= pk - first == std::max_element(x.begin(), x.begin() + period) - x.begin();
+        peak = *pk;
+    }
+    ok &= peak > 29000 && peak <= 30000 && x[period - 1] == 0;
+
+    // Multitom: soma de 50 + 120 + 300 Hz sem saturar
+    c.kind = SignalKind::MultiTone;
+    c.amplitude = 30000;
+    c.tones = 3;
+    c.tone_hz[0] = 50.0f;
+    c.tone_hz[1] = 120.0f;
+    c.tone_hz[2] = 300.0f;
+    x = generate(c, RATE);
+    const auto mm = std::minmax_element(x.begin(), x.end());
+    ok &= *mm.first >= -30000 && *mm.second <= 30000 && *mm.second > 20000;
+    std::printf("chirp, impulsos, batimento e multitom: %s\n", ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+static bool testCommands() {
+    GeneratorConfig c;
+    using stetho::GeneratorCommand;
+    bool ok = stetho::parseGeneratorCommand("sine 440 20000", c) == GeneratorCommand::Signal &&
+              c.kind == SignalKind::Sine && c.tone_hz[0] == 440.0f && c.amplitude == 20000;
+    ok &= stetho::parseGeneratorCommand("tones 50 120 300\r\n", c) == GeneratorCommand::Signal &&
+          c.kind == SignalKind::MultiTone && c.tones == 3 && c.tone_hz[2] == 300.0f;
+    ok &= stetho::parseGeneratorCommand("  chirp 20 2000 1.5", c) == GeneratorCommand::Signal &&
+          c.chirp_end_hz == 2000.0f && c.chirp_seconds == 1.5f;
+    ok &= stetho::parseGeneratorCommand("prbs 1234", c) == GeneratorCommand::Signal && c.seed == 1234;
+    ok &= stetho::parseGeneratorCommand("amp 500", c) == GeneratorCommand::Signal && c.amplitude == 500 &&
+          c.kind == SignalKind::Prbs;
+    ok &= stetho::parseGeneratorCommand("saturate", c) == GeneratorCommand::Saturate;
+    ok &= stetho::parseGeneratorCommand("paced", c) == GeneratorCommand::Paced;
+    // Inválidos não mexem na configuração
+    const GeneratorConfig before = c;
+    for (const char *bad : {"", "sine", "heart 10", "chirp 20 1000", "impulse 0", "amp 40000", "beep 3",
+                            "saturate 1", "muitolongoparaumcomando 1"})
+        ok &= stetho::parseGeneratorCommand(bad, c) == GeneratorCommand::Invalid;
+    ok &= c.kind == before.kind && c.seed == before.seed && c.amplitude == before.amplitude;
+    std::printf("comandos de texto: %s\n", ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+// Confere o stream remontado contra um gerador de referência; buracos
+// (silêncio marcado) avançam a referência sem comparar. O stream começa no
+// primeiro quadro que chegou, que pode não ser o primeiro enviado.
+struct VerifySink : stetho::ReassemblerSink {
+    SignalGenerator reference;
+    uint64_t next = 0, checked = 0, mismatches = 0, gap_samples = 0;
+    bool started = false, contiguous = true;
+    int16_t expected[stetho::Reassembler::MAX_FRAME_SAMPLES];
+
+    void onSamples(uint64_t index, const int16_t *s, size_t n, bool gap) override {
+        if (!started) {
+            started = true;
+            next = index;
+            reference.skip(index);
+            gap_samples += index;
+        }
+        if (index != next) contiguous = false;
+        next = index + n;
+        if (gap) {
+            reference.skip(n);
+            gap_samples += n;
+            return;
+        }
+        for (size_t done = 0; done < n;) {
+            const size_t chunk = std::min(n - done, sizeof(expected) / sizeof(expected[0]));
+            reference.generate(expected, chunk);
+            for (size_t i = 0; i < chunk; i++) mismatches += expected[i] != s[done + i];
+            checked += chunk;
+            done += chunk;
+        }
+    }
+};
+
+static bool endToEnd(const GeneratorConfig &c, stetho::StreamCodec codec, uint16_t mtu, double loss) {
+    SignalGenerator gen;
+    gen.configure(c, RATE);
+    stetho::Packetizer pk;
+    pk.configure(mtu, codec, true, RATE);
+    std::vector<std::vector<uint8_t>> frames;
+    uint8_t packet[stetho::Packetizer::MAX_PAYLOAD];
+    int16_t block[bench::BLOCK_SAMPLES];
+    const size_t total = 10 * RATE;
+    size_t len;
+    for (uint32_t index = 0; index < total; index += bench::BLOCK_SAMPLES) {
+        gen.generate(block, bench::BLOCK_SAMPLES);
+        pk.push(block, bench::BLOCK_SAMPLES, index, index * 50);
+        while (pk.nextPacket(packet, len)) frames.emplace_back(packet, packet + len);
+    }
+    while (pk.flush(packet, len)) frames.emplace_back(packet, packet + len);
+
+    // Perdas e trocas de ordem vizinhas, sempre com a mesma semente
+    bench::Rng rng(11);
+    std::vector<size_t> order;
+    for (size_t i = 0; i < frames.size(); i++)
+        if ((rng.uniform() + 1.0) * 0.5 >= loss) order.push_back(i);
+    for (size_t i = 1; i < order.size(); i++)
+        if (rng.next() % 20 == 0) std::swap(order[i - 1], order[i]);
+
+    VerifySink sink;
+    sink.reference.configure(c, RATE);
+    stetho::Reassembler re(sink);
+    for (size_t i : order) re.push(frames[i].data(), frames[i].size());
+    re.flush();
+    const uint64_t lost = total - sink.checked;
+    const bool ok = sink.contiguous && sink.mismatches == 0 && sink.next == total &&
+                    sink.checked + sink.gap_samples == total && (loss > 0 ? lost > 0 : lost == 0);
+    std::printf("  %-8s %-6s MTU %3u, perda %2.0f%%: %zu quadros, %llu amostras conferidas, %llu em buracos, "
+                "%llu erradas: %s\n",
+                stetho::signalKindName(c.kind), codec == stetho::StreamCodec::Rice ? "Rice" : "Pcm16", mtu,
+                100.0 * loss, frames.size(), (unsigned long long)sink.checked, (unsigned long long)sink.gap_samples,
+                (unsigned long long)sink.mismatches, ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+static bool testEndToEnd() {
+    std::printf("integridade ponta a ponta (10 s):\n");
+    bool ok = true;
+    GeneratorConfig prbs;
+    prbs.kind = SignalKind::Prbs;
+    prbs.seed = 42;
+    GeneratorConfig heart;
+    heart.kind = SignalKind::Heart;
+    GeneratorConfig chirp;
+    chirp.kind = SignalKind::Chirp;
+    ok &= endToEnd(prbs, stetho::StreamCodec::Pcm16, 517, 0.0);
+    ok &= endToEnd(prbs, stetho::StreamCodec::Pcm16, 247, 0.03);
+    ok &= endToEnd(prbs, stetho::StreamCodec::Rice, 185, 0.03);
+    ok &= endToEnd(heart, stetho::StreamCodec::Rice, 517, 0.03);
+    ok &= endToEnd(chirp, stetho::StreamCodec::Pcm16, 23, 0.01);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    bool ok = true;
+    ok &= testSine();
+    ok &= testPacing();
+    ok &= testPrbs();
+    ok &= testShapes();
+    ok &= testCommands();
+    ok &= testEndToEnd();
+
+    bench::printHeader("gerar um bloco de 250 amostras");
+    int16_t block[bench::BLOCK_SAMPLES];
+    {
+        // O sine_wave antigo: sinf por amostra com a fase em float
+        const float kPi = 3.14159265f;
+        const float step = 2.0f * kPi * 60.0f / (float)RATE;
+        float phase = 0.0f;
+        bench::Result r = bench::timeBlocks(bench::BLOCK_SAMPLES, blocks, [&](size_t) {
+            for (size_t i = 0; i < bench::BLOCK_SAMPLES; i++) {
+                block[i] = (int16_t)(10000.0f * sinf(phase));
+                phase += step;
+                if (phase >= 2.0f * kPi) phase -= 2.0f * kPi;
+            }
+            bench::doNotOptimize(block);
+        });
+        bench::printResult("sinf por amostra (antigo)", r);
+    }
+    struct Case {
+        const char *name;
+        SignalKind kind;
+    };
+    const Case cases[] = {{"seno por tabela", SignalKind::Sine},   {"multitom (4)", SignalKind::MultiTone},
+                          {"chirp", SignalKind::Chirp},            {"impulsos", SignalKind::Impulses},
+                          {"batimento", SignalKind::Heart},        {"PRBS", SignalKind::Prbs}};
+    for (const Case &cs : cases) {
+        GeneratorConfig c;
+        c.kind = cs.kind;
+        c.tones = 4;
+        c.tone_hz[1] = 120.0f;
+        c.tone_hz[2] = 300.0f;
+        c.tone_hz[3] = 700.0f;
+        SignalGenerator g;
+        g.configure(c, RATE);
+        bench::Result r = bench::timeBlocks(bench::BLOCK_SAMPLES, blocks, [&](size_t) {
+            g.generate(block, bench::BLOCK_SAMPLES);
+            bench::doNotOptimize(block);
+        });
+        bench::printResult(cs.name, r);
+    }
+    {
+        // Teto do modo saturate sem o rádio: PRBS + empacotador Pcm16 com MTU 517
+        GeneratorConfig c;
+        c.kind = SignalKind::Prbs;
+        SignalGenerator g;
+        g.configure(c, RATE);
+        stetho::Packetizer pk;
+        pk.configure(517, stetho::StreamCodec::Pcm16, true, RATE);
+        uint8_t packet[stetho::Packetizer::MAX_PAYLOAD];
+        uint32_t index = 0;
+        bench::Result r = bench::timeBlocks(bench::BLOCK_SAMPLES, blocks, [&](size_t) {
+            g.generate(block, bench::BLOCK_SAMPLES);
+            pk.push(block, bench::BLOCK_SAMPLES, index, 0);
+            index += bench::BLOCK_SAMPLES;
+            size_t len;
+            while (pk.nextPacket(packet, len)) bench::doNotOptimize(packet);
+        });
+        bench::printResult("PRBS + empacotador (saturate)", r);
+    }
+
+    std::printf("\n%s\n", ok ? "OK" : "FALHOU");
+    return ok ? 0 : 1;
+}
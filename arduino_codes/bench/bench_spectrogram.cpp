@@ -0,0 +1,217 @@
+// Espectrograma em streaming: acurácia da FFT real em ponto fixo contra
+// uma DFT em double e quadros por segundo do motor completo (janela, FFT,
+// nível em dB) para N = 128, 512 e 2048 com salto de N/4.
+//
+// Uso: bench_spectrogram [blocos]
+
+#include <algorithm>
+#include <cmath>
+
+#include "bench_common.h"
+#include "core/biquad.h"
+#include "core/spectrogram.h"
+
+using stetho::RealFft;
+using stetho::SpectrogramEngine;
+
+static const double kPi = 3.14159265358979323846;
+
+// Nível em dBFS de referência, com a mesma janela de Hann e a mesma escala
+// do firmware (senoide de amplitude 32767 = 0 dBFS)
+static std::vector<double> referenceLevels(const int16_t *x, size_t n) {
+    std::vector<double> w(n), out(n / 2);
+    for (size_t i = 0; i < n; i++) w[i] = x[i] * 0.5 * (1.0 - std::cos(2.0 * kPi * (double)i / (double)n));
+    const double ref = 32767.0 * (double)n / 4.0;
+    for (size_t k = 0; k < n / 2; k++) {
+        double re = 0.0, im = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            const double a = 2.0 * kPi * (double)((k * i) % n) / (double)n;
+            re += w[i] * std::cos(a);
+            im -= w[i] * std::sin(a);
+        }
+        const double p = (re * re + im * im) / (ref * ref);
+        out[k] = p > 0.0 ? 10.0 * std::log10(p) : -300.0;
+    }
+    return out;
+}
+
+struct Signal {
+    const char *name;
+    std::vector<int16_t> x;
+};
+
+static std::vector<int16_t> toInt16(const std::vector<double> &v) {
+    std::vector<int16_t> out(v.size());
+    for (size_t i = 0; i < v.size(); i++) {
+        const double s = std::round(v[i] * 32767.0);
+        out[i] = (int16_t)std::max(-32768.0, std::min(32767.0, s));
+    }
+    return out;
+}
+
+static std::vector<Signal> makeSignals(size_t n) {
+    std::vector<Signal> s;
+    bench::Rng rng(7);
+
+    // Tons fora do centro dos bins a 0, -20, -40 e -60 dBFS
+    std::vector<double> tones(n, 0.0);
+    const double freqs[] = {440.3, 1210.7, 3333.3, 7001.9};
+    const double amps[] = {0.5, 0.05, 0.005, 0.0005};
+    for (size_t i = 0; i < n; i++)
+        for (int t = 0; t < 4; t++) tones[i] += amps[t] * std::sin(2.0 * kPi * freqs[t] * (double)i / bench::SAMPLE_RATE);
+    s.push_back({"tons 0/-20/-40/-60 dBFS", toInt16(tones)});
+
+    std::vector<double> full(n);
+    for (size_t i = 0; i < n; i++) full[i] = 0.999 * std::sin(2.0 * kPi * 1000.0 * (double)i / bench::SAMPLE_RATE);
+    s.push_back({"senoide fundo de escala", toInt16(full)});
+
+    std::vector<double> noise(n);
+    for (size_t i = 0; i < n; i++) noise[i] = 0.3 * rng.uniform();
+    s.push_back({"ruído branco", toInt16(noise)});
+
+    // Som cardíaco depois do banco de filtros, como no firmware
+    std::vector<int32_t> raw = bench::makeI2SInput(16000 + RealFft::MAX_SIZE + bench::BLOCK_SAMPLES);
+    std::vector<int16_t> filtered(raw.size());
+    stetho::FilterBank bank(bench::SAMPLE_RATE, stetho::FilterMode::Heart);
+    for (size_t b = 0; b + bench::BLOCK_SAMPLES <= raw.size(); b += bench::BLOCK_SAMPLES)
+        bank.process(&raw[b], &filtered[b], bench::BLOCK_SAMPLES);
+    s.push_back({"som cardíaco filtrado", std::vector<int16_t>(filtered.begin() + 16000, filtered.begin() + 16000 + n)});
+
+    std::vector<int16_t> quiet(n);
+    for (size_t i = 0; i < n; i++) quiet[i] = (int16_t)std::lround(30.0 * std::sin(2.0 * kPi * 2500.0 * (double)i / bench::SAMPLE_RATE));
+    s.push_back({"tom fraco (-61 dBFS)", quiet});
+    return s;
+}
+
+// Erro do nível quantizado contra a referência nos bins até 60 dB abaixo do
+// pico do quadro (a faixa dinâmica útil da FFT de 16 bits)
+static bool testAccuracy(unsigned log2n) {
+    const size_t n = (size_t)1 << log2n;
+    SpectrogramEngine eng;
+    eng.configure((uint8_t)log2n, 0);
+    bool ok = true;
+    for (const Signal &sig : makeSignals(n)) {
+        eng.reset();
+        eng.feed(sig.x.data(), n, 0);
+        if (!eng.hasFrame()) {
+            std::printf("N=%zu %s: quadro não fechou\n", n, sig.name);
+            return false;
+        }
+        const std::vector<double> ref = referenceLevels(sig.x.data(), n);
+        const double peak = *std::max_element(ref.begin(), ref.end());
+        double max_err = 0.0, sum_err = 0.0;
+        size_t counted = 0;
+        for (size_t k = 0; k < n / 2; k++) {
+            if (ref[k] < peak - 60.0 || ref[k] < -127.0) continue;
+            const double got = ((double)eng.levels()[k] - 255.0) / 2.0;
+            const double err = std::fabs(got - std::min(ref[k], 0.0));
+            max_err = std::max(max_err, err);
+            sum_err += err;
+            counted++;
+        }
+        const double mean_err = counted ? sum_err / (double)counted : 0.0;
+        // Degrau de 0,5 dB + ruído de arredondamento da FFT perto de -60 dB do pico
+        const bool pass = counted > 0 && max_err < 3.0 && mean_err < 0.5;
+        std::printf("N=%-5zu %-26s bins=%4zu erro máx %5.2f dB  médio %5.3f dB  %s\n", n, sig.name, counted,
+                    max_err, mean_err, pass ? "ok" : "FALHOU");
+        ok &= pass;
+    }
+    return ok;
+}
+
+// Stream contínuo: índices dos quadros, salto, reinício em descontinuidade e agrupamento
+static bool testStreaming() {
+    SpectrogramEngine eng;
+    eng.configure(9, 2); // N = 512, salto 128
+    std::vector<int16_t> x(4000);
+    for (size_t i = 0; i < x.size(); i++) x[i] = (int16_t)std::lround(8000.0 * std::sin(2.0 * kPi * 1000.0 * (double)i / bench::SAMPLE_RATE));
+
+    uint8_t frame[600];
+    std::vector<uint32_t> firsts;
+    auto run = [&](size_t from, size_t to, uint32_t index) {
+        size_t pos = from;
+        while (pos < to) {
+            size_t n = std::min<size_t>(250, to - pos);
+            size_t done = 0;
+            while (done < n) {
+                done += eng.feed(&x[pos + done], n - done, index + (uint32_t)(pos - from + done));
+                if (eng.hasFrame()) {
+                    size_t len = eng.takeFrame(frame, sizeof(frame));
+                    if (len != stetho::SPECTROGRAM_HEADER + 256 || frame[0] != stetho::SPECTROGRAM_VERSION ||
+                        frame[1] != 9 || stetho::getLe16(frame + 8) != 128 || frame[10] != 1) {
+                        firsts.push_back(0xFFFFFFFFu);
+                    } else {
+                        firsts.push_back(stetho::getLe32(frame + 4));
+                    }
+                }
+            }
+            pos += n;
+        }
+    };
+    run(0, 2000, 1000);
+    const size_t before_gap = firsts.size();
+    run(2000, 4000, 50000); // salto de índice: a janela recomeça
+
+    bool ok = before_gap == (2000 - 512) / 128 + 1;
+    for (size_t i = 0; i < before_gap && ok; i++) ok = firsts[i] == 1000 + 128 * i;
+    for (size_t i = before_gap; i < firsts.size() && ok; i++) ok = firsts[i] == 50000 + 128 * (i - before_gap);
+
+    // MTU 23 (20 bytes de payload): 256 bins agrupados em 8 valores de 32 bins
+    eng.reset();
+    eng.feed(x.data(), 512, 0);
+    const std::vector<uint8_t> full(eng.levels(), eng.levels() + 256);
+    const size_t len = eng.takeFrame(frame, 20);
+    ok &= len == stetho::SPECTROGRAM_HEADER + 8 && frame[10] == 32;
+    for (size_t g = 0; g < 8 && ok; g++)
+        ok = frame[stetho::SPECTROGRAM_HEADER + g] == *std::max_element(full.begin() + 32 * g, full.begin() + 32 * (g + 1));
+
+    // Configuração do comando SetSpectrogram
+    stetho::SpectrogramConfig c;
+    ok &= stetho::decodeSpectrogramConfig(0x29, c) && c.enabled && c.log2n == 9 && c.overlap == 2;
+    ok &= stetho::encodeSpectrogramConfig(c) == 0x29;
+    ok &= stetho::decodeSpectrogramConfig(0, c) && !c.enabled;
+    ok &= !stetho::decodeSpectrogramConfig(0x0A, c); // N = 1024 não é suportado
+    std::printf("stream: %zu quadros, índices/salto/reinício/agrupamento %s\n", firsts.size(), ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv, 4000);
+    bool ok = true;
+
+    for (unsigned log2n = RealFft::MIN_LOG2; log2n <= RealFft::MAX_LOG2; log2n += 2) ok &= testAccuracy(log2n);
+    ok &= testStreaming();
+
+    // Custo por quadro com salto N/4: cada "bloco" é um salto de amostras
+    std::vector<int32_t> raw = bench::makeI2SInput(200000);
+    std::vector<int16_t> x(raw.size());
+    stetho::FilterBank bank(bench::SAMPLE_RATE);
+    for (size_t b = 0; b + bench::BLOCK_SAMPLES <= raw.size(); b += bench::BLOCK_SAMPLES)
+        bank.process(&raw[b], &x[b], bench::BLOCK_SAMPLES);
+
+    bench::printHeader("espectrograma (por quadro, salto N/4)");
+    for (unsigned log2n = RealFft::MIN_LOG2; log2n <= RealFft::MAX_LOG2; log2n += 2) {
+        SpectrogramEngine eng;
+        eng.configure((uint8_t)log2n, 2);
+        const size_t hop = eng.hop();
+        uint8_t frame[stetho::SPECTROGRAM_HEADER + SpectrogramEngine::MAX_BINS];
+        size_t pos = 0;
+        uint32_t index = 0;
+        bench::Result r = bench::timeBlocks(hop, blocks, [&](size_t) {
+            if (pos + hop > x.size()) pos = 0;
+            size_t done = 0;
+            while (done < hop) {
+                done += eng.feed(&x[pos + done], hop - done, index + (uint32_t)done);
+                if (eng.hasFrame()) bench::doNotOptimize(eng.takeFrame(frame, sizeof(frame)));
+            }
+            pos += hop;
+            index += (uint32_t)hop;
+        });
+        char name[48];
+        std::snprintf(name, sizeof(name), "N=%zu (%.0f quadros/s)", eng.fftSize(), 1e9 / r.ns_per_block);
+        bench::printResult(name, r);
+    }
+
+    std::printf("\n%s\n", ok ? "OK" : "FALHOU");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+// Instrumentação do caminho quente: custo de um StageTimer por bloco,
+// janela (média/p99) calculada pelas diferenças de leitura, leitura
+// concorrente sem trava, layout da característica de diagnóstico e
+// realinhamento do trace binário no meio de texto.
+//
+// Uso: bench_stats [blocos]
+
+#include <thread>
+
+#include "bench_common.h"
+#include "core/biquad.h"
+#include "core/resampler.h"
+#include "core/stats.h"
+
+using stetho::StageSnapshot;
+using stetho::StageStats;
+using stetho::StageWindow;
+
+static bool testWindow() {
+    StageStats st;
+    StageSnapshot before, after;
+    st.record(5);
+    st.snapshot(before);
+    // 990 registros de 1000 ciclos e 10 de 100000: p99 ainda no bin de 1000
+    for (int i = 0; i < 990; i++) st.record(1000);
+    for (int i = 0; i < 10; i++) st.record(100000);
+    st.snapshot(after);
+    StageWindow w = stetho::stageWindow(after, before);
+    bool ok = w.count == 1000 && w.avg == (990 * 1000 + 10 * 100000) / 1000 && w.p99 == 1023 && w.max == 100000;
+    // Mais um lento passa o p99 para o bin de 100000
+    st.record(100000);
+    st.snapshot(after);
+    w = stetho::stageWindow(after, before);
+    ok &= w.count == 1001 && w.p99 == 131071;
+    // Janela vazia
+    w = stetho::stageWindow(after, after);
+    ok &= w.count == 0 && w.avg == 0 && w.p99 == 0;
+    // Totais dando a volta em 32 bits
+    StageStats wrap;
+    for (int i = 0; i < 3; i++) wrap.record(0x7FFFFFFFu);
+    wrap.snapshot(before);
+    for (int i = 0; i < 2; i++) wrap.record(0x60000000u);
+    wrap.snapshot(after);
+    w = stetho::stageWindow(after, before);
+    ok &= w.count == 2 && w.avg == 0x60000000u;
+    std::printf("janela (média, p99, máximo, volta em 32 bits): %s\n", ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+// Um escritor registrando sem parar e um leitor fazendo leituras: as
+// contagens só crescem e no fim batem exatamente
+static bool testConcurrent() {
+    StageStats st;
+    stetho::StatCounter counter;
+    const uint32_t total = 2000000;
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (uint32_t i = 0; i < total; i++) {
+            st.record(i & 1023);
+            counter.add();
+        }
+        done = true;
+    });
+    bool ok = true;
+    uint32_t last = 0, reads = 0;
+    StageSnapshot snap;
+    while (!done) {
+        st.snapshot(snap);
+        ok &= snap.count >= last && counter.load() <= total;
+        last = snap.count;
+        reads++;
+    }
+    writer.join();
+    st.snapshot(snap);
+    uint32_t binned = 0;
+    for (size_t b = 0; b < StageSnapshot::BINS; b++) binned += snap.hist[b];
+    ok &= snap.count == total && binned == total && counter.load() == total && snap.max == 1023;
+    std::printf("escritor + leitor concorrentes (%u leituras): %s\n", reads, ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+static bool testLayouts() {
+    stetho::Diagnostics d, back;
+    d.cpu_mhz = 240;
+    d.uptime_ms = 123456;
+    d.samples_per_sec = 19998;
+    for (size_t s = 0; s < stetho::STAGE_COUNT; s++) d.stages[s] = {80u + (uint32_t)s, 1000u * (uint32_t)s, 2047, 9000};
+    d.dma_overruns = 1;
+    d.ring_overflows = 2;
+    d.notify_failures = 3;
+    d.stack_free[0] = 4321;
+    d.stack_free[1] = 1234;
+    d.free_heap = 150000;
+    d.min_free_heap = 120000;
+    d.power_state = 2;
+    d.last_connect_cold = true;
+    d.connect_latency_us = 41000;
+    d.connect_latency_max_cold_us = 52000;
+    d.capture_idle_s = 3600;
+    d.capture_stops = 7;
+    uint8_t buf[stetho::DIAGNOSTICS_SIZE];
+    bool ok = stetho::serializeDiagnostics(d, buf) == stetho::DIAGNOSTICS_SIZE &&
+              stetho::parseDiagnostics(buf, sizeof(buf), back);
+    ok &= back.cpu_mhz == 240 && back.uptime_ms == 123456 && back.samples_per_sec == 19998 &&
+          back.stages[2].count == 82 && back.stages[1].avg == 1000 && back.stages[0].p99 == 2047 &&
+          back.dma_overruns == 1 && back.ring_overflows == 2 && back.notify_failures == 3 &&
+          back.stack_free[0] == 4321 && back.stack_free[2] == 0 && back.min_free_heap == 120000;
+    ok &= back.power_state == 2 && back.last_connect_cold && back.connect_latency_us == 41000 &&
+          back.connect_latency_max_warm_us == 0 && back.connect_latency_max_cold_us == 52000 &&
+          back.capture_idle_s == 3600 && back.capture_stops == 7;
+    ok &= !stetho::parseDiagnostics(buf, 20, back); // notificação truncada com MTU 23
+    // Firmware anterior, sem os campos de energia
+    stetho::Diagnostics old;
+    ok &= stetho::parseDiagnostics(buf, stetho::DIAGNOSTICS_BASE_SIZE, old) && old.min_free_heap == 120000 &&
+          old.capture_stops == 0;
+
+    // Trace: registros entre texto e um registro corrompido
+    std::vector<uint8_t> serial;
+    const char *text = "Captura: 20000 amostras/s\n";
+    serial.insert(serial.end(), text, text + std::strlen(text));
+    uint8_t rec[stetho::TRACE_RECORD_SIZE];
+    for (uint32_t i = 0; i < 5; i++) {
+        stetho::serializeTraceRecord({(uint8_t)(i % 2), 1000 * i, 50 + i}, rec);
+        if (i == 2) rec[4] ^= 0x10;
+        serial.insert(serial.end(), rec, rec + sizeof(rec));
+        if (i == 3) serial.insert(serial.end(), text, text + 5);
+    }
+    std::vector<stetho::TraceRecord> got;
+    size_t pos = 0;
+    while (pos < serial.size()) {
+        stetho::TraceRecord r;
+        bool found;
+        size_t used = stetho::parseTraceRecord(serial.data() + pos, serial.size() - pos, r, found);
+        if (used == 0) break;
+        pos += used;
+        if (found) got.push_back(r);
+    }
+    ok &= got.size() == 4 && got[0].start == 0 && got[1].cycles == 51 && got[2].start == 3000 &&
+          got[3].stage == 0 && got[3].cycles == 54;
+    std::printf("layout do diagnóstico e trace binário: %s\n", ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    bool ok = true;
+    ok &= testWindow();
+    ok &= testConcurrent();
+    ok &= testLayouts();
+
+    // Custo da instrumentação: o bloco da captura com e sem StageTimer
+    std::vector<int32_t> x = bench::makeI2SInput();
+    const size_t total_blocks = x.size() / bench::BLOCK_SAMPLES;
+    stetho::FilterBank bank(bench::SAMPLE_RATE, stetho::FilterMode::Heart);
+    stetho::Decimator dec(stetho::OutputRate::Hz4000);
+    int16_t filtered[bench::BLOCK_SAMPLES], out[bench::BLOCK_SAMPLES + 1];
+
+    bench::printHeader("bloco da captura (filtro coração + decimação 4 kHz)");
+    bench::Result base = bench::timeBlocks(bench::BLOCK_SAMPLES, blocks, [&](size_t b) {
+        bank.process(&x[(b % total_blocks) * bench::BLOCK_SAMPLES], filtered, bench::BLOCK_SAMPLES);
+        bench::doNotOptimize(dec.process(filtered, bench::BLOCK_SAMPLES, out));
+    });
+    bench::printResult("sem instrumentação", base);
+
+    StageStats dsp;
+    bench::Result timed = bench::timeBlocks(bench::BLOCK_SAMPLES, blocks, [&](size_t b) {
+        stetho::StageTimer timer(dsp);
+        bank.process(&x[(b % total_blocks) * bench::BLOCK_SAMPLES], filtered, bench::BLOCK_SAMPLES);
+        bench::doNotOptimize(dec.process(filtered, bench::BLOCK_SAMPLES, out));
+    });
+    bench::printResult("com StageTimer", timed);
+
+    StageStats empty;
+    bench::Result bare = bench::timeBlocks(1, blocks, [&](size_t) { stetho::StageTimer timer(empty); });
+    std::printf("StageTimer vazio: %.1f ns, %.0f ciclos\n", bare.ns_per_block, bare.cycles_per_block);
+
+    // A mesma janela que o firmware publica, aqui sobre o bench
+    StageSnapshot zero, snap;
+    dsp.snapshot(snap);
+    const StageWindow w = stetho::stageWindow(snap, zero);
+    std::printf("janela do StageStats: %u blocos, média %u, p99 <= %u, máx %u ciclos\n", w.count, w.avg, w.p99,
+                w.max);
+
+    std::printf("\n%s\n", ok ? "OK" : "FALHOU");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+// Caminho da captura até o pacote BLE: o antigo (i2s_read copiando do DMA,
+// buffer filtrado separado, decimação com memcpy a 20 kHz, setValue copiando
+// o pacote) contra o novo (filtro no próprio buffer do DMA, saída direto no
+// slot da fila, pacote entregue sem cópia). Confere que os pacotes saem
+// idênticos e mede o tempo do buffer cheio até os pacotes prontos.
+//
+// Uso: bench_zero_copy [blocos]
+
+#include <string>
+
+#include "bench_common.h"
+#include "core/biquad.h"
+#include "core/packetizer.h"
+#include "core/resampler.h"
+
+using stetho::OutputRate;
+
+constexpr size_t N = bench::BLOCK_SAMPLES;
+
+struct Path {
+    stetho::FilterBank bank{bench::SAMPLE_RATE, stetho::FilterMode::Heart};
+    stetho::Decimator dec;
+    stetho::Packetizer pk;
+    uint32_t index = 0;
+    explicit Path(OutputRate rate) : dec(rate) {
+        pk.configure(517, stetho::StreamCodec::Pcm16, true, stetho::outputRateRatio(rate).hz);
+    }
+};
+
+// Antes: i2s_read -> raw_samples -> filtered_samples -> slot -> pacote -> valor da característica
+struct LegacyPath : Path {
+    int32_t raw[N];
+    int16_t filtered[N];
+    int16_t slot[N + 1];
+    uint8_t packet[stetho::Packetizer::MAX_PAYLOAD];
+    std::string value; // BLECharacteristic::setValue guarda uma cópia
+    using Path::Path;
+
+    template <typename Sink>
+    void block(const int32_t *dma, Sink &&sink) {
+        std::memcpy(raw, dma, sizeof(raw));
+        bank.process(raw, filtered, N);
+        const size_t out = dec.process(filtered, N, slot);
+        pk.push(slot, out, index, 0);
+        index += (uint32_t)out;
+        size_t len;
+        while (pk.nextPacket(packet, len)) {
+            value.assign((const char *)packet, len);
+            sink((const uint8_t *)value.data(), value.size());
+        }
+    }
+};
+
+// Agora: o DMA entrega o ponteiro; a 20 kHz o filtro escreve no slot, senão
+// converte no lugar e a decimação escreve no slot. O pacote vai direto.
+struct ZeroCopyPath : Path {
+    int16_t slot[N + 1];
+    uint8_t packet[stetho::Packetizer::MAX_PAYLOAD];
+    using Path::Path;
+
+    template <typename Sink>
+    void block(int32_t *dma, Sink &&sink) {
+        size_t out;
+        if (dec.preparePassthrough()) {
+            bank.process(dma, slot, N);
+            out = N;
+        } else {
+            int16_t *pcm = bank.processInPlace(dma, N);
+            out = dec.process(pcm, N, slot);
+        }
+        pk.push(slot, out, index, 0);
+        index += (uint32_t)out;
+        size_t len;
+        while (pk.nextPacket(packet, len)) sink(packet, len);
+    }
+};
+
+// Cópias puras por amostra de entrada em cada caminho (sem contar a da pilha BLE)
+static void printCopies(OutputRate rate) {
+    const double ratio = (double)stetho::outputRateRatio(rate).hz / bench::SAMPLE_RATE;
+    const bool passthrough = rate == OutputRate::Hz20000;
+    // i2s_read (4 bytes), memcpy do decimador, pacote e setValue (2 bytes cada, na taxa de saída)
+    const double legacy_copies = 1.0 + (passthrough ? 1.0 : 0.0) + 2.0 * ratio;
+    const double legacy_bytes = 4.0 + (passthrough ? 2.0 : 0.0) + 4.0 * ratio;
+    std::printf("%5u Hz: cópias por amostra %.1f -> %.1f, bytes copiados por amostra %.1f -> %.1f\n",
+                stetho::outputRateRatio(rate).hz, legacy_copies, ratio, legacy_bytes, 2.0 * ratio);
+}
+
+int main(int argc, char **argv) {
+    const size_t blocks = bench::blocksFromArgs(argc, argv);
+    const std::vector<int32_t> input = bench::makeI2SInput();
+    const size_t total_blocks = input.size() / N;
+    bool ok = true;
+
+    for (OutputRate rate : {OutputRate::Hz20000, OutputRate::Hz4000}) {
+        // Os dois caminhos precisam gerar exatamente os mesmos pacotes
+        LegacyPath legacy(rate);
+        ZeroCopyPath zero(rate);
+        std::vector<uint8_t> a, b;
+        int32_t dma[N];
+        for (size_t blk = 0; blk < total_blocks; blk++) {
+            std::memcpy(dma, &input[blk * N], sizeof(dma));
+            legacy.block(dma, [&](const uint8_t *p, size_t len) { a.insert(a.end(), p, p + len); });
+            zero.block(dma, [&](const uint8_t *p, size_t len) { b.insert(b.end(), p, p + len); });
+        }
+        const bool same = !a.empty() && a == b;
+        std::printf("%5u Hz: %zu bytes de pacotes, caminhos idênticos: %s\n", stetho::outputRateRatio(rate).hz,
+                    a.size(), same ? "ok" : "FALHOU");
+        ok &= same;
+    }
+
+    std::printf("\n");
+    printCopies(OutputRate::Hz20000);
+    printCopies(OutputRate::Hz4000);
+
+    // Do buffer cheio até os pacotes prontos. O memcpy que recarrega o
+    // "buffer do DMA" entra nos dois lados (no ESP32 é o próprio DMA).
+    for (OutputRate rate : {OutputRate::Hz20000, OutputRate::Hz4000}) {
+        char title[64];
+        std::snprintf(title, sizeof(title), "buffer do DMA -> pacotes (%u Hz)", stetho::outputRateRatio(rate).hz);
+        bench::printHeader(title);
+        size_t sent = 0;
+        auto sink = [&](const uint8_t *p, size_t len) { sent += len + p[0]; };
+        int32_t dma[N];
+
+        LegacyPath legacy(rate);
+        bench::Result r = bench::timeBlocks(N, blocks, [&](size_t blk) {
+            std::memcpy(dma, &input[(blk % total_blocks) * N], sizeof(dma));
+            legacy.block(dma, sink);
+        });
+        bench::printResult("i2s_read + cópias (antes)", r);
+
+        ZeroCopyPath zero(rate);
+        r = bench::timeBlocks(N, blocks, [&](size_t blk) {
+            std::memcpy(dma, &input[(blk % total_blocks) * N], sizeof(dma));
+            zero.block(dma, sink);
+        });
+        bench::printResult("no lugar, sem cópias (agora)", r);
+        bench::doNotOptimize(sent);
+    }
+
+    std::printf("\n%s\n", ok ? "OK" : "FALHOU");
+    return ok ? 0 : 1;
+}
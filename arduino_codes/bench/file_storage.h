@@ -0,0 +1,88 @@
+#pragma once
+
+// Implementação de stetho::Storage sobre arquivos comuns, para rodar no PC
+// os testes de gravação/recuperação que no ESP32 usam o LittleFS.
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "core/storage.h"
+
+namespace bench {
+
+class FileStorage : public stetho::Storage {
+public:
+    // Os caminhos do firmware ("/rec/00001.dat") ficam dentro de 'root'
+    explicit FileStorage(const std::string &root) : root_(root) {}
+    ~FileStorage() override { closeAppend(); }
+
+    bool append(const char *path, const uint8_t *data, size_t len) override {
+        if (append_path_ != path) {
+            closeAppend();
+            const std::string full = resolve(path);
+            std::filesystem::create_directories(std::filesystem::path(full).parent_path());
+            append_file_ = std::fopen(full.c_str(), "ab");
+            if (!append_file_) return false;
+            append_path_ = path;
+        }
+        return std::fwrite(data, 1, len, append_file_) == len;
+    }
+
+    bool flush(const char *path) override {
+        if (append_path_ == path && append_file_) return std::fflush(append_file_) == 0;
+        return true;
+    }
+
+    size_t read(const char *path, uint32_t offset, uint8_t *out, size_t len) override {
+        if (append_path_ == path && append_file_) std::fflush(append_file_);
+        std::FILE *f = std::fopen(resolve(path).c_str(), "rb");
+        if (!f) return 0;
+        size_t got = 0;
+        if (std::fseek(f, (long)offset, SEEK_SET) == 0) got = std::fread(out, 1, len, f);
+        std::fclose(f);
+        return got;
+    }
+
+    int32_t size(const char *path) override {
+        if (append_path_ == path && append_file_) std::fflush(append_file_);
+        std::error_code ec;
+        const auto s = std::filesystem::file_size(resolve(path), ec);
+        return ec ? -1 : (int32_t)s;
+    }
+
+    bool truncate(const char *path, uint32_t size) override {
+        if (append_path_ == path) closeAppend();
+        std::error_code ec;
+        std::filesystem::resize_file(resolve(path), size, ec);
+        return !ec;
+    }
+
+    bool remove(const char *path) override {
+        if (append_path_ == path) closeAppend();
+        std::error_code ec;
+        return std::filesystem::remove(resolve(path), ec);
+    }
+
+    void list(const char *dir, void (*fn)(const char *name, void *ctx), void *ctx) override {
+        std::error_code ec;
+        for (const auto &e : std::filesystem::directory_iterator(resolve(dir), ec))
+            if (e.is_regular_file()) fn(e.path().filename().string().c_str(), ctx);
+    }
+
+    // Fecha o arquivo aberto para escrita, como numa queda de energia
+    void closeAppend() {
+        if (append_file_) std::fclose(append_file_);
+        append_file_ = nullptr;
+        append_path_.clear();
+    }
+
+private:
+    std::string resolve(const char *path) const { return root_ + path; }
+
+    std::string root_;
+    std::string append_path_;
+    std::FILE *append_file_ = nullptr;
+};
+
+} // namespace bench
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "block_float.h"
+#include "compiler.h"
+#include "fixed_point.h"
+#include "sample_kernels.h"
+
+//================================================================
+// --- CASCATA DE BIQUADS (FORMA DIRETA II TRANSPOSTA) ---
+//================================================================
+// Cada seção: y = b0*x + z1;  z1 = b1*x - a1*y + z2;  z2 = b2*x - a2*y
+// O bloco é processado seção por seção, o que mantém os coeficientes em
+// registradores e usa a FPU do ESP32-S3 sem conversões no meio do laço.
+
+namespace stetho {
+
+struct BiquadCoeffs {
+    float b0, b1, b2, a1, a2;
+};
+
+// Projetos do "Audio EQ Cookbook" (RBJ), normalizados por a0
+inline BiquadCoeffs designLowPass(double fc, double fs, double q) {
+    const double w0 = 2.0 * M_PI * fc / fs;
+    const double alpha = std::sin(w0) / (2.0 * q);
+    const double c = std::cos(w0);
+    const double a0 = 1.0 + alpha;
+    return {(float)((1.0 - c) / 2.0 / a0), (float)((1.0 - c) / a0),
+            (float)((1.0 - c) / 2.0 / a0), (float)(-2.0 * c / a0), (float)((1.0 - alpha) / a0)};
+}
+
+inline BiquadCoeffs designHighPass(double fc, double fs, double q) {
+    const double w0 = 2.0 * M_PI * fc / fs;
+    const double alpha = std::sin(w0) / (2.0 * q);
+    const double c = std::cos(w0);
+    const double a0 = 1.0 + alpha;
+    return {(float)((1.0 + c) / 2.0 / a0), (float)(-(1.0 + c) / a0),
+            (float)((1.0 + c) / 2.0 / a0), (float)(-2.0 * c / a0), (float)((1.0 - alpha) / a0)};
+}
+
+// Módulo da resposta de uma seção em 'f' Hz, calculado em double
+inline double biquadMagnitude(const BiquadCoeffs &c, double f, double fs) {
+    const double w = 2.0 * M_PI * f / fs;
+    const double cr = std::cos(w), ci = -std::sin(w);      // e^-jw
+    const double c2r = std::cos(2 * w), c2i = -std::sin(2 * w); // e^-2jw
+    const double nr = c.b0 + c.b1 * cr + c.b2 * c2r, ni = c.b1 * ci + c.b2 * c2i;
+    const double dr = 1.0 + c.a1 * cr + c.a2 * c2r, di = c.a1 * ci + c.a2 * c2i;
+    return std::sqrt((nr * nr + ni * ni) / (dr * dr + di * di));
+}
+
+template <size_t MaxSections>
+class BiquadCascade {
+public:
+    void setSections(const BiquadCoeffs *coeffs, size_t count) {
+        count_ = count < MaxSections ? count : MaxSections;
+        for (size_t s = 0; s < count_; s++) coeffs_[s] = coeffs[s];
+        reset();
+    }
+
+    void reset() {
+        for (size_t s = 0; s < MaxSections; s++) z1_[s] = z2_[s] = 0.0f;
+    }
+
+    // Coloca o estado em regime permanente para uma entrada constante 'u',
+    // evitando o degrau que o offset DC causaria ao ligar a cascata.
+    void primeSteadyState(float u) {
+        for (size_t s = 0; s < count_; s++) {
+            const BiquadCoeffs &c = coeffs_[s];
+            float y = u * (c.b0 + c.b1 + c.b2) / (1.0f + c.a1 + c.a2);
+            z2_[s] = c.b2 * u - c.a2 * y;
+            z1_[s] = c.b1 * u - c.a1 * y + z2_[s];
+            u = y;
+        }
+    }
+
+    STETHO_HOT void process(float *buf, size_t n) {
+        for (size_t s = 0; s < count_; s++) {
+            const float b0 = coeffs_[s].b0, b1 = coeffs_[s].b1, b2 = coeffs_[s].b2;
+            const float a1 = coeffs_[s].a1, a2 = coeffs_[s].a2;
+            float z1 = z1_[s], z2 = z2_[s];
+            for (size_t i = 0; i < n; i++) {
+                const float x = buf[i];
+                const float y = b0 * x + z1;
+                z1 = b1 * x - a1 * y + z2;
+                z2 = b2 * x - a2 * y;
+                buf[i] = y;
+            }
+            z1_[s] = z1;
+            z2_[s] = z2;
+        }
+    }
+
+    double magnitude(double f, double fs) const {
+        double m = 1.0;
+        for (size_t s = 0; s < count_; s++) m *= biquadMagnitude(coeffs_[s], f, fs);
+        return m;
+    }
+
+    size_t sections() const { return count_; }
+
+private:
+    BiquadCoeffs coeffs_[MaxSections] = {};
+    float z1_[MaxSections] = {};
+    float z2_[MaxSections] = {};
+    size_t count_ = 0;
+};
+
+//================================================================
+// --- BANCO DE FILTROS DE AUSCULTA ---
+//================================================================
+// Presets: passa-altas Butterworth de 4ª ordem + passa-baixas de 4ª ordem.
+// Todos têm 4 seções, então o custo por bloco não depende do modo.
+
+enum class FilterMode : uint8_t {
+    Wideband = 0, // 20 Hz - 2 kHz
+    Heart = 1,    // 20 Hz - 200 Hz (modo campânula)
+    Lung = 2,     // 100 Hz - 1 kHz (modo diafragma)
+};
+
+constexpr size_t FILTER_MODE_COUNT = 3;
+
+struct FilterPreset {
+    const char *name;
+    double low_hz;
+    double high_hz;
+};
+
+inline const FilterPreset &filterPreset(FilterMode mode) {
+    static const FilterPreset presets[FILTER_MODE_COUNT] = {
+        {"wideband", 20.0, 2000.0},
+        {"heart", 20.0, 200.0},
+        {"lung", 100.0, 1000.0},
+    };
+    return presets[(size_t)mode < FILTER_MODE_COUNT ? (size_t)mode : 0];
+}
+
+class FilterBank {
+public:
+    static constexpr size_t SECTIONS = 4;
+    // Bloco máximo processado de uma vez (blocos maiores são fatiados)
+    static constexpr size_t MAX_BLOCK = 256;
+
+    explicit FilterBank(double sample_rate, FilterMode mode = FilterMode::Wideband)
+        : sample_rate_(sample_rate), active_((uint8_t)mode), pending_((uint8_t)mode) {
+        for (size_t m = 0; m < FILTER_MODE_COUNT; m++) designBank((FilterMode)m, designs_[m]);
+        cascade_[0].setSections(designs_[(uint8_t)mode], SECTIONS);
+    }
+
+    // Pode ser chamado de outra tarefa (callback BLE). A troca acontece no
+    // início do próximo bloco.
+    void requestMode(FilterMode mode) {
+        if ((size_t)mode < FILTER_MODE_COUNT) pending_.store((uint8_t)mode, std::memory_order_relaxed);
+    }
+
+    // Modo em uso; também pode ser lido de outra tarefa
+    FilterMode mode() const { return (FilterMode)active_.load(std::memory_order_relaxed); }
+
+    // Palavras I2S de 32 bits -> int16 na mesma escala do >> 14
+    STETHO_HOT void process(const int32_t *in, int16_t *out, size_t n) {
+        while (n > 0) {
+            const size_t len = n < MAX_BLOCK ? n : MAX_BLOCK;
+            processChunk(in, out, len);
+            in += len;
+            out += len;
+            n -= len;
+        }
+    }
+
+    // Mesmo processamento sobre o próprio buffer do DMA: cada trecho é lido
+    // inteiro para work_ antes de ser escrito, então o int16 de saída pode
+    // ocupar a metade de baixo da memória das palavras de 32 bits. Devolve o
+    // início das amostras de 16 bits.
+    STETHO_HOT int16_t *processInPlace(int32_t *buf, size_t n) {
+        int16_t *out = reinterpret_cast<int16_t *>(buf);
+        process(buf, out, n);
+        return out;
+    }
+
+    // Mesmo filtro, com a saída na escala larga de core/block_float.h (2^5
+    // vezes a do >> 14, sem saturar) escrita por cima das palavras de entrada
+    STETHO_HOT void widenInPlace(int32_t *buf, size_t n) {
+        const float scale = (float)(1 << BFP_WIDE_BITS);
+        while (n > 0) {
+            const size_t len = n < MAX_BLOCK ? n : MAX_BLOCK;
+            filterChunk(buf, len);
+            for (size_t i = 0; i < len; i++) buf[i] = (int32_t)(work_[i] * scale);
+            buf += len;
+            n -= len;
+        }
+    }
+
+    // Resposta projetada (double) do modo em 'f' Hz
+    double designMagnitude(FilterMode mode, double f) const {
+        double m = 1.0;
+        for (size_t s = 0; s < SECTIONS; s++)
+            m *= biquadMagnitude(designs_[(size_t)mode][s], f, sample_rate_);
+        return m;
+    }
+
+private:
+    void designBank(FilterMode mode, BiquadCoeffs *out) const {
+        // Q das duas seções de um Butterworth de 4ª ordem
+        const double q1 = 0.54119610, q2 = 1.30656296;
+        const FilterPreset &p = filterPreset(mode);
+        out[0] = designHighPass(p.low_hz, sample_rate_, q1);
+        out[1] = designHighPass(p.low_hz, sample_rate_, q2);
+        out[2] = designLowPass(p.high_hz, sample_rate_, q1);
+        out[3] = designLowPass(p.high_hz, sample_rate_, q2);
+    }
+
+    void processChunk(const int32_t *in, int16_t *out, size_t n) {
+        filterChunk(in, n);
+        for (size_t i = 0; i < n; i++) out[i] = sat16((int32_t)work_[i]);
+    }
+
+    // Filtra um trecho para work_, na escala do >> 14
+    void filterChunk(const int32_t *in, size_t n) {
+        const float scale = 1.0f / (float)(1 << I2S_TO_INT16_SHIFT);
+        for (size_t i = 0; i < n; i++) work_[i] = (float)in[i] * scale;
+
+        const uint8_t pending = pending_.load(std::memory_order_relaxed);
+        if (pending == active_.load(std::memory_order_relaxed)) {
+            cascade_[current_].process(work_, n);
+            return;
+        }
+
+        // Troca de modo: a cascata nova parte do regime permanente da média
+        // do bloco e as duas saídas são misturadas linearmente ao longo dele.
+        float mean = 0.0f;
+        for (size_t i = 0; i < n; i++) mean += work_[i];
+        mean /= (float)n;
+
+        const size_t next = current_ ^ 1u;
+        cascade_[next].setSections(designs_[pending], SECTIONS);
+        cascade_[next].primeSteadyState(mean);
+        for (size_t i = 0; i < n; i++) fade_[i] = work_[i];
+
+        cascade_[current_].process(work_, n);
+        cascade_[next].process(fade_, n);
+        const float step = 1.0f / (float)n;
+        for (size_t i = 0; i < n; i++) {
+            const float g = (float)(i + 1) * step;
+            work_[i] = work_[i] + g * (fade_[i] - work_[i]);
+        }
+        current_ = next;
+        active_.store(pending, std::memory_order_relaxed);
+    }
+
+    double sample_rate_;
+    BiquadCoeffs designs_[FILTER_MODE_COUNT][SECTIONS];
+    BiquadCascade<SECTIONS> cascade_[2];
+    size_t current_ = 0;
+    std::atomic<uint8_t> active_; // só a captura escreve
+    std::atomic<uint8_t> pending_;
+    float work_[MAX_BLOCK];
+    float fade_[MAX_BLOCK];
+};
+
+} // namespace stetho
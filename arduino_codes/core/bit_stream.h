@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "compiler.h"
+
+//================================================================
+// --- LEITURA E ESCRITA DE BITS (MSB PRIMEIRO) ---
+//================================================================
+
+namespace stetho {
+
+class BitWriter {
+public:
+    BitWriter(uint8_t *buf, size_t capacity) : buf_(buf), capacity_(capacity) {}
+
+    // Escreve os 'count' bits menos significativos de 'value' (count <= 32)
+    STETHO_ALWAYS_INLINE void put(uint32_t value, unsigned count) {
+        acc_ = (acc_ << count) | (value & (uint32_t)((1ull << count) - 1));
+        bits_ += count;
+        while (bits_ >= 8) {
+            bits_ -= 8;
+            if (pos_ < capacity_) buf_[pos_] = (uint8_t)(acc_ >> bits_);
+            pos_++;
+        }
+    }
+
+    // 'count' zeros seguidos de um 1
+    STETHO_ALWAYS_INLINE void putUnary(uint32_t count) {
+        while (count >= 32) {
+            put(0, 32);
+            count -= 32;
+        }
+        put(1, count + 1);
+    }
+
+    // Completa o último byte com zeros e devolve o total de bytes escritos
+    size_t finish() {
+        if (bits_ > 0) put(0, 8 - bits_);
+        return pos_;
+    }
+
+    // Verdadeiro se algum byte não coube no buffer
+    bool overflowed() const { return pos_ > capacity_; }
+
+private:
+    uint8_t *buf_;
+    size_t capacity_;
+    size_t pos_ = 0;
+    uint64_t acc_ = 0;
+    unsigned bits_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t *buf, size_t len) : buf_(buf), len_(len) {}
+
+    // Lê 'count' bits (count <= 32). Devolve false se os dados acabarem.
+    STETHO_ALWAYS_INLINE bool get(unsigned count, uint32_t &value) {
+        while (bits_ < count) {
+            if (pos_ >= len_) return false;
+            acc_ = (acc_ << 8) | buf_[pos_++];
+            bits_ += 8;
+        }
+        bits_ -= count;
+        value = (uint32_t)(acc_ >> bits_) & (uint32_t)((1ull << count) - 1);
+        return true;
+    }
+
+    // Conta zeros até o próximo 1. Devolve false se os dados acabarem antes.
+    STETHO_ALWAYS_INLINE bool getUnary(uint32_t &count) {
+        count = 0;
+        while (true) {
+            if (bits_ == 0) {
+                if (pos_ >= len_) return false;
+                acc_ = (acc_ << 8) | buf_[pos_++];
+                bits_ = 8;
+            }
+            const uint64_t pending = acc_ & ((1ull << bits_) - 1);
+            if (pending == 0) {
+                count += bits_;
+                bits_ = 0;
+                continue;
+            }
+            const unsigned width = 64u - (unsigned)__builtin_clzll(pending);
+            count += bits_ - width;
+            bits_ = width - 1;
+            return true;
+        }
+    }
+
+private:
+    const uint8_t *buf_;
+    size_t len_;
+    size_t pos_ = 0;
+    uint64_t acc_ = 0;
+    unsigned bits_ = 0;
+};
+
+} // namespace stetho
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "compiler.h"
+#include "fixed_point.h"
+
+//================================================================
+// --- PONTO FLUTUANTE EM BLOCO (EXPOENTE DE GANHO POR BLOCO) ---
+//================================================================
+// O >> 14 fixo joga fora os bits baixos da palavra de 24 bits nos sons
+// fracos (pulmão) e satura os fortes. Aqui o front-end entrega o bloco numa
+// escala larga (int32 sem saturação, 2^BFP_WIDE_BITS vezes a escala do
+// >> 14) e o pico do próprio bloco escolhe o expoente de ganho g:
+//
+//   amostra int16 = sat16(round(larga / 2^(BFP_WIDE_BITS - g)))
+//   escala do >> 14 = amostra / 2^g
+//
+// g vai de GAIN_EXP_MIN (-2: o fundo de escala do microfone cabe em 16
+// bits) a GAIN_EXP_MAX (5: o LSB é o da escala larga, 2^9 na palavra I2S,
+// ou seja 23 bits úteis). O expoente viaja nos 3 bits altos do byte 10 do
+// cabeçalho do quadro (core/frame.h), sem byte a mais por notificação, e o
+// receptor reconstrói o sinal em int32 com expandBlock().
+//
+// ScalingMode::Agc acrescenta um controle de ganho lento: o expoente segue
+// uma envoltória de pico com ataque rápido e liberação lenta, então muda
+// poucas vezes (cada troca fecha um pacote), mas nunca a ponto de saturar.
+
+namespace stetho {
+
+// Bits a mais da escala larga em relação ao >> 14
+constexpr int BFP_WIDE_BITS = 5;
+constexpr int GAIN_EXP_MIN = -2;
+constexpr int GAIN_EXP_MAX = BFP_WIDE_BITS;
+
+enum class ScalingMode : uint8_t {
+    Fixed = 0,      // >> 14 fixo, g = 0 (stream de antes)
+    BlockFloat = 1, // g pelo pico de cada bloco
+    Agc = 2,        // g pela envoltória lenta, limitado pelo pico do bloco
+};
+
+constexpr size_t SCALING_MODE_COUNT = 3;
+
+// Campo de 3 bits do cabeçalho: 0..5 = g, 6 = -2, 7 = -1 (0 é a escala fixa)
+constexpr uint8_t encodeGainExp(int g) { return (uint8_t)((unsigned)g & 0x7u); }
+constexpr int decodeGainExp(uint8_t v) { return (v & 0x7) >= 6 ? (int)(v & 0x7) - 8 : (int)(v & 0x7); }
+
+// Número de bits significativos de 'v' (0 para 0)
+STETHO_ALWAYS_INLINE int bitLength(uint32_t v) {
+#if defined(__GNUC__)
+    return v ? 32 - __builtin_clz(v) : 0;
+#else
+    int n = 0;
+    while (v) {
+        v >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+// Maior |x| do bloco, sem desvio por amostra
+STETHO_HOT inline uint32_t blockPeak(const int32_t *x, size_t n) {
+    uint32_t peak = 0;
+    for (size_t i = 0; i < n; i++) {
+        const uint32_t a = x[i] < 0 ? 0u - (uint32_t)x[i] : (uint32_t)x[i];
+        peak = a > peak ? a : peak;
+    }
+    return peak;
+}
+
+// Maior g com que o pico (escala larga), já arredondado, cabe no int16
+inline int fitGainExp(uint32_t peak) {
+    int shift = bitLength(peak) - 15;
+    if (shift < 0) shift = 0;
+    if (shift > 0 && (((uint64_t)peak + (1u << (shift - 1))) >> shift) > 32767) shift++;
+    const int g = BFP_WIDE_BITS - shift;
+    return g < GAIN_EXP_MIN ? GAIN_EXP_MIN : g;
+}
+
+// Escala larga -> int16 com o expoente 'g' (arredonda e satura)
+STETHO_HOT inline void quantizeBlock(const int32_t *STETHO_RESTRICT wide, int16_t *STETHO_RESTRICT out, size_t n,
+                                     int g) {
+    const int shift = BFP_WIDE_BITS - g;
+    if (shift == 0) {
+        for (size_t i = 0; i < n; i++) out[i] = sat16(wide[i]);
+        return;
+    }
+    const int32_t half = 1 << (shift - 1);
+    for (size_t i = 0; i < n; i++) out[i] = sat16((wide[i] + half) >> shift);
+}
+
+// O mesmo no próprio buffer, em trechos: o trecho k escreve bytes de
+// palavras já lidas (ver SampleFrontEnd::processInPlace). Devolve o início
+// das amostras de 16 bits.
+STETHO_HOT inline int16_t *quantizeInPlace(int32_t *buf, size_t n, int g) {
+    constexpr size_t CHUNK = 64;
+    int16_t *out = reinterpret_cast<int16_t *>(buf);
+    int16_t chunk[CHUNK];
+    for (size_t off = 0; off < n; off += CHUNK) {
+        const size_t len = n - off < CHUNK ? n - off : CHUNK;
+        quantizeBlock(buf + off, chunk, len, g);
+        std::memcpy(out + off, chunk, len * sizeof(int16_t));
+    }
+    return out;
+}
+
+// Receptor: amostras recebidas com o expoente 'g' -> escala larga
+inline void expandBlock(const int16_t *in, size_t n, int g, int32_t *out) {
+    const int shift = BFP_WIDE_BITS - g;
+    for (size_t i = 0; i < n; i++) out[i] = (int32_t)in[i] * (1 << shift);
+}
+
+// Amostras com o expoente 'g' -> escala fixa do >> 14 (saturada, como no
+// stream de antes). Pode ser chamado no lugar (in == out).
+STETHO_HOT inline void toFixedScale(const int16_t *in, int16_t *out, size_t n, int g) {
+    if (g > 0) {
+        const int32_t half = 1 << (g - 1);
+        for (size_t i = 0; i < n; i++) out[i] = (int16_t)(((int32_t)in[i] + half) >> g);
+    } else if (g < 0) {
+        for (size_t i = 0; i < n; i++) out[i] = sat16((int32_t)in[i] * (1 << -g));
+    } else if (in != out) {
+        std::memcpy(out, in, n * sizeof(int16_t));
+    }
+}
+
+//================================================================
+// --- ESCOLHA DO EXPOENTE (BFP E AGC) ---
+//================================================================
+class GainControl {
+public:
+    static constexpr float DEFAULT_ATTACK_MS = 5.0f;
+    static constexpr float DEFAULT_RELEASE_MS = 1500.0f;
+    // O AGC mira o pico da envoltória 6 dB abaixo do fundo de escala
+    static constexpr float AGC_HEADROOM = 2.0f;
+
+    explicit GainControl(double sample_rate = 20000.0) : sample_rate_((float)sample_rate) {}
+
+    void setMode(ScalingMode mode) {
+        mode_ = mode;
+        reset();
+    }
+    ScalingMode mode() const { return mode_; }
+
+    // Constantes de tempo da envoltória do AGC
+    void setTimes(float attack_ms, float release_ms) {
+        attack_ms_ = attack_ms;
+        release_ms_ = release_ms;
+        coeff_block_ = 0;
+    }
+
+    void reset() { envelope_ = 0.0f; }
+
+    // Expoente para um bloco de 'n' amostras com pico 'peak' (escala larga)
+    int next(uint32_t peak, size_t n) {
+        if (mode_ == ScalingMode::Fixed) return 0;
+        const int fit = fitGainExp(peak);
+        if (mode_ == ScalingMode::BlockFloat) return fit;
+
+        // Coeficientes recalculados só quando o tamanho do bloco muda
+        if (n != coeff_block_) {
+            const float block_ms = 1000.0f * (float)n / sample_rate_;
+            attack_ = 1.0f - std::exp(-block_ms / attack_ms_);
+            release_ = 1.0f - std::exp(-block_ms / release_ms_);
+            coeff_block_ = n;
+        }
+        const float p = (float)peak;
+        envelope_ += (p > envelope_ ? attack_ : release_) * (p - envelope_);
+        const int target = fitGainExp((uint32_t)(envelope_ * AGC_HEADROOM));
+        return target < fit ? target : fit;
+    }
+
+    float envelope() const { return envelope_; }
+
+private:
+    float sample_rate_;
+    ScalingMode mode_ = ScalingMode::Fixed;
+    float attack_ms_ = DEFAULT_ATTACK_MS;
+    float release_ms_ = DEFAULT_RELEASE_MS;
+    size_t coeff_block_ = 0;
+    float attack_ = 1.0f;
+    float release_ = 0.0f;
+    float envelope_ = 0.0f;
+};
+
+} // namespace stetho
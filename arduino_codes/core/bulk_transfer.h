@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "recording.h"
+#include "storage.h"
+#include "stream_format.h"
+
+//================================================================
+// --- TRANSFERÊNCIA EM MASSA DAS GRAVAÇÕES ---
+//================================================================
+// Pedidos que o app escreve na característica de transferência:
+//
+//   0x01                          LIST
+//   0x02 | id u16 | offset u32    PULL a partir do byte 'offset' do .dat
+//                                 (retomar = pedir de novo com o que já tem)
+//   0x03 | id u16                 DELETE
+//   0x04                          ABORT (nunca é recusado)
+//
+// Respostas, por notificação na mesma característica:
+//
+//   0x81 | id u16 | bytes u32 | blocos u32 | taxa u32    uma por gravação
+//   0x82 | quantidade u16                                fim da lista
+//   0x83 | id u16 | offset u32 | dados...                trecho do .dat
+//   0x84 | id u16 | bytes u32                            fim do PULL
+//   0x85 | id u16 | status u8                            resultado (BulkStatus)
+//
+// O app valida os blocos pelo CRC depois de juntar os trechos, então um
+// PULL interrompido pode ser retomado de qualquer byte. Um pedido que não
+// coube na fila do dispositivo volta como status BUSY com id 0: é só
+// repetir.
+
+namespace stetho {
+
+enum class BulkRequest : uint8_t {
+    List = 0x01,
+    Pull = 0x02,
+    Delete = 0x03,
+    Abort = 0x04,
+};
+
+enum class BulkResponse : uint8_t {
+    Entry = 0x81,
+    ListEnd = 0x82,
+    Data = 0x83,
+    PullEnd = 0x84,
+    Status = 0x85,
+};
+
+enum class BulkStatus : uint8_t {
+    Ok = 0,
+    NotFound = 1,
+    BadRequest = 2,
+    Busy = 3,  // gravação em andamento, ou fila de pedidos cheia
+};
+
+constexpr size_t BULK_DATA_HEADER = 7;
+constexpr size_t BULK_STATUS_SIZE = 4;
+constexpr size_t BULK_MAX_RECORDINGS = 64;
+
+// Notificação 0x85 em 'out'; devolve o tamanho
+inline size_t encodeBulkStatus(uint8_t *out, uint16_t id, BulkStatus st) {
+    out[0] = (uint8_t)BulkResponse::Status;
+    putLe16(out + 1, id);
+    out[3] = (uint8_t)st;
+    return BULK_STATUS_SIZE;
+}
+
+// Máquina de estados do lado do dispositivo: request() recebe o pedido,
+// next() monta cada notificação até o tamanho do payload ATT
+class BulkSender {
+public:
+    explicit BulkSender(Storage &storage) : storage_(storage) {}
+
+    // Gravação em andamento, que não pode ser apagada
+    void setActiveRecording(bool active, uint16_t id = 0) {
+        recording_active_ = active;
+        recording_id_ = id;
+    }
+
+    void request(const uint8_t *data, size_t len) {
+        state_ = State::Idle;
+        if (data == nullptr || len < 1) return;
+        switch ((BulkRequest)data[0]) {
+        case BulkRequest::List:
+            count_ = listRecordings(storage_, ids_, BULK_MAX_RECORDINGS);
+            pos_ = 0;
+            state_ = State::Listing;
+            break;
+        case BulkRequest::Pull: {
+            if (len < 7) return status(0, BulkStatus::BadRequest);
+            id_ = getLe16(data + 1);
+            offset_ = getLe32(data + 3);
+            recordingPath(id_, "dat", path_);
+            const int32_t size = storage_.size(path_);
+            if (size < 0) return status(id_, BulkStatus::NotFound);
+            if (offset_ > (uint32_t)size) offset_ = (uint32_t)size;
+            state_ = State::Pulling;
+            break;
+        }
+        case BulkRequest::Delete: {
+            if (len < 3) return status(0, BulkStatus::BadRequest);
+            const uint16_t id = getLe16(data + 1);
+            if (recording_active_ && id == recording_id_) return status(id, BulkStatus::Busy);
+            char path[RECORDING_PATH_MAX];
+            recordingPath(id, "dat", path);
+            const bool found = storage_.remove(path);
+            recordingPath(id, "idx", path);
+            storage_.remove(path);
+            status(id, found ? BulkStatus::Ok : BulkStatus::NotFound);
+            break;
+        }
+        case BulkRequest::Abort:
+            break;
+        default:
+            status(0, BulkStatus::BadRequest);
+            break;
+        }
+    }
+
+    bool busy() const { return state_ != State::Idle; }
+
+    // Próxima notificação em 'out' (até 'capacity' bytes); 0 = nada a enviar
+    size_t next(uint8_t *out, size_t capacity) {
+        switch (state_) {
+        case State::Idle:
+            return 0;
+
+        case State::Listing: {
+            if (pos_ == count_) {
+                out[0] = (uint8_t)BulkResponse::ListEnd;
+                putLe16(out + 1, (uint16_t)count_);
+                state_ = State::Idle;
+                return 3;
+            }
+            const uint16_t id = ids_[pos_++];
+            char path[RECORDING_PATH_MAX];
+            recordingPath(id, "dat", path);
+            const int32_t bytes = storage_.size(path);
+            recordingPath(id, "idx", path);
+            const int32_t idx = storage_.size(path);
+            recordingPath(id, "dat", path);
+            uint8_t head[RECORDING_HEADER_SIZE];
+            RecordingHeader header;
+            uint32_t rate = 0;
+            if (storage_.read(path, 0, head, sizeof(head)) == sizeof(head) &&
+                parseRecordingHeader(head, sizeof(head), header)) {
+                rate = header.sample_rate_hz;
+            }
+            out[0] = (uint8_t)BulkResponse::Entry;
+            putLe16(out + 1, id);
+            putLe32(out + 3, bytes > 0 ? (uint32_t)bytes : 0);
+            putLe32(out + 7, idx > 0 ? (uint32_t)idx / RECORDING_INDEX_ENTRY : 0);
+            putLe32(out + 11, rate);
+            return 15;
+        }
+
+        case State::Pulling: {
+            const int32_t size = storage_.size(path_);
+            if (size < 0 || offset_ >= (uint32_t)size || capacity <= BULK_DATA_HEADER) {
+                out[0] = (uint8_t)BulkResponse::PullEnd;
+                putLe16(out + 1, id_);
+                putLe32(out + 3, size > 0 ? (uint32_t)size : 0);
+                state_ = State::Idle;
+                return 7;
+            }
+            out[0] = (uint8_t)BulkResponse::Data;
+            putLe16(out + 1, id_);
+            putLe32(out + 3, offset_);
+            const size_t got = storage_.read(path_, offset_, out + BULK_DATA_HEADER, capacity - BULK_DATA_HEADER);
+            offset_ += (uint32_t)got;
+            if (got == 0) state_ = State::Idle;
+            return BULK_DATA_HEADER + got;
+        }
+
+        case State::Status:
+            for (size_t i = 0; i < BULK_STATUS_SIZE; i++) out[i] = status_msg_[i];
+            state_ = State::Idle;
+            return BULK_STATUS_SIZE;
+        }
+        return 0;
+    }
+
+private:
+    enum class State { Idle, Listing, Pulling, Status };
+
+    void status(uint16_t id, BulkStatus st) {
+        encodeBulkStatus(status_msg_, id, st);
+        state_ = State::Status;
+    }
+
+    Storage &storage_;
+    State state_ = State::Idle;
+    uint16_t ids_[BULK_MAX_RECORDINGS];
+    size_t count_ = 0, pos_ = 0;
+    uint16_t id_ = 0;
+    uint32_t offset_ = 0;
+    char path_[RECORDING_PATH_MAX] = {};
+    uint8_t status_msg_[BULK_STATUS_SIZE] = {};
+    bool recording_active_ = false;
+    uint16_t recording_id_ = 0;
+};
+
+} // namespace stetho
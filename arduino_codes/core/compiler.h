@@ -0,0 +1,23 @@
+#pragma once
+
+//================================================================
+// --- MACROS DE COMPILADOR (ESP32 e host Linux) ---
+//================================================================
+// O núcleo em core/ não depende de Arduino nem do ESP-IDF. Estas macros
+// escondem as poucas diferenças entre o xtensa-esp32 e o GCC/Clang do PC.
+
+#if defined(__GNUC__)
+#define STETHO_RESTRICT      __restrict__
+#define STETHO_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define STETHO_RESTRICT
+#define STETHO_ALWAYS_INLINE inline
+#endif
+
+// No ESP32 as funções do caminho quente ficam na IRAM para não sofrer
+// com misses do cache de flash. No host a macro não faz nada.
+#if defined(ESP_PLATFORM) && defined(IRAM_ATTR)
+#define STETHO_HOT IRAM_ATTR
+#else
+#define STETHO_HOT
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//================================================================
+// --- PROTOCOLO DA CARACTERÍSTICA DE CONTROLE ---
+//================================================================
+// O app escreve mensagens curtas na característica de controle:
+//
+//   byte 0: comando (ControlCommand)
+//   byte 1: valor
+//
+// Comandos desconhecidos ou com tamanho errado são ignorados pelo firmware.
+
+namespace stetho {
+
+enum class ControlCommand : uint8_t {
+    SetFilterMode = 0x01, // valor: FilterMode
+    SetCodec = 0x02,      // valor: StreamCodec
+    SetOutputRate = 0x03, // valor: OutputRate (20, 10, 8 ou 4 kHz)
+    SetFraming = 0x04,    // valor: 0 = stream legado, 1 = quadros com cabeçalho (core/frame.h)
+    SetRecording = 0x05,  // valor: 1 = começa a gravar na flash, 0 = para (core/recording.h)
+    SetSpectrogram = 0x06, // valor: 0 = desligado, senão log2 N | sobreposição << 4 (core/spectrogram.h)
+    SetPreview = 0x07,     // valor: 0 = desligado, senão pares min/max por segundo / 10 (core/minmax_preview.h)
+    SetScaling = 0x08,     // valor: ScalingMode (core/block_float.h); só vale com o enquadramento ligado
+    SetStereo = 0x09,      // valor: StereoMode (core/noise_canceller.h); só no firmware com dois microfones
+};
+
+struct ControlMessage {
+    ControlCommand command;
+    uint8_t value;
+};
+
+inline bool parseControlMessage(const uint8_t *data, size_t len, ControlMessage &out) {
+    if (data == nullptr || len < 2) return false;
+    switch ((ControlCommand)data[0]) {
+    case ControlCommand::SetFilterMode:
+    case ControlCommand::SetCodec:
+    case ControlCommand::SetOutputRate:
+    case ControlCommand::SetFraming:
+    case ControlCommand::SetRecording:
+    case ControlCommand::SetSpectrogram:
+    case ControlCommand::SetPreview:
+    case ControlCommand::SetScaling:
+    case ControlCommand::SetStereo:
+        out.command = (ControlCommand)data[0];
+        out.value = data[1];
+        return true;
+    }
+    return false;
+}
+
+} // namespace stetho
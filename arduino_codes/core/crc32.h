@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//================================================================
+// --- CRC-32 (IEEE 802.3, refletido, polinômio 0xEDB88320) ---
+//================================================================
+// Mesmo CRC do zlib/PNG, para o app conferir com bibliotecas prontas.
+// crc32Update encadeia: crc32Update(crc32(a), b) == crc32(a + b).
+
+namespace stetho {
+
+namespace detail {
+
+struct Crc32Table {
+    uint32_t v[256];
+    constexpr Crc32Table() : v() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            v[i] = c;
+        }
+    }
+};
+
+constexpr Crc32Table CRC32_TABLE{};
+
+} // namespace detail
+
+inline uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t len) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) crc = detail::CRC32_TABLE.v[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline uint32_t crc32(const uint8_t *data, size_t len) { return crc32Update(0, data, len); }
+
+} // namespace stetho
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "compiler.h"
+#include "fixed_point.h"
+#include "sample_kernels.h"
+
+//================================================================
+// --- PASSA-BAIXA DE PRIMEIRA ORDEM EM PONTO FIXO ---
+//================================================================
+// Substitui os filtros em float de current.cpp / current_with_filter.cpp (hoje
+// o front-end LowPass de core/pipeline.h, com o mesmo cálculo).
+// Em uma única passada sobre raw_samples faz filtro, deslocamento e saturação:
+//
+//   y[n] = y[n-1] + a * (x[n] - y[n-1])     estado Q31, mesma escala do I2S
+//   out  = sat16(y[n] >> 14)                saída Q15 (o mesmo ganho do >> 14)
+//
+// O estado em Q31 guarda os 14 bits que o deslocamento descarta, então não há
+// a zona morta do float de 24 bits de mantissa sobre palavras de 32 bits.
+// Tolerância: no máximo 1 LSB de diferença da referência em double
+// (ver bench/bench_fixed_lowpass.cpp).
+//
+// A troca é pela precisão, não por ciclos: no PC o kernel em Q31 sai 5 a 20%
+// mais lento que o float do arquivo original (bench_fixed_lowpass), e ainda
+// não há medida no ESP32.
+
+namespace stetho {
+
+class FixedLowPass {
+public:
+    // Tolerância garantida contra a referência em double, em LSB da saída
+    static constexpr int TOLERANCE_LSB = 1;
+
+    explicit FixedLowPass(float alpha) : alpha_q31_(toQ31(alpha)) {}
+
+    // A recorrência y[n-1] -> y[n] é inerentemente serial; o laço é mantido
+    // sem desvios (min/max em vez de if), com uma multiplicação 32x32 por
+    // amostra.
+    STETHO_HOT void process(const int32_t *STETHO_RESTRICT in,
+                            int16_t *STETHO_RESTRICT out, size_t n) {
+        int32_t y = state_;
+        const int32_t a = alpha_q31_;
+        for (size_t i = 0; i < n; i++) {
+            // Metade de cada termo para que a diferença caiba em 32 bits
+            int32_t d = (in[i] >> 1) - (y >> 1);
+            y += (int32_t)(((int64_t)d * a) >> 30);
+            out[i] = sat16(y >> I2S_TO_INT16_SHIFT);
+        }
+        state_ = y;
+    }
+
+    void reset() { state_ = 0; }
+    int32_t state() const { return state_; }
+
+private:
+    int32_t alpha_q31_;
+    int32_t state_ = 0;
+};
+
+} // namespace stetho
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "compiler.h"
+
+//================================================================
+// --- UTILITÁRIOS DE PONTO FIXO (Q15 / Q31) ---
+//================================================================
+// Qn: inteiro com sinal que representa valor / 2^n. A palavra de 32 bits
+// do I2S já é um Q31 (fundo de escala do microfone = ±1.0).
+
+namespace stetho {
+
+// Satura um int32 para a faixa de int16 sem desvios de fluxo
+STETHO_ALWAYS_INLINE int16_t sat16(int32_t v) {
+    v = v < -32768 ? -32768 : v;
+    v = v > 32767 ? 32767 : v;
+    return (int16_t)v;
+}
+
+STETHO_ALWAYS_INLINE int32_t sat32(int64_t v) {
+    v = v < INT32_MIN ? INT32_MIN : v;
+    v = v > INT32_MAX ? INT32_MAX : v;
+    return (int32_t)v;
+}
+
+// Converte um coeficiente em [-1, 1) para Q31 / Q15 com arredondamento e saturação
+constexpr int32_t toQ31(double v) {
+    return v >= 1.0 ? INT32_MAX
+                    : v <= -1.0 ? INT32_MIN
+                                : (int32_t)(v * 2147483648.0 + (v >= 0 ? 0.5 : -0.5));
+}
+
+constexpr int16_t toQ15(double v) {
+    return v >= 1.0 ? INT16_MAX
+                    : v <= -1.0 ? INT16_MIN : (int16_t)(v * 32768.0 + (v >= 0 ? 0.5 : -0.5));
+}
+
+// Produto Q31 x Q31 -> Q31. No xtensa vira mull + mulsh.
+STETHO_ALWAYS_INLINE int32_t mulQ31(int32_t a, int32_t b) {
+    return (int32_t)(((int64_t)a * b) >> 31);
+}
+
+// log2 aproximado (expoente do float + parábola na mantissa), erro < 0,01
+inline float fastLog2(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    const float e = (float)(int)((bits >> 23) & 0xFF) - 127.0f;
+    bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    return e + (-0.34484843f * m + 2.02466578f) * m - 1.67981735f;
+}
+
+} // namespace stetho
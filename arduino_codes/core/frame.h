@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "block_float.h"
+#include "stream_format.h"
+
+//================================================================
+// --- CABEÇALHO DE QUADRO DO STREAM DE ÁUDIO ---
+//================================================================
+// Com o enquadramento ligado (ControlCommand::SetFraming) cada notificação
+// começa com um cabeçalho fixo de 11 bytes, todos os campos little-endian:
+//
+//   bytes 0-1:  número de sequência do quadro (uint16, dá a volta)
+//   bytes 2-5:  índice da primeira amostra do quadro, na taxa de saída (uint32)
+//   bytes 6-9:  instante de captura da primeira amostra em µs (uint32, esp_timer)
+//   byte  10:   bits 0-3: codec (StreamCodec), bit 4: flags (FRAME_FLAG_*),
+//               bits 5-7: expoente de ganho das amostras (core/block_float.h)
+//
+// O índice da amostra conta também os blocos descartados no dispositivo,
+// então o receptor vê exatamente quantas amostras faltam em um buraco. O
+// expoente é 0 na escala fixa do >> 14, então o stream sem ponto flutuante
+// em bloco tem o mesmo cabeçalho de antes.
+
+namespace stetho {
+
+constexpr size_t FRAME_HEADER_SIZE = 11;
+
+// Houve descarte de amostras no dispositivo antes deste quadro
+constexpr uint8_t FRAME_FLAG_DISCONTINUITY = 0x1;
+constexpr uint8_t FRAME_FLAGS_MASK = 0x1;
+
+struct FrameHeader {
+    uint16_t seq = 0;
+    uint32_t first_sample = 0;
+    uint32_t timestamp_us = 0;
+    StreamCodec codec = StreamCodec::Pcm16;
+    uint8_t flags = 0;
+    int8_t gain_exp = 0;
+};
+
+inline size_t writeFrameHeader(const FrameHeader &h, uint8_t *out) {
+    putLe16(out, h.seq);
+    putLe32(out + 2, h.first_sample);
+    putLe32(out + 6, h.timestamp_us);
+    out[10] = (uint8_t)(((uint8_t)h.codec & 0x0F) | (uint8_t)((h.flags & FRAME_FLAGS_MASK) << 4) |
+                        (uint8_t)(encodeGainExp(h.gain_exp) << 5));
+    return FRAME_HEADER_SIZE;
+}
+
+inline bool readFrameHeader(const uint8_t *in, size_t len, FrameHeader &h) {
+    if (len < FRAME_HEADER_SIZE) return false;
+    h.seq = getLe16(in);
+    h.first_sample = getLe32(in + 2);
+    h.timestamp_us = getLe32(in + 6);
+    h.codec = (StreamCodec)(in[10] & 0x0F);
+    h.flags = (uint8_t)((in[10] >> 4) & FRAME_FLAGS_MASK);
+    h.gain_exp = (int8_t)decodeGainExp((uint8_t)(in[10] >> 5));
+    return (uint8_t)h.codec < STREAM_CODEC_COUNT;
+}
+
+} // namespace stetho
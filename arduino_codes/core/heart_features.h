@@ -0,0 +1,513 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "compiler.h"
+#include "fixed_point.h"
+#include "stream_format.h"
+
+//================================================================
+// --- FREQUÊNCIA CARDÍACA E SEGMENTAÇÃO S1/S2 ---
+//================================================================
+// Roda bloco a bloco sobre o stream já filtrado e decimado, com custo fixo:
+//
+//  1. Envelope de energia de Shannon (-x² log x², x normalizado pelo pico
+//     recente) em quadros de 10 ms, média de dois quadros (janela de 20 ms).
+//  2. Autocorrelação do envelope numa janela de 4 s, atualizada de forma
+//     incremental a cada quadro em inteiros (soma e subtração exatas, sem
+//     deriva). A cada 250 ms o pico mais coerente com a contagem de sons dá
+//     o período cardíaco (40 - 200 bpm), refinado por interpolação parabólica.
+//  3. Detector de sons por histerese sobre o envelope, com limiares entre o
+//     nível de ruído e o de pico. Cada som vira um evento com índice da
+//     amostra, timestamp e duração; S1/S2 é decidido pelo intervalo desde o
+//     som anterior e pela alternância S1/S2.
+//
+// O custo por amostra é um log2 aproximado; o resto é por quadro (100 Hz).
+
+namespace stetho {
+
+enum class HeartSound : uint8_t {
+    Unknown = 0, // ainda sem frequência cardíaca confiável
+    S1 = 1,
+    S2 = 2,
+};
+
+struct HeartEvent {
+    HeartSound type = HeartSound::Unknown;
+    uint32_t first_sample = 0; // índice na taxa de saída (o mesmo do core/frame.h)
+    uint32_t timestamp_us = 0;
+    uint16_t duration_ms = 0;
+};
+
+constexpr size_t HEART_MAX_EVENTS = 4;
+
+// Relatório publicado a cada HeartFeatureExtractor::REPORT_FRAMES quadros
+struct HeartFeatures {
+    bool hr_valid = false;
+    uint16_t bpm_x10 = 0;
+    uint8_t confidence = 0;  // pico da autocorrelação normalizada, 0 - 100
+    uint16_t envelope = 0;   // último valor do envelope (escala Q15)
+    uint8_t event_count = 0;
+    HeartEvent events[HEART_MAX_EVENTS];
+};
+
+//================================================================
+// --- LAYOUT DA CARACTERÍSTICA DE FEATURES ---
+//================================================================
+//   byte  0:   versão (HEART_FEATURES_VERSION)
+//   byte  1:   flags (HEART_FLAG_*)
+//   bytes 2-3: bpm x 10 (uint16 LE)
+//   byte  4:   confiança 0 - 100
+//   byte  5:   número de eventos que seguem
+//   bytes 6-7: envelope (uint16 LE)
+//   eventos, 11 bytes cada:
+//     tipo u8 (HeartSound) | first_sample u32 | timestamp_us u32 | duração ms u16
+
+constexpr uint8_t HEART_FEATURES_VERSION = 1;
+constexpr size_t HEART_FEATURES_HEADER = 8;
+constexpr size_t HEART_EVENT_SIZE = 11;
+constexpr size_t HEART_FEATURES_MAX_SIZE = HEART_FEATURES_HEADER + HEART_MAX_EVENTS * HEART_EVENT_SIZE;
+
+constexpr uint8_t HEART_FLAG_HR_VALID = 0x1;
+
+// Escreve até 'capacity' bytes; eventos que não cabem ficam de fora
+inline size_t serializeHeartFeatures(const HeartFeatures &f, uint8_t *out, size_t capacity) {
+    if (capacity < HEART_FEATURES_HEADER) return 0;
+    size_t count = (capacity - HEART_FEATURES_HEADER) / HEART_EVENT_SIZE;
+    if (count > f.event_count) count = f.event_count;
+    out[0] = HEART_FEATURES_VERSION;
+    out[1] = f.hr_valid ? HEART_FLAG_HR_VALID : 0;
+    putLe16(out + 2, f.bpm_x10);
+    out[4] = f.confidence;
+    out[5] = (uint8_t)count;
+    putLe16(out + 6, f.envelope);
+    uint8_t *p = out + HEART_FEATURES_HEADER;
+    for (size_t i = 0; i < count; i++, p += HEART_EVENT_SIZE) {
+        p[0] = (uint8_t)f.events[i].type;
+        putLe32(p + 1, f.events[i].first_sample);
+        putLe32(p + 5, f.events[i].timestamp_us);
+        putLe16(p + 9, f.events[i].duration_ms);
+    }
+    return HEART_FEATURES_HEADER + count * HEART_EVENT_SIZE;
+}
+
+inline bool parseHeartFeatures(const uint8_t *in, size_t len, HeartFeatures &f) {
+    if (len < HEART_FEATURES_HEADER || in[0] != HEART_FEATURES_VERSION) return false;
+    f.hr_valid = (in[1] & HEART_FLAG_HR_VALID) != 0;
+    f.bpm_x10 = getLe16(in + 2);
+    f.confidence = in[4];
+    f.event_count = in[5];
+    f.envelope = getLe16(in + 6);
+    if (f.event_count > HEART_MAX_EVENTS || len < HEART_FEATURES_HEADER + f.event_count * HEART_EVENT_SIZE) return false;
+    const uint8_t *p = in + HEART_FEATURES_HEADER;
+    for (size_t i = 0; i < f.event_count; i++, p += HEART_EVENT_SIZE) {
+        f.events[i].type = (HeartSound)p[0];
+        f.events[i].first_sample = getLe32(p + 1);
+        f.events[i].timestamp_us = getLe32(p + 5);
+        f.events[i].duration_ms = getLe16(p + 9);
+    }
+    return true;
+}
+
+//================================================================
+// --- EXTRATOR ---
+//================================================================
+
+class HeartFeatureExtractor {
+public:
+    static constexpr uint32_t FRAME_RATE_HZ = 100;            // quadros de 10 ms
+    static constexpr size_t ACF_WINDOW = 4 * FRAME_RATE_HZ;    // 4 s
+    static constexpr size_t MIN_LAG = 60 * FRAME_RATE_HZ / 200; // 200 bpm
+    static constexpr size_t MAX_LAG = 60 * FRAME_RATE_HZ / 40;  // 40 bpm
+    static constexpr size_t REPORT_FRAMES = FRAME_RATE_HZ / 4;  // 4 relatórios/s
+    static constexpr size_t REFRACTORY_FRAMES = 6;  // junta sons separados por < 60 ms
+    static constexpr size_t MAX_SOUND_FRAMES = 25;  // > 250 ms é sopro/ruído, não S1/S2
+
+    explicit HeartFeatureExtractor(uint32_t sample_rate_hz = 20000) { configure(sample_rate_hz); }
+
+    // Taxa de saída do decimador; recomeça do zero
+    void configure(uint32_t sample_rate_hz) {
+        sample_rate_hz_ = sample_rate_hz ? sample_rate_hz : 1;
+        frame_len_ = sample_rate_hz_ / FRAME_RATE_HZ;
+        if (frame_len_ == 0) frame_len_ = 1;
+        reset();
+    }
+
+    void reset() {
+        frame_pos_ = 0;
+        acc_ = 0.0f;
+        frame_peak_ = 0;
+        peak_abs_ = MIN_PEAK;
+        inv_peak_ = 1.0f / MIN_PEAK;
+        prev_shannon_ = 0.0f;
+        frames_ = 0;
+        std::memset(hist_, 0, sizeof(hist_));
+        std::memset(acf_, 0, sizeof(acf_));
+        acf0_ = 0;
+        std::memset(smooth_, 0, sizeof(smooth_));
+        smooth_sum_ = 0.0f;
+        env_mean_ = 0.0f;
+        hr_valid_ = false;
+        period_frames_ = 0.0f;
+        bpm_x10_ = 0;
+        confidence_ = 0;
+        noise_level_ = 0.0f;
+        peak_level_ = 0.0f;
+        state_ = State::Idle;
+        rise_ = Mark();
+        sound_start_ = Mark();
+        has_last_onset_ = false;
+        onset_total_ = 0;
+        sys_frames_ = dia_frames_ = 0.0f;
+        last_label_ = HeartSound::Unknown;
+        evidence_ = 0.0f;
+        event_count_ = 0;
+        dropped_events_ = 0;
+        report_ready_ = false;
+    }
+
+    // Bloco contínuo na taxa de saída; 'first_sample'/'timestamp_us' como no Packetizer
+    STETHO_HOT void process(const int16_t *x, size_t n, uint32_t first_sample, uint32_t timestamp_us) {
+        for (size_t i = 0; i < n; i++) {
+            if (frame_pos_ == 0) {
+                frame_first_ = first_sample + (uint32_t)i;
+                frame_ts_ = timestamp_us + (uint32_t)((uint64_t)i * 1000000 / sample_rate_hz_);
+            }
+            const int32_t s = x[i];
+            const uint32_t a = (uint32_t)(s < 0 ? -s : s);
+            if (a > frame_peak_) frame_peak_ = a;
+            const float v = (float)s * inv_peak_;
+            float e = v * v;
+            if (e > 1.0f) e = 1.0f;
+            if (e > 1e-9f) acc_ += e * fastLog2(e);
+            if (++frame_pos_ == frame_len_) endFrame();
+        }
+    }
+
+    // Relatório dos últimos 250 ms (HR + eventos novos); false se ainda não há
+    bool poll(HeartFeatures &out) {
+        if (!report_ready_) return false;
+        report_ready_ = false;
+        out.hr_valid = hr_valid_;
+        out.bpm_x10 = hr_valid_ ? bpm_x10_ : 0;
+        out.confidence = confidence_;
+        out.envelope = envelope_q15_;
+        out.event_count = (uint8_t)event_count_;
+        for (size_t i = 0; i < event_count_; i++) out.events[i] = events_[i];
+        event_count_ = 0;
+        return true;
+    }
+
+    bool hrValid() const { return hr_valid_; }
+    float bpm() const { return hr_valid_ ? bpm_x10_ / 10.0f : 0.0f; }
+    uint32_t droppedEvents() const { return dropped_events_; }
+
+private:
+    enum class State { Idle, InSound, Ending, Blocked };
+
+    static constexpr uint32_t MIN_PEAK = 64;           // não amplifica o silêncio
+    static constexpr float PEAK_DECAY = 0.9965f;       // meia-vida ~2 s
+    static constexpr float ENV_SCALE = 32767.0f / 0.6f; // máximo de -e log2 e é 0,53
+    static constexpr size_t HIST = ACF_WINDOW + MAX_LAG + 2;
+    static constexpr size_t SMOOTH_FRAMES = 8;
+    static constexpr size_t ONSET_HISTORY = 16;
+
+    void endFrame() {
+        // 1. ENVELOPE DE SHANNON
+        const float shannon = -acc_ / (float)frame_len_;
+        const float env = 0.5f * (shannon + prev_shannon_);
+        prev_shannon_ = shannon;
+        acc_ = 0.0f;
+        frame_pos_ = 0;
+        envelope_q15_ = (uint16_t)(env * ENV_SCALE > 32767.0f ? 32767.0f : env * ENV_SCALE);
+
+        // Normalização pelo pico recente (vale para o próximo quadro)
+        float peak = peak_abs_ * PEAK_DECAY;
+        if ((float)frame_peak_ > peak) peak = (float)frame_peak_;
+        if (peak < (float)MIN_PEAK) peak = (float)MIN_PEAK;
+        peak_abs_ = peak;
+        inv_peak_ = 1.0f / peak;
+        frame_peak_ = 0;
+
+        // 2. AUTOCORRELAÇÃO INCREMENTAL (envelope alargado por média móvel,
+        // sem a média, em int16). Pulsos largos toleram a variação do RR
+        // dentro da janela; com pulsos estreitos o pico da sístole, que
+        // varia pouco, passaria o do período.
+        smooth_sum_ += env - smooth_[frames_ % SMOOTH_FRAMES];
+        smooth_[frames_ % SMOOTH_FRAMES] = env;
+        const float broad = smooth_sum_ * (1.0f / SMOOTH_FRAMES);
+        env_mean_ += (broad - env_mean_) * (1.0f / 128.0f);
+        float q = (broad - env_mean_) * ENV_SCALE;
+        if (q > 32767.0f) q = 32767.0f;
+        if (q < -32767.0f) q = -32767.0f;
+        updateAcf((int16_t)q);
+
+        // 3. DETECÇÃO DOS SONS
+        detect(env);
+
+        frames_++;
+        if (frames_ % REPORT_FRAMES == 0) {
+            estimateRate();
+            report_ready_ = true;
+        }
+    }
+
+    // acf[l] = soma de q[n] q[n-l] nos últimos ACF_WINDOW quadros. O anel
+    // começa zerado, então os termos que saem antes de encher valem zero.
+    void updateAcf(int16_t q) {
+        const size_t n = (size_t)(frames_ % HIST);
+        hist_[n] = q;
+        const size_t old = (n + HIST - ACF_WINDOW) % HIST;
+        const int32_t q_old = hist_[old];
+        acf0_ += (int64_t)q * q - (int64_t)q_old * q_old;
+        for (size_t l = MIN_LAG - 1; l <= MAX_LAG + 1; l++) {
+            const int32_t add = hist_[(n + HIST - l) % HIST];
+            const int32_t sub = hist_[(old + HIST - l) % HIST];
+            acf_[l] += (int64_t)q * add - (int64_t)q_old * sub;
+        }
+    }
+
+    void estimateRate() {
+        hr_valid_ = false;
+        confidence_ = 0;
+        if (frames_ < ACF_WINDOW || acf0_ <= 0) return;
+
+        // Maior pico, com um leve desconto para atrasos longos (os múltiplos
+        // do período têm quase a mesma altura)
+        size_t lag = 0;
+        float best = 0.0f;
+        for (size_t l = MIN_LAG; l <= MAX_LAG; l++) {
+            const float w = weightedAcf(l);
+            if (isPeak(l) && w > best) {
+                best = w;
+                lag = l;
+            }
+        }
+        if (lag == 0) return;
+
+        // Com a frequência variando dentro da janela (arritmia respiratória)
+        // o pico do período se espalha e o da sístole (S1 -> S2), que varia
+        // pouco, pode passar dele. Entre os picos fortes fica o mais perto do
+        // período dado pela contagem de sons (dois por batimento).
+        const float counted = countedPeriod();
+        if (counted > 0.0f) {
+            float closest = 0.0f;
+            for (size_t l = MIN_LAG; l <= MAX_LAG; l++) {
+                if (!isPeak(l) || weightedAcf(l) * 2.0f < best) continue;
+                const float ratio = (float)l > counted ? (float)l / counted : counted / (float)l;
+                if (closest == 0.0f || ratio < closest) {
+                    closest = ratio;
+                    lag = l;
+                }
+            }
+        }
+
+        // Outro pico quase tão alto na metade do atraso: o escolhido era um
+        // múltiplo (ou a contagem perdeu os S2)
+        for (size_t l = (lag * 46) / 100; l <= (lag * 54) / 100; l++) {
+            if (l >= MIN_LAG && isPeak(l) && acf_[l] * 4 >= acf_[lag] * 3) {
+                lag = l;
+                break;
+            }
+        }
+        const float a = (float)acf_[lag - 1], b = (float)acf_[lag], c = (float)acf_[lag + 1];
+        const float den = a - 2.0f * b + c;
+        float delta = den < 0.0f ? 0.5f * (a - c) / den : 0.0f;
+        if (delta > 0.5f) delta = 0.5f;
+        if (delta < -0.5f) delta = -0.5f;
+
+        const float conf = b / (float)acf0_;
+        confidence_ = (uint8_t)(conf > 1.0f ? 100.0f : conf < 0.0f ? 0.0f : conf * 100.0f);
+        if (conf < 0.25f) return;
+        period_frames_ = (float)lag + delta;
+        bpm_x10_ = (uint16_t)(600.0f * FRAME_RATE_HZ / period_frames_ + 0.5f);
+        hr_valid_ = true;
+
+        // Sístole/diástole aprendidas que não somam mais o período: recomeça
+        const float cycle = sys_frames_ + dia_frames_;
+        if (cycle < 0.7f * period_frames_ || cycle > 1.3f * period_frames_) {
+            sys_frames_ = 0.42f * period_frames_;
+            dia_frames_ = 0.58f * period_frames_;
+        }
+    }
+
+    float weightedAcf(size_t l) const { return (float)acf_[l] * (1.0f - 0.25f * (float)l / (float)MAX_LAG); }
+
+    // Período pelos sons detectados na janela da autocorrelação; 0 se poucos
+    float countedPeriod() const {
+        size_t n = 0;
+        uint64_t first = 0, last = 0;
+        for (size_t k = 0; k < ONSET_HISTORY && k < onset_total_; k++) {
+            const uint64_t f = onsets_[(onset_total_ - 1 - k) % ONSET_HISTORY];
+            if (frames_ - f > ACF_WINDOW) break;
+            if (n == 0) last = f;
+            first = f;
+            n++;
+        }
+        if (n < 4) return 0.0f;
+        return 2.0f * (float)(last - first) / (float)(n - 1);
+    }
+
+    bool isPeak(size_t l) const { return acf_[l] >= acf_[l - 1] && acf_[l] >= acf_[l + 1]; }
+
+    // Histerese entre o ruído de fundo e o pico do envelope
+    void detect(float env) {
+        if (env > peak_level_) peak_level_ = env;
+        else peak_level_ *= 0.995f;
+        if (env < noise_level_ || frames_ == 0) noise_level_ = env;
+        else noise_level_ += (env - noise_level_) * 0.005f;
+
+        const float span = peak_level_ - noise_level_;
+        const bool contrast = peak_level_ > 1.5f * noise_level_ + 1e-4f;
+        const float thr_on = noise_level_ + 0.3f * span;
+        const float thr_off = noise_level_ + 0.15f * span;
+
+        switch (state_) {
+        case State::Idle:
+            if (contrast && env > thr_on) {
+                state_ = State::InSound;
+                sound_start_ = rise_;
+            }
+            break;
+        case State::InSound:
+            if (frames_ - sound_start_.frame >= MAX_SOUND_FRAMES) {
+                emit(frames_ - sound_start_.frame);
+                state_ = State::Blocked;
+            } else if (env < thr_off) {
+                state_ = State::Ending;
+                sound_end_ = frames_;
+            }
+            break;
+        case State::Ending:
+            if (env > thr_on) {
+                state_ = State::InSound; // segundo componente do mesmo som (ex.: S2 desdobrada)
+            } else if (frames_ - sound_end_ >= REFRACTORY_FRAMES) {
+                emit(sound_end_ - sound_start_.frame);
+                state_ = State::Idle;
+            }
+            break;
+        case State::Blocked:
+            if (env < thr_off) state_ = State::Idle;
+            break;
+        }
+
+        // Começo do próximo quadro: onde um som que suba a partir daqui começa
+        if (env <= thr_off) {
+            rise_.frame = frames_ + 1;
+            rise_.first_sample = frame_first_ + (uint32_t)frame_len_;
+            rise_.timestamp_us = frame_ts_ + (uint32_t)((uint64_t)frame_len_ * 1000000 / sample_rate_hz_);
+        }
+    }
+
+    void emit(uint64_t duration_frames) {
+        HeartEvent ev;
+        ev.type = classify(sound_start_.frame);
+        ev.first_sample = sound_start_.first_sample;
+        ev.timestamp_us = sound_start_.timestamp_us;
+        ev.duration_ms = (uint16_t)(duration_frames * (1000 / FRAME_RATE_HZ));
+        if (event_count_ == HEART_MAX_EVENTS) {
+            dropped_events_++;
+            return;
+        }
+        events_[event_count_++] = ev;
+    }
+
+    // Os sons alternam: S1 -> (sístole) -> S2 -> (diástole) -> S1. Perto de
+    // 130 bpm sístole e diástole ficam a poucos quadros uma da outra, então
+    // cada intervalo sozinho não decide; o rótulo segue a alternância e uma
+    // evidência acumulada (diástole mais longa que a sístole) inverte a fase
+    // quando ela estava trocada.
+    HeartSound classify(uint64_t onset) {
+        onsets_[onset_total_++ % ONSET_HISTORY] = onset;
+        const bool has_last = has_last_onset_;
+        const float interval = (float)(onset - last_onset_);
+        has_last_onset_ = true;
+        last_onset_ = onset;
+        if (!hr_valid_ || !has_last || interval < 0.15f * period_frames_) {
+            last_label_ = HeartSound::Unknown;
+            return HeartSound::Unknown;
+        }
+
+        // Mais que um período quase inteiro: faltou um som (o S2, em geral)
+        if (interval >= 0.8f * period_frames_) {
+            last_label_ = HeartSound::S1;
+            evidence_ = 0.0f;
+            return HeartSound::S1;
+        }
+
+        const float boundary = 0.5f * (sys_frames_ + dia_frames_);
+        HeartSound label;
+        if (last_label_ == HeartSound::S1) label = HeartSound::S2;
+        else if (last_label_ == HeartSound::S2) label = HeartSound::S1;
+        else label = interval < boundary ? HeartSound::S2 : HeartSound::S1;
+
+        evidence_ = 0.8f * evidence_ + (label == HeartSound::S1 ? interval - boundary : boundary - interval);
+        if (evidence_ < 0.0f) {
+            label = label == HeartSound::S1 ? HeartSound::S2 : HeartSound::S1;
+            evidence_ = -evidence_;
+        }
+
+        if (label == HeartSound::S2) sys_frames_ += 0.2f * (interval - sys_frames_);
+        else dia_frames_ += 0.2f * (interval - dia_frames_);
+        last_label_ = label;
+        return label;
+    }
+
+    struct Mark {
+        uint64_t frame = 0;
+        uint32_t first_sample = 0;
+        uint32_t timestamp_us = 0;
+    };
+
+    uint32_t sample_rate_hz_ = 20000;
+    size_t frame_len_ = 200;
+
+    // Quadro em andamento
+    size_t frame_pos_ = 0;
+    float acc_ = 0.0f;
+    uint32_t frame_peak_ = 0;
+    uint32_t frame_first_ = 0;
+    uint32_t frame_ts_ = 0;
+    float peak_abs_ = MIN_PEAK;
+    float inv_peak_ = 1.0f / MIN_PEAK;
+    float prev_shannon_ = 0.0f;
+    uint16_t envelope_q15_ = 0;
+    uint64_t frames_ = 0;
+
+    // Autocorrelação
+    int16_t hist_[HIST];
+    int64_t acf_[MAX_LAG + 2];
+    int64_t acf0_ = 0;
+    float smooth_[SMOOTH_FRAMES];
+    float smooth_sum_ = 0.0f;
+    float env_mean_ = 0.0f;
+    bool hr_valid_ = false;
+    float period_frames_ = 0.0f;
+    uint16_t bpm_x10_ = 0;
+    uint8_t confidence_ = 0;
+
+    // Detector
+    float noise_level_ = 0.0f;
+    float peak_level_ = 0.0f;
+    State state_ = State::Idle;
+    Mark rise_;
+    Mark sound_start_;
+    uint64_t sound_end_ = 0;
+    bool has_last_onset_ = false;
+    uint64_t last_onset_ = 0;
+    uint64_t onsets_[ONSET_HISTORY];
+    size_t onset_total_ = 0;
+    float sys_frames_ = 0.0f;
+    float dia_frames_ = 0.0f;
+    HeartSound last_label_ = HeartSound::Unknown;
+    float evidence_ = 0.0f;
+
+    HeartEvent events_[HEART_MAX_EVENTS];
+    size_t event_count_ = 0;
+    uint32_t dropped_events_ = 0;
+    bool report_ready_ = false;
+};
+
+} // namespace stetho
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//================================================================
+// --- BATIMENTO DE REFERÊNCIA PARA O GERADOR DE SINAIS ---
+//================================================================
+// Um ciclo S1 + S2 amostrado a 4 kHz (390 ms), int16 com pico em 30000.
+// Gerado pelo mesmo modelo do makeHeartSignal dos benchmarks (senoides
+// amortecidas de 45/90 Hz no S1 e 110/180 Hz no S2, S2 a 300 ms), sem o
+// ruído e o offset. Uma gravação real pode substituir a tabela desde que
+// mantenha a taxa e termine em silêncio; o gerador completa o resto do
+// período do batimento com zeros.
+
+namespace stetho {
+
+constexpr uint32_t HEART_TEMPLATE_RATE_HZ = 4000;
+
+constexpr int16_t HEART_TEMPLATE[] = {
+    0, 3650, 7185, 10564, 13750, 16710, 19415, 21841, 23968, 25782, 27273, 28438,
+    29276, 29793, 30000, 29911, 29544, 28921, 28066, 27006, 25769, 24386, 22885, 21298,
+    19654, 17981, 16305, 14653, 13046, 11503, 10042, 8676, 7415, 6266, 5233, 4316,
+    3513, 2819, 2225, 1722, 1298, 939, 631, 360, 109, -136, -391, -668,
+    -980, -1338, -1751, -2225, -2767, -3377, -4056, -4803, -5612, -6476, -7387, -8334,
+    -9304, -10284, -11259, -12213, -13131, -13996, -14792, -15504, -16118, -16620, -16999, -17243,
+    -17346, -17301, -17104, -16754, -16251, -15598, -14800, -13865, -12803, -11624, -10343, -8972,
+    -7530, -6031, -4494, -2936, -1375, 171, 1685, 3150, 4552, 5876, 7110, 8241,
+    9262, 10164, 10941, 11590, 12110, 12499, 12761, 12899, 12918, 12824, 12627, 12334,
+    11957, 11504, 10989, 10421, 9812, 9174, 8516, 7850, 7184, 6527, 5887, 5271,
+    4682, 4127, 3608, 3126, 2683, 2277, 1908, 1574, 1270, 994, 740, 505,
+    284, 70, -140, -351, -569, -796, -1036, -1293, -1567, -1861, -2174, -2507,
+    -2858, -3225, -3605, -3996, -4391, -4788, -5180, -5562, -5929, -6274, -6592, -6877,
+    -7123, -7326, -7481, -7583, -7630, -7618, -7547, -7414, -7220, -6966, -6652, -6282,
+    -5859, -5387, -4870, -4314, -3724, -3108, -2471, -1820, -1163, -506, 143, 779,
+    1394, 1983, 2540, 3061, 3540, 3974, 4361, 4698, 4984, 5217, 5398, 5527,
+    5607, 5637, 5622, 5564, 5466, 5333, 5167, 4974, 4757, 4521, 4270, 4009,
+    3739, 3467, 3195, 2925, 2661, 2404, 2157, 1920, 1696, 1483, 1282, 1094,
+    917, 750, 593, 444, 301, 164, 29, -103, -234, -367, -502, -639,
+    -781, -927, -1078, -1233, -1393, -1556, -1723, -1890, -2058, -2225, -2388, -2546,
+    -2697, -2838, -2968, -3085, -3185, -3269, -3332, -3375, -3396, -3393, -3366, -3315,
+    -3238, -3137, -3012, -2863, -2692, -2500, -2289, -2061, -1818, -1562, -1296, -1022,
+    -744, -464, -185, 91, 361, 623, 873, 1110, 1332, 1537, 1725, 1892,
+    2040, 2166, 2272, 2356, 2418, 2461, 2483, 2486, 2471, 2440, 2393, 2332,
+    2259, 2176, 2083, 1983, 1877, 1767, 1654, 1539, 1424, 1309, 1196, 1085,
+    977, 872, 770, 673, 579, 489, 402, 318, 238, 159, 83, 8,
+    -65, -139, -211, -284, -357, -431, -505, -580, -655, -731, -806, -881,
+    -955, -1028, -1099, -1166, -1231, -1290, -1345, -1394, -1437, -1472, -1499, -1517,
+    -1526, -1526, -1516, -1495, -1465, -1424, -1373, -1313, -1243, -1164, -1077, -982,
+    -881, -774, -662, -546, -427, -307, -186, -66, 52, 168, 280, 388,
+    490, 586, 675, 756, 829, 894, 951, 999, 1037, 1068, 1089, 1102,
+    1107, 1105, 1095, 1079, 1057, 1029, 997, 960, 919, 876, 830, 782,
+    733, 683, 633, 582, 532, 482, 433, 385, 338, 292, 248, 204,
+    161, 120, 79, 39, 0, -39, -77, -114, -152, -189, -226, -262,
+    -299, -335, -370, -405, -438, -471, -503, -533, -561, -588, -612, -633,
+    -651, -667, -678, -687, -691, -691, -688, -680, -667, -651, -630, -605,
+    -576, -543, -507, -467, -425, -380, -332, -283, -232, -180, -128, -75,
+    -23, 28, 79, 127, 174, 218, 260, 299, 334, 367, 396, 421,
+    443, 461, 475, 486, 493, 496, 497, 494, 489, 480, 470, 457,
+    442, 425, 407, 388, 367, 346, 324, 302, 279, 256, 233, 210,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 5433, 10460, 14856, 18435, 21064, 22669, 23234, 22799, 21457, 19340, 16616,
+    13466, 10081, 6641, 3312, 232, -2496, -4800, -6649, -8043, -9011, -9606, -9893,
+    -9944, -9829, -9609, -9331, -9024, -8697, -8341, -7933, -7435, -6808, -6010, -5006,
+    -3776, -2314, -635, 1222, 3201, 5226, 7207, 9046, 10643, 11904, 12749, 13112,
+    12956, 12267, 11063, 9388, 7315, 4938, 2368, -274, -2863, -5279, -7414, -9176,
+    -10496, -11330, -11662, -11502, -10886, -9870, -8528, -6945, -5212, -3421, -1654, 12,
+    1516, 2814, 3879, 4698, 5276, 5631, 5789, 5781, 5644, 5411, 5111, 4768,
+    4398, 4008, 3599, 3165, 2697, 2182, 1609, 971, 266, -503, -1321, -2170,
+    -3020, -3837, -4583, -5218, -5704, -6008, -6101, -5967, -5601, -5007, -4205, -3224,
+    -2106, -898, 344, 1566, 2711, 3730, 4576, 5218, 5630, 5802, 5735, 5444,
+    4951, 4289, 3499, 2623, 1704, 787, -89, -893, -1596, -2182, -2639, -2966,
+    -3167, -3252, -3235, -3134, -2966, -2747, -2494, -2219, -1930, -1633, -1331, -1024,
+    -711, -388, -54, 292, 648, 1011, 1372, 1723, 2050, 2339, 2576, 2745,
+    2834, 2831, 2730, 2528, 2228, 1838, 1370, 842, 276, -306, -877, -1413,
+    -1890, -2288, -2590, -2785, -2866, -2832, -2689, -2446, -2119, -1726, -1286, -822,
+    -354, 99, 517, 887, 1199, 1445, 1622, 1731, 1775, 1760, 1696, 1590,
+    1451, 1290, 1113, 927, 738, 549, 362, 179, 0, -175, -347, -513,
+    -674, -827, -968, -1094, -1199, -1278, -1326, -1338, -1310, -1240, -1127, -972,
+    -780, -555, -305, -39, 231, 496, 744, 964, 1147, 1285, 1373, 1407,
+    1386, 1314, 1193, 1030, 835, 615, 383, 147, -83, -297, -487, -649,
+    -777, -869, -926, -948, -937, -899, -836, -755, -659, -554, -443, -331,
+    -219, -111, -8, 90, 182, 267, 346, 417, 481, 536, 581, 615,
+    635, 642, 631, 604, 559, 495, 415, 318, 209, 90, -34, -160,
+    -281, -395, -494, -577, -638, -675, -687, -674, -635, -574, -493, -396,
+    -287, -171, -53, 62, 169, 265, 347, 412, 459, 487, 498, 491,
+    468, 433, 387, 332, 273, 210, 146, 83, 23, -34, -87, -134,
+    -177, -214, -246, -272, -292, -307, -315, -316, -311, -298, -277, -249,
+    -214, -171, -123, -70, -13, 45, 103, 159, 210, 254, 290, 316,
+    331, 334, 325, 304, 273, 232, 184, 130, 73, 14, -43, -96,
+    -144, -184, -216, -240, -253, -258, -253, -240, -221, -195, -165, -133,
+};
+
+constexpr size_t HEART_TEMPLATE_SAMPLES = sizeof(HEART_TEMPLATE) / sizeof(HEART_TEMPLATE[0]);
+
+} // namespace stetho
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "ima_adpcm.h"
+#include "stream_format.h"
+
+//================================================================
+// --- HISTÓRICO PRÉ-GATILHO (ÚLTIMOS N SEGUNDOS) ---
+//================================================================
+// A captura grava continuamente, mesmo sem conexão, num anel circular de
+// blocos de CHUNK_SAMPLES amostras na taxa de saída. Ao conectar, a tarefa
+// de envio lê o histórico em rajada e depois passa para o stream ao vivo,
+// então o app recebe também os segundos antes da conexão.
+//
+// Cada slot guarda [first_sample u32][timestamp_us u32][count u16][pad u16]
+// seguido das amostras em Pcm16 (PSRAM) ou IMA-ADPCM (4:1, RAM interna).
+// A memória vem de fora (heap_caps_malloc no ESP32, vetor no PC).
+//
+// Um único produtor sobrescreve os blocos mais antigos sem nunca esperar.
+// O leitor usa um esquema de seqlock: copia o slot e depois confere se o
+// produtor não começou a reescrevê-lo no meio; se começou, o bloco é dado
+// como perdido (o leitor estava atrasado mais que o anel inteiro). Como os
+// dois podem estar no mesmo slot ao mesmo tempo, o slot é lido e escrito
+// em palavras de 32 bits atômicas (relaxed, o mesmo custo de um acesso
+// normal no ESP32): a cópia pode sair rasgada, mas nunca é uma corrida.
+// Por isso a memória precisa estar alinhada em 4 bytes.
+
+namespace stetho {
+
+enum class HistoryFormat : uint8_t {
+    Pcm16 = 0,
+    ImaAdpcm = 1,
+};
+
+class HistoryRing {
+public:
+    static constexpr size_t CHUNK_SAMPLES = 256;
+    static constexpr size_t SLOT_HEADER = 12;
+
+    struct Chunk {
+        uint32_t first_sample;
+        uint32_t timestamp_us;
+        uint16_t count;
+        int16_t samples[CHUNK_SAMPLES];
+    };
+
+    static constexpr size_t slotSize(HistoryFormat fmt) {
+        return SLOT_HEADER + (fmt == HistoryFormat::Pcm16 ? 2 * CHUNK_SAMPLES : adpcm::encodedSize(CHUNK_SAMPLES));
+    }
+
+    // Bytes para guardar 'seconds' segundos a 'rate_hz'
+    static constexpr size_t bytesFor(uint32_t seconds, uint32_t rate_hz, HistoryFormat fmt) {
+        return ((size_t)seconds * rate_hz / CHUNK_SAMPLES + 2) * slotSize(fmt);
+    }
+
+    HistoryRing(uint8_t *storage, size_t bytes, HistoryFormat fmt)
+        : storage_(storage), fmt_(fmt), slot_size_(slotSize(fmt)), slots_(bytes / slotSize(fmt)) {}
+
+    size_t slots() const { return slots_; }
+    HistoryFormat format() const { return fmt_; }
+
+    //------------------------------------------------------------
+    // Produtor (tarefa de captura)
+    //------------------------------------------------------------
+
+    // Acrescenta amostras contínuas; um salto no índice fecha o bloco atual
+    void write(const int16_t *samples, size_t n, uint32_t first_sample, uint32_t timestamp_us) {
+        if (slots_ < 2) return;
+        if (stage_count_ > 0 && first_sample != stage_first_ + stage_count_) commitStage();
+        while (n > 0) {
+            if (stage_count_ == 0) {
+                stage_first_ = first_sample;
+                stage_ts_ = timestamp_us;
+            }
+            size_t take = CHUNK_SAMPLES - stage_count_;
+            if (take > n) take = n;
+            std::memcpy(stage_ + stage_count_, samples, take * sizeof(int16_t));
+            stage_count_ += take;
+            samples += take;
+            n -= take;
+            first_sample += (uint32_t)take;
+            // Timestamp do resto do bloco, se ele abrir o próximo slot
+            timestamp_us += (uint32_t)((uint64_t)take * ts_step_x1000_ / 1000);
+            if (stage_count_ == CHUNK_SAMPLES) commitStage();
+        }
+    }
+
+    // Passo do timestamp por amostra, para os slots que começam no meio de um bloco
+    void setSampleRate(uint32_t rate_hz) { ts_step_x1000_ = rate_hz ? 1000000000ull / rate_hz : 0; }
+
+    // Esquece o histórico (ex.: troca da taxa de saída)
+    void clear() {
+        stage_count_ = 0;
+        floor_.store(written_.load(std::memory_order_relaxed), std::memory_order_release);
+    }
+
+    //------------------------------------------------------------
+    // Consumidor (tarefa de envio)
+    //------------------------------------------------------------
+
+    // Número do próximo bloco a ser gravado (os válidos estão em [oldest, newest))
+    uint64_t newest() const { return written_.load(std::memory_order_acquire); }
+
+    uint64_t oldest() const {
+        const uint64_t w = newest();
+        // Um slot de folga: o que o produtor pode estar escrevendo agora
+        const uint64_t ring_start = w > slots_ - 1 ? w - (slots_ - 1) : 0;
+        const uint64_t floor = floor_.load(std::memory_order_acquire);
+        return ring_start > floor ? ring_start : floor;
+    }
+
+    // Índice da amostra seguinte ao último bloco gravado
+    uint32_t committedEnd() const { return committed_end_.load(std::memory_order_acquire); }
+
+    // Copia o bloco 'k'; false se ainda não existe ou já foi sobrescrito
+    bool read(uint64_t k, Chunk &out) const {
+        if (k >= newest() || k < floor_.load(std::memory_order_acquire)) return false;
+        uint8_t *slot = storage_ + (size_t)(k % slots_) * slot_size_;
+        uint8_t header[SLOT_HEADER];
+        loadWords(header, slot, SLOT_HEADER);
+        out.first_sample = getLe32(header);
+        out.timestamp_us = getLe32(header + 4);
+        out.count = getLe16(header + 8);
+        if (out.count > CHUNK_SAMPLES) return false;
+        // Só decodifica depois de saber que a cópia não rasgou
+        uint8_t encoded[wordBytes(adpcm::encodedSize(CHUNK_SAMPLES))];
+        if (fmt_ == HistoryFormat::Pcm16) {
+            loadWords(reinterpret_cast<uint8_t *>(out.samples), slot + SLOT_HEADER, wordBytes(out.count * sizeof(int16_t)));
+        } else {
+            loadWords(encoded, slot + SLOT_HEADER, wordBytes(adpcm::encodedSize(out.count)));
+        }
+        // O produtor começou a reescrever este slot enquanto líamos?
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (begun_.load(std::memory_order_relaxed) > k + slots_) return false;
+        if (fmt_ == HistoryFormat::Pcm16) return true;
+        return adpcmDecode(encoded, adpcm::encodedSize(out.count), out.samples, CHUNK_SAMPLES) == (int)out.count;
+    }
+
+private:
+    static constexpr size_t wordBytes(size_t bytes) { return (bytes + 3) & ~(size_t)3; }
+
+    // 'bytes' múltiplo de 4; só o lado do anel ('src' ou 'dst') precisa de alinhamento
+    static void loadWords(uint8_t *dst, const uint8_t *src, size_t bytes) {
+        const uint32_t *words = reinterpret_cast<const uint32_t *>(src);
+        for (size_t i = 0; i < bytes / 4; i++) {
+            const uint32_t w = __atomic_load_n(words + i, __ATOMIC_RELAXED);
+            std::memcpy(dst + 4 * i, &w, 4);
+        }
+    }
+
+    static void storeWords(uint8_t *dst, const uint8_t *src, size_t bytes) {
+        uint32_t *words = reinterpret_cast<uint32_t *>(dst);
+        for (size_t i = 0; i < bytes / 4; i++) {
+            uint32_t w;
+            std::memcpy(&w, src + 4 * i, 4);
+            __atomic_store_n(words + i, w, __ATOMIC_RELAXED);
+        }
+    }
+
+    void commitStage() {
+        const uint64_t k = written_.load(std::memory_order_relaxed);
+        begun_.store(k + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        uint8_t *slot = storage_ + (size_t)(k % slots_) * slot_size_;
+        uint8_t header[SLOT_HEADER];
+        putLe32(header, stage_first_);
+        putLe32(header + 4, stage_ts_);
+        putLe16(header + 8, (uint16_t)stage_count_);
+        putLe16(header + 10, 0);
+        storeWords(slot, header, SLOT_HEADER);
+        if (fmt_ == HistoryFormat::Pcm16) {
+            storeWords(slot + SLOT_HEADER, reinterpret_cast<const uint8_t *>(stage_),
+                       wordBytes(stage_count_ * sizeof(int16_t)));
+        } else {
+            // Cada slot é independente (o preditor vai no cabeçalho do ADPCM)
+            uint8_t encoded[wordBytes(adpcm::encodedSize(CHUNK_SAMPLES))];
+            const size_t len = encoder_.encode(stage_, stage_count_, encoded);
+            storeWords(slot + SLOT_HEADER, encoded, wordBytes(len));
+        }
+
+        committed_end_.store(stage_first_ + (uint32_t)stage_count_, std::memory_order_release);
+        written_.store(k + 1, std::memory_order_release);
+        stage_count_ = 0;
+    }
+
+    uint8_t *storage_;
+    HistoryFormat fmt_;
+    size_t slot_size_;
+    size_t slots_;
+
+    // Só o produtor mexe
+    int16_t stage_[CHUNK_SAMPLES];
+    size_t stage_count_ = 0;
+    uint32_t stage_first_ = 0;
+    uint32_t stage_ts_ = 0;
+    uint64_t ts_step_x1000_ = 50000; // 20 kHz
+    AdpcmEncoder encoder_;
+
+    alignas(64) std::atomic<uint64_t> written_{0};  // blocos completos
+    alignas(64) std::atomic<uint64_t> begun_{0};    // blocos cuja escrita começou
+    std::atomic<uint64_t> floor_{0};                // primeiro bloco após clear()
+    std::atomic<uint32_t> committed_end_{0};
+};
+
+static_assert(HistoryRing::slotSize(HistoryFormat::Pcm16) % 4 == 0 &&
+                  HistoryRing::slotSize(HistoryFormat::ImaAdpcm) % 4 == 0,
+              "slots em palavras de 32 bits");
+
+//================================================================
+// --- RAJADA DO HISTÓRICO E PASSAGEM PARA O AO VIVO ---
+//================================================================
+// Percorre o histórico do mais antigo ao mais novo e diz o que fazer com
+// os blocos ao vivo que chegam enquanto isso: o que o histórico já cobre é
+// descartado, e o primeiro bloco ao vivo é aparado no ponto exato em que o
+// histórico parou, então o stream sai sem buracos nem repetições.
+
+class BackfillCursor {
+public:
+    void start(const HistoryRing &history) {
+        next_ = history.oldest();
+        active_ = next_ < history.newest();
+        has_sent_ = false;
+    }
+
+    bool active() const { return active_; }
+
+    // Próximo bloco do histórico; ao alcançar o mais novo a rajada termina
+    bool next(const HistoryRing &history, HistoryRing::Chunk &out) {
+        while (active_) {
+            const uint64_t oldest = history.oldest();
+            if (next_ < oldest) next_ = oldest; // atrasou mais que o anel
+            if (next_ >= history.newest()) {
+                active_ = false;
+                break;
+            }
+            if (history.read(next_++, out)) {
+                sent_end_ = out.first_sample + out.count;
+                has_sent_ = true;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Quantas amostras do início de um bloco ao vivo já saíram pelo histórico
+    // (count inteiro = descartar o bloco)
+    size_t liveSkip(uint32_t first_sample, size_t count) const {
+        if (!has_sent_) return 0;
+        const int32_t covered = (int32_t)(sent_end_ - first_sample);
+        if (covered <= 0) return 0;
+        return (size_t)covered < count ? (size_t)covered : count;
+    }
+
+    // O bloco ao vivo já está no histórico e pode ser descartado durante a rajada
+    static bool coveredByHistory(const HistoryRing &history, uint32_t first_sample, size_t count) {
+        return (int32_t)(history.committedEnd() - (first_sample + (uint32_t)count)) >= 0;
+    }
+
+private:
+    uint64_t next_ = 0;
+    bool active_ = false;
+    bool has_sent_ = false;
+    uint32_t sent_end_ = 0;
+};
+
+} // namespace stetho
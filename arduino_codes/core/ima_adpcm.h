@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "compiler.h"
+
+//================================================================
+// --- IMA-ADPCM (4 BITS POR AMOSTRA) ---
+//================================================================
+// Cada bloco é autossuficiente, como os blocos IMA de arquivos WAV:
+//
+//   bytes 0-1: preditor inicial (int16 LE) = primeira amostra do bloco
+//   byte  2:   índice do passo (0 a 88)
+//   byte  3:   flags (bit 0: o último nibble é enchimento)
+//   bytes 4-:  n-1 códigos de 4 bits, nibble baixo primeiro
+//
+// Como o estado do codec viaja no cabeçalho, perder uma notificação não
+// afeta a decodificação das seguintes. 250 amostras -> 4 + 125 = 129 bytes.
+
+namespace stetho {
+
+namespace adpcm {
+
+constexpr size_t HEADER_SIZE = 4;
+constexpr uint8_t FLAG_PAD_NIBBLE = 0x01;
+
+constexpr size_t encodedSize(size_t n) { return n == 0 ? 0 : HEADER_SIZE + n / 2; }
+
+static const int8_t INDEX_TABLE[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+static const int16_t STEP_TABLE[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,
+    25,    28,    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,
+    88,    97,    107,   118,   130,   143,   157,   173,   190,   209,   230,   253,   279,
+    307,   337,   371,   408,   449,   494,   544,   598,   658,   724,   796,   876,   963,
+    1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,  3327,
+    3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+struct State {
+    int32_t predictor = 0;
+    int32_t index = 0;
+};
+
+STETHO_ALWAYS_INLINE int32_t clampIndex(int32_t i) { return i < 0 ? 0 : (i > 88 ? 88 : i); }
+
+// Reconstrói a próxima amostra a partir de um código (igual no codificador)
+STETHO_ALWAYS_INLINE int32_t step(State &s, uint8_t code) {
+    const int32_t st = STEP_TABLE[s.index];
+    int32_t diff = st >> 3;
+    if (code & 4) diff += st;
+    if (code & 2) diff += st >> 1;
+    if (code & 1) diff += st >> 2;
+    int32_t p = (code & 8) ? s.predictor - diff : s.predictor + diff;
+    p = p < -32768 ? -32768 : (p > 32767 ? 32767 : p);
+    s.predictor = p;
+    s.index = clampIndex(s.index + INDEX_TABLE[code]);
+    return p;
+}
+
+STETHO_ALWAYS_INLINE uint8_t encodeSample(State &s, int32_t sample) {
+    const int32_t st = STEP_TABLE[s.index];
+    int32_t diff = sample - s.predictor;
+    uint8_t code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    if (diff >= st) {
+        code |= 4;
+        diff -= st;
+    }
+    if (diff >= (st >> 1)) {
+        code |= 2;
+        diff -= st >> 1;
+    }
+    if (diff >= (st >> 2)) code |= 1;
+    step(s, code);
+    return code;
+}
+
+} // namespace adpcm
+
+// Codificador com estado contínuo entre blocos (o índice do passo segue de
+// um bloco para o outro, o preditor é reiniciado na primeira amostra).
+class AdpcmEncoder {
+public:
+    // Devolve o número de bytes escritos (adpcm::encodedSize(n))
+    STETHO_HOT size_t encode(const int16_t *in, size_t n, uint8_t *out) {
+        if (n == 0) return 0;
+        state_.predictor = in[0];
+        out[0] = (uint8_t)((uint16_t)in[0] & 0xFF);
+        out[1] = (uint8_t)((uint16_t)in[0] >> 8);
+        out[2] = (uint8_t)state_.index;
+        out[3] = (n % 2 == 0) ? adpcm::FLAG_PAD_NIBBLE : 0;
+
+        uint8_t *p = out + adpcm::HEADER_SIZE;
+        size_t i = 1;
+        for (; i + 1 < n; i += 2) {
+            uint8_t lo = adpcm::encodeSample(state_, in[i]);
+            uint8_t hi = adpcm::encodeSample(state_, in[i + 1]);
+            *p++ = (uint8_t)(lo | (hi << 4));
+        }
+        if (i < n) *p++ = adpcm::encodeSample(state_, in[i]);
+        return (size_t)(p - out);
+    }
+
+    void reset() { state_ = adpcm::State(); }
+
+private:
+    adpcm::State state_;
+};
+
+// Decodifica um bloco. Devolve o número de amostras escritas ou -1 se o
+// bloco for inválido ou não couber em 'max_samples'.
+inline int adpcmDecode(const uint8_t *in, size_t len, int16_t *out, size_t max_samples) {
+    if (len < adpcm::HEADER_SIZE || in[2] > 88) return -1;
+    const size_t data_len = len - adpcm::HEADER_SIZE;
+    const bool pad = (in[3] & adpcm::FLAG_PAD_NIBBLE) != 0;
+    if (pad && data_len == 0) return -1;
+    const size_t n = 1 + 2 * data_len - (pad ? 1 : 0);
+    if (n > max_samples) return -1;
+
+    adpcm::State s;
+    s.predictor = (int16_t)(uint16_t)(in[0] | (in[1] << 8));
+    s.index = in[2];
+    out[0] = (int16_t)s.predictor;
+    const uint8_t *p = in + adpcm::HEADER_SIZE;
+    for (size_t i = 1; i < n; i++) {
+        const uint8_t byte = p[(i - 1) >> 1];
+        const uint8_t code = ((i - 1) & 1) ? (byte >> 4) : (byte & 0x0F);
+        out[i] = (int16_t)adpcm::step(s, code);
+    }
+    return (int)n;
+}
+
+} // namespace stetho
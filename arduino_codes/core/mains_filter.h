@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "compiler.h"
+#include "fixed_point.h"
+#include "sample_kernels.h"
+
+//================================================================
+// --- BLOQUEIO DE DC + CANCELADOR DO ZUMBIDO DA REDE ---
+//================================================================
+// Roda sobre as palavras I2S no próprio buffer do DMA, antes de qualquer
+// front-end, então vale para o banco de biquads, o passa-baixa e o >> 14:
+//
+//  1. Bloqueio de DC: y = x - média, com a média num integrador com vazamento
+//     2^-DC_BLOCK_SHIFT (corte ~3 Hz a 20 kHz) em int64. O offset do
+//     microfone deixa de gastar a faixa do int16 depois do >> 14.
+//
+//  2. Cancelador adaptativo (Widrow): para a fundamental da rede e as
+//     harmônicas até MAINS_HARMONICS, um fasor de referência gira a k vezes a
+//     frequência estimada e dois pesos estimam amplitude e fase do zumbido,
+//     que é subtraído. Cada harmônica equivale a um notch de
+//     MAINS_NOTCH_BANDWIDTH_HZ de largura.
+//
+//  3. Os pesos aprendem por bloco (LMS em bloco: o gradiente é somado com os
+//     pesos parados e aplicado no fim) e só nos blocos calmos, em que o
+//     resíduo fica perto do piso recente. O zumbido é contínuo e as bulhas
+//     não: durante uma bulha o cancelador só subtrai a estimativa e não
+//     arranca do som cardíaco o que cai perto das harmônicas.
+//
+//  4. Rastreio da frequência: com a referência fora da frequência real, o
+//     peso da fundamental gira na diferença. Entre dois blocos calmos a
+//     rotação corrige a estimativa (FLL), dentro de ± MAINS_MAX_DRIFT_HZ da
+//     nominal; sem zumbido audível a estimativa fica parada.
+//
+// O custo por amostra é fixo (sem desvio por amostra nem por harmônica); o
+// trabalho por bloco é uma atan2 e MAINS_HARMONICS pares de cos/sin quando a
+// frequência muda.
+
+namespace stetho {
+
+constexpr int DC_BLOCK_SHIFT = 10;
+constexpr size_t MAINS_HARMONICS = 4;
+constexpr double MAINS_NOTCH_BANDWIDTH_HZ = 1.0;
+constexpr double MAINS_MAX_DRIFT_HZ = 2.0;
+
+class MainsFilter {
+public:
+    // Abaixo disso (LSB da escala do >> 14) a fundamental não move o FLL
+    static constexpr float LOCK_AMPLITUDE = 32.0f;
+    // Fração da diferença medida aplicada por bloco calmo. A rotação dos
+    // pesos responde à correção com o atraso do LMS (~13 blocos), e este
+    // ganho deixa a malha amortecida.
+    static constexpr float FLL_GAIN = 0.04f;
+    // Bloco calmo: potência do resíduo até QUIET_RATIO vezes o piso, que sobe
+    // FLOOR_RISE por bloco enquanto não é renovado (dobra em ~35 blocos)
+    static constexpr float QUIET_RATIO = 4.0f;
+    static constexpr float FLOOR_RISE = 1.02f;
+    // Uma bulha dura ~0,1-0,2 s. Resíduo alto por mais tempo que isso é o
+    // próprio zumbido escapando com os pesos parados: o piso recomeça ali e os
+    // pesos voltam a aprender.
+    static constexpr double MAX_LOUD_SECONDS = 0.25;
+    // O piso não desce abaixo de 1 LSB rms: sem som cardíaco o resíduo vira só
+    // quantização, e qualquer passo do FLL pareceria uma bulha
+    static constexpr float MIN_FLOOR = 1.0f;
+
+    MainsFilter(double sample_rate, double nominal_hz)
+        : sample_rate_(sample_rate), nominal_hz_(nominal_hz),
+          mu_((float)(2.0 * M_PI * MAINS_NOTCH_BANDWIDTH_HZ / sample_rate)) {
+        reset();
+    }
+
+    void reset() {
+        dc_ = 0;
+        dc_primed_ = false;
+        for (size_t k = 0; k < MAINS_HARMONICS; k++) {
+            w_re_[k] = w_im_[k] = 0.0f;
+            p_re_[k] = 1.0f;
+            p_im_[k] = 0.0f;
+        }
+        prev_re_ = prev_im_ = 0.0f;
+        prev_quiet_ = false;
+        floor_ = 0.0f;
+        loud_ = 0;
+        warmup_ = (size_t)sample_rate_;
+        setFrequency(nominal_hz_);
+    }
+
+    // Filtra as palavras I2S no lugar; cada chamada é um bloco do LMS
+    STETHO_HOT void process(int32_t *buf, size_t n) {
+        if (n == 0) return;
+        // Primeiro bloco: a média parte da primeira amostra, sem degrau
+        if (!dc_primed_) {
+            dc_ = (int64_t)buf[0] << DC_BLOCK_SHIFT;
+            dc_primed_ = true;
+        }
+        constexpr float IN_SCALE = 1.0f / (float)(1 << I2S_TO_INT16_SHIFT);
+        constexpr float OUT_SCALE = (float)(1 << I2S_TO_INT16_SHIFT);
+        // Maior float abaixo de 2^31
+        constexpr float OUT_MAX = 2147483520.0f;
+
+        float w_re[MAINS_HARMONICS], w_im[MAINS_HARMONICS], p_re[MAINS_HARMONICS], p_im[MAINS_HARMONICS];
+        float g_re[MAINS_HARMONICS], g_im[MAINS_HARMONICS];
+        for (size_t k = 0; k < MAINS_HARMONICS; k++) {
+            w_re[k] = w_re_[k];
+            w_im[k] = w_im_[k];
+            p_re[k] = p_re_[k];
+            p_im[k] = p_im_[k];
+            g_re[k] = g_im[k] = 0.0f;
+        }
+        int64_t dc = dc_;
+        float energy = 0.0f;
+
+        for (size_t i = 0; i < n; i++) {
+            // dc guarda a média com DC_BLOCK_SHIFT bits de fração
+            const int64_t x = buf[i];
+            dc += x - (dc >> DC_BLOCK_SHIFT);
+            const float v = (float)sat32(x - (dc >> DC_BLOCK_SHIFT)) * IN_SCALE;
+
+            float hum = 0.0f;
+            for (size_t k = 0; k < MAINS_HARMONICS; k++) hum += w_re[k] * p_re[k] + w_im[k] * p_im[k];
+            const float e = v - hum;
+            energy += e * e;
+            for (size_t k = 0; k < MAINS_HARMONICS; k++) {
+                g_re[k] += e * p_re[k];
+                g_im[k] += e * p_im[k];
+                const float re = p_re[k] * c_[k] - p_im[k] * s_[k];
+                p_im[k] = p_re[k] * s_[k] + p_im[k] * c_[k];
+                p_re[k] = re;
+            }
+
+            float out = e * OUT_SCALE;
+            out = out > OUT_MAX ? OUT_MAX : out;
+            out = out < -OUT_MAX ? -OUT_MAX : out;
+            buf[i] = (int32_t)out;
+        }
+        dc_ = dc;
+
+        const bool quiet = quietBlock(energy / (float)n, n);
+        const float mu = quiet ? mu_ : 0.0f;
+        for (size_t k = 0; k < MAINS_HARMONICS; k++) {
+            w_re_[k] = w_re[k] + mu * g_re[k];
+            w_im_[k] = w_im[k] + mu * g_im[k];
+            // O erro de arredondamento das rotações encurta/alonga o fasor
+            const float g = 1.5f - 0.5f * (p_re[k] * p_re[k] + p_im[k] * p_im[k]);
+            p_re_[k] = p_re[k] * g;
+            p_im_[k] = p_im[k] * g;
+        }
+        track(n, quiet);
+    }
+
+    // Frequência da rede estimada, em Hz
+    double frequency() const { return freq_hz_; }
+    double nominal() const { return nominal_hz_; }
+    // Amplitude estimada da harmônica k (0 = fundamental), na escala do >> 14
+    float humAmplitude(size_t k) const {
+        return k < MAINS_HARMONICS ? std::sqrt(w_re_[k] * w_re_[k] + w_im_[k] * w_im_[k]) : 0.0f;
+    }
+    bool locked() const { return humAmplitude(0) >= LOCK_AMPLITUDE; }
+    // Média retirada pelo bloqueio de DC, em palavras I2S
+    int32_t dcOffset() const { return (int32_t)(dc_ >> DC_BLOCK_SHIFT); }
+
+private:
+    // 'floor_' é o menor nível recente do resíduo. No primeiro segundo ele só
+    // é medido e os pesos não aprendem (o sinal pode começar numa bulha).
+    bool quietBlock(float mean_square, size_t n) {
+        if (warmup_ > 0) {
+            if (floor_ <= 0.0f || mean_square < floor_) floor_ = mean_square;
+            warmup_ -= n < warmup_ ? n : warmup_;
+            return false;
+        }
+        if (mean_square < floor_) {
+            floor_ = mean_square > MIN_FLOOR ? mean_square : MIN_FLOOR;
+        } else {
+            floor_ *= FLOOR_RISE;
+        }
+        if (mean_square <= QUIET_RATIO * floor_) {
+            loud_ = 0;
+            return true;
+        }
+        loud_ += n;
+        if ((double)loud_ < MAX_LOUD_SECONDS * sample_rate_) return false;
+        floor_ = mean_square;
+        loud_ = 0;
+        return true;
+    }
+
+    void setFrequency(double hz) {
+        freq_hz_ = hz;
+        for (size_t k = 0; k < MAINS_HARMONICS; k++) {
+            const double w = 2.0 * M_PI * (double)(k + 1) * hz / sample_rate_;
+            c_[k] = (float)std::cos(w);
+            s_[k] = (float)std::sin(w);
+        }
+    }
+
+    // O peso W da fundamental segue conj(zumbido / referência): com a
+    // referência delta Hz abaixo da rede, W gira -delta por segundo
+    void track(size_t n, bool quiet) {
+        const float re = w_re_[0], im = w_im_[0];
+        // Só mede entre dois blocos em que os pesos aprenderam
+        const bool strong = quiet && prev_quiet_ && humAmplitude(0) >= LOCK_AMPLITUDE &&
+                            prev_re_ * prev_re_ + prev_im_ * prev_im_ >= LOCK_AMPLITUDE * LOCK_AMPLITUDE;
+        prev_quiet_ = quiet;
+        if (strong) {
+            // Ângulo de W * conj(W anterior)
+            const float dphi = std::atan2(im * prev_re_ - re * prev_im_, re * prev_re_ + im * prev_im_);
+            const double delta_hz = -(double)dphi * sample_rate_ / (2.0 * M_PI * (double)n);
+            double hz = freq_hz_ + FLL_GAIN * delta_hz;
+            if (hz > nominal_hz_ + MAINS_MAX_DRIFT_HZ) hz = nominal_hz_ + MAINS_MAX_DRIFT_HZ;
+            if (hz < nominal_hz_ - MAINS_MAX_DRIFT_HZ) hz = nominal_hz_ - MAINS_MAX_DRIFT_HZ;
+            setFrequency(hz);
+        }
+        prev_re_ = re;
+        prev_im_ = im;
+    }
+
+    double sample_rate_;
+    double nominal_hz_;
+    double freq_hz_ = 0.0;
+    float mu_;
+    int64_t dc_ = 0;
+    bool dc_primed_ = false;
+    float w_re_[MAINS_HARMONICS], w_im_[MAINS_HARMONICS];
+    float p_re_[MAINS_HARMONICS], p_im_[MAINS_HARMONICS];
+    float c_[MAINS_HARMONICS], s_[MAINS_HARMONICS];
+    float prev_re_ = 0.0f, prev_im_ = 0.0f;
+    bool prev_quiet_ = false;
+    float floor_ = 0.0f;
+    size_t loud_ = 0;   // amostras seguidas acima do piso
+    size_t warmup_ = 0; // amostras até os pesos começarem a aprender
+};
+
+} // namespace stetho
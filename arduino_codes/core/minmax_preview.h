@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "compiler.h"
+#include "packetizer.h"
+#include "stream_format.h"
+
+//================================================================
+// --- PRÉVIA MIN/MAX PARA O GRÁFICO AO VIVO ---
+//================================================================
+// Um par (mínimo, máximo) a cada 'bucket' amostras do stream decimado.
+// Desenhar a linha vertical de cada par reproduz o traçado do gráfico com
+// ~800 pontos por segundo em vez das 20.000 amostras, e o pico que o
+// downsampleData do SkiaLineChart escolhe é sempre um dos dois extremos.
+//
+// Layout de uma notificação da característica de prévia:
+//
+//   byte  0:   versão (PREVIEW_VERSION)
+//   byte  1:   reservado
+//   bytes 2-3: amostras por par u16
+//   bytes 4-7: first_sample u32 (índice da primeira amostra do primeiro par)
+//   pares int16 LE (mínimo, máximo), consecutivos
+//
+// Um salto de índice no stream fecha a notificação em andamento e descarta
+// o par incompleto, então os pares de uma notificação nunca atravessam buracos.
+
+namespace stetho {
+
+constexpr uint8_t PREVIEW_VERSION = 1;
+constexpr size_t PREVIEW_HEADER = 8;
+constexpr size_t PREVIEW_PAIR_BYTES = 4;
+
+// Valor do comando SetPreview: 0 = desligado, senão pares por segundo / 10
+inline uint32_t previewPairsPerSecond(uint8_t value) { return (uint32_t)value * 10; }
+
+// Mínimo e máximo de um trecho contíguo. Quatro acumuladores independentes
+// tiram a dependência entre iterações (o GCC vetoriza no host; no xtensa
+// vira min/max sem desvio).
+STETHO_HOT inline void minMaxBlock(const int16_t *STETHO_RESTRICT x, size_t n, int16_t &lo, int16_t &hi) {
+    int16_t l0 = lo, l1 = lo, l2 = lo, l3 = lo;
+    int16_t h0 = hi, h1 = hi, h2 = hi, h3 = hi;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        l0 = x[i] < l0 ? x[i] : l0;
+        h0 = x[i] > h0 ? x[i] : h0;
+        l1 = x[i + 1] < l1 ? x[i + 1] : l1;
+        h1 = x[i + 1] > h1 ? x[i + 1] : h1;
+        l2 = x[i + 2] < l2 ? x[i + 2] : l2;
+        h2 = x[i + 2] > h2 ? x[i + 2] : h2;
+        l3 = x[i + 3] < l3 ? x[i + 3] : l3;
+        h3 = x[i + 3] > h3 ? x[i + 3] : h3;
+    }
+    for (; i < n; i++) {
+        l0 = x[i] < l0 ? x[i] : l0;
+        h0 = x[i] > h0 ? x[i] : h0;
+    }
+    l0 = l1 < l0 ? l1 : l0;
+    l2 = l3 < l2 ? l3 : l2;
+    h0 = h1 > h0 ? h1 : h0;
+    h2 = h3 > h2 ? h3 : h2;
+    lo = l2 < l0 ? l2 : l0;
+    hi = h2 > h0 ? h2 : h0;
+}
+
+class MinMaxPreview {
+public:
+    // Uma notificação cabe no buffer de pacote do envio (MTU máximo - 3)
+    static constexpr size_t MAX_PAIRS = (Packetizer::MAX_PAYLOAD - PREVIEW_HEADER) / PREVIEW_PAIR_BYTES;
+
+    // bucket: amostras por par; pairs_per_packet: pares por notificação
+    void configure(size_t bucket, size_t pairs_per_packet) {
+        bucket_ = bucket < 1 ? 1 : bucket > 0xFFFF ? 0xFFFF : bucket;
+        per_packet_ = pairs_per_packet < 1 ? 1 : pairs_per_packet > MAX_PAIRS ? MAX_PAIRS : pairs_per_packet;
+        reset();
+    }
+
+    void reset() {
+        fill_ = 0;
+        pairs_ = 0;
+        ready_ = false;
+    }
+
+    size_t bucket() const { return bucket_; }
+    size_t pairsPerPacket() const { return per_packet_; }
+
+    // Consome amostras até fechar uma notificação ou acabar a entrada e
+    // devolve quantas usou. Com uma notificação pronta, nada é consumido
+    // até takePacket().
+    STETHO_HOT size_t feed(const int16_t *x, size_t n, uint32_t first_sample) {
+        if (ready_ || n == 0) return 0;
+        if (pairs_ > 0 || fill_ > 0) {
+            if (first_sample != next_sample_) {
+                // Buraco: o par incompleto se perde; os completos saem já
+                fill_ = 0;
+                if (pairs_ > 0) {
+                    ready_ = true;
+                    return 0;
+                }
+            }
+        }
+        if (pairs_ == 0 && fill_ == 0) packet_first_ = first_sample;
+
+        size_t used = 0;
+        while (used < n && !ready_) {
+            size_t take = bucket_ - fill_;
+            if (take > n - used) take = n - used;
+            if (fill_ == 0) lo_ = hi_ = x[used];
+            minMaxBlock(x + used, take, lo_, hi_);
+            used += take;
+            fill_ += take;
+            if (fill_ == bucket_) {
+                lo_pairs_[pairs_] = lo_;
+                hi_pairs_[pairs_] = hi_;
+                pairs_++;
+                fill_ = 0;
+                if (pairs_ == per_packet_) ready_ = true;
+            }
+        }
+        next_sample_ = first_sample + (uint32_t)used;
+        return used;
+    }
+
+    bool hasPacket() const { return ready_; }
+
+    // Escreve a notificação pronta em 'out' (até Packetizer::MAX_PAYLOAD
+    // bytes) e começa a próxima
+    size_t takePacket(uint8_t *out) {
+        if (!ready_) return 0;
+        out[0] = PREVIEW_VERSION;
+        out[1] = 0;
+        putLe16(out + 2, (uint16_t)bucket_);
+        putLe32(out + 4, packet_first_);
+        uint8_t *p = out + PREVIEW_HEADER;
+        for (size_t i = 0; i < pairs_; i++, p += PREVIEW_PAIR_BYTES) {
+            putLe16(p, (uint16_t)lo_pairs_[i]);
+            putLe16(p + 2, (uint16_t)hi_pairs_[i]);
+        }
+        const size_t len = PREVIEW_HEADER + pairs_ * PREVIEW_PAIR_BYTES;
+        // O par em andamento (se houver) abre a próxima notificação
+        packet_first_ += (uint32_t)(pairs_ * bucket_);
+        pairs_ = 0;
+        ready_ = false;
+        return len;
+    }
+
+private:
+    size_t bucket_ = 50;
+    size_t per_packet_ = 40;
+    size_t fill_ = 0;
+    size_t pairs_ = 0;
+    bool ready_ = false;
+    int16_t lo_ = 0, hi_ = 0;
+    uint32_t next_sample_ = 0;
+    uint32_t packet_first_ = 0;
+    int16_t lo_pairs_[MAX_PAIRS];
+    int16_t hi_pairs_[MAX_PAIRS];
+};
+
+} // namespace stetho
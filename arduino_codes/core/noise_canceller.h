@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "compiler.h"
+#include "sample_kernels.h"
+
+//================================================================
+// --- CANCELADOR DE RUÍDO AMBIENTE COM DOIS MICROFONES ---
+//================================================================
+// O microfone do peito fica no slot esquerdo do I2S e um segundo microfone,
+// virado para fora, no direito. O de fora ouve a conversa, os alarmes e o
+// ventilador quase sem o som cardíaco; um FIR adaptativo de
+// NOISE_CANCELLER_TAPS coeficientes estima o caminho do ambiente até o peito
+// e a estimativa é subtraída (Widrow):
+//
+//   e[n] = peito[n] - sum_k w[k] * ref[n - k]
+//
+// Os coeficientes aprendem por NLMS em bloco: em cada trecho de
+// NOISE_CANCELLER_BLOCK amostras o filtro roda com w parado, e o gradiente
+// sum e[n] * ref[n - k] é aplicado no fim, normalizado pela potência da
+// referência. A potência do próprio resíduo também entra no denominador:
+// durante uma bulha o resíduo é som cardíaco, que não tem nada a ver com a
+// referência, e o passo encolhe em vez de espalhar esse som pelos pesos.
+//
+// Os dois laços (FIR e correlação do gradiente) são produtos escalares sobre
+// vetores contíguos de float, sem desvio, e o histórico da referência fica
+// linear na frente do trecho, sem índice circular.
+
+namespace stetho {
+
+// O que vai para o stream quando há dois microfones
+enum class StereoMode : uint8_t {
+    Cancel = 0,      // peito com o ambiente cancelado
+    Bypass = 1,      // peito sem o cancelador
+    Interleaved = 2, // peito e referência intercalados, sem o cancelador (gravações de pesquisa)
+};
+
+constexpr size_t STEREO_MODE_COUNT = 3;
+
+// 32 coeficientes = 1,6 ms a 20 kHz de diferença de caminho entre os microfones
+constexpr size_t NOISE_CANCELLER_TAPS = 32;
+constexpr size_t NOISE_CANCELLER_BLOCK = 64;
+
+// Quadros L/R do DMA estéreo -> esquerdo compactado em frames[0, n) e direito
+// em 'right'. O quadro i só escreve a palavra i, que já foi lida.
+STETHO_HOT inline void deinterleaveFrames(int32_t *frames, int32_t *STETHO_RESTRICT right, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        const int32_t l = frames[2 * i];
+        right[i] = frames[2 * i + 1];
+        frames[i] = l;
+    }
+}
+
+// buf[0, n) e b[0, n) -> pares (buf[0], b[0], buf[1], ...) em buf[0, 2n).
+// De trás para frente, cada par só escreve posições de buf já lidas.
+STETHO_HOT inline void interleavePairs(int16_t *buf, const int16_t *STETHO_RESTRICT b, size_t n) {
+    for (size_t i = n; i-- > 0;) {
+        const int16_t a = buf[i];
+        buf[2 * i + 1] = b[i];
+        buf[2 * i] = a;
+    }
+}
+
+class NoiseCanceller {
+public:
+    // Passo do NLMS (estável abaixo de 2)
+    static constexpr float STEP = 0.5f;
+    // Piso da potência da referência, na escala do >> 14 (LSB^2): com o
+    // ambiente em silêncio o passo não explode
+    static constexpr float MIN_POWER = 1.0f;
+    // Peso da potência do resíduo no denominador do passo
+    static constexpr float ERROR_WEIGHT = 1.0f;
+
+    NoiseCanceller() { reset(); }
+
+    void reset() {
+        std::memset(w_, 0, sizeof(w_));
+        std::memset(x_, 0, sizeof(x_));
+        ref_power_ = in_power_ = out_power_ = 0.0f;
+    }
+
+    // Subtrai do peito a parte correlacionada com a referência, no lugar.
+    // As duas são palavras I2S sem DC; com adapt = false os pesos ficam parados.
+    STETHO_HOT void process(int32_t *chest, const int32_t *reference, size_t n, bool adapt = true) {
+        while (n > 0) {
+            const size_t len = n < NOISE_CANCELLER_BLOCK ? n : NOISE_CANCELLER_BLOCK;
+            processChunk(chest, reference, len, adapt);
+            chest += len;
+            reference += len;
+            n -= len;
+        }
+    }
+
+    // Potências médias (escala do >> 14) do peito antes e depois, com
+    // constante de tempo de ~16 trechos
+    float inputPower() const { return in_power_; }
+    float outputPower() const { return out_power_; }
+    const float *weights() const { return w_; }
+
+private:
+    STETHO_HOT void processChunk(int32_t *chest, const int32_t *reference, size_t len, bool adapt) {
+        constexpr size_t T = NOISE_CANCELLER_TAPS;
+        constexpr float IN_SCALE = 1.0f / (float)(1 << I2S_TO_INT16_SHIFT);
+        constexpr float OUT_SCALE = (float)(1 << I2S_TO_INT16_SHIFT);
+        constexpr float OUT_MAX = 2147483520.0f; // maior float abaixo de 2^31
+
+        // x_[T - 1 + i] é ref[i]; x_[0, T - 1) são as últimas do trecho anterior
+        float *x = x_ + (T - 1);
+        float ref_energy = 0.0f;
+        for (size_t i = 0; i < len; i++) {
+            x[i] = (float)reference[i] * IN_SCALE;
+            ref_energy += x[i] * x[i];
+        }
+
+        // FIR com w parado; wr[k] multiplica ref[n - (T - 1 - k)]
+        float e[NOISE_CANCELLER_BLOCK];
+        float in_energy = 0.0f, err_energy = 0.0f;
+        for (size_t i = 0; i < len; i++) {
+            const float *xi = x_ + i;
+            float y = 0.0f;
+            for (size_t k = 0; k < T; k++) y += w_[k] * xi[k];
+            const float d = (float)chest[i] * IN_SCALE;
+            e[i] = d - y;
+            in_energy += d * d;
+            err_energy += e[i] * e[i];
+        }
+
+        for (size_t i = 0; i < len; i++) {
+            float out = e[i] * OUT_SCALE;
+            out = out > OUT_MAX ? OUT_MAX : out;
+            out = out < -OUT_MAX ? -OUT_MAX : out;
+            chest[i] = (int32_t)out;
+        }
+
+        const float inv_len = 1.0f / (float)len;
+        const float ref_power = ref_energy * inv_len;
+        ref_power_ += (ref_power - ref_power_) * (1.0f / 16.0f);
+        if (adapt) {
+            // Num trecho quieto a potência lenta manda: senão o ruído próprio
+            // do microfone de fora puxaria os pesos com o passo inteiro
+            const float power = ref_power > ref_power_ ? ref_power : ref_power_;
+            const float norm = (float)T * (power + MIN_POWER) + ERROR_WEIGHT * err_energy * inv_len;
+            const float mu = STEP * inv_len / norm;
+            for (size_t k = 0; k < T; k++) {
+                const float *xk = x_ + k;
+                float g = 0.0f;
+                for (size_t i = 0; i < len; i++) g += e[i] * xk[i];
+                w_[k] += mu * g;
+            }
+        }
+
+        // O fim deste trecho vira o histórico do próximo
+        std::memmove(x_, x_ + len, (T - 1) * sizeof(float));
+
+        in_power_ += (in_energy * inv_len - in_power_) * (1.0f / 16.0f);
+        out_power_ += (err_energy * inv_len - out_power_) * (1.0f / 16.0f);
+    }
+
+    float w_[NOISE_CANCELLER_TAPS];
+    float x_[NOISE_CANCELLER_TAPS - 1 + NOISE_CANCELLER_BLOCK];
+    float ref_power_ = 0.0f;
+    float in_power_ = 0.0f;
+    float out_power_ = 0.0f;
+};
+
+} // namespace stetho
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "frame.h"
+#include "ima_adpcm.h"
+#include "rice_codec.h"
+#include "stream_format.h"
+
+//================================================================
+// --- EMPACOTADOR CIENTE DO MTU ---
+//================================================================
+// Recebe as amostras como um stream contínuo (blocos de qualquer tamanho,
+// vindos do I2S/decimador) e corta notificações que ocupam o payload ATT
+// inteiro (MTU - 3 bytes), independente de como o tamanho do i2s_read se
+// alinha com o MTU negociado:
+//
+//  - Pcm16:    floor(capacidade / 2) amostras (capacidade par = cheio exato);
+//  - ImaAdpcm: 1 + 2 * (capacidade - 4) amostras, sempre cheio exato;
+//  - Rice:     o tamanho depende do sinal; o número de amostras é estimado
+//              pelos bits/amostra do pacote anterior e reduzido até caber.
+//
+// Blocos pequenos (ex.: 50 amostras a 4 kHz) são coalescidos no mesmo
+// pacote. Um pacote nunca atravessa uma descontinuidade (blocos descartados
+// no dispositivo) nem uma troca do expoente de ganho (core/block_float.h),
+// que vai no cabeçalho: o que veio antes sai num pacote curto.
+
+namespace stetho {
+
+struct PacketizerStats {
+    uint32_t packets = 0;
+    uint32_t dropped_samples = 0;  // push sem espaço no buffer
+    uint64_t samples = 0;
+    uint64_t payload_bytes = 0;    // bytes de áudio (sem o cabeçalho do quadro)
+    uint64_t header_bytes = 0;
+    uint64_t capacity_bytes = 0;   // soma de MTU - 3 dos pacotes enviados
+
+    // Fração do payload ATT ocupada por áudio
+    double efficiency() const {
+        return capacity_bytes ? (double)payload_bytes / (double)capacity_bytes : 0.0;
+    }
+};
+
+class Packetizer {
+public:
+    static constexpr uint16_t ATT_OVERHEAD = 3;
+    static constexpr uint16_t DEFAULT_MTU = 23;  // antes da troca de MTU
+    static constexpr uint16_t MAX_MTU = 517;
+    static constexpr size_t MAX_PAYLOAD = MAX_MTU - ATT_OVERHEAD;
+    // Mesmo limite do Reassembler (~51 ms a 20 kHz)
+    static constexpr size_t MAX_PACKET_SAMPLES = 1024;
+    static constexpr size_t FIFO_SAMPLES = 2 * MAX_PACKET_SAMPLES;
+    static constexpr size_t MAX_BREAKS = 8;
+
+    Packetizer() = default;
+
+    // O chamador esvazia com flush() antes de trocar a configuração
+    void configure(uint16_t mtu, StreamCodec codec, bool framed, uint32_t sample_rate_hz) {
+        if (mtu < DEFAULT_MTU) mtu = DEFAULT_MTU;
+        if (mtu > MAX_MTU) mtu = MAX_MTU;
+        mtu_ = mtu;
+        if (codec != codec_) adpcm_.reset();
+        codec_ = codec;
+        framed_ = framed;
+        sample_rate_hz_ = sample_rate_hz ? sample_rate_hz : 1;
+        rice_bits_x16_ = 0;
+    }
+
+    uint16_t mtu() const { return mtu_; }
+    StreamCodec codec() const { return codec_; }
+    bool framed() const { return framed_; }
+
+    // Bytes disponíveis em uma notificação
+    size_t capacity() const { return (size_t)(mtu_ - ATT_OVERHEAD); }
+    size_t payloadCapacity() const { return capacity() - (framed_ ? FRAME_HEADER_SIZE : 0); }
+    size_t buffered() const { return count_; }
+
+    // Acrescenta um bloco; 'first_sample' é o índice da sua primeira amostra
+    // na taxa de saída, 'timestamp_us' o instante de captura dela e
+    // 'gain_exp' o expoente de ganho das amostras
+    void push(const int16_t *samples, size_t n, uint32_t first_sample, uint32_t timestamp_us, int gain_exp = 0) {
+        const bool empty = count_ == 0 && break_count_ == 0;
+        const bool contiguous = first_sample == tailIndex();
+        if (empty || !started_) {
+            // Começo do stream ou fila vazia: este bloco vira a cabeça
+            if (started_ && !contiguous) head_flags_ |= FRAME_FLAG_DISCONTINUITY;
+            started_ = true;
+            head_index_ = first_sample;
+            head_gain_ = (int8_t)gain_exp;
+            ref_index_ = first_sample;
+            ref_ts_ = timestamp_us;
+        } else if (!contiguous || gain_exp != tailGain()) {
+            // Trecho novo: um quadro tem um só expoente
+            if (break_count_ == MAX_BREAKS) {
+                stats_.dropped_samples += (uint32_t)n;
+                return;
+            }
+            breaks_[break_count_++] = {count_, first_sample, timestamp_us, (int8_t)gain_exp, !contiguous};
+        } else if (break_count_ == 0) {
+            ref_index_ = first_sample;
+            ref_ts_ = timestamp_us;
+        }
+
+        if (n > FIFO_SAMPLES - count_) {
+            stats_.dropped_samples += (uint32_t)(n - (FIFO_SAMPLES - count_));
+            n = FIFO_SAMPLES - count_;
+        }
+        std::memcpy(fifo_ + count_, samples, n * sizeof(int16_t));
+        count_ += n;
+    }
+
+    // Escreve em 'out' o próximo pacote cheio; false se ainda faltam amostras
+    bool nextPacket(uint8_t *out, size_t &len) { return emit(out, len, false); }
+
+    // Escreve o que houver, mesmo que não encha o pacote (troca de MTU/codec, fim)
+    bool flush(uint8_t *out, size_t &len) { return emit(out, len, true); }
+
+    const PacketizerStats &stats() const { return stats_; }
+    void resetStats() { stats_ = PacketizerStats(); }
+
+    // Esquece o que está na fila (nova conexão)
+    void reset() {
+        count_ = 0;
+        break_count_ = 0;
+        started_ = false;
+        head_flags_ = 0;
+        head_gain_ = 0;
+        seq_ = 0;
+        rice_bits_x16_ = 0;
+        adpcm_.reset();
+    }
+
+    // Amostras de áudio que cabem em 'payload' bytes para os codecs de tamanho fixo
+    static size_t fixedSamplesFor(StreamCodec codec, size_t payload) {
+        switch (codec) {
+        case StreamCodec::ImaAdpcm:
+            return payload > adpcm::HEADER_SIZE ? 1 + 2 * (payload - adpcm::HEADER_SIZE) : 0;
+        default:
+            return payload / 2;
+        }
+    }
+
+private:
+    struct Break {
+        size_t offset;      // posição na fila onde começa o trecho
+        uint32_t first_sample;
+        uint32_t timestamp_us;
+        int8_t gain_exp;
+        bool discontinuity; // false: só o expoente mudou
+    };
+
+    bool emit(uint8_t *out, size_t &len, bool force) {
+        if (count_ == 0) {
+            if (break_count_ > 0) popBreak();
+            if (count_ == 0) return false;
+        }
+        // Amostras do trecho contínuo da cabeça
+        const size_t segment = break_count_ > 0 ? breaks_[0].offset : count_;
+        const bool segment_closed = break_count_ > 0;
+        const size_t payload_cap = payloadCapacity();
+
+        uint8_t *payload = out + (framed_ ? FRAME_HEADER_SIZE : 0);
+        size_t n = 0, payload_len = 0;
+
+        if (codec_ == StreamCodec::Rice) {
+            if (!riceFit(segment, payload_cap, force || segment_closed, payload, n, payload_len)) return false;
+        } else {
+            size_t want = fixedSamplesFor(codec_, payload_cap);
+            if (want > MAX_PACKET_SAMPLES) want = MAX_PACKET_SAMPLES;
+            if (want == 0) return false;
+            if (segment < want && !(force || segment_closed)) return false;
+            n = segment < want ? segment : want;
+            if (codec_ == StreamCodec::ImaAdpcm) {
+                payload_len = adpcm_.encode(fifo_, n, payload);
+            } else {
+                for (size_t i = 0; i < n; i++) putLe16(payload + 2 * i, (uint16_t)fifo_[i]);
+                payload_len = 2 * n;
+            }
+        }
+
+        size_t header_len = 0;
+        if (framed_) {
+            FrameHeader h;
+            h.seq = seq_++;
+            h.first_sample = head_index_;
+            h.timestamp_us = timestampOf(head_index_);
+            h.codec = codec_;
+            h.flags = head_flags_;
+            h.gain_exp = head_gain_;
+            header_len = writeFrameHeader(h, out);
+        }
+        head_flags_ = 0;
+        consume(n);
+
+        len = header_len + payload_len;
+        stats_.packets++;
+        stats_.samples += n;
+        stats_.payload_bytes += payload_len;
+        stats_.header_bytes += header_len;
+        stats_.capacity_bytes += capacity();
+        return true;
+    }
+
+    // Rice: maior n que cabe em 'cap' bytes. Sem 'force', só emite quando o
+    // trecho disponível já não cabe inteiro (ou seja, o pacote fica cheio).
+    bool riceFit(size_t segment, size_t cap, bool force, uint8_t *payload, size_t &n, size_t &len) {
+        const size_t limit = segment < MAX_PACKET_SAMPLES ? segment : MAX_PACKET_SAMPLES;
+        const bool can_wait = !force && limit < MAX_PACKET_SAMPLES;
+        if (cap < 3) return false;
+
+        // Estimativa pelos bits/amostra do último pacote evita codificar à toa
+        if (can_wait && rice_bits_x16_ != 0) {
+            const size_t estimate = ((cap - 1) * 8 * 16) / rice_bits_x16_;
+            if (limit * 10 < estimate * 9) return false;
+        }
+
+        n = limit;
+        size_t size = riceEncode(fifo_, n, scratch_);
+        if (size <= cap && can_wait) return false;
+        while (size > cap) {
+            // Encolhe proporcionalmente, com 2% de folga
+            size_t next = (n * cap * 49) / (size * 50);
+            if (next >= n) next = n - 1;
+            if (next == 0) return false;
+            n = next;
+            size = riceEncode(fifo_, n, scratch_);
+        }
+        std::memcpy(payload, scratch_, size);
+        len = size;
+        rice_bits_x16_ = (len * 8 * 16) / n;
+        if (rice_bits_x16_ == 0) rice_bits_x16_ = 1;
+        return true;
+    }
+
+    uint32_t timestampOf(uint32_t index) const {
+        const int64_t delta = (int64_t)(int32_t)(index - ref_index_);
+        return (uint32_t)((int64_t)ref_ts_ + delta * 1000000 / (int64_t)sample_rate_hz_);
+    }
+
+    int tailGain() const { return break_count_ > 0 ? breaks_[break_count_ - 1].gain_exp : head_gain_; }
+
+    // Índice da amostra seguinte à última da fila
+    uint32_t tailIndex() const {
+        if (break_count_ == 0) return head_index_ + (uint32_t)count_;
+        const Break &last = breaks_[break_count_ - 1];
+        return last.first_sample + (uint32_t)(count_ - last.offset);
+    }
+
+    void consume(size_t n) {
+        count_ -= n;
+        if (count_ > 0) std::memmove(fifo_, fifo_ + n, count_ * sizeof(int16_t));
+        for (size_t i = 0; i < break_count_; i++) breaks_[i].offset -= n;
+        head_index_ += (uint32_t)n;
+        if (break_count_ > 0 && breaks_[0].offset == 0) popBreak();
+    }
+
+    void popBreak() {
+        head_index_ = breaks_[0].first_sample;
+        ref_index_ = breaks_[0].first_sample;
+        ref_ts_ = breaks_[0].timestamp_us;
+        head_gain_ = breaks_[0].gain_exp;
+        if (breaks_[0].discontinuity) head_flags_ |= FRAME_FLAG_DISCONTINUITY;
+        for (size_t i = 1; i < break_count_; i++) breaks_[i - 1] = breaks_[i];
+        break_count_--;
+    }
+
+    uint16_t mtu_ = DEFAULT_MTU;
+    StreamCodec codec_ = StreamCodec::Pcm16;
+    bool framed_ = false;
+    uint32_t sample_rate_hz_ = 20000;
+
+    int16_t fifo_[FIFO_SAMPLES];
+    size_t count_ = 0;
+    bool started_ = false;
+    uint32_t head_index_ = 0;   // índice de fifo_[0]
+    uint8_t head_flags_ = 0;
+    int8_t head_gain_ = 0;      // expoente do trecho da cabeça
+    uint32_t ref_index_ = 0;    // referência para interpolar o timestamp
+    uint32_t ref_ts_ = 0;
+    Break breaks_[MAX_BREAKS];
+    size_t break_count_ = 0;
+
+    uint16_t seq_ = 0;
+    size_t rice_bits_x16_ = 0;
+    AdpcmEncoder adpcm_;
+    uint8_t scratch_[rice::maxEncodedSize(MAX_PACKET_SAMPLES)];
+    PacketizerStats stats_;
+};
+
+} // namespace stetho
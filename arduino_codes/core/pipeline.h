@@ -0,0 +1,415 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <utility>
+
+#include "biquad.h"
+#include "block_float.h"
+#include "compiler.h"
+#include "fixed_point.h"
+#include "mains_filter.h"
+#include "noise_canceller.h"
+#include "resampler.h"
+#include "sample_kernels.h"
+
+//================================================================
+// --- PIPELINE DE CAPTURA COMPOSTO EM TEMPO DE COMPILAÇÃO ---
+//================================================================
+// O caminho do buffer do DMA até o slot da fila é uma composição de
+// estágios escolhida por tipo, sem desvio nenhum por amostra:
+//
+//   palavras I2S -> [condicionamento: nada, DC + zumbido da rede, ou os
+//                    dois microfones com o cancelador de ambiente]
+//                -> [front-end: estágios por amostra + codificação int16,
+//                    ou o banco de biquads] -> [escala: >> 14 fixo ou
+//                    expoente por bloco] -> [taxa: direto ou decimado] -> slot
+//
+// Os estágios por amostra são functores int32 -> int32 sem virtual; o
+// SampleFrontEnd aplica todos em sequência dentro de um único laço e a
+// codificação final decide como o valor vira int16 (saturado ou cortado).
+// Como os tipos são conhecidos, o compilador gera um laço por variante com
+// tudo inline, igual ao que se escreveria à mão (bench/bench_pipeline.cpp).
+//
+// A fonte (buffer do DMA) e o destino (slot da fila) continuam sendo os
+// ponteiros passados a process(). O modo do filtro e a taxa de saída seguem
+// trocáveis em tempo de execução pelo app, na borda do bloco.
+
+namespace stetho {
+
+//================================================================
+// --- CONDICIONAMENTO DAS PALAVRAS I2S ---
+//================================================================
+// Roda no buffer do DMA antes do front-end, sobre as palavras de 32 bits
+
+struct NoConditioning {
+    explicit NoConditioning(double) {}
+    STETHO_ALWAYS_INLINE void process(int32_t *, size_t) {}
+};
+
+// Bloqueio de DC + cancelador do zumbido de MAINS_HZ e harmônicas (core/mains_filter.h)
+template <int MAINS_HZ>
+class MainsConditioning : public MainsFilter {
+public:
+    static_assert(MAINS_HZ == 50 || MAINS_HZ == 60, "rede de 50 ou 60 Hz");
+    explicit MainsConditioning(double sample_rate) : MainsFilter(sample_rate, MAINS_HZ) {}
+};
+
+// Dois microfones (core/noise_canceller.h): o buffer do DMA chega com n
+// quadros L/R e sai com o peito em dma[0, n), condicionado por Inner e, no
+// modo Cancel, sem o ambiente. A referência, condicionada por outro Inner,
+// fica em reference() até o próximo bloco. n <= MAX_FRAMES.
+template <class Inner, size_t MAX_FRAMES = 256>
+class DualMicConditioning {
+public:
+    static constexpr size_t MAX_BLOCK_FRAMES = MAX_FRAMES;
+
+    explicit DualMicConditioning(double sample_rate) : chest_(sample_rate), outside_(sample_rate) {}
+
+    // Pode ser chamado de outra tarefa (callback BLE); vale no próximo bloco
+    void requestMode(StereoMode mode) {
+        if ((size_t)mode < STEREO_MODE_COUNT) pending_.store((uint8_t)mode, std::memory_order_relaxed);
+    }
+    // Modo em uso; também pode ser lido de outra tarefa
+    StereoMode mode() const { return (StereoMode)active_.load(std::memory_order_relaxed); }
+
+    STETHO_HOT void process(int32_t *dma, size_t n) {
+        const uint8_t active = pending_.load(std::memory_order_relaxed);
+        active_.store(active, std::memory_order_relaxed);
+        if (n > MAX_FRAMES) n = MAX_FRAMES;
+        deinterleaveFrames(dma, reference_, n);
+        chest_.process(dma, n);
+        outside_.process(reference_, n);
+        // Fora do Cancel os pesos ficam onde estavam para a volta
+        if ((StereoMode)active == StereoMode::Cancel) canceller_.process(dma, reference_, n);
+    }
+
+    // Palavras da referência do último bloco; o chamador pode destruí-las
+    int32_t *reference() { return reference_; }
+    Inner &chest() { return chest_; }
+    NoiseCanceller &canceller() { return canceller_; }
+
+private:
+    Inner chest_;
+    Inner outside_;
+    NoiseCanceller canceller_;
+    std::atomic<uint8_t> active_{(uint8_t)StereoMode::Cancel}; // só a captura escreve
+    std::atomic<uint8_t> pending_{(uint8_t)StereoMode::Cancel};
+    int32_t reference_[MAX_FRAMES];
+};
+
+//================================================================
+// --- ESTÁGIOS POR AMOSTRA ---
+//================================================================
+
+// Cada estágio tem também wide(): o mesmo passo no caminho da escala larga
+// de core/block_float.h, em que só o deslocamento muda.
+
+// Palavra I2S de 32 bits -> escala de 16 bits
+template <int SHIFT = I2S_TO_INT16_SHIFT>
+struct ShiftStage {
+    static_assert(SHIFT >= BFP_WIDE_BITS, "a escala larga precisa de BFP_WIDE_BITS bits abaixo do deslocamento");
+    STETHO_ALWAYS_INLINE int32_t operator()(int32_t x) const { return x >> SHIFT; }
+    STETHO_ALWAYS_INLINE int32_t wide(int32_t x) const { return x >> (SHIFT - BFP_WIDE_BITS); }
+    void reset() {}
+};
+
+// y[n] = y[n-1] + a * (x[n] - y[n-1]) com 'a' em Q31, na escala da entrada.
+// Antes do deslocamento, o estado guarda os 14 bits que ele descarta (o
+// mesmo cálculo do FixedLowPass).
+template <int32_t ALPHA_Q31>
+class LowPassStage {
+public:
+    STETHO_ALWAYS_INLINE int32_t operator()(int32_t x) {
+        // Metade de cada termo para que a diferença caiba em 32 bits
+        const int32_t d = (x >> 1) - (y_ >> 1);
+        y_ += (int32_t)(((int64_t)d * ALPHA_Q31) >> 30);
+        return y_;
+    }
+    STETHO_ALWAYS_INLINE int32_t wide(int32_t x) { return (*this)(x); }
+    void reset() { y_ = 0; }
+
+private:
+    int32_t y_ = 0;
+};
+
+//================================================================
+// --- CODIFICAÇÃO EM INT16 ---
+//================================================================
+
+struct Saturate16 {
+    static STETHO_ALWAYS_INLINE int16_t encode(int32_t x) { return sat16(x); }
+};
+
+// Descarta os bits altos: sinais fortes dão a volta (o shiftBlock original)
+struct Wrap16 {
+    static STETHO_ALWAYS_INLINE int16_t encode(int32_t x) { return (int16_t)x; }
+};
+
+//================================================================
+// --- FRONT-ENDS: PALAVRAS I2S -> INT16 ---
+//================================================================
+// Mesma interface do FilterBank (process, processInPlace, widenInPlace,
+// requestMode, mode), que é o front-end do banco de biquads.
+
+template <class Encode, class... Stages>
+class SampleFrontEnd {
+public:
+    // Trecho convertido por vez no lugar (ver processInPlace)
+    static constexpr size_t CHUNK = 64;
+
+    SampleFrontEnd() = default;
+    // Mesma construção do FilterBank; sem banco não há modo para escolher
+    SampleFrontEnd(double, FilterMode) {}
+
+    STETHO_HOT void process(const int32_t *STETHO_RESTRICT in, int16_t *STETHO_RESTRICT out, size_t n) {
+        for (size_t i = 0; i < n; i++) out[i] = Encode::encode(apply(in[i], std::index_sequence_for<Stages...>{}));
+    }
+
+    // Converte no próprio buffer do DMA em trechos de CHUNK amostras: o trecho
+    // k escreve os bytes [2 * CHUNK * k, 2 * CHUNK * (k + 1)), que estão em
+    // palavras já lidas (as do próprio trecho no primeiro, de trechos
+    // anteriores nos demais). Devolve o início das amostras de 16 bits.
+    STETHO_HOT int16_t *processInPlace(int32_t *buf, size_t n) {
+        int16_t *out = reinterpret_cast<int16_t *>(buf);
+        int16_t chunk[CHUNK];
+        for (size_t off = 0; off < n; off += CHUNK) {
+            const size_t len = n - off < CHUNK ? n - off : CHUNK;
+            process(buf + off, chunk, len);
+            std::memcpy(out + off, chunk, len * sizeof(int16_t));
+        }
+        return out;
+    }
+
+    // Escala larga sem saturar, por cima das palavras de entrada
+    STETHO_HOT void widenInPlace(int32_t *buf, size_t n) {
+        for (size_t i = 0; i < n; i++) buf[i] = applyWide(buf[i], std::index_sequence_for<Stages...>{});
+    }
+
+    void requestMode(FilterMode) {}
+    FilterMode mode() const { return FilterMode::Wideband; }
+
+    void reset() {
+        std::apply([](auto &...stage) { (stage.reset(), ...); }, stages_);
+    }
+
+private:
+    template <size_t... I>
+    STETHO_ALWAYS_INLINE int32_t apply(int32_t x, std::index_sequence<I...>) {
+        ((x = std::get<I>(stages_)(x)), ...);
+        return x;
+    }
+
+    template <size_t... I>
+    STETHO_ALWAYS_INLINE int32_t applyWide(int32_t x, std::index_sequence<I...>) {
+        ((x = std::get<I>(stages_).wide(x)), ...);
+        return x;
+    }
+
+    std::tuple<Stages...> stages_;
+};
+
+//================================================================
+// --- TAXA DE SAÍDA ---
+//================================================================
+
+// Além de run(), cada taxa diz se o int16 vai direto ao destino (direct) ou
+// passa antes por finish(), e expõe o histórico do FIR para a troca de
+// expoente do ponto flutuante em bloco.
+
+// Sem decimação: o front-end escreve direto no destino
+struct FixedRate {
+    template <class FrontEnd>
+    STETHO_ALWAYS_INLINE size_t run(FrontEnd &front, int32_t *dma, int16_t *dst, size_t n) {
+        front.process(dma, dst, n);
+        return n;
+    }
+
+    bool direct() { return true; }
+    size_t finish(const int16_t *, size_t n, int16_t *) { return n; }
+    int historyHeadroom() const { return 15; }
+    void rescaleHistory(int) {}
+};
+
+// Decimador trocável pelo app: a 20 kHz o front-end escreve no destino,
+// nas outras taxas escreve direto na entrada do FIR (Decimator::input), em
+// trechos de até MAX_INPUT amostras, e a decimação escreve no destino
+class Decimated {
+public:
+    explicit Decimated(Decimator &decimator) : dec_(decimator) {}
+
+    template <class FrontEnd>
+    STETHO_ALWAYS_INLINE size_t run(FrontEnd &front, int32_t *dma, int16_t *dst, size_t n) {
+        if (dec_.preparePassthrough()) {
+            front.process(dma, dst, n);
+            return n;
+        }
+        if (n <= Decimator::MAX_INPUT) {
+            front.process(dma, dec_.input(), n);
+            return dec_.processInput(n, dst);
+        }
+        size_t produced = 0;
+        while (n > 0) {
+            const size_t len = n < Decimator::MAX_INPUT ? n : Decimator::MAX_INPUT;
+            front.process(dma, dec_.input(), len);
+            produced += dec_.processInput(len, dst + produced);
+            dma += len;
+            n -= len;
+        }
+        return produced;
+    }
+
+    bool direct() { return dec_.preparePassthrough(); }
+    size_t finish(const int16_t *pcm, size_t n, int16_t *dst) { return dec_.process(pcm, n, dst); }
+    int historyHeadroom() const { return dec_.historyHeadroom(); }
+    void rescaleHistory(int shift) { dec_.rescaleHistory(shift); }
+
+    Decimator &decimator() { return dec_; }
+
+private:
+    Decimator &dec_;
+};
+
+//================================================================
+// --- ESCALA DA SAÍDA ---
+//================================================================
+
+// Sempre o >> 14 (expoente 0)
+struct FixedScaling {
+    explicit FixedScaling(double) {}
+
+    template <class FrontEnd, class Rate>
+    STETHO_ALWAYS_INLINE size_t run(FrontEnd &front, Rate &rate, int32_t *dma, int16_t *dst, size_t n) {
+        return rate.run(front, dma, dst, n);
+    }
+
+    int gainExp() const { return 0; }
+};
+
+// Ponto flutuante em bloco (core/block_float.h), com o modo trocável pelo
+// app na borda do bloco. No modo Fixed o caminho é o mesmo do FixedScaling.
+class BlockScaling {
+public:
+    explicit BlockScaling(double sample_rate) : control_(sample_rate) {}
+
+    // Pode ser chamado de outra tarefa (callback BLE)
+    void requestMode(ScalingMode mode) {
+        if ((size_t)mode < SCALING_MODE_COUNT) pending_.store((uint8_t)mode, std::memory_order_relaxed);
+    }
+    // Modo em uso; também pode ser lido de outra tarefa
+    ScalingMode mode() const { return (ScalingMode)active_.load(std::memory_order_relaxed); }
+
+    // Expoente do último bloco processado
+    int gainExp() const { return gain_exp_; }
+    GainControl &gainControl() { return control_; }
+
+    template <class FrontEnd, class Rate>
+    STETHO_ALWAYS_INLINE size_t run(FrontEnd &front, Rate &rate, int32_t *dma, int16_t *dst, size_t n) {
+        const uint8_t pending = pending_.load(std::memory_order_relaxed);
+        if (pending != active_.load(std::memory_order_relaxed)) {
+            active_.store(pending, std::memory_order_relaxed);
+            control_.setMode((ScalingMode)pending);
+        }
+        if ((ScalingMode)pending == ScalingMode::Fixed) {
+            if (gain_exp_ != 0) {
+                rate.rescaleHistory(-gain_exp_);
+                gain_exp_ = 0;
+            }
+            return rate.run(front, dma, dst, n);
+        }
+
+        const bool direct = rate.direct();
+        front.widenInPlace(dma, n);
+        int g = control_.next(blockPeak(dma, n), n);
+        if (!direct && g > gain_exp_) {
+            // O histórico do FIR sobe junto; não pode saturar
+            const int room = rate.historyHeadroom();
+            if (g > gain_exp_ + room) g = gain_exp_ + room;
+        }
+        if (g != gain_exp_) {
+            if (!direct) rate.rescaleHistory(g - gain_exp_);
+            gain_exp_ = g;
+        }
+        if (direct) {
+            quantizeBlock(dma, dst, n, g);
+            return n;
+        }
+        return rate.finish(quantizeInPlace(dma, n, g), n, dst);
+    }
+
+private:
+    GainControl control_;
+    std::atomic<uint8_t> active_{(uint8_t)ScalingMode::Fixed}; // só a captura escreve
+    std::atomic<uint8_t> pending_{(uint8_t)ScalingMode::Fixed};
+    int gain_exp_ = 0;
+};
+
+//================================================================
+// --- PIPELINE ---
+//================================================================
+// O destino precisa de espaço para n + 1 amostras (ver Decimator::process).
+// process() destrói o conteúdo do buffer do DMA.
+template <class FrontEnd, class Rate, class Scaling = FixedScaling, class Conditioning = NoConditioning>
+class CapturePipeline {
+public:
+    template <class... RateArgs>
+    CapturePipeline(double sample_rate, FilterMode mode, RateArgs &&...rate_args)
+        : conditioning_(sample_rate), front_(sample_rate, mode), rate_(std::forward<RateArgs>(rate_args)...),
+          scaling_(sample_rate) {}
+
+    STETHO_HOT size_t process(int32_t *dma, int16_t *dst, size_t n) {
+        conditioning_.process(dma, n);
+        return scaling_.run(front_, rate_, dma, dst, n);
+    }
+
+    // Pode ser chamado de outra tarefa (callback BLE), como no FilterBank
+    void requestMode(FilterMode mode) { front_.requestMode(mode); }
+    FilterMode mode() const { return front_.mode(); }
+
+    FrontEnd &frontEnd() { return front_; }
+    Rate &rate() { return rate_; }
+    Scaling &scaling() { return scaling_; }
+    Conditioning &conditioning() { return conditioning_; }
+
+private:
+    Conditioning conditioning_;
+    FrontEnd front_;
+    Rate rate_;
+    Scaling scaling_;
+};
+
+//================================================================
+// --- CONFIGURAÇÕES DOS FIRMWARES ---
+//================================================================
+// Os três caminhos que existiam como arquivos separados:
+//
+//   BiquadBank: banco de biquads selecionável (current.cpp)
+//   LowPass:    passa-baixa de 1ª ordem a = 0.05, saturado (current_with_filter.cpp)
+//   Shift:      só o >> 14, sem saturação (current_without_filter.cpp)
+//
+// Shift é o mesmo cálculo do arquivo original, bit a bit. O LowPass é o do
+// FixedLowPass em Q31 que já tinha substituído o float do arquivo: igual a
+// ele bit a bit, mas só perto do float original (filtra antes do >> 14, com
+// os bits que ele descartava); o bench_fixed_lowpass mede os dois contra uma
+// referência em double.
+enum class CaptureFrontEnd : uint8_t {
+    BiquadBank = 0,
+    LowPass = 1,
+    Shift = 2,
+};
+
+constexpr int32_t LOWPASS_FRONT_END_ALPHA_Q31 = toQ31(0.05f);
+
+using BiquadFrontEnd = FilterBank;
+using LowPassFrontEnd = SampleFrontEnd<Saturate16, LowPassStage<LOWPASS_FRONT_END_ALPHA_Q31>, ShiftStage<>>;
+using ShiftFrontEnd = SampleFrontEnd<Wrap16, ShiftStage<>>;
+
+template <CaptureFrontEnd K> struct FrontEndFor;
+template <> struct FrontEndFor<CaptureFrontEnd::BiquadBank> { using type = BiquadFrontEnd; };
+template <> struct FrontEndFor<CaptureFrontEnd::LowPass> { using type = LowPassFrontEnd; };
+template <> struct FrontEndFor<CaptureFrontEnd::Shift> { using type = ShiftFrontEnd; };
+
+} // namespace stetho
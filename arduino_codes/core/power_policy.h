@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//================================================================
+// --- ENERGIA: I2S PARADO E LIGHT SLEEP SEM CENTRAL ---
+//================================================================
+// A captura só serve a alguém: o app conectado, uma gravação na flash ou, logo
+// depois de uma desconexão, o histórico pré-gatilho que cobre uma reconexão
+// rápida. Fora disso o I2S para (e com ele o clock do microfone), a CPU não
+// segura mais o lock de frequência máxima e o gerenciador de energia pode
+// entrar em light sleep entre os anúncios BLE.
+//
+//   Active --sem central nem gravação--> Linger --linger_ms--> Idle
+//     ^                                    |                     |
+//     +-----------conexão ou gravação------+---------------------+
+//
+// Só Idle para a captura; voltar de Idle religa o I2S. A lógica não lê
+// relógio nem FreeRTOS: quem chama passa o instante, e a tarefa de energia
+// do firmware dorme num event group até o próximo evento ou o prazo de
+// msUntilDeadline(). O bench_power_policy roda a mesma lógica num
+// escalonador simulado.
+
+namespace stetho {
+
+enum class PowerState : uint8_t {
+    Active = 0, // central conectado ou gravando
+    Linger = 1, // desconectado há menos de linger_ms: captura segue para o histórico
+    Idle = 2,   // I2S parado
+};
+
+enum class PowerAction : uint8_t {
+    None,
+    StartCapture,
+    StopCapture,
+};
+
+class CapturePowerPolicy {
+public:
+    static constexpr uint32_t NO_DEADLINE = 0xFFFFFFFFu;
+
+    // No boot a captura já está ligada e espera linger_ms por uma conexão
+    CapturePowerPolicy(uint32_t linger_ms, uint32_t now_ms) : linger_ms_(linger_ms), since_ms_(now_ms) {}
+
+    // A cada evento (conexão, gravação) e quando o prazo vence
+    PowerAction update(bool connected, bool recording, uint32_t now_ms) {
+        const bool wanted = connected || recording;
+        if (wanted) {
+            if (state_ == PowerState::Active) return PowerAction::None;
+            const bool was_idle = state_ == PowerState::Idle;
+            if (was_idle) {
+                idle_ms_ += now_ms - since_ms_;
+                starts_++;
+            }
+            enter(PowerState::Active, now_ms);
+            return was_idle ? PowerAction::StartCapture : PowerAction::None;
+        }
+        if (state_ == PowerState::Active) enter(PowerState::Linger, now_ms);
+        if (state_ == PowerState::Linger && now_ms - since_ms_ >= linger_ms_) {
+            enter(PowerState::Idle, now_ms);
+            stops_++;
+            return PowerAction::StopCapture;
+        }
+        return PowerAction::None;
+    }
+
+    // ms até update() precisar rodar sem evento nenhum (só Linger tem prazo)
+    uint32_t msUntilDeadline(uint32_t now_ms) const {
+        if (state_ != PowerState::Linger) return NO_DEADLINE;
+        const uint32_t elapsed = now_ms - since_ms_;
+        return elapsed >= linger_ms_ ? 0 : linger_ms_ - elapsed;
+    }
+
+    PowerState state() const { return state_; }
+    bool captureOn() const { return state_ != PowerState::Idle; }
+    uint32_t stops() const { return stops_; }
+    uint32_t starts() const { return starts_; }
+    // Tempo total com a captura parada até now_ms
+    uint64_t idleMs(uint32_t now_ms) const {
+        return idle_ms_ + (state_ == PowerState::Idle ? now_ms - since_ms_ : 0);
+    }
+
+private:
+    void enter(PowerState s, uint32_t now_ms) {
+        state_ = s;
+        since_ms_ = now_ms;
+    }
+
+    uint32_t linger_ms_;
+    PowerState state_ = PowerState::Linger;
+    uint32_t since_ms_;
+    uint32_t stops_ = 0;
+    uint32_t starts_ = 0;
+    uint64_t idle_ms_ = 0;
+};
+
+//================================================================
+// --- LATÊNCIA DA CONEXÃO ATÉ A PRIMEIRA AMOSTRA ---
+//================================================================
+// Da conexão até a primeira notificação de áudio aceita pela pilha BLE.
+// connected() roda no callback de conexão e firstSample() na tarefa de
+// envio; 'cold' marca as conexões que encontraram o I2S parado.
+class ConnectLatency {
+public:
+    void connected(int64_t now_us, bool cold) {
+        cold_pending_.store(cold, std::memory_order_relaxed);
+        start_us_.store(now_us, std::memory_order_release);
+    }
+
+    // Barato depois da primeira: um load por pacote
+    void firstSample(int64_t now_us) {
+        if (start_us_.load(std::memory_order_relaxed) < 0) return;
+        const int64_t start = start_us_.exchange(-1, std::memory_order_acquire);
+        if (start < 0) return;
+        const uint32_t us = (uint32_t)(now_us - start);
+        const bool cold = cold_pending_.load(std::memory_order_relaxed);
+        last_us_.store(us, std::memory_order_relaxed);
+        last_cold_.store(cold, std::memory_order_relaxed);
+        std::atomic<uint32_t> &max = cold ? max_cold_us_ : max_warm_us_;
+        if (us > max.load(std::memory_order_relaxed)) max.store(us, std::memory_order_relaxed);
+    }
+
+    uint32_t lastUs() const { return last_us_.load(std::memory_order_relaxed); }
+    bool lastCold() const { return last_cold_.load(std::memory_order_relaxed); }
+    uint32_t maxUs(bool cold) const { return (cold ? max_cold_us_ : max_warm_us_).load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> start_us_{-1};
+    std::atomic<bool> cold_pending_{false};
+    std::atomic<uint32_t> last_us_{0};
+    std::atomic<bool> last_cold_{false};
+    std::atomic<uint32_t> max_warm_us_{0};
+    std::atomic<uint32_t> max_cold_us_{0};
+};
+
+} // namespace stetho
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "frame.h"
+#include "ima_adpcm.h"
+#include "rice_codec.h"
+#include "stream_format.h"
+
+//================================================================
+// --- REMONTAGEM DO STREAM NO RECEPTOR ---
+//================================================================
+// Recebe quadros (core/frame.h) na ordem em que chegaram e entrega ao
+// ReassemblerSink um stream contínuo, em ordem de índice de amostra:
+//
+//  - duplicatas (ou retransmissões já entregues) são descartadas;
+//  - quadros adiantados esperam numa janela de reordenação de tamanho fixo;
+//  - quando a janela enche, o buraco é declarado e preenchido com silêncio
+//    marcado (onSamples com gap = true), para que a duração e o alinhamento
+//    temporal do que vem depois continuem corretos;
+//  - um quadro com FRAME_FLAG_DISCONTINUITY cuja sequência segue a do último
+//    entregue fecha o buraco na hora: as amostras foram descartadas no
+//    dispositivo e não vão chegar;
+//  - cada troca do expoente de ganho (core/block_float.h) é avisada com
+//    onGain() antes das amostras que ele cobre.
+//
+// Toda a memória é fixa (sem alocação por quadro).
+
+namespace stetho {
+
+class ReassemblerSink {
+public:
+    virtual ~ReassemblerSink() = default;
+    // 'index' é o índice absoluto (64 bits) da primeira amostra
+    virtual void onSamples(uint64_t index, const int16_t *samples, size_t n, bool gap) = 0;
+    // As amostras a partir de 'index' usam o expoente 'gain_exp' (começa em
+    // 0); expandBlock() as leva para a escala larga
+    virtual void onGain(uint64_t index, int gain_exp) {
+        (void)index;
+        (void)gain_exp;
+    }
+};
+
+struct ReassemblerStats {
+    uint32_t frames = 0;       // quadros válidos recebidos
+    uint32_t invalid = 0;      // quadros que não puderam ser lidos
+    uint32_t duplicates = 0;   // já entregues (descartados)
+    uint32_t reordered = 0;    // chegaram depois de um quadro mais novo
+    uint32_t gaps = 0;         // buracos preenchidos com silêncio
+    uint64_t gap_samples = 0;  // amostras de silêncio inseridas
+    uint64_t samples_out = 0;  // total entregue (incluindo silêncio)
+};
+
+class Reassembler {
+public:
+    static constexpr size_t MAX_FRAME_SAMPLES = 1024;
+    static constexpr size_t REORDER_WINDOW = 8;
+
+    explicit Reassembler(ReassemblerSink &sink) : sink_(sink) {}
+
+    // Processa uma notificação completa (cabeçalho + carga)
+    void push(const uint8_t *frame, size_t len) {
+        FrameHeader h;
+        if (!readFrameHeader(frame, len, h)) {
+            stats_.invalid++;
+            return;
+        }
+        Pending &slot = scratch_;
+        int n = decodePayload(h.codec, frame + FRAME_HEADER_SIZE, len - FRAME_HEADER_SIZE, slot.samples);
+        if (n <= 0) {
+            stats_.invalid++;
+            return;
+        }
+        stats_.frames++;
+        last_timestamp_us_ = h.timestamp_us;
+
+        if (!started_) {
+            started_ = true;
+            next_ = h.first_sample;
+            newest_ = h.first_sample;
+        }
+        const uint64_t first = unwrap(h.first_sample);
+        if (first < newest_) stats_.reordered++;
+        else newest_ = first;
+        accept(first, h.seq, h.flags, h.gain_exp, slot.samples, (size_t)n);
+    }
+
+    // Fim do stream: entrega o que estiver esperando, preenchendo buracos
+    void flush() {
+        while (pending_count_ > 0) releaseEarliest();
+    }
+
+    // Stream novo (outra conexão): descarta a janela e recomeça a sequência
+    void reset() {
+        stats_ = ReassemblerStats();
+        started_ = false;
+        next_ = newest_ = 0;
+        has_last_seq_ = false;
+        gain_exp_ = 0;
+        pending_count_ = 0;
+    }
+
+    const ReassemblerStats &stats() const { return stats_; }
+    uint64_t nextIndex() const { return next_; }
+    uint32_t lastTimestampUs() const { return last_timestamp_us_; }
+
+    static int decodePayload(StreamCodec codec, const uint8_t *p, size_t len, int16_t *out) {
+        switch (codec) {
+        case StreamCodec::Pcm16: {
+            if (len % 2 != 0 || len / 2 > MAX_FRAME_SAMPLES) return -1;
+            for (size_t i = 0; i < len / 2; i++) out[i] = (int16_t)getLe16(p + 2 * i);
+            return (int)(len / 2);
+        }
+        case StreamCodec::Rice:
+            return riceDecode(p, len, out, MAX_FRAME_SAMPLES);
+        case StreamCodec::ImaAdpcm:
+            return adpcmDecode(p, len, out, MAX_FRAME_SAMPLES);
+        }
+        return -1;
+    }
+
+private:
+    struct Pending {
+        uint64_t first;
+        uint16_t seq;
+        uint8_t flags;
+        int8_t gain_exp;
+        size_t count;
+        int16_t samples[MAX_FRAME_SAMPLES];
+    };
+
+    // Estende o índice de 32 bits para 64 bits usando o próximo esperado
+    uint64_t unwrap(uint32_t idx) const {
+        const uint64_t base = next_ & ~0xFFFFFFFFull;
+        uint64_t candidate = base | idx;
+        const int64_t diff = (int64_t)candidate - (int64_t)next_;
+        if (diff > (int64_t)0x80000000ll && candidate >= 0x100000000ull) candidate -= 0x100000000ull;
+        else if (diff < -(int64_t)0x80000000ll) candidate += 0x100000000ull;
+        return candidate;
+    }
+
+    // O quadro vem logo depois do último entregue e avisa que houve descarte
+    bool closesGap(uint16_t seq, uint8_t flags) const {
+        return has_last_seq_ && (flags & FRAME_FLAG_DISCONTINUITY) && seq == (uint16_t)(last_seq_ + 1);
+    }
+
+    void accept(uint64_t first, uint16_t seq, uint8_t flags, int8_t gain_exp, const int16_t *samples, size_t n) {
+        if (first + n <= next_) {
+            stats_.duplicates++;
+            return;
+        }
+        if (first <= next_) {
+            // Começa aqui ou sobrepõe o que já foi entregue: entrega só o novo
+            const size_t skip = (size_t)(next_ - first);
+            deliver(seq, gain_exp, samples + skip, n - skip);
+            drainReady();
+            return;
+        }
+        if (closesGap(seq, flags)) {
+            fillGap(first - next_);
+            deliver(seq, gain_exp, samples, n);
+            drainReady();
+            return;
+        }
+
+        // Adiantado: espera na janela (ignorando cópias do mesmo quadro)
+        for (size_t i = 0; i < pending_count_; i++) {
+            if (pending_[i].first == first) {
+                stats_.duplicates++;
+                return;
+            }
+        }
+        if (pending_count_ == REORDER_WINDOW) {
+            if (first < earliestPending()) {
+                // Janela cheia e este é o mais antigo: o buraco vai até ele
+                fillGap(first - next_);
+                deliver(seq, gain_exp, samples, n);
+                drainReady();
+                return;
+            }
+            releaseEarliest();
+        }
+        Pending &p = pending_[pending_count_++];
+        p.first = first;
+        p.seq = seq;
+        p.flags = flags;
+        p.gain_exp = gain_exp;
+        p.count = n;
+        std::memcpy(p.samples, samples, n * sizeof(int16_t));
+    }
+
+    // Entrega os quadros da janela que ficaram contíguos
+    void drainReady() {
+        bool progressed = true;
+        while (progressed) {
+            progressed = false;
+            for (size_t i = 0; i < pending_count_; i++) {
+                Pending &p = pending_[i];
+                if (p.first > next_) {
+                    if (!closesGap(p.seq, p.flags)) continue;
+                    fillGap(p.first - next_);
+                }
+                if (p.first + p.count > next_) {
+                    const size_t skip = (size_t)(next_ - p.first);
+                    deliver(p.seq, p.gain_exp, p.samples + skip, p.count - skip);
+                } else {
+                    stats_.duplicates++;
+                }
+                removePending(i);
+                progressed = true;
+                break;
+            }
+        }
+    }
+
+    // Declara o buraco até o quadro mais antigo da janela e o entrega
+    void releaseEarliest() {
+        const uint64_t target = earliestPending();
+        if (target > next_) fillGap(target - next_);
+        drainReady();
+    }
+
+    uint64_t earliestPending() const {
+        uint64_t earliest = pending_[0].first;
+        for (size_t i = 1; i < pending_count_; i++)
+            if (pending_[i].first < earliest) earliest = pending_[i].first;
+        return earliest;
+    }
+
+    void fillGap(uint64_t n) {
+        static const int16_t silence[256] = {};
+        stats_.gaps++;
+        stats_.gap_samples += n;
+        while (n > 0) {
+            const size_t len = n < 256 ? (size_t)n : 256;
+            sink_.onSamples(next_, silence, len, true);
+            next_ += len;
+            stats_.samples_out += len;
+            n -= len;
+        }
+    }
+
+    void deliver(uint16_t seq, int8_t gain_exp, const int16_t *samples, size_t n) {
+        last_seq_ = seq;
+        has_last_seq_ = true;
+        if (n == 0) return;
+        if (gain_exp != gain_exp_) {
+            gain_exp_ = gain_exp;
+            sink_.onGain(next_, gain_exp);
+        }
+        sink_.onSamples(next_, samples, n, false);
+        next_ += n;
+        stats_.samples_out += n;
+    }
+
+    void removePending(size_t i) {
+        pending_count_--;
+        if (i != pending_count_) {
+            Pending &dst = pending_[i];
+            const Pending &src = pending_[pending_count_];
+            dst.first = src.first;
+            dst.seq = src.seq;
+            dst.flags = src.flags;
+            dst.gain_exp = src.gain_exp;
+            dst.count = src.count;
+            std::memcpy(dst.samples, src.samples, src.count * sizeof(int16_t));
+        }
+    }
+
+    ReassemblerSink &sink_;
+    ReassemblerStats stats_;
+    bool started_ = false;
+    uint64_t next_ = 0;
+    uint64_t newest_ = 0;  // maior índice inicial já recebido
+    uint16_t last_seq_ = 0; // sequência do último quadro entregue
+    bool has_last_seq_ = false;
+    int8_t gain_exp_ = 0;   // expoente das últimas amostras entregues
+    uint32_t last_timestamp_us_ = 0;
+    Pending pending_[REORDER_WINDOW];
+    size_t pending_count_ = 0;
+    Pending scratch_;
+};
+
+} // namespace stetho
@@ -0,0 +1,391 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "crc32.h"
+#include "rice_codec.h"
+#include "storage.h"
+#include "stream_format.h"
+
+//================================================================
+// --- GRAVAÇÃO NA FLASH (STORE-AND-FORWARD) ---
+//================================================================
+// Cada gravação tem dois arquivos em RECORDING_DIR:
+//
+// NNNNN.dat, append-only:
+//   cabeçalho (16 bytes): "STRC" | versão u8 | codec u8 | filtro u8 |
+//                         canais u8 (0 = 1; 2 = pares intercalados) |
+//                         taxa de cada canal em Hz u32 | reservado u32
+//   blocos:  sync u16 (0x5AC3) | payload u16 | first_sample u32 |
+//            timestamp_us u32 | amostras u16 | flags u8 | 0 |
+//            payload (Rice) | crc32 u32 (do cabeçalho do bloco + payload)
+//
+// NNNNN.idx, uma entrada de 8 bytes por bloco: first_sample u32 | offset u32
+//
+// Tudo little-endian. Os dados são gravados antes do índice, então após
+// uma queda o índice nunca aponta para um bloco que não existe. A
+// recuperação valida os blocos pelo CRC, corta o que ficou pela metade e
+// refaz o índice se ele não bate com os dados.
+
+namespace stetho {
+
+constexpr const char *RECORDING_DIR = "/rec";
+constexpr uint8_t RECORDING_VERSION = 1;
+constexpr size_t RECORDING_HEADER_SIZE = 16;
+constexpr uint16_t RECORDING_CHUNK_SYNC = 0x5AC3;
+constexpr size_t RECORDING_CHUNK_HEADER = 16;
+constexpr size_t RECORDING_CHUNK_SAMPLES = 1024;
+constexpr size_t RECORDING_CHUNK_MAX = RECORDING_CHUNK_HEADER + rice::maxEncodedSize(RECORDING_CHUNK_SAMPLES) + 4;
+constexpr size_t RECORDING_INDEX_ENTRY = 8;
+constexpr size_t RECORDING_PATH_MAX = 24;
+
+struct RecordingHeader {
+    StreamCodec codec = StreamCodec::Rice;
+    uint8_t filter_mode = 0;
+    uint32_t sample_rate_hz = 20000;
+    uint8_t channels = 1;
+};
+
+struct RecordingChunk {
+    uint16_t payload_len = 0;
+    uint32_t first_sample = 0;
+    uint32_t timestamp_us = 0;
+    uint16_t count = 0;
+    uint8_t flags = 0;
+};
+
+struct RecordingIndexEntry {
+    uint32_t first_sample;
+    uint32_t offset;
+};
+
+// "/rec/00042.dat" e "/rec/00042.idx"
+inline void recordingPath(uint16_t id, const char *ext, char *out) {
+    std::snprintf(out, RECORDING_PATH_MAX, "%s/%05u.%s", RECORDING_DIR, (unsigned)id, ext);
+}
+
+// Id a partir do nome do arquivo de dados; false para outros arquivos
+inline bool parseRecordingName(const char *name, uint16_t &id) {
+    unsigned v = 0;
+    char ext[4] = {};
+    if (std::sscanf(name, "%5u.%3s", &v, ext) != 2 || std::strcmp(ext, "dat") != 0 || v > 0xFFFF) return false;
+    id = (uint16_t)v;
+    return true;
+}
+
+inline void serializeRecordingHeader(const RecordingHeader &h, uint8_t *out) {
+    std::memcpy(out, "STRC", 4);
+    out[4] = RECORDING_VERSION;
+    out[5] = (uint8_t)h.codec;
+    out[6] = h.filter_mode;
+    // Gravações mono continuam com o 0 da versão anterior do layout
+    out[7] = h.channels > 1 ? h.channels : 0;
+    putLe32(out + 8, h.sample_rate_hz);
+    putLe32(out + 12, 0);
+}
+
+inline bool parseRecordingHeader(const uint8_t *in, size_t len, RecordingHeader &h) {
+    if (len < RECORDING_HEADER_SIZE || std::memcmp(in, "STRC", 4) != 0 || in[4] != RECORDING_VERSION) return false;
+    h.codec = (StreamCodec)in[5];
+    h.filter_mode = in[6];
+    h.channels = in[7] > 1 ? in[7] : 1;
+    h.sample_rate_hz = getLe32(in + 8);
+    return true;
+}
+
+// Confere um bloco completo (cabeçalho + payload + CRC) em 'in'
+inline bool parseRecordingChunk(const uint8_t *in, size_t len, RecordingChunk &c) {
+    if (len < RECORDING_CHUNK_HEADER + 4 || getLe16(in) != RECORDING_CHUNK_SYNC) return false;
+    c.payload_len = getLe16(in + 2);
+    c.first_sample = getLe32(in + 4);
+    c.timestamp_us = getLe32(in + 8);
+    c.count = getLe16(in + 12);
+    c.flags = in[14];
+    const size_t total = RECORDING_CHUNK_HEADER + c.payload_len + 4;
+    if (total > len || total > RECORDING_CHUNK_MAX || c.count > RECORDING_CHUNK_SAMPLES) return false;
+    return crc32(in, RECORDING_CHUNK_HEADER + c.payload_len) == getLe32(in + RECORDING_CHUNK_HEADER + c.payload_len);
+}
+
+//================================================================
+// --- ESCRITA ---
+//================================================================
+
+struct RecordingStats {
+    uint32_t chunks = 0;
+    uint32_t errors = 0;    // appends que falharam (flash cheia, etc.)
+    uint64_t samples = 0;
+    uint64_t bytes = 0;
+};
+
+class RecordingWriter {
+public:
+    // Blocos entre flushes: limita o que se perde numa queda (~0,8 s a 20 kHz)
+    static constexpr uint32_t FLUSH_EVERY_CHUNKS = 16;
+
+    explicit RecordingWriter(Storage &storage) : storage_(storage) {}
+
+    bool begin(uint16_t id, const RecordingHeader &header) {
+        recordingPath(id, "dat", data_path_);
+        recordingPath(id, "idx", index_path_);
+        storage_.remove(data_path_);
+        storage_.remove(index_path_);
+        uint8_t buf[RECORDING_HEADER_SIZE];
+        serializeRecordingHeader(header, buf);
+        stats_ = RecordingStats();
+        stage_count_ = 0;
+        offset_ = RECORDING_HEADER_SIZE;
+        open_ = storage_.append(data_path_, buf, sizeof(buf));
+        return open_;
+    }
+
+    bool isOpen() const { return open_; }
+
+    // Amostras contínuas; um salto no índice fecha o bloco atual
+    void write(const int16_t *samples, size_t n, uint32_t first_sample, uint32_t timestamp_us) {
+        if (!open_) return;
+        if (stage_count_ > 0 && first_sample != stage_first_ + stage_count_) commit();
+        while (n > 0) {
+            if (stage_count_ == 0) {
+                stage_first_ = first_sample;
+                stage_ts_ = timestamp_us;
+            }
+            size_t take = RECORDING_CHUNK_SAMPLES - stage_count_;
+            if (take > n) take = n;
+            std::memcpy(stage_ + stage_count_, samples, take * sizeof(int16_t));
+            stage_count_ += take;
+            samples += take;
+            n -= take;
+            first_sample += (uint32_t)take;
+            if (stage_count_ == RECORDING_CHUNK_SAMPLES) commit();
+        }
+    }
+
+    // Grava o bloco parcial e fecha a gravação
+    void end() {
+        if (!open_) return;
+        if (stage_count_ > 0) commit();
+        storage_.flush(data_path_);
+        storage_.flush(index_path_);
+        open_ = false;
+    }
+
+    const RecordingStats &stats() const { return stats_; }
+
+private:
+    void commit() {
+        uint8_t *payload = chunk_ + RECORDING_CHUNK_HEADER;
+        const size_t payload_len = riceEncode(stage_, stage_count_, payload);
+        putLe16(chunk_, RECORDING_CHUNK_SYNC);
+        putLe16(chunk_ + 2, (uint16_t)payload_len);
+        putLe32(chunk_ + 4, stage_first_);
+        putLe32(chunk_ + 8, stage_ts_);
+        putLe16(chunk_ + 12, (uint16_t)stage_count_);
+        chunk_[14] = 0;
+        chunk_[15] = 0;
+        putLe32(payload + payload_len, crc32(chunk_, RECORDING_CHUNK_HEADER + payload_len));
+        const size_t total = RECORDING_CHUNK_HEADER + payload_len + 4;
+
+        uint8_t entry[RECORDING_INDEX_ENTRY];
+        putLe32(entry, stage_first_);
+        putLe32(entry + 4, offset_);
+        if (storage_.append(data_path_, chunk_, total)) {
+            // Sem a entrada no índice o bloco continua válido; recoverRecording refaz o índice
+            if (!storage_.append(index_path_, entry, sizeof(entry))) stats_.errors++;
+            offset_ += (uint32_t)total;
+            stats_.chunks++;
+            stats_.samples += stage_count_;
+            stats_.bytes += total;
+            if (stats_.chunks % FLUSH_EVERY_CHUNKS == 0) {
+                storage_.flush(data_path_);
+                storage_.flush(index_path_);
+            }
+        } else {
+            // Flash cheia ou falha de escrita: o final pode ter ficado pela
+            // metade, então a gravação para aqui (recoverRecording corta o resto)
+            stats_.errors++;
+            open_ = false;
+        }
+        stage_count_ = 0;
+    }
+
+    Storage &storage_;
+    char data_path_[RECORDING_PATH_MAX] = {};
+    char index_path_[RECORDING_PATH_MAX] = {};
+    bool open_ = false;
+    uint32_t offset_ = 0;
+    int16_t stage_[RECORDING_CHUNK_SAMPLES];
+    size_t stage_count_ = 0;
+    uint32_t stage_first_ = 0;
+    uint32_t stage_ts_ = 0;
+    uint8_t chunk_[RECORDING_CHUNK_MAX];
+    RecordingStats stats_;
+};
+
+//================================================================
+// --- LEITURA ---
+//================================================================
+
+class RecordingReader {
+public:
+    explicit RecordingReader(Storage &storage) : storage_(storage) {}
+
+    bool open(uint16_t id) {
+        recordingPath(id, "dat", data_path_);
+        recordingPath(id, "idx", index_path_);
+        uint8_t buf[RECORDING_HEADER_SIZE];
+        if (storage_.read(data_path_, 0, buf, sizeof(buf)) != sizeof(buf) || !parseRecordingHeader(buf, sizeof(buf), header_))
+            return false;
+        const int32_t idx_size = storage_.size(index_path_);
+        chunks_ = idx_size > 0 ? (uint32_t)idx_size / RECORDING_INDEX_ENTRY : 0;
+        return true;
+    }
+
+    const RecordingHeader &header() const { return header_; }
+    uint32_t chunkCount() const { return chunks_; }
+
+    bool entry(uint32_t i, RecordingIndexEntry &e) {
+        uint8_t buf[RECORDING_INDEX_ENTRY];
+        if (i >= chunks_ || storage_.read(index_path_, i * RECORDING_INDEX_ENTRY, buf, sizeof(buf)) != sizeof(buf))
+            return false;
+        e.first_sample = getLe32(buf);
+        e.offset = getLe32(buf + 4);
+        return true;
+    }
+
+    // Último bloco que começa em 'sample' ou antes (busca binária no índice); -1 se nenhum
+    int32_t findChunk(uint32_t sample) {
+        int32_t lo = 0, hi = (int32_t)chunks_ - 1, found = -1;
+        RecordingIndexEntry e;
+        while (lo <= hi) {
+            const int32_t mid = lo + (hi - lo) / 2;
+            if (!entry((uint32_t)mid, e)) return -1;
+            if (e.first_sample <= sample) {
+                found = mid;
+                lo = mid + 1;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        return found;
+    }
+
+    // Decodifica o bloco 'i' em 'out' (RECORDING_CHUNK_SAMPLES); -1 se o CRC não bate
+    int readChunk(uint32_t i, int16_t *out, RecordingChunk &c) {
+        RecordingIndexEntry e;
+        if (!entry(i, e)) return -1;
+        const size_t got = storage_.read(data_path_, e.offset, buf_, sizeof(buf_));
+        if (!parseRecordingChunk(buf_, got, c)) return -1;
+        const int n = riceDecode(buf_ + RECORDING_CHUNK_HEADER, c.payload_len, out, RECORDING_CHUNK_SAMPLES);
+        return n == (int)c.count ? n : -1;
+    }
+
+private:
+    Storage &storage_;
+    char data_path_[RECORDING_PATH_MAX] = {};
+    char index_path_[RECORDING_PATH_MAX] = {};
+    RecordingHeader header_;
+    uint32_t chunks_ = 0;
+    uint8_t buf_[RECORDING_CHUNK_MAX];
+};
+
+//================================================================
+// --- RECUPERAÇÃO APÓS QUEDA ---
+//================================================================
+
+struct RecoveryResult {
+    bool valid = false;          // cabeçalho legível
+    uint32_t chunks = 0;         // blocos íntegros
+    uint32_t truncated_bytes = 0;
+    bool index_rebuilt = false;
+};
+
+// Varre os dados, corta o final pela metade e refaz o índice se preciso
+inline RecoveryResult recoverRecording(Storage &storage, uint16_t id) {
+    RecoveryResult r;
+    char data_path[RECORDING_PATH_MAX], index_path[RECORDING_PATH_MAX];
+    recordingPath(id, "dat", data_path);
+    recordingPath(id, "idx", index_path);
+
+    const int32_t data_size = storage.size(data_path);
+    uint8_t buf[RECORDING_CHUNK_MAX];
+    RecordingHeader header;
+    if (data_size < (int32_t)RECORDING_HEADER_SIZE ||
+        storage.read(data_path, 0, buf, RECORDING_HEADER_SIZE) != RECORDING_HEADER_SIZE ||
+        !parseRecordingHeader(buf, RECORDING_HEADER_SIZE, header)) {
+        return r;
+    }
+    r.valid = true;
+
+    // O índice está certo enquanto cada entrada bate com o bloco que os dados têm
+    const int32_t idx_size = storage.size(index_path);
+    const uint32_t idx_entries = idx_size > 0 ? (uint32_t)idx_size / RECORDING_INDEX_ENTRY : 0;
+    bool index_ok = idx_size >= 0 && idx_size % RECORDING_INDEX_ENTRY == 0;
+
+    uint32_t offset = RECORDING_HEADER_SIZE;
+    RecordingChunk c;
+    while (offset < (uint32_t)data_size) {
+        const size_t got = storage.read(data_path, offset, buf, sizeof(buf));
+        if (!parseRecordingChunk(buf, got, c)) break;
+        if (index_ok) {
+            uint8_t e[RECORDING_INDEX_ENTRY];
+            index_ok = r.chunks < idx_entries &&
+                       storage.read(index_path, r.chunks * RECORDING_INDEX_ENTRY, e, sizeof(e)) == sizeof(e) &&
+                       getLe32(e) == c.first_sample && getLe32(e + 4) == offset;
+        }
+        offset += (uint32_t)(RECORDING_CHUNK_HEADER + c.payload_len + 4);
+        r.chunks++;
+    }
+    index_ok = index_ok && idx_entries == r.chunks;
+
+    if (offset < (uint32_t)data_size) {
+        r.truncated_bytes = (uint32_t)data_size - offset;
+        storage.truncate(data_path, offset);
+    }
+    if (!index_ok) {
+        // Refaz o índice a partir dos blocos válidos
+        storage.remove(index_path);
+        uint32_t pos = RECORDING_HEADER_SIZE;
+        for (uint32_t i = 0; i < r.chunks; i++) {
+            const size_t got = storage.read(data_path, pos, buf, sizeof(buf));
+            if (!parseRecordingChunk(buf, got, c)) break;
+            uint8_t e[RECORDING_INDEX_ENTRY];
+            putLe32(e, c.first_sample);
+            putLe32(e + 4, pos);
+            storage.append(index_path, e, sizeof(e));
+            pos += (uint32_t)(RECORDING_CHUNK_HEADER + c.payload_len + 4);
+        }
+        storage.flush(index_path);
+        r.index_rebuilt = true;
+    }
+    storage.flush(data_path);
+    return r;
+}
+
+// Ids das gravações em RECORDING_DIR, em ordem crescente; devolve quantas há
+inline size_t listRecordings(Storage &storage, uint16_t *ids, size_t max_ids) {
+    struct Ctx {
+        uint16_t *ids;
+        size_t max, count;
+    } ctx{ids, max_ids, 0};
+    storage.list(
+        RECORDING_DIR,
+        [](const char *name, void *p) {
+            Ctx &c = *static_cast<Ctx *>(p);
+            uint16_t id;
+            if (c.count < c.max && parseRecordingName(name, id)) c.ids[c.count++] = id;
+        },
+        &ctx);
+    // Inserção: poucas gravações
+    for (size_t i = 1; i < ctx.count; i++)
+        for (size_t j = i; j > 0 && ids[j - 1] > ids[j]; j--) {
+            const uint16_t t = ids[j];
+            ids[j] = ids[j - 1];
+            ids[j - 1] = t;
+        }
+    return ctx.count;
+}
+
+} // namespace stetho
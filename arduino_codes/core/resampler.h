@@ -0,0 +1,276 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "compiler.h"
+#include "fixed_point.h"
+
+//================================================================
+// --- REAMOSTRAGEM POLIFÁSICA RACIONAL (L/M) ---
+//================================================================
+// Decima o stream de 20 kHz para 10, 8 ou 4 kHz. O FIR protótipo é um sinc
+// com janela de Kaiser projetado na taxa L*fs, com banda passante até 0.4 da
+// taxa de saída e rejeição de ~80 dB a partir da nova frequência de Nyquist,
+// então nada acima dela cai de volta na banda útil.
+//
+// Cada fase guarda seus K coeficientes Q15 em ordem reversa, de modo que
+// cada amostra de saída é um produto escalar contíguo int16 x int16 -> int32
+// (vetorizável: pmaddwd no host, PIE no ESP32-S3).
+
+namespace stetho {
+
+enum class OutputRate : uint8_t {
+    Hz20000 = 0, // sem decimação
+    Hz10000 = 1, // L/M = 1/2
+    Hz8000 = 2,  // L/M = 2/5
+    Hz4000 = 3,  // L/M = 1/5
+};
+
+constexpr size_t OUTPUT_RATE_COUNT = 4;
+
+struct RateRatio {
+    uint32_t hz;
+    unsigned up;   // L
+    unsigned down; // M
+};
+
+inline RateRatio outputRateRatio(OutputRate rate) {
+    static const RateRatio ratios[OUTPUT_RATE_COUNT] = {
+        {20000, 1, 1}, {10000, 1, 2}, {8000, 2, 5}, {4000, 1, 5}};
+    return ratios[(size_t)rate < OUTPUT_RATE_COUNT ? (size_t)rate : 0];
+}
+
+// Função de Bessel modificada de ordem zero (série de potências)
+inline double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 50; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < 1e-12 * sum) break;
+    }
+    return sum;
+}
+
+// FIR passa-baixa com janela de Kaiser. Frequências normalizadas por fs.
+inline std::vector<double> designKaiserLowPass(double pass, double stop, double atten_db) {
+    const double dw = 2.0 * M_PI * (stop - pass);
+    size_t n = (size_t)std::ceil((atten_db - 8.0) / (2.285 * dw)) + 1;
+    if (n % 2 == 0) n++;
+    const double beta = atten_db > 50.0 ? 0.1102 * (atten_db - 8.7)
+                                        : 0.5842 * std::pow(atten_db - 21.0, 0.4) + 0.07886 * (atten_db - 21.0);
+    const double fc = 0.5 * (pass + stop);
+    const double mid = 0.5 * (double)(n - 1);
+    std::vector<double> h(n);
+    for (size_t i = 0; i < n; i++) {
+        const double t = (double)i - mid;
+        const double sinc = t == 0.0 ? 2.0 * fc : std::sin(2.0 * M_PI * fc * t) / (M_PI * t);
+        const double r = t / mid;
+        h[i] = sinc * besselI0(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) / besselI0(beta);
+    }
+    return h;
+}
+
+class PolyphaseResampler {
+public:
+    // Maior bloco de entrada aceito de uma vez
+    static constexpr size_t MAX_BLOCK = 512;
+    static constexpr double STOPBAND_DB = 80.0;
+
+    // Projeta o FIR e aloca o histórico (em double, com alocação: fora do
+    // caminho de tempo real)
+    void configure(unsigned up, unsigned down) {
+        up_ = up;
+        down_ = down;
+        if (up == down) {
+            taps_ = 0;
+            history_.clear();
+            reset();
+            return;
+        }
+        // Projeto na taxa L*fs (normalizada = 1): banda passante até 0.4 e
+        // rejeição a partir de 0.5 da taxa de saída
+        const double out_rate = 1.0 / (double)down;
+        std::vector<double> h = designKaiserLowPass(0.4 * out_rate, 0.5 * out_rate, STOPBAND_DB);
+        taps_ = (h.size() + up - 1) / up;
+        coeffs_.assign(taps_ * up, 0);
+        for (unsigned p = 0; p < up; p++) {
+            for (size_t k = 0; k < taps_; k++) {
+                const size_t idx = p + k * up;
+                const double v = idx < h.size() ? h[idx] * (double)up : 0.0;
+                coeffs_[p * taps_ + (taps_ - 1 - k)] = toQ15(v);
+            }
+        }
+        history_.assign(taps_ - 1 + MAX_BLOCK, 0);
+        reset();
+    }
+
+    // Zera o histórico sem alocar
+    void reset() {
+        std::fill(history_.begin(), history_.end(), (int16_t)0);
+        pos_ = taps_ > 0 ? (uint32_t)(taps_ - 1) * up_ : 0;
+    }
+
+    // Maior número de saídas geradas para 'n' entradas
+    size_t maxOutput(size_t n) const { return (n * up_) / down_ + 1; }
+
+    size_t taps() const { return taps_; }
+
+    // Quantos bits para cima o histórico do FIR pode ser deslocado sem saturar
+    int historyHeadroom() const {
+        int32_t peak = 0;
+        for (size_t i = 0; i + 1 < taps_; i++) {
+            const int32_t a = history_[i] < 0 ? -(int32_t)history_[i] : history_[i];
+            peak = a > peak ? a : peak;
+        }
+        if (peak == 0) return 15;
+        int bits = 0;
+        while (bits < 15 && (peak << (bits + 1)) <= 32767) bits++;
+        return bits;
+    }
+
+    // Muda a escala do histórico do FIR em 2^shift (troca do expoente do
+    // ponto flutuante em bloco, core/block_float.h), para que as saídas
+    // logo depois da troca não misturem amostras em duas escalas
+    void rescaleHistory(int shift) {
+        if (shift > 0) {
+            for (size_t i = 0; i + 1 < taps_; i++) history_[i] = sat16((int32_t)history_[i] * (1 << shift));
+        } else if (shift < 0) {
+            const int32_t half = 1 << (-shift - 1);
+            for (size_t i = 0; i + 1 < taps_; i++) history_[i] = (int16_t)(((int32_t)history_[i] + half) >> -shift);
+        }
+    }
+
+    // Devolve o número de amostras escritas em 'out'
+    STETHO_HOT size_t process(const int16_t *in, size_t n, int16_t *out) {
+        if (taps_ == 0) {
+            std::memcpy(out, in, n * sizeof(int16_t));
+            return n;
+        }
+        size_t produced = 0;
+        while (n > 0) {
+            const size_t len = n < MAX_BLOCK ? n : MAX_BLOCK;
+            produced += processChunk(in, len, out + produced);
+            in += len;
+            n -= len;
+        }
+        return produced;
+    }
+
+    // Onde as próximas até MAX_BLOCK entradas ficam, logo depois do histórico:
+    // quem as produz pode escrever aqui e chamar processInput(), sem a cópia
+    // de process(). Só com decimação (taps() > 0).
+    int16_t *input() { return history_.data() + (taps_ - 1); }
+
+    // As 'n' entradas já escritas em input(); devolve as saídas escritas em 'out'
+    STETHO_HOT size_t processInput(size_t n, int16_t *out) { return filterInput(n, out); }
+
+private:
+    size_t processChunk(const int16_t *in, size_t n, int16_t *out) {
+        std::memcpy(input(), in, n * sizeof(int16_t));
+        return filterInput(n, out);
+    }
+
+    size_t filterInput(size_t n, int16_t *out) {
+        int16_t *x = history_.data();
+        const size_t keep = taps_ - 1;
+        const size_t len = keep + n;
+
+        size_t produced = 0;
+        uint32_t pos = pos_;
+        while (pos / up_ < len) {
+            const size_t i = pos / up_;
+            const unsigned phase = pos % up_;
+            out[produced++] = sat16(dot(coeffs_.data() + phase * taps_, x + i + 1 - taps_, taps_) >> 15);
+            pos += down_;
+        }
+
+        // Mantém as últimas K-1 entradas para o próximo bloco
+        std::memmove(x, x + n, keep * sizeof(int16_t));
+        pos_ = pos - (uint32_t)(n * up_);
+        return produced;
+    }
+
+    static STETHO_ALWAYS_INLINE int32_t dot(const int16_t *STETHO_RESTRICT h,
+                                           const int16_t *STETHO_RESTRICT x, size_t k) {
+        int32_t acc = 1 << 14; // arredondamento do >> 15
+        for (size_t j = 0; j < k; j++) acc += (int32_t)h[j] * x[j];
+        return acc;
+    }
+
+    unsigned up_ = 1;
+    unsigned down_ = 1;
+    size_t taps_ = 0;
+    uint32_t pos_ = 0;
+    std::vector<int16_t> coeffs_;
+    std::vector<int16_t> history_;
+};
+
+// Decimador com as taxas de saída selecionáveis em tempo de execução. Os
+// FIRs de todas as taxas são projetados na construção (como os designs_ do
+// FilterBank); a troca é aplicada no início do próximo bloco e só reinicia
+// o histórico.
+class Decimator {
+public:
+    explicit Decimator(OutputRate rate = OutputRate::Hz20000) {
+        for (size_t r = 0; r < OUTPUT_RATE_COUNT; r++) {
+            const RateRatio ratio = outputRateRatio((OutputRate)r);
+            resamplers_[r].configure(ratio.up, ratio.down);
+        }
+        if ((size_t)rate >= OUTPUT_RATE_COUNT) rate = OutputRate::Hz20000;
+        active_.store((uint8_t)rate, std::memory_order_relaxed);
+        pending_.store((uint8_t)rate, std::memory_order_relaxed);
+    }
+
+    void requestRate(OutputRate rate) {
+        if ((size_t)rate < OUTPUT_RATE_COUNT) pending_.store((uint8_t)rate, std::memory_order_relaxed);
+    }
+
+    // Taxa em uso; também pode ser lida de outra tarefa
+    OutputRate rate() const { return (OutputRate)active_.load(std::memory_order_relaxed); }
+    uint32_t rateHz() const { return outputRateRatio(rate()).hz; }
+
+    STETHO_HOT size_t process(const int16_t *in, size_t n, int16_t *out) {
+        return resamplers_[applyPending()].process(in, n, out);
+    }
+
+    // Entrada direta (ver PolyphaseResampler::input): depois de
+    // preparePassthrough() devolver false, quem chama escreve até MAX_INPUT
+    // amostras em input() e as processa com processInput()
+    static constexpr size_t MAX_INPUT = PolyphaseResampler::MAX_BLOCK;
+    int16_t *input() { return resamplers_[current()].input(); }
+    STETHO_HOT size_t processInput(size_t n, int16_t *out) { return resamplers_[current()].processInput(n, out); }
+
+    // Histórico do FIR da taxa atual (ver PolyphaseResampler)
+    int historyHeadroom() const { return resamplers_[current()].historyHeadroom(); }
+    void rescaleHistory(int shift) { resamplers_[current()].rescaleHistory(shift); }
+
+    // Aplica uma troca pendente e diz se a taxa atual passa as amostras sem
+    // mudança. Nesse caso quem chama pode escrever direto no destino e pular
+    // process(), que seria só um memcpy.
+    bool preparePassthrough() { return (OutputRate)applyPending() == OutputRate::Hz20000; }
+
+private:
+    // Só a captura escreve active_; o pedido fica em pending_ até ser aplicado
+    uint8_t current() const { return active_.load(std::memory_order_relaxed); }
+
+    uint8_t applyPending() {
+        const uint8_t pending = pending_.load(std::memory_order_relaxed);
+        if (pending != current()) {
+            resamplers_[pending].reset();
+            active_.store(pending, std::memory_order_relaxed);
+        }
+        return pending;
+    }
+
+    PolyphaseResampler resamplers_[OUTPUT_RATE_COUNT];
+    std::atomic<uint8_t> active_{0};
+    std::atomic<uint8_t> pending_{0};
+};
+
+} // namespace stetho
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "bit_stream.h"
+#include "compiler.h"
+
+//================================================================
+// --- CODEC SEM PERDAS: PREDIÇÃO LINEAR + RICE ---
+//================================================================
+// Um bloco codificado começa com um byte de modo:
+//
+//   bits 7-6: tipo (0 = cru, 1 = Rice)
+//   bits 5-4: ordem do preditor (0 a 3)
+//   bits 3-0: parâmetro k do Rice (0 a 15)
+//
+// Cru:  seguido de n amostras int16 LE (fallback quando Rice não ajuda).
+// Rice: 'ordem' amostras int16 LE de aquecimento e depois os resíduos do
+//       preditor polinomial fixo (como no FLAC), em zigzag, codificados
+//       como q = u >> k em unário (q zeros + um 1) e os k bits baixos.
+//       O último byte é completado com zeros, que não formam um código
+//       válido, então o decodificador sabe onde parar sem contar amostras.
+//
+// A ordem e o k são escolhidos por bloco pelo custo exato em bits.
+
+namespace stetho {
+
+namespace rice {
+
+constexpr uint8_t TYPE_RAW = 0;
+constexpr uint8_t TYPE_RICE = 1;
+constexpr unsigned MAX_ORDER = 3;
+constexpr unsigned MAX_K = 15;
+
+constexpr uint8_t makeHeader(uint8_t type, unsigned order, unsigned k) {
+    return (uint8_t)((type << 6) | ((order & 3u) << 4) | (k & 15u));
+}
+
+// Pior caso: cabeçalho + bloco cru
+constexpr size_t maxEncodedSize(size_t n) { return 1 + 2 * n; }
+
+STETHO_ALWAYS_INLINE uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+STETHO_ALWAYS_INLINE int32_t unzigzag(uint32_t u) { return (int32_t)(u >> 1) ^ -(int32_t)(u & 1); }
+
+// Resíduo do preditor polinomial fixo de ordem 'order' na posição i >= order
+STETHO_ALWAYS_INLINE int32_t residual(const int16_t *x, size_t i, unsigned order) {
+    switch (order) {
+    case 0: return x[i];
+    case 1: return x[i] - x[i - 1];
+    case 2: return x[i] - 2 * x[i - 1] + x[i - 2];
+    default: return x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+    }
+}
+
+STETHO_ALWAYS_INLINE int32_t predict(const int16_t *x, size_t i, unsigned order) {
+    switch (order) {
+    case 0: return 0;
+    case 1: return x[i - 1];
+    case 2: return 2 * x[i - 1] - x[i - 2];
+    default: return 3 * x[i - 1] - 3 * x[i - 2] + x[i - 3];
+    }
+}
+
+inline void putInt16(uint8_t *p, int16_t v) {
+    p[0] = (uint8_t)((uint16_t)v & 0xFF);
+    p[1] = (uint8_t)((uint16_t)v >> 8);
+}
+
+inline int16_t getInt16(const uint8_t *p) { return (int16_t)(uint16_t)(p[0] | (p[1] << 8)); }
+
+} // namespace rice
+
+// Codifica n amostras em 'out' (capacidade >= rice::maxEncodedSize(n)).
+// Devolve o número de bytes escritos.
+STETHO_HOT inline size_t riceEncode(const int16_t *in, size_t n, uint8_t *out) {
+    using namespace rice;
+    const size_t raw_size = maxEncodedSize(n);
+
+    // 1. Escolhe o preditor com a menor soma de resíduos em zigzag
+    unsigned order = 0;
+    uint64_t best_sum = UINT64_MAX;
+    if (n > MAX_ORDER) {
+        uint64_t sums[MAX_ORDER + 1] = {0, 0, 0, 0};
+        for (size_t i = MAX_ORDER; i < n; i++) {
+            const int32_t x0 = in[i], x1 = in[i - 1], x2 = in[i - 2], x3 = in[i - 3];
+            const int32_t e1 = x0 - x1;
+            const int32_t e2 = e1 - (x1 - x2);
+            const int32_t e3 = e2 - ((x1 - x2) - (x2 - x3));
+            sums[0] += zigzag(x0);
+            sums[1] += zigzag(e1);
+            sums[2] += zigzag(e2);
+            sums[3] += zigzag(e3);
+        }
+        for (unsigned o = 0; o <= MAX_ORDER; o++) {
+            if (sums[o] < best_sum) {
+                best_sum = sums[o];
+                order = o;
+            }
+        }
+    }
+
+    // 2. k inicial pela média (u ~ 2^k) e refinamento pelo custo exato
+    unsigned k = 0;
+    if (best_sum != UINT64_MAX) {
+        uint64_t mean = best_sum / (n - MAX_ORDER);
+        while (k < MAX_K && (1ull << (k + 1)) <= mean) k++;
+
+        auto cost = [&](unsigned kk) {
+            uint64_t bits = 0;
+            for (size_t i = order; i < n; i++) bits += (zigzag(residual(in, i, order)) >> kk) + 1 + kk;
+            return bits;
+        };
+        uint64_t best_bits = cost(k);
+        if (k > 0) {
+            uint64_t b = cost(k - 1);
+            if (b < best_bits) {
+                best_bits = b;
+                k--;
+            }
+        }
+        if (k < MAX_K) {
+            uint64_t b = cost(k + 1);
+            if (b < best_bits) {
+                best_bits = b;
+                k++;
+            }
+        }
+
+        const size_t rice_size = 1 + 2 * order + (size_t)((best_bits + 7) / 8);
+        if (rice_size < raw_size) {
+            out[0] = makeHeader(TYPE_RICE, order, k);
+            for (unsigned i = 0; i < order; i++) putInt16(out + 1 + 2 * i, in[i]);
+
+            BitWriter bw(out + 1 + 2 * order, raw_size - 1 - 2 * order);
+            for (size_t i = order; i < n; i++) {
+                const uint32_t u = zigzag(residual(in, i, order));
+                bw.putUnary(u >> k);
+                if (k) bw.put(u, k);
+            }
+            return 1 + 2 * order + bw.finish();
+        }
+    }
+
+    // 3. Fallback: bloco cru
+    out[0] = makeHeader(TYPE_RAW, 0, 0);
+    for (size_t i = 0; i < n; i++) putInt16(out + 1 + 2 * i, in[i]);
+    return raw_size;
+}
+
+// Decodifica um bloco. Devolve o número de amostras escritas em 'out' ou
+// -1 se o bloco estiver corrompido ou não couber em 'max_samples'.
+inline int riceDecode(const uint8_t *in, size_t len, int16_t *out, size_t max_samples) {
+    using namespace rice;
+    if (len < 1) return -1;
+    const uint8_t type = in[0] >> 6;
+    const unsigned order = (in[0] >> 4) & 3u;
+    const unsigned k = in[0] & 15u;
+
+    if (type == TYPE_RAW) {
+        const size_t n = (len - 1) / 2;
+        if (n > max_samples || (len - 1) % 2 != 0) return -1;
+        for (size_t i = 0; i < n; i++) out[i] = getInt16(in + 1 + 2 * i);
+        return (int)n;
+    }
+    if (type != TYPE_RICE || len < 1 + 2 * order || order > max_samples) return -1;
+
+    for (unsigned i = 0; i < order; i++) out[i] = getInt16(in + 1 + 2 * i);
+    size_t n = order;
+    BitReader br(in + 1 + 2 * order, len - 1 - 2 * order);
+    uint32_t q, low = 0;
+    while (br.getUnary(q)) {
+        if (k && !br.get(k, low)) break;
+        if (n >= max_samples) return -1;
+        const int32_t v = predict(out, n, order) + unzigzag((q << k) | low);
+        if (v < INT16_MIN || v > INT16_MAX) return -1;
+        out[n++] = (int16_t)v;
+    }
+    return (int)n;
+}
+
+} // namespace stetho
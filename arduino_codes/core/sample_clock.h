@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+
+//================================================================
+// --- RELÓGIO DA AMOSTRAGEM CONTRA O esp_timer ---
+//================================================================
+// O I2S roda de um divisor do PLL (ou do APLL) e o esp_timer de outro: a
+// taxa real fica perto, mas não exatamente, dos 20000 Hz nominais, e uma
+// gravação longa escorrega contra o relógio de parede. A cada buffer do DMA a
+// captura passa o índice do primeiro quadro (contínuo, da ISR) e o instante
+// medido; o resíduo contra a taxa nominal,
+//
+//   r[n] = t[n] - n / taxa_nominal
+//
+// só sobe com a latência da ISR (nunca desce), então o mínimo de cada janela
+// de WINDOW quadros fica colado na reta verdadeira. Uma regressão linear com
+// esquecimento exponencial sobre esses mínimos dá a inclinação (erro do
+// período) e o offset acumulado, e segue a deriva lenta com a temperatura.
+//
+// Por bloco só há somas e um mínimo em inteiros; a regressão, em double,
+// roda uma vez por janela (1 s). O timestamp sai da reta ajustada, em ponto
+// fixo, sem o jitter da ISR.
+
+namespace stetho {
+
+class SampleClockEstimator {
+public:
+    // Janelas até a primeira estimativa e constante de tempo do esquecimento
+    static constexpr uint32_t MIN_WINDOWS = 4;
+    static constexpr double TIME_CONSTANT_WINDOWS = 30.0;
+
+    // nominal_hz >= 1000 (o período em Q16 cabe com folga no produto de 64 bits)
+    explicit SampleClockEstimator(uint32_t nominal_hz, uint32_t window_frames = 0)
+        : nominal_hz_(nominal_hz), window_frames_(window_frames ? window_frames : nominal_hz),
+          period_q16_(((uint64_t)1000000 << 16) / nominal_hz) {
+        reset();
+    }
+
+    // O I2S parou e voltou: o tempo saltou e a estimativa recomeça
+    void reset() {
+        started_ = false;
+        windows_ = 0;
+        min_ = INT64_MAX;
+        sw_ = sx_ = sy_ = sxx_ = sxy_ = 0.0;
+        slope_ = offset_ = origin_ = 0.0;
+    }
+
+    // A cada buffer do DMA. Devolve true quando uma janela fechou e a
+    // estimativa (rateHz, offsetUs, timestampUs) foi atualizada.
+    bool update(uint32_t first_frame, uint32_t timestamp_us) {
+        if (!started_) {
+            started_ = true;
+            anchor_frame_ = last_frame_ = first_frame;
+            anchor_us_ = last_us_ = timestamp_us;
+            frames_ = 0;
+            time_us_ = 0;
+            window_start_ = 0;
+        } else {
+            frames_ += (uint32_t)(first_frame - last_frame_);
+            time_us_ += (int32_t)(timestamp_us - last_us_); // o µs de 32 bits dá a volta em 71 min
+            last_frame_ = first_frame;
+            last_us_ = timestamp_us;
+        }
+        const int64_t residual = time_us_ - (int64_t)((frames_ * period_q16_) >> 16);
+        if (residual < min_) {
+            min_ = residual;
+            min_frames_ = frames_;
+        }
+        if (frames_ - window_start_ < window_frames_) return false;
+        closeWindow();
+        return windows_ >= MIN_WINDOWS;
+    }
+
+    bool valid() const { return windows_ >= MIN_WINDOWS; }
+    // Taxa medida em Hz e em mHz (0 sem estimativa)
+    double rateHz() const { return valid() ? 1e6 / (1e6 / (double)nominal_hz_ + slope_) : 0.0; }
+    uint32_t rateMilliHz() const { return (uint32_t)(rateHz() * 1000.0 + 0.5); }
+    // Erro relativo da taxa em ppm (positivo: mais rápida que a nominal)
+    double ppm() const { return valid() ? (rateHz() / (double)nominal_hz_ - 1.0) * 1e6 : 0.0; }
+    // Quanto o tempo real passou à frente de índice / taxa nominal desde o
+    // início da estimativa até o último bloco, em µs (positivo: amostras mais lentas)
+    int32_t offsetUs() const {
+        return valid() ? (int32_t)(offset_ + slope_ * (double)(frames_ - fit_frames_) - origin_) : 0;
+    }
+
+    // Instante do quadro pela reta ajustada; sem estimativa, o medido
+    uint32_t timestampUs(uint32_t frame, uint32_t measured_us) const {
+        if (!valid()) return measured_us;
+        const int64_t dn = (int32_t)(frame - base_frame_);
+        return base_us_ + (uint32_t)((dn * period_fit_q32_) >> 32);
+    }
+
+private:
+    void closeWindow() {
+        // A reta fica centrada no ponto mais novo: as somas não crescem e o
+        // double não perde a inclinação (20 ppm = 0,001 µs por quadro)
+        const double x = (double)min_frames_;
+        if (windows_ == 0) {
+            y0_ = min_;
+            x_ref_ = x;
+        }
+        const double d = x - x_ref_;
+        sxx_ += d * d * sw_ - 2.0 * d * sx_;
+        sxy_ -= d * sy_;
+        sx_ -= d * sw_;
+        x_ref_ = x;
+        const double keep = 1.0 - 1.0 / TIME_CONSTANT_WINDOWS;
+        sw_ = sw_ * keep + 1.0;
+        sx_ *= keep;
+        sy_ = sy_ * keep + (double)(min_ - y0_);
+        sxx_ *= keep;
+        sxy_ *= keep;
+        windows_++;
+
+        const double den = sw_ * sxx_ - sx_ * sx_;
+        if (windows_ >= MIN_WINDOWS && den > 0.0) {
+            slope_ = (sw_ * sxy_ - sx_ * sy_) / den;
+            offset_ = (sy_ - slope_ * sx_) / sw_;
+            // Reta em ponto fixo para o timestamp de cada bloco
+            const double period_us = 1e6 / (double)nominal_hz_ + slope_;
+            period_fit_q32_ = (int64_t)(period_us * 4294967296.0);
+            fit_frames_ = min_frames_;
+            // A primeira reta, estendida até a âncora, é o zero do offset
+            if (windows_ == MIN_WINDOWS) origin_ = offset_ - slope_ * (double)fit_frames_;
+            base_frame_ = anchor_frame_ + (uint32_t)min_frames_;
+            const int64_t nominal_us = (int64_t)((min_frames_ * period_q16_) >> 16);
+            base_us_ = anchor_us_ + (uint32_t)(nominal_us + y0_ + (int64_t)offset_);
+        }
+        window_start_ = frames_;
+        min_ = INT64_MAX;
+    }
+
+    uint32_t nominal_hz_;
+    uint32_t window_frames_;
+    uint64_t period_q16_; // µs por quadro na taxa nominal, Q16
+
+    bool started_ = false;
+    uint32_t anchor_frame_ = 0, anchor_us_ = 0;
+    uint32_t last_frame_ = 0, last_us_ = 0;
+    uint64_t frames_ = 0; // quadros desde a âncora
+    int64_t time_us_ = 0; // µs desde a âncora
+    uint64_t window_start_ = 0;
+    int64_t min_ = INT64_MAX; // menor resíduo da janela
+    uint64_t min_frames_ = 0;
+
+    // Regressão dos mínimos (x em quadros relativo a x_ref_, y em µs relativo a y0_)
+    uint32_t windows_ = 0;
+    int64_t y0_ = 0;
+    double x_ref_ = 0.0;
+    double sw_ = 0.0, sx_ = 0.0, sy_ = 0.0, sxx_ = 0.0, sxy_ = 0.0;
+    double slope_ = 0.0;  // µs por quadro além do período nominal
+    double offset_ = 0.0; // resíduo ajustado em x_ref_, µs
+    uint64_t fit_frames_ = 0; // x_ref_ em quadros desde a âncora
+    double origin_ = 0.0;     // a reta na âncora, µs
+
+    uint32_t base_frame_ = 0, base_us_ = 0;
+    int64_t period_fit_q32_ = 0;
+};
+
+} // namespace stetho
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "compiler.h"
+
+//================================================================
+// --- KERNELS DE AMOSTRA DOS FIRMWARES ATUAIS ---
+//================================================================
+// Processamento por amostra que antes vivia dentro de audioStreamingTask,
+// extraído sem mudança de comportamento para poder ser medido no PC. Os
+// firmwares que usavam estes laços viraram front-ends de core/pipeline.h;
+// eles ficam como referência escrita à mão para os benchmarks.
+
+namespace stetho {
+
+// Palavra I2S de 32 bits (dado de 24 bits alinhado à esquerda) -> int16
+constexpr int I2S_TO_INT16_SHIFT = 14;
+
+// Antigo current_without_filter.cpp: apenas o deslocamento. O cast para int16_t
+// descarta os bits altos, então sinais fortes dão a volta (sem saturação).
+STETHO_HOT inline void shiftBlock(const int32_t *STETHO_RESTRICT in,
+                                  int16_t *STETHO_RESTRICT out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = (int16_t)(in[i] >> I2S_TO_INT16_SHIFT);
+    }
+}
+
+// Antigo current_with_filter.cpp (antes do FixedLowPass): desloca, aplica y[n] = a*x[n] + (1-a)*y[n-1] em float e
+// satura em 16 bits. O estado guardado já é o valor saturado.
+class ClampedLowPass {
+public:
+    explicit ClampedLowPass(float alpha = 0.05f) : alpha_(alpha) {}
+
+    STETHO_HOT void process(const int32_t *STETHO_RESTRICT in,
+                            int16_t *STETHO_RESTRICT out, size_t n) {
+        float filtered_prev = filtered_prev_;
+        for (size_t i = 0; i < n; i++) {
+            float sample = (float)(in[i] >> I2S_TO_INT16_SHIFT);
+            float filtered = alpha_ * sample + (1.0f - alpha_) * filtered_prev;
+
+            if (filtered > 32767.0f) filtered = 32767.0f;
+            else if (filtered < -32768.0f) filtered = -32768.0f;
+
+            filtered_prev = filtered;
+            out[i] = (int16_t)filtered;
+        }
+        filtered_prev_ = filtered_prev;
+    }
+
+    void reset() { filtered_prev_ = 0.0f; }
+
+private:
+    float alpha_;
+    float filtered_prev_ = 0.0f;
+};
+
+// current.cpp: filtra a palavra bruta de 32 bits em float e só
+// depois desloca para 16 bits (FILTER_ALPHA). Não satura.
+class RawLowPass {
+public:
+    explicit RawLowPass(float alpha = 0.25f) : alpha_(alpha) {}
+
+    STETHO_HOT void process(const int32_t *STETHO_RESTRICT in,
+                            int16_t *STETHO_RESTRICT out, size_t n) {
+        float filtered_value = filtered_value_;
+        for (size_t i = 0; i < n; i++) {
+            float current_sample = (float)in[i];
+            filtered_value = (alpha_ * current_sample) + ((1.0f - alpha_) * filtered_value);
+            out[i] = (int16_t)((int32_t)filtered_value >> I2S_TO_INT16_SHIFT);
+        }
+        filtered_value_ = filtered_value;
+    }
+
+    void reset() { filtered_value_ = 0.0f; }
+
+private:
+    float alpha_;
+    float filtered_value_ = 0.0f;
+};
+
+} // namespace stetho
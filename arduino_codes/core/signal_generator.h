@@ -0,0 +1,429 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "compiler.h"
+#include "crc32.h"
+#include "heart_sound_table.h"
+#include "stream_format.h"
+
+//================================================================
+// --- GERADOR DE SINAIS DE TESTE ---
+//================================================================
+// Sinais determinísticos para o firmware de bancada e para os testes de
+// host: depois de configure() tudo é aritmética inteira, então o ESP32 e
+// o Linux geram exatamente as mesmas amostras e o receptor pode conferir
+// o stream amostra a amostra.
+//
+//  - Sine:      acumulador de fase de 32 bits + tabela de 1024 pontos com
+//               interpolação linear (erro < 1 LSB, resolução de 5 µHz);
+//  - MultiTone: até MAX_TONES senoides somadas, cada uma com amplitude/n;
+//  - Chirp:     varredura linear de frequência; cada varredura repete a
+//               anterior amostra a amostra (dá para fazer média);
+//  - Impulses:  um impulso de uma amostra a cada período (resposta ao
+//               impulso e latência ponta a ponta);
+//  - Heart:     o batimento de heart_sound_table.h no BPM pedido;
+//  - Prbs:      ruído branco de 16 bits em que cada amostra é função só de
+//               (semente, índice), então qualquer quadro pode ser
+//               conferido isoladamente, mesmo depois de perdas.
+//
+// Sine, MultiTone, Impulses e Prbs dependem só do índice absoluto da
+// amostra; Chirp e Heart começam a varredura/batimento no configure().
+
+namespace stetho {
+
+enum class SignalKind : uint8_t {
+    Sine = 0,
+    MultiTone = 1,
+    Chirp = 2,
+    Impulses = 3,
+    Heart = 4,
+    Prbs = 5,
+};
+
+constexpr size_t MAX_TONES = 4;
+
+struct GeneratorConfig {
+    SignalKind kind = SignalKind::Sine;
+    int16_t amplitude = 10000;         // pico (Prbs usa sempre os 16 bits)
+    float tone_hz[MAX_TONES] = {60.0f}; // Sine usa só o primeiro
+    uint8_t tones = 1;
+    float chirp_start_hz = 20.0f;
+    float chirp_end_hz = 1000.0f;
+    float chirp_seconds = 2.0f;
+    float impulse_ms = 500.0f;
+    uint16_t heart_bpm = 75;
+    uint32_t seed = 1;
+};
+
+//================================================================
+// --- SENO POR TABELA ---
+//================================================================
+
+namespace detail {
+
+constexpr size_t SINE_TABLE_BITS = 10;
+constexpr size_t SINE_TABLE_SIZE = (size_t)1 << SINE_TABLE_BITS;
+
+// Série de Taylor até x^23 para |x| <= pi/2 (erro ~1e-16); constexpr para a
+// tabela sair igual em qualquer compilador, sem depender da libm
+constexpr double taylorSin(double x) {
+    const double x2 = x * x;
+    double term = x, sum = x;
+    for (int k = 1; k < 12; k++) {
+        term *= -x2 / (double)((2 * k) * (2 * k + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+// Um ciclo em int16 (pico 32767) com uma entrada extra para a interpolação
+struct SineTable {
+    int16_t v[SINE_TABLE_SIZE + 1];
+    constexpr SineTable() : v() {
+        constexpr double kTwoPi = 6.283185307179586476925;
+        for (size_t i = 0; i <= SINE_TABLE_SIZE; i++) {
+            const size_t q = i % SINE_TABLE_SIZE;
+            const bool negative = q >= SINE_TABLE_SIZE / 2;
+            size_t k = q % (SINE_TABLE_SIZE / 2);
+            if (k > SINE_TABLE_SIZE / 4) k = SINE_TABLE_SIZE / 2 - k;
+            const int32_t mag = (int32_t)(taylorSin(kTwoPi * (double)k / (double)SINE_TABLE_SIZE) * 32767.0 + 0.5);
+            v[i] = (int16_t)(negative ? -mag : mag);
+        }
+    }
+};
+
+constexpr SineTable SINE_TABLE{};
+
+} // namespace detail
+
+// Seno da fase (2^32 = uma volta) em int16
+STETHO_ALWAYS_INLINE int16_t sineFromPhase(uint32_t phase) {
+    const uint32_t idx = phase >> (32 - detail::SINE_TABLE_BITS);
+    const int32_t frac = (int32_t)((phase >> (16 - detail::SINE_TABLE_BITS)) & 0xFFFF);
+    const int32_t a = detail::SINE_TABLE.v[idx];
+    const int32_t b = detail::SINE_TABLE.v[idx + 1];
+    return (int16_t)(a + (((b - a) * frac + 0x8000) >> 16));
+}
+
+// Incremento de fase por amostra para 'hz' a 'sample_rate_hz'
+inline uint32_t phaseStep(double hz, uint32_t sample_rate_hz) {
+    if (hz <= 0.0 || sample_rate_hz == 0) return 0;
+    double step = hz / (double)sample_rate_hz * 4294967296.0;
+    if (step > 2147483648.0) step = 2147483648.0; // Nyquist
+    return (uint32_t)(uint64_t)(step + 0.5);
+}
+
+STETHO_ALWAYS_INLINE int16_t scaleSample(int32_t v, int32_t amplitude) { return (int16_t)((v * amplitude) >> 15); }
+
+//================================================================
+// --- SEQUÊNCIA PSEUDOALEATÓRIA ---
+//================================================================
+// Hash de (semente, índice) com o finalizador do MurmurHash3. Referência
+// para conferir implementações do receptor: semente 1, amostras 0..19999
+// (1 s a 20 kHz) em int16 LE têm CRC-32 PRBS_REFERENCE_CRC.
+
+constexpr uint32_t PRBS_REFERENCE_CRC = 0x1E3FE966u;
+
+STETHO_ALWAYS_INLINE int16_t prbsSample(uint32_t seed, uint32_t index) {
+    uint32_t h = index * 0x9E3779B1u ^ seed * 0x85EBCA77u;
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return (int16_t)(uint16_t)(h >> 16);
+}
+
+// CRC-32 (core/crc32.h) das amostras [first, first + n) em int16 LE
+inline uint32_t prbsCrc(uint32_t seed, uint32_t first, size_t n) {
+    uint32_t crc = 0;
+    uint8_t buf[128];
+    while (n > 0) {
+        const size_t chunk = n < sizeof(buf) / 2 ? n : sizeof(buf) / 2;
+        for (size_t i = 0; i < chunk; i++) putLe16(buf + 2 * i, (uint16_t)prbsSample(seed, first + (uint32_t)i));
+        crc = crc32Update(crc, buf, 2 * chunk);
+        first += (uint32_t)chunk;
+        n -= chunk;
+    }
+    return crc;
+}
+
+//================================================================
+// --- RITMO SEM DERIVA ---
+//================================================================
+// Conta as amostras devidas a partir do relógio absoluto (esp_timer), não
+// somando atrasos: um despertar atrasado só faz a próxima volta gerar mais
+// amostras, e o total nunca se afasta de taxa x tempo decorrido.
+
+class SamplePacer {
+public:
+    void start(int64_t now_us, uint32_t sample_rate_hz) {
+        start_us_ = now_us;
+        rate_ = sample_rate_hz;
+    }
+
+    // Amostras que já deveriam ter saído em 'now_us'
+    uint64_t due(int64_t now_us) const {
+        return now_us <= start_us_ ? 0 : (uint64_t)(now_us - start_us_) * rate_ / 1000000u;
+    }
+
+    // Instante ideal da n-ésima amostra desde start()
+    int64_t timeOf(uint64_t n) const { return start_us_ + (int64_t)(n * 1000000u / rate_); }
+
+private:
+    int64_t start_us_ = 0;
+    uint32_t rate_ = 20000;
+};
+
+//================================================================
+// --- GERADOR ---
+//================================================================
+
+class SignalGenerator {
+public:
+    // 'first_index' é o índice absoluto da próxima amostra do stream
+    void configure(const GeneratorConfig &config, uint32_t sample_rate_hz, uint32_t first_index = 0) {
+        config_ = config;
+        rate_ = sample_rate_hz ? sample_rate_hz : 1;
+        index_ = first_index;
+        amplitude_ = config.amplitude < 0 ? 0 : config.amplitude;
+
+        tone_count_ = config.kind == SignalKind::Sine ? 1 : config.tones;
+        if (tone_count_ < 1) tone_count_ = 1;
+        if (tone_count_ > MAX_TONES) tone_count_ = MAX_TONES;
+        tone_amplitude_ = amplitude_ / (int32_t)tone_count_;
+        for (size_t t = 0; t < tone_count_; t++) {
+            step_[t] = phaseStep(config.tone_hz[t], rate_);
+            phase_[t] = first_index * step_[t]; // mesma fase que acumular desde 0
+        }
+
+        // Varredura em Q16 de incremento de fase
+        chirp_length_ = durationSamples(config.chirp_seconds * 1000.0f);
+        chirp_start_ = (int64_t)phaseStep(config.chirp_start_hz, rate_) << 16;
+        const int64_t end = (int64_t)phaseStep(config.chirp_end_hz, rate_) << 16;
+        chirp_delta_ = (end - chirp_start_) / (int64_t)chirp_length_;
+        chirp_step_ = chirp_start_;
+        chirp_pos_ = 0;
+        if (config.kind == SignalKind::Chirp) phase_[0] = 0;
+
+        impulse_period_ = durationSamples(config.impulse_ms);
+        impulse_countdown_ = (impulse_period_ - first_index % impulse_period_) % impulse_period_;
+
+        const uint32_t bpm = config.heart_bpm < 20 ? 20 : config.heart_bpm > 240 ? 240 : config.heart_bpm;
+        beat_period_ = (uint32_t)((uint64_t)rate_ * 60u / bpm);
+        template_step_ = (uint32_t)(((uint64_t)HEART_TEMPLATE_RATE_HZ << 16) / rate_);
+        beat_pos_ = 0;
+    }
+
+    const GeneratorConfig &config() const { return config_; }
+    uint32_t sampleRate() const { return rate_; }
+    // Índice absoluto da próxima amostra
+    uint32_t index() const { return index_; }
+
+    STETHO_HOT void generate(int16_t *out, size_t n) {
+        switch (config_.kind) {
+        case SignalKind::Sine:
+        case SignalKind::MultiTone:
+            tones(out, n);
+            break;
+        case SignalKind::Chirp:
+            chirp(out, n);
+            break;
+        case SignalKind::Impulses:
+            impulses(out, n);
+            break;
+        case SignalKind::Heart:
+            heart(out, n);
+            break;
+        case SignalKind::Prbs:
+            for (size_t i = 0; i < n; i++) out[i] = prbsSample(config_.seed, index_ + (uint32_t)i);
+            break;
+        }
+        index_ += (uint32_t)n;
+    }
+
+    // Avança sem entregar (o receptor pula um buraco do stream)
+    void skip(uint64_t n) {
+        int16_t scratch[256];
+        while (n > 0) {
+            const size_t chunk = n < 256 ? (size_t)n : 256;
+            generate(scratch, chunk);
+            n -= chunk;
+        }
+    }
+
+private:
+    uint32_t durationSamples(float ms) const {
+        const double n = (double)ms * (double)rate_ / 1000.0;
+        return n < 1.0 ? 1u : n > 4.0e9 ? 4000000000u : (uint32_t)(n + 0.5);
+    }
+
+    void tones(int16_t *out, size_t n) {
+        if (tone_count_ == 1) {
+            uint32_t phase = phase_[0];
+            const uint32_t step = step_[0];
+            for (size_t i = 0; i < n; i++, phase += step) out[i] = scaleSample(sineFromPhase(phase), amplitude_);
+            phase_[0] = phase;
+            return;
+        }
+        for (size_t i = 0; i < n; i++) {
+            int32_t acc = 0;
+            for (size_t t = 0; t < tone_count_; t++) {
+                acc += scaleSample(sineFromPhase(phase_[t]), tone_amplitude_);
+                phase_[t] += step_[t];
+            }
+            out[i] = (int16_t)acc;
+        }
+    }
+
+    void chirp(int16_t *out, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            out[i] = scaleSample(sineFromPhase(phase_[0]), amplitude_);
+            phase_[0] += (uint32_t)(chirp_step_ >> 16);
+            chirp_step_ += chirp_delta_;
+            if (++chirp_pos_ == chirp_length_) {
+                chirp_pos_ = 0;
+                chirp_step_ = chirp_start_;
+                phase_[0] = 0;
+            }
+        }
+    }
+
+    void impulses(int16_t *out, size_t n) {
+        std::memset(out, 0, n * sizeof(int16_t));
+        size_t i = impulse_countdown_;
+        for (; i < n; i += impulse_period_) out[i] = (int16_t)amplitude_;
+        impulse_countdown_ = (uint32_t)(i - n);
+    }
+
+    void heart(int16_t *out, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            // Posição no batimento em amostras da tabela (Q16)
+            const uint64_t pos = (uint64_t)beat_pos_ * template_step_;
+            const size_t idx = (size_t)(pos >> 16);
+            int32_t v = 0;
+            if (idx + 1 < HEART_TEMPLATE_SAMPLES) {
+                const int32_t a = HEART_TEMPLATE[idx], b = HEART_TEMPLATE[idx + 1];
+                v = a + (((b - a) * (int32_t)(pos & 0xFFFF)) >> 16);
+            }
+            out[i] = scaleSample(v, amplitude_);
+            if (++beat_pos_ == beat_period_) beat_pos_ = 0;
+        }
+    }
+
+    GeneratorConfig config_;
+    uint32_t rate_ = 20000;
+    uint32_t index_ = 0;
+    int32_t amplitude_ = 0;
+
+    size_t tone_count_ = 1;
+    int32_t tone_amplitude_ = 0;
+    uint32_t phase_[MAX_TONES] = {};
+    uint32_t step_[MAX_TONES] = {};
+
+    int64_t chirp_start_ = 0;
+    int64_t chirp_delta_ = 0;
+    int64_t chirp_step_ = 0;
+    uint32_t chirp_length_ = 1;
+    uint32_t chirp_pos_ = 0;
+
+    uint32_t impulse_period_ = 1;
+    uint32_t impulse_countdown_ = 0;
+
+    uint32_t beat_period_ = 1;
+    uint32_t beat_pos_ = 0;
+    uint32_t template_step_ = 0;
+};
+
+//================================================================
+// --- COMANDOS DE TEXTO (serial do firmware de bancada) ---
+//================================================================
+// Uma linha por comando:
+//
+//   sine <Hz> [amplitude]        tones <Hz> <Hz> [<Hz> <Hz>]
+//   chirp <Hz inicial> <Hz final> <segundos>
+//   impulse <período em ms>      heart <bpm>      prbs <semente>
+//   amp <amplitude>              saturate         paced
+
+enum class GeneratorCommand : uint8_t {
+    Invalid = 0,
+    Signal = 1,   // 'config' foi alterada
+    Saturate = 2, // enviar o mais rápido que o enlace aceitar
+    Paced = 3,    // voltar à taxa nominal
+};
+
+inline GeneratorCommand parseGeneratorCommand(const char *line, GeneratorConfig &config) {
+    while (*line == ' ' || *line == '\t') line++;
+    char word[16];
+    size_t len = 0;
+    while (line[len] && line[len] != ' ' && line[len] != '\t' && line[len] != '\r' && line[len] != '\n') {
+        if (len + 1 >= sizeof(word)) return GeneratorCommand::Invalid;
+        word[len] = line[len];
+        len++;
+    }
+    word[len] = '\0';
+
+    double args[MAX_TONES];
+    size_t argc = 0;
+    const char *p = line + len;
+    while (argc < MAX_TONES) {
+        char *end;
+        const double v = std::strtod(p, &end);
+        if (end == p) break;
+        args[argc++] = v;
+        p = end;
+    }
+
+    GeneratorConfig c = config;
+    if (std::strcmp(word, "sine") == 0 && argc >= 1 && args[0] > 0) {
+        c.kind = SignalKind::Sine;
+        c.tone_hz[0] = (float)args[0];
+        if (argc >= 2) c.amplitude = (int16_t)(args[1] < 0 ? 0 : args[1] > 32767 ? 32767 : args[1]);
+    } else if (std::strcmp(word, "tones") == 0 && argc >= 2) {
+        c.kind = SignalKind::MultiTone;
+        c.tones = (uint8_t)argc;
+        for (size_t t = 0; t < argc; t++) c.tone_hz[t] = (float)args[t];
+    } else if (std::strcmp(word, "chirp") == 0 && argc == 3 && args[2] > 0) {
+        c.kind = SignalKind::Chirp;
+        c.chirp_start_hz = (float)args[0];
+        c.chirp_end_hz = (float)args[1];
+        c.chirp_seconds = (float)args[2];
+    } else if (std::strcmp(word, "impulse") == 0 && argc == 1 && args[0] > 0) {
+        c.kind = SignalKind::Impulses;
+        c.impulse_ms = (float)args[0];
+    } else if (std::strcmp(word, "heart") == 0 && argc == 1 && args[0] >= 20 && args[0] <= 240) {
+        c.kind = SignalKind::Heart;
+        c.heart_bpm = (uint16_t)args[0];
+    } else if (std::strcmp(word, "prbs") == 0 && argc <= 1) {
+        c.kind = SignalKind::Prbs;
+        if (argc == 1) c.seed = (uint32_t)args[0];
+    } else if (std::strcmp(word, "amp") == 0 && argc == 1 && args[0] >= 0 && args[0] <= 32767) {
+        c.amplitude = (int16_t)args[0];
+    } else if (std::strcmp(word, "saturate") == 0 && argc == 0) {
+        return GeneratorCommand::Saturate;
+    } else if (std::strcmp(word, "paced") == 0 && argc == 0) {
+        return GeneratorCommand::Paced;
+    } else {
+        return GeneratorCommand::Invalid;
+    }
+    config = c;
+    return GeneratorCommand::Signal;
+}
+
+inline const char *signalKindName(SignalKind kind) {
+    switch (kind) {
+    case SignalKind::Sine: return "sine";
+    case SignalKind::MultiTone: return "tones";
+    case SignalKind::Chirp: return "chirp";
+    case SignalKind::Impulses: return "impulse";
+    case SignalKind::Heart: return "heart";
+    case SignalKind::Prbs: return "prbs";
+    }
+    return "?";
+}
+
+} // namespace stetho
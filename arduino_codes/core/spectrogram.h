@@ -0,0 +1,331 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "compiler.h"
+#include "fixed_point.h"
+#include "stream_format.h"
+
+//================================================================
+// --- FFT REAL EM PONTO FIXO (RADIX-4) ---
+//================================================================
+// N amostras reais viram uma FFT complexa de M = N/2 pontos (pares nas
+// partes reais, ímpares nas imaginárias), seguida da separação par/ímpar.
+// A FFT complexa é radix-4 com decimação na frequência, então M precisa
+// ser potência de 4: N = 128, 512 ou 2048.
+//
+// Dados em int16 com ponto flutuante em bloco: antes de cada estágio o
+// maior componente decide o deslocamento (0 a 3 bits) que garante que a
+// borboleta (ganho até 4·√2) não estoura, e o expoente acumulado volta no
+// cálculo do nível em dB. Twiddles Q15 numa única tabela de cossenos de
+// 5N/4 pontos (o seno sai do cosseno deslocado de N/4).
+// Faixa útil: ~60 dB abaixo do pico do quadro com erro < 3 dB (bench_spectrogram).
+
+namespace stetho {
+
+class RealFft {
+public:
+    static constexpr unsigned MIN_LOG2 = 7;
+    static constexpr unsigned MAX_LOG2 = 11;
+    static constexpr size_t MAX_SIZE = (size_t)1 << MAX_LOG2;
+
+    // Só tamanhos com N/2 potência de 4 (log2 ímpar)
+    static constexpr bool supported(unsigned log2n) {
+        return log2n >= MIN_LOG2 && log2n <= MAX_LOG2 && (log2n & 1) == 1;
+    }
+
+    bool configure(unsigned log2n) {
+        if (!supported(log2n)) return false;
+        log2n_ = log2n;
+        n_ = (size_t)1 << log2n;
+        m_ = n_ / 2;
+        for (size_t i = 0; i < n_ + n_ / 4; i++)
+            cos_[i] = q15(std::cos(2.0 * M_PI * (double)i / (double)n_));
+        // Ordem de saída do DIF radix-4: dígitos de base 4 invertidos
+        const unsigned digits = (log2n - 1) / 2;
+        for (size_t k = 0; k < m_; k++) {
+            size_t r = 0, v = k;
+            for (unsigned d = 0; d < digits; d++, v >>= 2) r = (r << 2) | (v & 3);
+            rev_[k] = (uint16_t)r;
+        }
+        return true;
+    }
+
+    size_t size() const { return n_; }
+    unsigned log2Size() const { return log2n_; }
+
+    // x: N amostras (já com janela). Saída em re/im (N/2 bins, DC até
+    // Nyquist exclusive) com valor real = re * 2^exponent.
+    STETHO_HOT void forward(const int16_t *x, int32_t *re, int32_t *im, int &exponent) {
+        int16_t *z = work_;
+        int32_t peak = 0;
+        for (size_t i = 0; i < n_; i++) {
+            z[i] = x[i];
+            const int32_t a = x[i] < 0 ? -(int32_t)x[i] : x[i];
+            if (a > peak) peak = a;
+        }
+        exponent = 0;
+
+        // Estágios radix-4: L = M, M/4, ..., 4
+        for (size_t len = m_; len >= 4; len /= 4) {
+            const unsigned shift = shiftFor(peak);
+            const int32_t rnd = (1 << shift) >> 1;
+            exponent += (int)shift;
+            peak = 0;
+            const size_t q = len / 4;
+            const size_t step = n_ / len; // W_M^j = W_N^(2j), e len divide M
+            for (size_t j = 0; j < q; j++) {
+                const size_t t1 = j * step, t2 = 2 * t1, t3 = 3 * t1;
+                const int32_t w1r = cos_[t1], w1i = cos_[t1 + n_ / 4];
+                const int32_t w2r = cos_[t2], w2i = cos_[t2 + n_ / 4];
+                const int32_t w3r = cos_[t3], w3i = cos_[t3 + n_ / 4];
+                for (size_t base = j; base < m_; base += len) {
+                    int16_t *a = z + 2 * base, *b = z + 2 * (base + q), *c = z + 2 * (base + 2 * q),
+                            *d = z + 2 * (base + 3 * q);
+                    const int32_t ar = (a[0] + rnd) >> shift, ai = (a[1] + rnd) >> shift;
+                    const int32_t br = (b[0] + rnd) >> shift, bi = (b[1] + rnd) >> shift;
+                    const int32_t cr = (c[0] + rnd) >> shift, ci = (c[1] + rnd) >> shift;
+                    const int32_t dr = (d[0] + rnd) >> shift, di = (d[1] + rnd) >> shift;
+                    const int32_t t0r = ar + cr, t0i = ai + ci, t1r = ar - cr, t1i = ai - ci;
+                    const int32_t t2r = br + dr, t2i = bi + di, t3r = br - dr, t3i = bi - di;
+                    // y1 = t1 - j t3, y3 = t1 + j t3
+                    const int32_t y0r = t0r + t2r, y0i = t0i + t2i;
+                    const int32_t y2r = t0r - t2r, y2i = t0i - t2i;
+                    const int32_t y1r = t1r + t3i, y1i = t1i - t3r;
+                    const int32_t y3r = t1r - t3i, y3i = t1i + t3r;
+                    a[0] = (int16_t)y0r;
+                    a[1] = (int16_t)y0i;
+                    rotate(y1r, y1i, w1r, w1i, b);
+                    rotate(y2r, y2i, w2r, w2i, c);
+                    rotate(y3r, y3i, w3r, w3i, d);
+                    peak = maxAbs(peak, a);
+                    peak = maxAbs(peak, b);
+                    peak = maxAbs(peak, c);
+                    peak = maxAbs(peak, d);
+                }
+            }
+        }
+
+        // Separação: X[k] = (Z[k] + Z*[M-k])/2 + W_N^k (Z[k] - Z*[M-k])/(2j)
+        for (size_t k = 0; k < m_; k++) {
+            const size_t ka = rev_[k], kb = rev_[(m_ - k) & (m_ - 1)];
+            const int32_t zr = z[2 * ka], zi = z[2 * ka + 1];
+            const int32_t cr = z[2 * kb], ci = -z[2 * kb + 1];
+            const int32_t er = zr + cr, ei = zi + ci; // 2 Fe
+            const int32_t odr = zi - ci, odi = cr - zr; // 2 Fo = (Z - Z*)/j
+            const int32_t wr = cos_[k], wi = cos_[k + n_ / 4];
+            re[k] = (er + (int32_t)(((int64_t)odr * wr - (int64_t)odi * wi) >> 15)) / 2;
+            im[k] = (ei + (int32_t)(((int64_t)odr * wi + (int64_t)odi * wr) >> 15)) / 2;
+        }
+    }
+
+private:
+    static int16_t q15(double v) {
+        const double s = std::round(v * 32767.0);
+        return (int16_t)(s > 32767.0 ? 32767 : s < -32767.0 ? -32767 : s);
+    }
+
+    // Deslocamento que deixa o maior componente abaixo de 32767 / (4·√2)
+    static unsigned shiftFor(int32_t peak) {
+        unsigned s = 0;
+        while (s < 3 && (peak >> s) > 5792) s++;
+        return s;
+    }
+
+    // out = y * W, com W = wr - j·sin (wi = -sin já vem da tabela)
+    static STETHO_ALWAYS_INLINE void rotate(int32_t yr, int32_t yi, int32_t wr, int32_t wi, int16_t *out) {
+        out[0] = (int16_t)((yr * wr - yi * wi + (1 << 14)) >> 15);
+        out[1] = (int16_t)((yr * wi + yi * wr + (1 << 14)) >> 15);
+    }
+
+    static STETHO_ALWAYS_INLINE int32_t maxAbs(int32_t peak, const int16_t *v) {
+        const int32_t r = v[0] < 0 ? -(int32_t)v[0] : v[0];
+        const int32_t i = v[1] < 0 ? -(int32_t)v[1] : v[1];
+        if (r > peak) peak = r;
+        return i > peak ? i : peak;
+    }
+
+    unsigned log2n_ = 0;
+    size_t n_ = 0;
+    size_t m_ = 0;
+    int16_t cos_[MAX_SIZE + MAX_SIZE / 4];
+    uint16_t rev_[MAX_SIZE / 2];
+    int16_t work_[MAX_SIZE]; // M complexos intercalados (re, im)
+};
+
+//================================================================
+// --- ESPECTROGRAMA EM STREAMING ---
+//================================================================
+// Janelas de Hann de N amostras com salto N >> sobreposição. Cada quadro
+// vira N/2 níveis em dBFS quantizados em 8 bits: 0,5 dB por passo, 255 =
+// 0 dBFS (senoide de fundo de escala), 0 = -127,5 dBFS ou menos.
+//
+// Layout de uma notificação da característica de espectrograma:
+//
+//   byte  0:   versão (SPECTROGRAM_VERSION)
+//   byte  1:   log2 N
+//   bytes 2-3: seq u16
+//   bytes 4-7: first_sample u32 (índice da primeira amostra da janela)
+//   bytes 8-9: salto em amostras u16
+//   byte  10:  bins por valor (potência de 2; o valor é o máximo do grupo)
+//   byte  11:  reservado
+//   níveis u8, do DC para cima (a quantidade vem do tamanho da notificação)
+//
+// Com MTU pequeno os bins são agrupados até o quadro caber numa notificação.
+
+constexpr uint8_t SPECTROGRAM_VERSION = 1;
+constexpr size_t SPECTROGRAM_HEADER = 12;
+
+// Valor do comando SetSpectrogram: 0 = desligado; bits 0-3 = log2 N;
+// bits 4-5 = sobreposição (salto = N >> valor: 0 = nenhuma, 1 = 50%, 2 = 75%, 3 = 87,5%)
+struct SpectrogramConfig {
+    bool enabled = false;
+    uint8_t log2n = 9;
+    uint8_t overlap = 2;
+};
+
+inline bool decodeSpectrogramConfig(uint8_t value, SpectrogramConfig &c) {
+    if (value == 0) {
+        c.enabled = false;
+        return true;
+    }
+    const uint8_t log2n = value & 0x0F, overlap = (value >> 4) & 0x03;
+    if (!RealFft::supported(log2n) || (value & 0xC0) != 0) return false;
+    c.enabled = true;
+    c.log2n = log2n;
+    c.overlap = overlap;
+    return true;
+}
+
+inline uint8_t encodeSpectrogramConfig(const SpectrogramConfig &c) {
+    return c.enabled ? (uint8_t)(c.log2n | (c.overlap << 4)) : 0;
+}
+
+class SpectrogramEngine {
+public:
+    static constexpr size_t MAX_BINS = RealFft::MAX_SIZE / 2;
+
+    SpectrogramEngine() { configure(9, 2); }
+
+    bool configure(uint8_t log2n, uint8_t overlap) {
+        if (!fft_.configure(log2n) || overlap > 3) return false;
+        n_ = fft_.size();
+        hop_ = n_ >> overlap;
+        for (size_t i = 0; i < n_; i++)
+            window_[i] = (int16_t)std::lround(32767.0 * 0.5 * (1.0 - std::cos(2.0 * M_PI * (double)i / (double)n_)));
+        // Referência: senoide de amplitude 32767, ganho coerente da Hann = 1/2
+        ref_log2_ = 2.0f * (float)std::log2(32767.0 * (double)n_ / 4.0);
+        reset();
+        return true;
+    }
+
+    void reset() {
+        fill_ = 0;
+        ready_ = false;
+        seq_ = 0;
+    }
+
+    size_t fftSize() const { return n_; }
+    size_t hop() const { return hop_; }
+    size_t binCount() const { return n_ / 2; }
+
+    // Consome amostras até completar um quadro ou acabar a entrada e devolve
+    // quantas usou. Com um quadro pronto, nada é consumido até takeFrame().
+    STETHO_HOT size_t feed(const int16_t *x, size_t n, uint32_t first_sample) {
+        if (ready_ || n == 0) return 0;
+        // Descontinuidade: a janela não pode misturar os dois lados
+        if (fill_ > 0 && first_sample != buf_first_ + (uint32_t)fill_) fill_ = 0;
+        if (fill_ == 0) buf_first_ = first_sample;
+        size_t take = n_ - fill_;
+        if (take > n) take = n;
+        std::memcpy(buf_ + fill_, x, take * sizeof(int16_t));
+        fill_ += take;
+        if (fill_ == n_) computeFrame();
+        return take;
+    }
+
+    bool hasFrame() const { return ready_; }
+
+    // Níveis do quadro pronto (binCount() valores)
+    const uint8_t *levels() const { return levels_; }
+
+    // Escreve o quadro pronto em até 'capacity' bytes e libera o próximo
+    size_t takeFrame(uint8_t *out, size_t capacity) {
+        if (!ready_ || capacity <= SPECTROGRAM_HEADER) return 0;
+        const size_t bins = binCount();
+        size_t group = 1;
+        while (bins / group > capacity - SPECTROGRAM_HEADER) group *= 2;
+
+        out[0] = SPECTROGRAM_VERSION;
+        out[1] = (uint8_t)fft_.log2Size();
+        putLe16(out + 2, seq_++);
+        putLe32(out + 4, frame_first_);
+        putLe16(out + 8, (uint16_t)hop_);
+        out[10] = (uint8_t)group;
+        out[11] = 0;
+        uint8_t *p = out + SPECTROGRAM_HEADER;
+        for (size_t k = 0; k < bins; k += group) {
+            uint8_t v = levels_[k];
+            for (size_t g = 1; g < group; g++)
+                if (levels_[k + g] > v) v = levels_[k + g];
+            *p++ = v;
+        }
+        ready_ = false;
+        return SPECTROGRAM_HEADER + bins / group;
+    }
+
+private:
+    void computeFrame() {
+        // Sinais fracos sobem até perto do fundo de escala antes da janela,
+        // para o arredondamento da FFT não comer os bits de baixo
+        int32_t peak = 0;
+        for (size_t i = 0; i < n_; i++) {
+            const int32_t a = buf_[i] < 0 ? -(int32_t)buf_[i] : buf_[i];
+            if (a > peak) peak = a;
+        }
+        int gain = 0;
+        while (gain < 15 && peak != 0 && (peak << (gain + 1)) <= 32767) gain++;
+        for (size_t i = 0; i < n_; i++)
+            windowed_[i] = (int16_t)((((int32_t)buf_[i] << gain) * (int32_t)window_[i] + (1 << 14)) >> 15);
+        int exponent = 0;
+        fft_.forward(windowed_, re_, im_, exponent);
+        exponent -= gain;
+
+        // 2 x dBFS + 255, com 10 log10(P) = 3,0103 log2(P)
+        const float offset = 2.0f * (float)exponent - ref_log2_;
+        for (size_t k = 0; k < n_ / 2; k++) {
+            const float power = (float)((int64_t)re_[k] * re_[k] + (int64_t)im_[k] * im_[k]);
+            float q = 0.0f;
+            if (power > 0.0f) q = 255.0f + 6.0206f * (fastLog2(power) + offset) + 0.5f;
+            levels_[k] = (uint8_t)(q <= 0.0f ? 0.0f : q >= 255.0f ? 255.0f : q);
+        }
+        frame_first_ = buf_first_;
+        ready_ = true;
+
+        // Mantém a sobreposição para a próxima janela
+        fill_ = n_ - hop_;
+        std::memmove(buf_, buf_ + hop_, fill_ * sizeof(int16_t));
+        buf_first_ += (uint32_t)hop_;
+    }
+
+    RealFft fft_;
+    size_t n_ = 0;
+    size_t hop_ = 0;
+    float ref_log2_ = 0.0f;
+    int16_t window_[RealFft::MAX_SIZE];
+    int16_t buf_[RealFft::MAX_SIZE];
+    int16_t windowed_[RealFft::MAX_SIZE];
+    int32_t re_[MAX_BINS];
+    int32_t im_[MAX_BINS];
+    uint8_t levels_[MAX_BINS];
+    size_t fill_ = 0;
+    uint32_t buf_first_ = 0;
+    uint32_t frame_first_ = 0;
+    bool ready_ = false;
+    uint16_t seq_ = 0;
+};
+
+} // namespace stetho
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//================================================================
+// --- FILA LOCK-FREE PRODUTOR ÚNICO / CONSUMIDOR ÚNICO ---
+//================================================================
+// Anel de blocos pré-alocados entre a tarefa de captura (produtor) e a de
+// envio BLE (consumidor). Nenhuma das pontas bloqueia: se o anel estiver
+// cheio o produtor descarta o bloco novo e conta um overflow, assim um
+// travamento do BLE nunca chega ao DMA do I2S.
+//
+// Uso do produtor:  T *b = ring.beginWrite(); if (b) { ...; ring.commitWrite(); }
+// Uso do consumidor: T *b = ring.beginRead();  if (b) { ...; ring.commitRead(); }
+//
+// Os índices crescem sem parar e são reduzidos com & (Capacity - 1); a
+// diferença head - tail dá a ocupação mesmo depois de dar a volta em 32 bits.
+
+namespace stetho {
+
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity deve ser potência de 2");
+
+public:
+    // --- Produtor ---
+
+    // Slot livre para escrita, ou nullptr se o anel estiver cheio
+    T *beginWrite() {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        const uint32_t tail = tail_.load(std::memory_order_acquire);
+        if (head - tail >= Capacity) {
+            overflows_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &slots_[head & (Capacity - 1)];
+    }
+
+    void commitWrite() {
+        const uint32_t head = head_.load(std::memory_order_relaxed) + 1;
+        head_.store(head, std::memory_order_release);
+
+        const uint32_t used = head - tail_.load(std::memory_order_relaxed);
+        if (used > high_water_.load(std::memory_order_relaxed))
+            high_water_.store(used, std::memory_order_relaxed);
+    }
+
+    // --- Consumidor ---
+
+    // Próximo bloco para leitura, ou nullptr se o anel estiver vazio
+    T *beginRead() {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) == tail) return nullptr;
+        return &slots_[tail & (Capacity - 1)];
+    }
+
+    void commitRead() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // --- Estatísticas (qualquer tarefa) ---
+
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+    static constexpr size_t capacity() { return Capacity; }
+    uint32_t highWaterMark() const { return high_water_.load(std::memory_order_relaxed); }
+    uint32_t overflowCount() const { return overflows_.load(std::memory_order_relaxed); }
+
+private:
+    // Índices em linhas de cache separadas para o produtor e o consumidor
+    // não disputarem a mesma linha
+    alignas(64) std::atomic<uint32_t> head_{0};
+    alignas(64) std::atomic<uint32_t> tail_{0};
+    alignas(64) std::atomic<uint32_t> high_water_{0};
+    std::atomic<uint32_t> overflows_{0};
+    T slots_[Capacity];
+};
+
+} // namespace stetho
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "compiler.h"
+#include "stream_format.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_idf_version.h>
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#include <esp_cpu.h>
+#else
+#include <hal/cpu_hal.h>
+#endif
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+//================================================================
+// --- INSTRUMENTAÇÃO DO CAMINHO QUENTE ---
+//================================================================
+// Contadores de ciclos por estágio e contadores de eventos sem trava: cada
+// bloco tem um único escritor (a tarefa que o atualiza) e qualquer tarefa
+// pode ler. O leitor não zera nada; guarda a última leitura e calcula a
+// janela pela diferença, então os totais em 32 bits podem dar a volta
+// (basta uma janela durar menos que 2^32 ciclos, ~17 s a 240 MHz).
+//
+// Os campos de uma leitura não são atômicos entre si: uma janela pode ver
+// o total de ciclos de um registro a mais que a contagem, o que some na
+// média de centenas de registros por segundo.
+
+namespace stetho {
+
+// Contador de ciclos da CPU (ccount no ESP32, TSC no x86, ns nos demais)
+STETHO_ALWAYS_INLINE uint32_t cycleCount() {
+#if defined(ESP_PLATFORM)
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    return (uint32_t)esp_cpu_get_cycle_count();
+#else
+    return cpu_hal_get_cycle_count();
+#endif
+#elif defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Contador de eventos com um único escritor
+class StatCounter {
+public:
+    STETHO_ALWAYS_INLINE void add(uint32_t n = 1) {
+        value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    uint32_t load() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> value_{0};
+};
+
+// Leitura de um estágio: contagem, ciclos somados, pior caso desde o boot
+// e histograma log2 (bin b = durações em [2^b, 2^(b+1)))
+struct StageSnapshot {
+    static constexpr size_t BINS = 32;
+    uint32_t count = 0;
+    uint32_t cycles = 0;
+    uint32_t max = 0;
+    uint32_t hist[BINS] = {};
+};
+
+// Resumo de uma janela entre duas leituras
+struct StageWindow {
+    uint32_t count = 0;
+    uint32_t avg = 0;
+    uint32_t p99 = 0; // limite superior do bin (resolução de uma oitava)
+    uint32_t max = 0; // desde o boot
+};
+
+class StageStats {
+public:
+    STETHO_HOT void record(uint32_t cycles) {
+        count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        total_.store(total_.load(std::memory_order_relaxed) + cycles, std::memory_order_relaxed);
+        if (cycles > max_.load(std::memory_order_relaxed)) max_.store(cycles, std::memory_order_relaxed);
+        std::atomic<uint32_t> &bin = hist_[binFor(cycles)];
+        bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void snapshot(StageSnapshot &out) const {
+        out.count = count_.load(std::memory_order_relaxed);
+        out.cycles = total_.load(std::memory_order_relaxed);
+        out.max = max_.load(std::memory_order_relaxed);
+        for (size_t b = 0; b < StageSnapshot::BINS; b++) out.hist[b] = hist_[b].load(std::memory_order_relaxed);
+    }
+
+    static STETHO_ALWAYS_INLINE size_t binFor(uint32_t cycles) {
+        return cycles == 0 ? 0 : 31 - (size_t)__builtin_clz(cycles);
+    }
+
+private:
+    std::atomic<uint32_t> count_{0};
+    std::atomic<uint32_t> total_{0};
+    std::atomic<uint32_t> max_{0};
+    std::atomic<uint32_t> hist_[StageSnapshot::BINS] = {};
+};
+
+// Mede o trecho entre a construção e o destrutor (ou stop())
+class StageTimer {
+public:
+    explicit StageTimer(StageStats &stats) : stats_(&stats), start_(cycleCount()) {}
+    ~StageTimer() { stop(); }
+    void stop() {
+        if (stats_) stats_->record(cycleCount() - start_);
+        stats_ = nullptr;
+    }
+
+private:
+    StageStats *stats_;
+    uint32_t start_;
+};
+
+inline StageWindow stageWindow(const StageSnapshot &now, const StageSnapshot &prev) {
+    StageWindow w;
+    w.count = now.count - prev.count;
+    w.max = now.max;
+    if (w.count == 0) return w;
+    w.avg = (now.cycles - prev.cycles) / w.count;
+    // Primeiro bin que acumula 99% da janela
+    const uint32_t target = w.count - w.count / 100;
+    uint32_t seen = 0;
+    for (size_t b = 0; b < StageSnapshot::BINS; b++) {
+        seen += now.hist[b] - prev.hist[b];
+        if (seen >= target) {
+            w.p99 = b >= 31 ? 0xFFFFFFFFu : (uint32_t)((2u << b) - 1);
+            break;
+        }
+    }
+    return w;
+}
+
+//================================================================
+// --- CARACTERÍSTICA DE DIAGNÓSTICO ---
+//================================================================
+// Publicada por leitura e por notificação (~1 vez por segundo). Com MTU 23
+// a notificação chega truncada e o app deve ler a característica.
+//
+//   byte  0:     versão (DIAGNOSTICS_VERSION)
+//   byte  1:     reservado
+//   bytes 2-3:   clock da CPU em MHz u16 (converte ciclos em µs)
+//   bytes 4-7:   uptime em ms u32
+//   bytes 8-11:  amostras I2S lidas por segundo na última janela u32
+//   bytes 12-59: 3 estágios (espera pelo I2S, DSP, notify), cada um com
+//                contagem, média, p99 e máximo em ciclos (u32)
+//   bytes 60-63: overruns do DMA do I2S u32
+//   bytes 64-67: blocos descartados com a fila cheia (contrapressão do BLE) u32
+//   bytes 68-71: notificações que falharam u32
+//   bytes 72-77: pilha livre (bytes) das tarefas de captura, envio e armazenamento u16
+//   bytes 78-81: heap livre u32
+//   bytes 82-85: menor heap livre desde o boot u32
+//   byte  86:    estado de energia (core/power_policy.h: 0 ativo, 1 esperando, 2 I2S parado)
+//   byte  87:    1 se a última conexão encontrou o I2S parado
+//   bytes 88-91: conexão -> primeira notificação de áudio na última conexão, µs u32
+//   bytes 92-95: máximo disso com o I2S ligado na conexão, µs u32
+//   bytes 96-99: máximo disso com o I2S parado na conexão, µs u32
+//   bytes 100-103: tempo total com o I2S parado, s u32
+//   bytes 104-105: paradas do I2S u16
+//
+// Os campos de energia vieram depois, no fim: um leitor antigo continua
+// lendo os 86 primeiros bytes da mesma versão.
+
+constexpr uint8_t DIAGNOSTICS_VERSION = 1;
+constexpr size_t DIAGNOSTICS_BASE_SIZE = 86;
+constexpr size_t DIAGNOSTICS_SIZE = 106;
+
+enum class Stage : uint8_t {
+    I2sWait = 0,
+    Dsp = 1,
+    Notify = 2,
+};
+constexpr size_t STAGE_COUNT = 3;
+
+struct Diagnostics {
+    uint16_t cpu_mhz = 0;
+    uint32_t uptime_ms = 0;
+    uint32_t samples_per_sec = 0;
+    StageWindow stages[STAGE_COUNT];
+    uint32_t dma_overruns = 0;
+    uint32_t ring_overflows = 0;
+    uint32_t notify_failures = 0;
+    uint16_t stack_free[3] = {};
+    uint32_t free_heap = 0;
+    uint32_t min_free_heap = 0;
+    uint8_t power_state = 0;
+    bool last_connect_cold = false;
+    uint32_t connect_latency_us = 0;
+    uint32_t connect_latency_max_warm_us = 0;
+    uint32_t connect_latency_max_cold_us = 0;
+    uint32_t capture_idle_s = 0;
+    uint16_t capture_stops = 0;
+};
+
+inline size_t serializeDiagnostics(const Diagnostics &d, uint8_t *out) {
+    out[0] = DIAGNOSTICS_VERSION;
+    out[1] = 0;
+    putLe16(out + 2, d.cpu_mhz);
+    putLe32(out + 4, d.uptime_ms);
+    putLe32(out + 8, d.samples_per_sec);
+    uint8_t *p = out + 12;
+    for (size_t s = 0; s < STAGE_COUNT; s++, p += 16) {
+        putLe32(p, d.stages[s].count);
+        putLe32(p + 4, d.stages[s].avg);
+        putLe32(p + 8, d.stages[s].p99);
+        putLe32(p + 12, d.stages[s].max);
+    }
+    putLe32(out + 60, d.dma_overruns);
+    putLe32(out + 64, d.ring_overflows);
+    putLe32(out + 68, d.notify_failures);
+    for (size_t t = 0; t < 3; t++) putLe16(out + 72 + 2 * t, d.stack_free[t]);
+    putLe32(out + 78, d.free_heap);
+    putLe32(out + 82, d.min_free_heap);
+    out[86] = d.power_state;
+    out[87] = d.last_connect_cold ? 1 : 0;
+    putLe32(out + 88, d.connect_latency_us);
+    putLe32(out + 92, d.connect_latency_max_warm_us);
+    putLe32(out + 96, d.connect_latency_max_cold_us);
+    putLe32(out + 100, d.capture_idle_s);
+    putLe16(out + 104, d.capture_stops);
+    return DIAGNOSTICS_SIZE;
+}
+
+// Sem os campos de energia (firmware anterior) eles ficam zerados
+inline bool parseDiagnostics(const uint8_t *in, size_t len, Diagnostics &d) {
+    if (len < DIAGNOSTICS_BASE_SIZE || in[0] != DIAGNOSTICS_VERSION) return false;
+    d.cpu_mhz = getLe16(in + 2);
+    d.uptime_ms = getLe32(in + 4);
+    d.samples_per_sec = getLe32(in + 8);
+    const uint8_t *p = in + 12;
+    for (size_t s = 0; s < STAGE_COUNT; s++, p += 16) {
+        d.stages[s].count = getLe32(p);
+        d.stages[s].avg = getLe32(p + 4);
+        d.stages[s].p99 = getLe32(p + 8);
+        d.stages[s].max = getLe32(p + 12);
+    }
+    d.dma_overruns = getLe32(in + 60);
+    d.ring_overflows = getLe32(in + 64);
+    d.notify_failures = getLe32(in + 68);
+    for (size_t t = 0; t < 3; t++) d.stack_free[t] = getLe16(in + 72 + 2 * t);
+    d.free_heap = getLe32(in + 78);
+    d.min_free_heap = getLe32(in + 82);
+    if (len >= DIAGNOSTICS_SIZE) {
+        d.power_state = in[86];
+        d.last_connect_cold = in[87] != 0;
+        d.connect_latency_us = getLe32(in + 88);
+        d.connect_latency_max_warm_us = getLe32(in + 92);
+        d.connect_latency_max_cold_us = getLe32(in + 96);
+        d.capture_idle_s = getLe32(in + 100);
+        d.capture_stops = getLe16(in + 104);
+    }
+    return true;
+}
+
+//================================================================
+// --- TRACE BINÁRIO PELA SERIAL ---
+//================================================================
+// Um registro por estágio medido, de 11 bytes:
+//
+//   0xA5 | estágio u8 | início u32 (ciclos) | duração u32 (ciclos) | xor dos 10 anteriores
+//
+// O byte de sincronia e o xor deixam o leitor se realinhar no meio do
+// texto que o firmware também manda pela serial.
+
+constexpr uint8_t TRACE_SYNC = 0xA5;
+constexpr size_t TRACE_RECORD_SIZE = 11;
+
+struct TraceRecord {
+    uint8_t stage;
+    uint32_t start;
+    uint32_t cycles;
+};
+
+inline void serializeTraceRecord(const TraceRecord &r, uint8_t *out) {
+    out[0] = TRACE_SYNC;
+    out[1] = r.stage;
+    putLe32(out + 2, r.start);
+    putLe32(out + 6, r.cycles);
+    uint8_t x = 0;
+    for (size_t i = 0; i < TRACE_RECORD_SIZE - 1; i++) x ^= out[i];
+    out[10] = x;
+}
+
+// Procura o próximo registro válido a partir de 'in'; devolve quantos bytes
+// foram consumidos (0 = falta dado para decidir)
+inline size_t parseTraceRecord(const uint8_t *in, size_t len, TraceRecord &r, bool &found) {
+    found = false;
+    size_t pos = 0;
+    while (pos + TRACE_RECORD_SIZE <= len) {
+        if (in[pos] == TRACE_SYNC) {
+            uint8_t x = 0;
+            for (size_t i = 0; i < TRACE_RECORD_SIZE - 1; i++) x ^= in[pos + i];
+            if (x == in[pos + 10] && in[pos + 1] < STAGE_COUNT) {
+                r.stage = in[pos + 1];
+                r.start = getLe32(in + pos + 2);
+                r.cycles = getLe32(in + pos + 6);
+                found = true;
+                return pos + TRACE_RECORD_SIZE;
+            }
+        }
+        pos++;
+    }
+    return pos;
+}
+
+} // namespace stetho
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//================================================================
+// --- INTERFACE DE ARMAZENAMENTO ---
+//================================================================
+// O formato de gravação (core/recording.h) só precisa de arquivos
+// append-only com leitura aleatória. No ESP32 a implementação usa o
+// LittleFS; no PC, arquivos comuns (bench/file_storage.h), para os testes
+// de vazão e recuperação após queda rodarem sem o hardware.
+
+namespace stetho {
+
+class Storage {
+public:
+    virtual ~Storage() = default;
+
+    // Acrescenta ao fim do arquivo (criando se não existir)
+    virtual bool append(const char *path, const uint8_t *data, size_t len) = 0;
+    // Garante que o que foi acrescentado chegou à mídia
+    virtual bool flush(const char *path) = 0;
+    // Lê a partir de 'offset'; devolve quantos bytes foram lidos
+    virtual size_t read(const char *path, uint32_t offset, uint8_t *out, size_t len) = 0;
+    // Tamanho em bytes, ou -1 se o arquivo não existe
+    virtual int32_t size(const char *path) = 0;
+    // Corta o arquivo em 'size' bytes (recuperação de um bloco pela metade)
+    virtual bool truncate(const char *path, uint32_t size) = 0;
+    virtual bool remove(const char *path) = 0;
+    // Chama fn(nome, ctx) para cada arquivo do diretório (só o nome, sem o caminho)
+    virtual void list(const char *dir, void (*fn)(const char *name, void *ctx), void *ctx) = 0;
+};
+
+} // namespace stetho
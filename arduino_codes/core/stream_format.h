@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//================================================================
+// --- FORMATOS DO STREAM DE ÁUDIO ---
+//================================================================
+// Codec aplicado às amostras antes de pCharacteristic->setValue. O padrão
+// continua sendo int16 little-endian sem cabeçalho, que é o que o app
+// entende hoje; os demais são ativados pela característica de controle.
+
+namespace stetho {
+
+enum class StreamCodec : uint8_t {
+    Pcm16 = 0,    // int16 LE cru, sem cabeçalho (formato legado)
+    Rice = 1,     // predição linear + Rice, sem perdas (core/rice_codec.h)
+    ImaAdpcm = 2, // IMA-ADPCM 4:1 com estado no cabeçalho (core/ima_adpcm.h)
+};
+
+constexpr uint8_t STREAM_CODEC_COUNT = 3;
+
+//================================================================
+// --- METADADOS DO STREAM (característica de informações) ---
+//================================================================
+// Lidos pelo app para saber como interpretar as notificações de áudio:
+//
+//   byte  0:   versão do layout (STREAM_INFO_VERSION)
+//   byte  1:   codec (StreamCodec)
+//   byte  2:   modo do banco de filtros (FilterMode)
+//   byte  3:   flags (STREAM_FLAG_*; 0 no stream legado)
+//   bytes 4-7: taxa de amostragem efetiva em Hz (uint32 LE)
+//   bytes 8-9: amostras por notificação (uint16 LE; 0 = variável, ex.: Rice)
+//   bytes 10-13: taxa medida contra o esp_timer em mHz (uint32 LE; 0 = ainda
+//                sem medida), na mesma escala da taxa efetiva (core/sample_clock.h)
+//   bytes 14-17: offset acumulado do relógio da amostragem em µs (int32 LE):
+//                tempo real menos índice / taxa nominal desde o início da medida
+//
+// A medida veio depois, no fim: um leitor antigo continua lendo os 10
+// primeiros bytes da mesma versão.
+
+constexpr uint8_t STREAM_INFO_VERSION = 1;
+constexpr size_t STREAM_INFO_BASE_SIZE = 10;
+constexpr size_t STREAM_INFO_SIZE = 18;
+
+// As notificações de áudio começam com o cabeçalho de core/frame.h
+constexpr uint8_t STREAM_FLAG_FRAMED = 0x1;
+// O dispositivo está enviando em rajada o histórico anterior à conexão
+constexpr uint8_t STREAM_FLAG_BACKFILL = 0x2;
+// Gravando na flash (store-and-forward)
+constexpr uint8_t STREAM_FLAG_RECORDING = 0x4;
+// Quadros de espectrograma na característica própria (core/spectrogram.h)
+constexpr uint8_t STREAM_FLAG_SPECTROGRAM = 0x8;
+// Pares min/max para o gráfico ao vivo na característica de prévia (core/minmax_preview.h)
+constexpr uint8_t STREAM_FLAG_PREVIEW = 0x10;
+// As amostras usam o expoente de ganho do cabeçalho de cada quadro (core/block_float.h)
+constexpr uint8_t STREAM_FLAG_SCALED = 0x20;
+// Peito e microfone de fora intercalados (core/noise_canceller.h): a taxa é a
+// de cada canal, e índices e timestamps contam as amostras dos dois
+constexpr uint8_t STREAM_FLAG_STEREO = 0x40;
+
+struct StreamInfo {
+    StreamCodec codec = StreamCodec::Pcm16;
+    uint8_t filter_mode = 0;
+    uint8_t flags = 0;
+    uint32_t sample_rate_hz = 20000;
+    uint16_t block_samples = 0;
+    uint32_t measured_rate_mhz = 0;
+    int32_t clock_offset_us = 0;
+};
+
+inline void putLe16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+inline void putLe32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+inline uint16_t getLe16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+inline uint32_t getLe32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline size_t serializeStreamInfo(const StreamInfo &info, uint8_t *out) {
+    out[0] = STREAM_INFO_VERSION;
+    out[1] = (uint8_t)info.codec;
+    out[2] = info.filter_mode;
+    out[3] = info.flags;
+    putLe32(out + 4, info.sample_rate_hz);
+    putLe16(out + 8, info.block_samples);
+    putLe32(out + 10, info.measured_rate_mhz);
+    putLe32(out + 14, (uint32_t)info.clock_offset_us);
+    return STREAM_INFO_SIZE;
+}
+
+// Sem a medida do relógio (firmware anterior) ela fica zerada
+inline bool parseStreamInfo(const uint8_t *in, size_t len, StreamInfo &info) {
+    if (len < STREAM_INFO_BASE_SIZE || in[0] != STREAM_INFO_VERSION) return false;
+    info.codec = (StreamCodec)in[1];
+    info.filter_mode = in[2];
+    info.flags = in[3];
+    info.sample_rate_hz = getLe32(in + 4);
+    info.block_samples = getLe16(in + 8);
+    info.measured_rate_mhz = len >= STREAM_INFO_SIZE ? getLe32(in + 10) : 0;
+    info.clock_offset_us = len >= STREAM_INFO_SIZE ? (int32_t)getLe32(in + 14) : 0;
+    return true;
+}
+
+} // namespace stetho
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "block_float.h"
+#include "reassembler.h"
+#include "stream_format.h"
+#include "wav_writer.h"
+
+//================================================================
+// --- RECEPTOR PORTÁTIL DO STREAM (LADO DO APP) ---
+//================================================================
+// O que o app faz com cada notificação, em C++ e sem alocação depois da
+// construção: lê o StreamInfo, remonta os quadros (core/reassembler.h),
+// leva as amostras com expoente de ganho para a escala fixa do >> 14 (a que
+// o app converte em pascal), põe tudo numa janela para o gráfico e, se
+// pedido, grava um WAV incremental (core/wav_writer.h).
+//
+// A posição na gravação é contínua entre conexões: cada conexão tem um
+// Reassembler novo, e o índice do dispositivo (32 bits, que não para entre
+// conexões) diz quanto tempo passou. O começo de uma conexão que o
+// histórico pré-gatilho já cobriu é descartado; um buraco vira silêncio
+// até MAX_FILL_SECONDS (acima disso a gravação só continua, e a quebra é
+// contada em jumps).
+//
+// Todas as chamadas vêm de uma thread só (o callback do BLE). A janela é a
+// exceção: o gráfico pode ler de outra thread (ver SampleWindow).
+
+namespace stetho {
+
+//================================================================
+// --- JANELA PARA O GRÁFICO (SEM CÓPIA) ---
+//================================================================
+// As últimas 'capacity' amostras, com cada uma escrita duas vezes (em i e
+// em i + capacity): qualquer trecho de até 'capacity' amostras fica
+// contíguo na memória, e o gráfico (ou um typed array do JS apontando para
+// o mesmo buffer) lê direto dela. A memória vem de fora: 2 * capacity
+// amostras.
+//
+// Um único escritor; o leitor pega o ponteiro de latest()/view() e, depois
+// de usar o trecho, confere com intact() que o escritor não deu a volta por
+// cima dele (como o seqlock do HistoryRing). Uma janela com o dobro do que
+// o gráfico mostra deixa meio anel de folga.
+class SampleWindow {
+public:
+    // capacity potência de 2
+    SampleWindow(int16_t *storage, size_t capacity) : buf_(storage), capacity_(capacity) {
+        std::memset(buf_, 0, 2 * capacity_ * sizeof(int16_t));
+    }
+
+    void push(const int16_t *samples, size_t n) {
+        uint64_t end = end_.load(std::memory_order_relaxed);
+        while (n > 0) {
+            const size_t at = (size_t)end & (capacity_ - 1);
+            size_t k = capacity_ - at;
+            if (k > n) k = n;
+            if (samples) {
+                std::memcpy(buf_ + at, samples, k * sizeof(int16_t));
+                std::memcpy(buf_ + at + capacity_, samples, k * sizeof(int16_t));
+                samples += k;
+            } else {
+                std::memset(buf_ + at, 0, k * sizeof(int16_t));
+                std::memset(buf_ + at + capacity_, 0, k * sizeof(int16_t));
+            }
+            end += k;
+            n -= k;
+            end_.store(end, std::memory_order_release);
+        }
+    }
+
+    size_t capacity() const { return capacity_; }
+    // Posição depois da última amostra escrita
+    uint64_t end() const { return end_.load(std::memory_order_acquire); }
+
+    // [index, index + n) contíguo, ou nullptr se o trecho não está (todo) na janela
+    const int16_t *view(uint64_t index, size_t n) const {
+        const uint64_t e = end();
+        if (n > capacity_ || index + n > e || e - index > capacity_) return nullptr;
+        return buf_ + ((size_t)index & (capacity_ - 1));
+    }
+
+    // As últimas n amostras (menos, no começo); 'first' recebe o índice da primeira
+    const int16_t *latest(size_t n, uint64_t &first) const {
+        const uint64_t e = end();
+        if (n > capacity_) n = capacity_;
+        if (n > e) n = (size_t)e;
+        first = e - n;
+        return buf_ + ((size_t)first & (capacity_ - 1));
+    }
+
+    // O trecho que começa em 'index' ainda não foi sobrescrito
+    bool intact(uint64_t index) const { return end() - index <= capacity_; }
+
+private:
+    int16_t *buf_;
+    size_t capacity_;
+    std::atomic<uint64_t> end_{0};
+};
+
+struct ReceiverStats {
+    uint64_t notifications = 0;   // de áudio
+    uint64_t bytes = 0;           // de áudio, com cabeçalho
+    uint64_t samples = 0;         // saída (com silêncio)
+    uint64_t gap_samples = 0;     // silêncio: quadros perdidos e intervalos entre conexões
+    uint64_t overlap_samples = 0; // já recebidas, vindas de novo na rajada do histórico
+    uint32_t jumps = 0;           // intervalos acima de MAX_FILL_SECONDS
+    uint32_t connections = 0;
+    ReassemblerStats frames;      // somado entre as conexões
+};
+
+class StreamReceiver : private ReassemblerSink {
+public:
+    static constexpr uint32_t MAX_FILL_SECONDS = 60;
+
+    // 'window' pode ser nullptr (só gravação)
+    explicit StreamReceiver(SampleWindow *window) : window_(window), reassembler_(*this) {}
+
+    // A cada conexão, antes da primeira notificação dela
+    void onConnect() {
+        endConnection();
+        connected_ = true;
+        mapped_ = false;
+        stats_.connections++;
+    }
+
+    // Fim do stream (desconexão): entrega o que o Reassembler segurava
+    void onDisconnect() { endConnection(); }
+
+    // Valor da característica de StreamInfo (notificação ou leitura na conexão)
+    bool onStreamInfo(const uint8_t *data, size_t len) {
+        StreamInfo info;
+        if (!parseStreamInfo(data, len, info)) return false;
+        info_ = info;
+        if (wav_.isOpen()) wav_.setSampleRate(wavRateHz());
+        return true;
+    }
+
+    // Notificação de áudio: quadro (STREAM_FLAG_FRAMED) ou Pcm16 cru
+    void onAudio(const uint8_t *data, size_t len) {
+        stats_.notifications++;
+        stats_.bytes += len;
+        if (info_.flags & STREAM_FLAG_FRAMED) {
+            connected_ = true;
+            reassembler_.push(data, len);
+            return;
+        }
+        // Legado: sem índice, as amostras seguem a última
+        int16_t samples[Reassembler::MAX_FRAME_SAMPLES];
+        const int n = Reassembler::decodePayload(StreamCodec::Pcm16, data, len, samples);
+        if (n > 0) emit(samples, (size_t)n);
+    }
+
+    // WAV com o formato do StreamInfo atual (taxa medida, se já houver)
+    bool startWav(const char *path) {
+        return wav_.open(path, wavRateHz(), (info_.flags & STREAM_FLAG_STEREO) ? 2 : 1);
+    }
+    bool checkpointWav() { return wav_.checkpoint(); }
+    bool stopWav() {
+        endConnection();
+        wav_.setSampleRate(wavRateHz());
+        return wav_.close();
+    }
+
+    const StreamInfo &info() const { return info_; }
+    // Posição na gravação (amostras, contando os canais) desde a primeira conexão
+    uint64_t position() const { return next_; }
+    const ReceiverStats &stats() const { return stats_; }
+    const WavWriter &wav() const { return wav_; }
+
+private:
+    uint32_t wavRateHz() const {
+        return info_.measured_rate_mhz ? (info_.measured_rate_mhz + 500) / 1000 : info_.sample_rate_hz;
+    }
+
+    void endConnection() {
+        if (!connected_) return;
+        connected_ = false;
+        reassembler_.flush();
+        const ReassemblerStats &s = reassembler_.stats();
+        stats_.frames.frames += s.frames;
+        stats_.frames.invalid += s.invalid;
+        stats_.frames.duplicates += s.duplicates;
+        stats_.frames.reordered += s.reordered;
+        stats_.frames.gaps += s.gaps;
+        stats_.frames.gap_samples += s.gap_samples;
+        stats_.frames.samples_out += s.samples_out;
+        reassembler_.reset();
+        // O Reassembler novo começa no expoente 0 e só avisa as trocas
+        gain_exp_ = 0;
+        mapped_ = false;
+    }
+
+    void onGain(uint64_t, int gain_exp) override { gain_exp_ = gain_exp; }
+
+    void onSamples(uint64_t index, const int16_t *samples, size_t n, bool gap) override {
+        if (!mapped_) {
+            mapped_ = true;
+            // Primeira conexão: a gravação começa aqui. Depois, o índice de
+            // 32 bits do dispositivo diz onde a conexão nova cai
+            const int64_t at = started_ ? (int64_t)next_ + (int32_t)((uint32_t)index - device_next_) : 0;
+            shift_ = at - (int64_t)index;
+            started_ = true;
+        }
+        device_next_ = (uint32_t)(index + n);
+        int64_t at = (int64_t)index + shift_;
+        if (at + (int64_t)n <= (int64_t)next_) {
+            stats_.overlap_samples += n;
+            return;
+        }
+        if (at < (int64_t)next_) {
+            const size_t skip = (size_t)((int64_t)next_ - at);
+            stats_.overlap_samples += skip;
+            samples += skip;
+            n -= skip;
+            at = (int64_t)next_;
+        }
+        if (at > (int64_t)next_) {
+            const uint64_t hole = (uint64_t)(at - (int64_t)next_);
+            if (hole <= (uint64_t)MAX_FILL_SECONDS * info_.sample_rate_hz * channels()) {
+                stats_.gap_samples += hole;
+                emit(nullptr, (size_t)hole);
+            } else {
+                // Longe demais para encher de silêncio: a gravação segue daqui
+                stats_.jumps++;
+                shift_ -= (int64_t)hole;
+            }
+        }
+        if (gap) {
+            stats_.gap_samples += n;
+            emit(nullptr, n);
+            return;
+        }
+        if (gain_exp_ == 0) {
+            emit(samples, n);
+            return;
+        }
+        int16_t fixed[Reassembler::MAX_FRAME_SAMPLES];
+        toFixedScale(samples, fixed, n, gain_exp_);
+        emit(fixed, n);
+    }
+
+    size_t channels() const { return (info_.flags & STREAM_FLAG_STEREO) ? 2 : 1; }
+
+    // nullptr = silêncio
+    void emit(const int16_t *samples, size_t n) {
+        if (window_) window_->push(samples, n);
+        if (wav_.isOpen()) wav_.write(samples, n);
+        next_ += n;
+        stats_.samples += n;
+    }
+
+    SampleWindow *window_;
+    Reassembler reassembler_;
+    WavWriter wav_;
+    StreamInfo info_;
+    ReceiverStats stats_;
+    int gain_exp_ = 0;
+    bool connected_ = false;
+    bool started_ = false;
+    bool mapped_ = false;     // a conexão atual já sabe onde cai na gravação
+    int64_t shift_ = 0;       // índice do Reassembler -> posição na gravação
+    uint32_t device_next_ = 0; // índice do dispositivo depois da última amostra
+    uint64_t next_ = 0;
+};
+
+} // namespace stetho
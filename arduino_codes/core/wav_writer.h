@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "stream_format.h"
+
+//================================================================
+// --- WAV INCREMENTAL NO RECEPTOR ---
+//================================================================
+// Grava PCM de 16 bits no disco à medida que as amostras chegam, por um
+// buffer fixo, em vez de montar o arquivo inteiro na memória no fim. O
+// cabeçalho sai com os tamanhos em 0xFFFFFFFF (o valor de "stream" que os
+// leitores aceitam) e é corrigido no close(), junto com a taxa: a medida
+// do relógio da amostragem (core/sample_clock.h) só fica boa depois de
+// alguns segundos. checkpoint() faz o mesmo no meio da gravação, para um
+// app encerrado à força deixar um arquivo válido até ali.
+//
+// O limite do formato é 4 GB de dados (mais de 27 h a 20 kHz mono); passado
+// isso write() devolve false e o arquivo fecha válido.
+
+namespace stetho {
+
+class WavWriter {
+public:
+    static constexpr size_t HEADER_SIZE = 44;
+    static constexpr size_t BUFFER_BYTES = 32768;
+    static constexpr uint32_t MAX_DATA_BYTES = 0xFFFFFFFFu - (HEADER_SIZE - 8);
+
+    WavWriter() = default;
+    WavWriter(const WavWriter &) = delete;
+    WavWriter &operator=(const WavWriter &) = delete;
+    ~WavWriter() { close(); }
+
+    // Cria (ou trunca) o arquivo; 'channels' amostras intercaladas por quadro
+    bool open(const char *path, uint32_t sample_rate_hz, uint16_t channels) {
+        close();
+        file_ = std::fopen(path, "wb");
+        if (!file_) return false;
+        rate_hz_ = sample_rate_hz;
+        channels_ = channels ? channels : 1;
+        data_bytes_ = 0;
+        used_ = 0;
+        failed_ = false;
+        uint8_t header[HEADER_SIZE];
+        makeHeader(header, 0xFFFFFFFFu, 0xFFFFFFFFu);
+        failed_ = std::fwrite(header, 1, HEADER_SIZE, file_) != HEADER_SIZE;
+        return !failed_;
+    }
+
+    bool isOpen() const { return file_ != nullptr; }
+    bool failed() const { return failed_; }
+    // Amostras gravadas (contando os canais)
+    uint64_t samples() const { return (data_bytes_ + used_) / 2; }
+    uint16_t channels() const { return channels_; }
+
+    // Taxa que vai para o cabeçalho no próximo checkpoint() ou close()
+    void setSampleRate(uint32_t hz) {
+        if (hz) rate_hz_ = hz;
+    }
+
+    // 'n' amostras intercaladas; nullptr grava silêncio
+    bool write(const int16_t *samples, size_t n) {
+        if (!file_ || failed_) return false;
+        while (n > 0) {
+            if ((uint64_t)data_bytes_ + used_ + 2 > MAX_DATA_BYTES) return false;
+            if (used_ == BUFFER_BYTES && !drain()) return false;
+            size_t k = (BUFFER_BYTES - used_) / 2;
+            if (k > n) k = n;
+            uint8_t *p = buffer_ + used_;
+            if (samples) {
+                for (size_t i = 0; i < k; i++) putLe16(p + 2 * i, (uint16_t)samples[i]);
+                samples += k;
+            } else {
+                std::memset(p, 0, 2 * k);
+            }
+            used_ += 2 * k;
+            n -= k;
+        }
+        return true;
+    }
+
+    // Esvazia o buffer e corrige o cabeçalho, sem fechar
+    bool checkpoint() {
+        if (!file_ || !drain()) return false;
+        if (!patchHeader() || std::fseek(file_, 0, SEEK_END) != 0) failed_ = true;
+        return !failed_ && std::fflush(file_) == 0;
+    }
+
+    // Cabeçalho final; sem arquivo aberto não faz nada
+    bool close() {
+        if (!file_) return true;
+        bool ok = drain() && patchHeader();
+        ok &= std::fclose(file_) == 0;
+        file_ = nullptr;
+        return ok && !failed_;
+    }
+
+private:
+    void makeHeader(uint8_t *h, uint32_t riff_size, uint32_t data_size) const {
+        const uint32_t block_align = 2u * channels_;
+        std::memcpy(h, "RIFF", 4);
+        putLe32(h + 4, riff_size);
+        std::memcpy(h + 8, "WAVEfmt ", 8);
+        putLe32(h + 16, 16);
+        putLe16(h + 20, 1); // PCM
+        putLe16(h + 22, channels_);
+        putLe32(h + 24, rate_hz_);
+        putLe32(h + 28, rate_hz_ * block_align);
+        putLe16(h + 32, (uint16_t)block_align);
+        putLe16(h + 34, 16);
+        std::memcpy(h + 36, "data", 4);
+        putLe32(h + 40, data_size);
+    }
+
+    bool patchHeader() {
+        uint8_t header[HEADER_SIZE];
+        makeHeader(header, data_bytes_ + (uint32_t)(HEADER_SIZE - 8), data_bytes_);
+        if (std::fseek(file_, 0, SEEK_SET) != 0 || std::fwrite(header, 1, HEADER_SIZE, file_) != HEADER_SIZE) {
+            failed_ = true;
+        }
+        return !failed_;
+    }
+
+    bool drain() {
+        if (failed_) return false;
+        if (used_ == 0) return true;
+        if (std::fwrite(buffer_, 1, used_, file_) != used_) {
+            failed_ = true;
+            return false;
+        }
+        data_bytes_ += (uint32_t)used_;
+        used_ = 0;
+        return true;
+    }
+
+    std::FILE *file_ = nullptr;
+    uint32_t rate_hz_ = 20000;
+    uint16_t channels_ = 1;
+    uint32_t data_bytes_ = 0; // já no arquivo
+    size_t used_ = 0;         // no buffer
+    bool failed_ = false;
+    uint8_t buffer_[BUFFER_BYTES];
+};
+
+} // namespace stetho
@@ -3,7 +3,33 @@
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <BLE2902.h>
-#include <driver/i2s.h>
+#include <driver/i2s_std.h>
+#include <esp_gatts_api.h>
+#include <esp_heap_caps.h>
+#include <esp_pm.h>
+#include <freertos/event_groups.h>
+#include <LittleFS.h>
+#include <atomic>
+
+#include "core/biquad.h"
+#include "core/block_float.h"
+#include "core/bulk_transfer.h"
+#include "core/control_protocol.h"
+#include "core/frame.h"
+#include "core/heart_features.h"
+#include "core/minmax_preview.h"
+#include "core/history_ring.h"
+#include "core/noise_canceller.h"
+#include "core/packetizer.h"
+#include "core/pipeline.h"
+#include "core/power_policy.h"
+#include "core/recording.h"
+#include "core/resampler.h"
+#include "core/sample_clock.h"
+#include "core/spectrogram.h"
+#include "core/spsc_ring.h"
+#include "core/stats.h"
+#include "core/stream_format.h"
 
 //================================================================
 // --- SEÇÃO DE CONFIGURAÇÃO OTIMIZADA ---
@@ -12,6 +38,13 @@
 // 1. CONFIGURAÇÕES DE BLUETOOTH LOW ENERGY (BLE)
 #define SERVICE_UUID        "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
 #define CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26a8"
+#define CONTROL_CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26a9" // Escrita: comandos do app
+#define STREAM_INFO_CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26aa" // Leitura: metadados do stream
+#define BULK_CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26ab" // Escrita + notify: gravações na flash
+#define FEATURES_CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26ac" // Leitura + notify: BPM e S1/S2
+#define SPECTROGRAM_CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26ad" // Notify: quadros de espectrograma
+#define PREVIEW_CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26ae" // Notify: pares min/max do gráfico ao vivo
+#define DIAGNOSTICS_CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26af" // Leitura + notify: estatísticas
 
 // 2. CONFIGURAÇÕES DO MICROFONE I2S
 #define I2S_WS_PIN    4  // Word Select
@@ -21,12 +54,120 @@
 // 3. PARÂMETROS DE ÁUDIO OTIMIZADOS
 #define I2S_PORT          I2S_NUM_0
 #define I2S_SAMPLE_RATE   20000     // Aumentar a taxa de amostragem agora é mais viável
-#define I2S_SAMPLE_BITS   I2S_BITS_PER_SAMPLE_32BIT
-#define I2S_CHANNEL_FMT   I2S_CHANNEL_FMT_ONLY_LEFT
 
-// OTIMIZAÇÃO: Ajusta o buffer de amostras para o tamanho máximo do pacote BLE (MTU)
-#define I2S_BUFFER_SAMPLES 250  // 257 amostras * 2 bytes/amostra = 514 bytes
-#define FILTER_ALPHA 0.25f
+// Bloco de captura = um buffer de DMA: 250 amostras = 12,5 ms a 20 kHz. O tamanho de
+// cada notificação não depende dele: o empacotador enche MTU - 3 bytes (257 amostras
+// int16 com MTU 517)
+#define I2S_BUFFER_SAMPLES 250
+// Buffers de DMA no anel do driver. A captura processa cada um no próprio lugar,
+// então tem I2S_DMA_BUFFERS - 2 blocos (75 ms) para terminar antes do DMA voltar nele.
+#define I2S_DMA_BUFFERS 8
+
+// 4. FILTRO: banco de biquads selecionável pelo app (ver core/biquad.h)
+#define DEFAULT_FILTER_MODE stetho::FilterMode::Wideband
+
+// 5. CODEC: o padrão é int16 cru, que é o formato que o app já entende
+#define DEFAULT_STREAM_CODEC stetho::StreamCodec::Pcm16
+
+// 6. TAXA DE SAÍDA: decimação polifásica após o filtro (20, 10, 8 ou 4 kHz)
+#define DEFAULT_OUTPUT_RATE stetho::OutputRate::Hz20000
+
+// 7. FILA ENTRE CAPTURA E ENVIO: 16 blocos = 200 ms de folga para o BLE
+#define AUDIO_RING_BLOCKS 16
+
+// 8. ENQUADRAMENTO: desligado por padrão para o app atual continuar funcionando
+#define DEFAULT_FRAMING false
+
+// 9. PRÉ-GATILHO: últimos N segundos guardados sem conexão e enviados em rajada ao conectar
+#define PRETRIGGER_SECONDS 5
+#define BACKFILL_SPEEDUP   4   // rajada limitada a 4x o tempo real
+
+// 10. GRAVAÇÃO NA FLASH: a tarefa de armazenamento acorda a cada 20 ms e manda
+// até 8 notificações da transferência em massa por volta
+#define STORAGE_TASK_PERIOD_MS 20
+#define BULK_PACKETS_PER_TICK  8
+// Pedidos da transferência em massa esperando a tarefa (um é atendido por volta)
+#define BULK_REQUEST_RING      4
+
+// 11. FEATURES CARDÍACAS: relatórios de BPM e S1/S2 (4 por segundo) esperando o envio
+#define FEATURE_RING_REPORTS 8
+
+// 12. ESPECTROGRAMA: desligado até o app pedir (SetSpectrogram); o valor segue
+// core/spectrogram.h, e o padrão sugerido ao ligar é N = 512 com salto de N/4
+#define DEFAULT_SPECTROGRAM_CONFIG 0
+
+// 13. PRÉVIA MIN/MAX: desligada até o app pedir (SetPreview, em pares/s / 10);
+// 40 pares por notificação = 10 notificações/s a 400 pares/s
+#define DEFAULT_PREVIEW_CONFIG 0
+#define PREVIEW_PAIRS_PER_PACKET 40
+
+// 14. DIAGNÓSTICO: estatísticas publicadas a cada segundo pelo loop(). Com o
+// trace ligado, cada bloco da captura também vira dois registros binários na
+// serial (core/stats.h) e os prints de texto do loop() param.
+#define STATS_PERIOD_MS    1000
+#define STATS_SERIAL_TRACE 0
+#define TRACE_RING_RECORDS 256
+
+// 15. PONTO DE MONTAGEM DO LITTLEFS no VFS (o simulador do Linux troca pelo
+// diretório que faz o papel da flash)
+#ifndef LITTLEFS_MOUNT_POINT
+#define LITTLEFS_MOUNT_POINT "/littlefs"
+#endif
+
+// 16. FRONT-END DA CAPTURA, escolhido em tempo de compilação (core/pipeline.h):
+// BiquadBank é o banco selecionável pelo app; LowPass e Shift reproduzem os
+// antigos current_with_filter.cpp e current_without_filter.cpp. Só o front-end
+// escolhido é compilado; fora do BiquadBank o modo de filtro do app é ignorado.
+constexpr stetho::CaptureFrontEnd CAPTURE_FRONT_END = stetho::CaptureFrontEnd::BiquadBank;
+
+// 17. ESCALA DO STREAM: >> 14 fixo até o app pedir ponto flutuante em bloco ou
+// AGC (SetScaling, core/block_float.h). Só vale com o enquadramento ligado, que
+// leva o expoente de cada quadro; histórico, features, espectrograma e prévia
+// continuam na escala fixa.
+#define DEFAULT_SCALING_MODE stetho::ScalingMode::Fixed
+
+// 18. REDE ELÉTRICA: o buffer do DMA passa por um bloqueio de DC e por um
+// cancelador adaptativo do zumbido da rede e de 3 harmônicas, que segue a
+// deriva da frequência (core/mains_filter.h). 60 Hz no Brasil, 50 Hz na
+// Europa; stetho::NoConditioning desliga.
+#define MAINS_FREQUENCY_HZ 60
+
+// 19. MICROFONES: 1 = só o do peito, no slot esquerdo (placa atual); 2 = um
+// segundo INMP441 virado para fora no slot direito (L/R em 3V3), com o
+// cancelador de ruído ambiente (core/noise_canceller.h). Com 2 o app escolhe
+// por SetStereo entre o peito cancelado, o peito sem cancelador ou os dois
+// canais intercalados para gravações de pesquisa. O simulador compila as duas
+// variantes.
+#ifndef CAPTURE_CHANNELS
+#define CAPTURE_CHANNELS 1
+#endif
+#define DEFAULT_STEREO_MODE stetho::StereoMode::Cancel
+
+#if CAPTURE_CHANNELS == 2
+using CaptureConditioning = stetho::DualMicConditioning<stetho::MainsConditioning<MAINS_FREQUENCY_HZ>>;
+static_assert(I2S_BUFFER_SAMPLES <= CaptureConditioning::MAX_BLOCK_FRAMES, "bloco maior que o da referência");
+#else
+using CaptureConditioning = stetho::MainsConditioning<MAINS_FREQUENCY_HZ>;
+#endif
+
+// 20. ENERGIA: sem central conectado nem gravação, a captura segue por
+// IDLE_CAPTURE_SECONDS (o histórico pré-gatilho cobre uma reconexão rápida) e
+// depois o I2S para (core/power_policy.h). Sem os locks da captura e do I2S o
+// gerenciador de energia baixa a CPU para PM_MIN_CPU_MHZ e entra em light
+// sleep entre os anúncios; isso exige CONFIG_PM_ENABLE e
+// CONFIG_FREERTOS_USE_TICKLESS_IDLE no sdkconfig (sem eles o esp_pm_configure
+// falha, o erro vai para a serial e só o I2S para).
+#define IDLE_CAPTURE_SECONDS 30
+#define PM_MIN_CPU_MHZ       40
+
+// 21. RELÓGIO DA AMOSTRAGEM: a captura mede a taxa real do I2S contra o
+// esp_timer (core/sample_clock.h), publica a taxa medida e o offset
+// acumulado no StreamInfo e tira os timestamps dos quadros da reta ajustada,
+// sem o jitter da ISR. Com I2S_USE_APLL o clock do I2S vem do APLL em vez do
+// divisor do PLL de 160 MHz (ESP32 e S2). O app é notificado quando a taxa
+// medida anda mais que CLOCK_NOTIFY_PPM; o offset só atualiza o valor lido.
+#define I2S_USE_APLL     0
+#define CLOCK_NOTIFY_PPM 1
 
 //================================================================
 // --- VARIÁVEIS GLOBAIS E CALLBACKS ---
@@ -34,110 +175,1048 @@
 
 BLEServer *pServer = nullptr;
 BLECharacteristic *pCharacteristic = nullptr;
-bool deviceConnected = false;
+BLECharacteristic *pControlCharacteristic = nullptr;
+BLECharacteristic *pStreamInfoCharacteristic = nullptr;
+BLECharacteristic *pBulkCharacteristic = nullptr;
+BLECharacteristic *pFeatureCharacteristic = nullptr;
+BLECharacteristic *pSpectrogramCharacteristic = nullptr;
+BLECharacteristic *pPreviewCharacteristic = nullptr;
+BLECharacteristic *pDiagnosticsCharacteristic = nullptr;
+// Estado do enlace, escrito pelos callbacks BLE: CONNECTED enquanto há um
+// central e CHANGED a cada evento que a tarefa de energia precisa ver
+EventGroupHandle_t linkEvents = nullptr;
+constexpr EventBits_t LINK_CONNECTED_BIT = 1 << 0;
+constexpr EventBits_t LINK_CHANGED_BIT = 1 << 1;
+
+static bool linkConnected() { return (xEventGroupGetBits(linkEvents) & LINK_CONNECTED_BIT) != 0; }
+// Acorda a tarefa de energia (conexão, gravação)
+static void signalPowerTask() { xEventGroupSetBits(linkEvents, LINK_CHANGED_BIT); }
+// MTU da conexão atual (23 até o app negociar um maior)
+std::atomic<uint16_t> negotiatedMtu(stetho::Packetizer::DEFAULT_MTU);
+// Incrementado a cada conexão para a tarefa de envio descartar o que sobrou da anterior
+std::atomic<uint32_t> connectionCount(0);
+
+// Codec do stream, escrito pelo callback de controle e lido a cada bloco
+std::atomic<uint8_t> streamCodec((uint8_t)DEFAULT_STREAM_CODEC);
+// Cabeçalho com sequência/índice/timestamp em cada notificação (core/frame.h)
+std::atomic<bool> framingEnabled(DEFAULT_FRAMING);
+// Decimador da taxa de saída (a troca é aplicada pela tarefa de áudio)
+stetho::Decimator decimator(DEFAULT_OUTPUT_RATE);
+// Condicionamento + front-end + escala + decimação do buffer do DMA até o slot
+// da fila. O modo do filtro e a escala são trocados pelo callback de controle e
+// aplicados pela tarefa de áudio.
+using CapturePipeline = stetho::CapturePipeline<stetho::FrontEndFor<CAPTURE_FRONT_END>::type, stetho::Decimated,
+                                                stetho::BlockScaling, CaptureConditioning>;
+CapturePipeline capture(I2S_SAMPLE_RATE, DEFAULT_FILTER_MODE, decimator);
+// Escala pedida pelo app (ScalingMode); sem enquadramento vale o >> 14 fixo
+std::atomic<uint8_t> scalingMode((uint8_t)DEFAULT_SCALING_MODE);
+// Modo dos microfones pedido pelo app (StereoMode) e os canais do stream, que
+// a captura troca na borda do bloco (2 = pares peito/fora intercalados)
+std::atomic<uint8_t> stereoMode((uint8_t)DEFAULT_STEREO_MODE);
+std::atomic<uint8_t> streamChannels(1);
+#if CAPTURE_CHANNELS == 2
+// Microfone de fora pelo mesmo front-end, filtro e taxa do peito, na escala
+// fixa. Roda em todo bloco para o decimador ficar na mesma fase do outro.
+stetho::Decimator referenceDecimator(DEFAULT_OUTPUT_RATE);
+stetho::CapturePipeline<stetho::FrontEndFor<CAPTURE_FRONT_END>::type, stetho::Decimated>
+    referenceCapture(I2S_SAMPLE_RATE, DEFAULT_FILTER_MODE, referenceDecimator);
+#endif
+
+// Amostras por segundo no stream (as dos dois canais no modo intercalado)
+static uint32_t streamRateHz() { return decimator.rateHz() * streamChannels.load(); }
+
+// Bloco processado que passa da tarefa de captura para a de envio
+struct AudioBlock {
+    uint16_t count;
+    uint32_t first_sample;  // índice da primeira amostra na taxa de saída
+    uint32_t timestamp_us;  // instante de captura da primeira amostra
+    int8_t gain_exp;        // expoente de ganho das amostras (core/block_float.h)
+    uint8_t channels;       // 2 = pares peito/fora intercalados
+    int16_t samples[CAPTURE_CHANNELS * (I2S_BUFFER_SAMPLES + 1)];
+};
+
+// Fila lock-free produtor/consumidor com blocos pré-alocados
+stetho::SpscRing<AudioBlock, AUDIO_RING_BLOCKS> audioRing;
+TaskHandle_t notifyTaskHandle = nullptr;
+TaskHandle_t captureTaskHandle = nullptr;
+TaskHandle_t storageTaskHandle = nullptr;
+TaskHandle_t powerTaskHandle = nullptr;
+
+// Corta o stream em notificações do tamanho do MTU (só usado pela tarefa de envio)
+stetho::Packetizer packetizer;
+
+// Histórico contínuo da captura (PSRAM em Pcm16, senão RAM interna em ADPCM)
+stetho::HistoryRing *history = nullptr;
+// A tarefa de envio está mandando o histórico (sinalizado no StreamInfo)
+std::atomic<bool> backfillActive(false);
+
+// Frequência cardíaca e S1/S2, calculados pela tarefa de captura sobre o stream decimado
+stetho::HeartFeatureExtractor heartFeatures;
+stetho::SpscRing<stetho::HeartFeatures, FEATURE_RING_REPORTS> featureRing;
+
+// Espectrograma: configuração pedida pelo app (valor do SetSpectrogram) e o
+// motor, que só a tarefa de envio usa
+std::atomic<uint8_t> spectrogramConfig(DEFAULT_SPECTROGRAM_CONFIG);
+stetho::SpectrogramEngine spectrogram;
+
+// Prévia min/max: taxa pedida pelo app (valor do SetPreview) e o gerador,
+// que também só a tarefa de envio usa
+std::atomic<uint8_t> previewConfig(DEFAULT_PREVIEW_CONFIG);
+stetho::MinMaxPreview preview;
+
+// Estatísticas do caminho quente; cada uma tem um único escritor
+stetho::StageStats i2sWaitStats;  // captura: espera pelo próximo buffer do DMA
+stetho::StageStats dspStats;      // captura: filtro, decimação, histórico, features
+stetho::StageStats notifyStats;   // envio: esp_ble_gatts_send_indicate de cada pacote de áudio
+stetho::StatCounter samplesRead;  // captura
+stetho::StatCounter dmaOverruns;  // ISR do I2S (buffer que a captura não pegou a tempo)
+stetho::StatCounter notifyFailures; // envio (erro do esp_ble_gatts_send_indicate)
+// Cópia dos contadores do empacotador para o loop(): só a tarefa de envio mexe nele
+std::atomic<uint32_t> packetsSent(0);
+std::atomic<uint16_t> packetEfficiencyPermille(0); // áudio / payload ATT dos pacotes enviados
+
+// Canal I2S (driver i2s_std) e os buffers de DMA cheios, do callback para a captura
+i2s_chan_handle_t i2sRxHandle = nullptr;
+struct DmaBlock {
+    int32_t *words;         // o próprio buffer do DMA
+    uint16_t count;         // quadros (CAPTURE_CHANNELS palavras cada)
+    uint32_t first_frame;   // índice da primeira amostra na taxa do I2S
+    uint32_t timestamp_us;  // instante de captura da primeira amostra
+};
+QueueHandle_t dmaQueue = nullptr;
+// A tarefa de energia religou o I2S: o histórico é de antes da parada e a
+// captura recomeça o histórico e as features no próximo bloco
+std::atomic<bool> captureRestarted(false);
+
+// Taxa do I2S medida pela captura (mHz, 0 = ainda sem medida) e o offset acumulado
+stetho::SampleClockEstimator sampleClock(I2S_SAMPLE_RATE);
+std::atomic<uint32_t> measuredRateMilliHz(0);
+std::atomic<int32_t> clockOffsetUs(0);
+
+// Estado publicado pela tarefa de energia para o diagnóstico
+std::atomic<uint8_t> powerState((uint8_t)stetho::PowerState::Linger);
+std::atomic<uint32_t> captureStops(0);
+std::atomic<uint32_t> captureIdleMs(0);   // parada acumulada até a última partida
+std::atomic<uint32_t> captureIdleSince(0); // millis() da parada atual
+stetho::ConnectLatency connectLatency;
+// Locks do gerenciador de energia segurados enquanto a captura roda
+esp_pm_lock_handle_t capturePmLock = nullptr;
+
+// Interface GATT e conexão atuais, para as notificações de áudio saírem direto
+// do buffer do pacote (sem a cópia para o valor da característica)
+std::atomic<uint16_t> gattsIf(ESP_GATT_IF_NONE);
+std::atomic<uint16_t> connId(0);
+BLE2902 *pAudioCccd = nullptr;
+// Registros do trace binário, da captura para o loop()
+stetho::SpscRing<stetho::TraceRecord, TRACE_RING_RECORDS> traceRing;
+
+// Gravação pedida pelo app e o estado real (a tarefa de armazenamento faz a troca)
+std::atomic<bool> recordingRequested(false);
+std::atomic<bool> recordingActive(false);
+
+// Pedidos da transferência em massa, do callback BLE para a tarefa de
+// armazenamento. Com a fila cheia o pedido é recusado e a tarefa responde
+// BUSY (conta pelo overflowCount() do anel).
+struct BulkRequestMsg {
+    uint8_t data[16];
+    size_t len;
+};
+stetho::SpscRing<BulkRequestMsg, BULK_REQUEST_RING> bulkRequests;
+// ABORT não entra na fila, então sempre chega: o callback marca a flag e
+// quantos pedidos já tinha enfileirado, e a tarefa descarta esses antes de
+// abortar (os que chegaram depois do ABORT continuam valendo)
+std::atomic<bool> bulkAbortRequested(false);
+std::atomic<uint32_t> bulkAbortQueued(0);
+
+//================================================================
+// --- ARMAZENAMENTO: LittleFS ATRÁS DA INTERFACE stetho::Storage ---
+//================================================================
+// Só a tarefa de armazenamento usa, então não há trava. O arquivo que está
+// recebendo appends fica aberto entre chamadas.
+class LittleFsStorage : public stetho::Storage {
+public:
+    bool append(const char *path, const uint8_t *data, size_t len) override {
+        if (!appendFile || appendPath != path) {
+            closeAppend();
+            appendFile = LittleFS.open(path, FILE_APPEND, true);
+            if (!appendFile) return false;
+            appendPath = path;
+        }
+        return appendFile.write(data, len) == len;
+    }
+
+    bool flush(const char *path) override {
+        if (appendFile && appendPath == path) appendFile.flush();
+        return true;
+    }
+
+    size_t read(const char *path, uint32_t offset, uint8_t *out, size_t len) override {
+        flush(path);
+        File f = LittleFS.open(path, FILE_READ);
+        if (!f || !f.seek(offset)) return 0;
+        return f.read(out, len);
+    }
+
+    int32_t size(const char *path) override {
+        flush(path);
+        if (!LittleFS.exists(path)) return -1;
+        File f = LittleFS.open(path, FILE_READ);
+        return f ? (int32_t)f.size() : -1;
+    }
+
+    bool truncate(const char *path, uint32_t size) override {
+        if (appendPath == path) closeAppend();
+        // O VFS do ESP-IDF expõe o LittleFS em /littlefs, com truncate() POSIX
+        String full = String(LITTLEFS_MOUNT_POINT) + path;
+        return ::truncate(full.c_str(), size) == 0;
+    }
+
+    bool remove(const char *path) override {
+        if (appendPath == path) closeAppend();
+        return LittleFS.remove(path);
+    }
+
+    void list(const char *dir, void (*fn)(const char *name, void *ctx), void *ctx) override {
+        File d = LittleFS.open(dir);
+        if (!d || !d.isDirectory()) return;
+        for (File f = d.openNextFile(); f; f = d.openNextFile()) {
+            if (!f.isDirectory()) fn(f.name(), ctx);
+        }
+    }
+
+private:
+    void closeAppend() {
+        if (appendFile) appendFile.close();
+        appendPath = "";
+    }
+
+    File appendFile;
+    String appendPath;
+};
+
+LittleFsStorage flashStorage;
+bool flashMounted = false;
 
 // --- NOVOS CALLBACKS para monitorar status da conexão e MTU ---
 class MyServerCallbacks: public BLEServerCallbacks {
-    void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t *param) {
-      deviceConnected = true;
+    void onConnect(BLEServer*, esp_ble_gatts_cb_param_t *param) {
+      negotiatedMtu.store(stetho::Packetizer::DEFAULT_MTU);
+      connId.store(param->connect.conn_id);
+      connectionCount.fetch_add(1);
+      connectLatency.connected(esp_timer_get_time(), powerState.load() == (uint8_t)stetho::PowerState::Idle);
+      xEventGroupSetBits(linkEvents, LINK_CONNECTED_BIT | LINK_CHANGED_BIT);
       Serial.println("Dispositivo conectado");
-      // Imprime o MTU negociado na conexão
     }
 
-    void onDisconnect(BLEServer* pServer) {
-      deviceConnected = false;
+    void onDisconnect(BLEServer*) {
+      xEventGroupClearBits(linkEvents, LINK_CONNECTED_BIT);
+      signalPowerTask();
       Serial.println("Dispositivo desconectado");
     }
     
     // Callback para quando o MTU é atualizado após a conexão
-    void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+    void onMtuChanged(BLEServer*, esp_ble_gatts_cb_param_t* param) {
+      negotiatedMtu.store(param->mtu.mtu);
       Serial.printf("MTU foi alterado para: %d\n", param->mtu.mtu);
     }
 };
 
+// --- Eventos GATT crus: guarda a interface usada pelo envio direto ---
+static void gattsEventHandler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *) {
+    if (event == ESP_GATTS_CONNECT_EVT) gattsIf.store(gatts_if);
+}
+
+// O expoente só chega ao app no cabeçalho do quadro, e os pares intercalados
+// ficam na escala fixa
+static bool scalingAllowed() {
+    return framingEnabled.load() && stereoMode.load() != (uint8_t)stetho::StereoMode::Interleaved;
+}
+
+// Passa à captura a escala pedida
+static void applyScalingMode() {
+    capture.scaling().requestMode(scalingAllowed() ? (stetho::ScalingMode)scalingMode.load()
+                                                   : stetho::ScalingMode::Fixed);
+}
+
+// --- CALLBACK da característica de controle (comandos escritos pelo app) ---
+class ControlCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic* pCharacteristic) {
+      stetho::ControlMessage msg;
+      if (!stetho::parseControlMessage(pCharacteristic->getData(), pCharacteristic->getLength(), msg)) {
+        Serial.println("Comando de controle inválido");
+        return;
+      }
+
+      switch (msg.command) {
+        case stetho::ControlCommand::SetFilterMode:
+          // A troca é feita pela tarefa de áudio na borda do próximo bloco
+          capture.requestMode((stetho::FilterMode)msg.value);
+          Serial.printf("Modo de filtro solicitado: %d\n", msg.value);
+          break;
+
+        case stetho::ControlCommand::SetCodec:
+          if (msg.value < stetho::STREAM_CODEC_COUNT) {
+            streamCodec.store(msg.value);
+            Serial.printf("Codec do stream: %d\n", msg.value);
+          }
+          break;
+
+        case stetho::ControlCommand::SetOutputRate:
+          decimator.requestRate((stetho::OutputRate)msg.value);
+          Serial.printf("Taxa de saída solicitada: %d\n", msg.value);
+          break;
+
+        case stetho::ControlCommand::SetFraming:
+          framingEnabled.store(msg.value != 0);
+          applyScalingMode();
+          Serial.printf("Enquadramento: %d\n", msg.value != 0);
+          break;
+
+        case stetho::ControlCommand::SetRecording:
+          recordingRequested.store(msg.value != 0);
+          Serial.printf("Gravação na flash solicitada: %d\n", msg.value != 0);
+          break;
+
+        case stetho::ControlCommand::SetSpectrogram: {
+          stetho::SpectrogramConfig config;
+          if (stetho::decodeSpectrogramConfig(msg.value, config)) {
+            spectrogramConfig.store(msg.value);
+            Serial.printf("Espectrograma: %s (N = %d)\n", config.enabled ? "ligado" : "desligado",
+                          config.enabled ? 1 << config.log2n : 0);
+          }
+          break;
+        }
+
+        case stetho::ControlCommand::SetPreview:
+          previewConfig.store(msg.value);
+          Serial.printf("Prévia min/max: %u pares/s\n", (unsigned)stetho::previewPairsPerSecond(msg.value));
+          break;
+
+        case stetho::ControlCommand::SetScaling:
+          if (msg.value < stetho::SCALING_MODE_COUNT) {
+            scalingMode.store(msg.value);
+            applyScalingMode();
+            Serial.printf("Escala do stream: %d\n", msg.value);
+          }
+          break;
+
+        case stetho::ControlCommand::SetStereo:
+#if CAPTURE_CHANNELS == 2
+          if (msg.value < stetho::STEREO_MODE_COUNT) {
+            stereoMode.store(msg.value);
+            capture.conditioning().requestMode((stetho::StereoMode)msg.value);
+            applyScalingMode();
+            Serial.printf("Modo dos microfones: %d\n", msg.value);
+          }
+#endif
+          break;
+      }
+    }
+};
+
+// --- CALLBACK da transferência em massa: só guarda o pedido para a tarefa de armazenamento ---
+class BulkCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic* pCharacteristic) {
+      size_t len = pCharacteristic->getLength();
+      const uint8_t *data = pCharacteristic->getData();
+      if (len >= 1 && data[0] == (uint8_t)stetho::BulkRequest::Abort) {
+        bulkAbortQueued.store(queued_, std::memory_order_relaxed);
+        bulkAbortRequested.store(true, std::memory_order_release);
+        return;
+      }
+      BulkRequestMsg *msg = bulkRequests.beginWrite();
+      if (msg == nullptr) return; // fila cheia: a tarefa responde BUSY
+      if (len > sizeof(msg->data)) len = sizeof(msg->data);
+      memcpy(msg->data, data, len);
+      msg->len = len;
+      bulkRequests.commitWrite();
+      queued_++;
+    }
+
+    // Pedidos já enfileirados (só este callback escreve)
+    uint32_t queued_ = 0;
+};
+
+// Publica os metadados do stream (taxa efetiva, codec, filtro) quando mudam
+void updateStreamInfo(bool force = false) {
+    static stetho::StreamInfo published;
+    stetho::RateRatio ratio = stetho::outputRateRatio(decimator.rate());
+
+    stetho::StreamInfo info;
+    info.codec = (stetho::StreamCodec)streamCodec.load();
+    info.filter_mode = (uint8_t)capture.mode();
+    info.flags = (framingEnabled.load() ? stetho::STREAM_FLAG_FRAMED : 0) |
+                 (backfillActive.load() ? stetho::STREAM_FLAG_BACKFILL : 0) |
+                 (recordingActive.load() ? stetho::STREAM_FLAG_RECORDING : 0) |
+                 (spectrogramConfig.load() != 0 ? stetho::STREAM_FLAG_SPECTROGRAM : 0) |
+                 (previewConfig.load() != 0 ? stetho::STREAM_FLAG_PREVIEW : 0) |
+                 (scalingAllowed() && scalingMode.load() != (uint8_t)stetho::ScalingMode::Fixed
+                      ? stetho::STREAM_FLAG_SCALED : 0) |
+                 (streamChannels.load() == 2 ? stetho::STREAM_FLAG_STEREO : 0);
+    info.sample_rate_hz = ratio.hz;
+    // Amostras por notificação; 0 no Rice, em que o número varia com o sinal
+    size_t per_packet = stetho::Packetizer::fixedSamplesFor(info.codec, packetizer.payloadCapacity());
+    if (per_packet > stetho::Packetizer::MAX_PACKET_SAMPLES) per_packet = stetho::Packetizer::MAX_PACKET_SAMPLES;
+    info.block_samples = info.codec == stetho::StreamCodec::Rice ? 0 : (uint16_t)per_packet;
+    // Taxa medida do I2S levada para a taxa de saída
+    info.measured_rate_mhz = (uint32_t)((uint64_t)measuredRateMilliHz.load() * ratio.hz / I2S_SAMPLE_RATE);
+    info.clock_offset_us = clockOffsetUs.load();
+
+    bool changed = force || info.codec != published.codec || info.filter_mode != published.filter_mode ||
+                   info.flags != published.flags || info.sample_rate_hz != published.sample_rate_hz ||
+                   info.block_samples != published.block_samples;
+    // A medida só notifica quando anda mais que CLOCK_NOTIFY_PPM (ou chega a primeira)
+    uint32_t moved = info.measured_rate_mhz > published.measured_rate_mhz
+                         ? info.measured_rate_mhz - published.measured_rate_mhz
+                         : published.measured_rate_mhz - info.measured_rate_mhz;
+    changed |= (published.measured_rate_mhz == 0) != (info.measured_rate_mhz == 0) ||
+               (uint64_t)moved * 1000000 > (uint64_t)CLOCK_NOTIFY_PPM * info.measured_rate_mhz;
+    bool clock_only = info.clock_offset_us != published.clock_offset_us;
+    if (!changed && !clock_only) return;
+    if (!changed) {
+        // Só o offset: atualiza o valor para a leitura, sem notificar
+        info.measured_rate_mhz = published.measured_rate_mhz;
+    }
+    published = info;
+
+    uint8_t payload[stetho::STREAM_INFO_SIZE];
+    size_t len = stetho::serializeStreamInfo(info, payload);
+    pStreamInfoCharacteristic->setValue(payload, len);
+    if (changed) pStreamInfoCharacteristic->notify();
+}
+
 //================================================================
-// --- OTIMIZAÇÃO 3: TAREFA DEDICADA PARA STREAMING DE ÁUDIO ---
+// --- OTIMIZAÇÃO 3: TAREFAS DEDICADAS PARA CAPTURA E ENVIO ---
 //================================================================
-void audioStreamingTask(void *pvParameters) {
-    Serial.println("Tarefa de streaming de áudio iniciada.");
-    
-    // Buffer para amostras brutas
-    int32_t raw_samples[I2S_BUFFER_SAMPLES];
-    // Buffer para amostras processadas prontas para envio
-    int16_t processed_samples[I2S_BUFFER_SAMPLES];
-    size_t bytes_read = 0;
-
-    // --- FILTRO ---
-    // Variável estática para guardar o último valor do filtro
-    // Usamos float para manter a precisão da matemática do filtro
-    static float filtered_value = 0.0f; 
-    // --- FIM FILTRO ---
+// Callback do driver (ISR) a cada buffer de DMA cheio: só repassa o ponteiro.
+// Se a captura não deu conta dos anteriores, o buffer é perdido e contado.
+static bool IRAM_ATTR onI2sReceive(i2s_chan_handle_t, i2s_event_data_t *event, void *) {
+    static uint32_t frame_counter = 0;
+    DmaBlock block;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0)
+    block.words = (int32_t*)event->dma_buf;
+#else
+    block.words = *(int32_t**)event->data;
+#endif
+    block.count = (uint16_t)(event->size / (sizeof(int32_t) * CAPTURE_CHANNELS));
+    block.first_frame = frame_counter;
+    block.timestamp_us = (uint32_t)(esp_timer_get_time() - (int64_t)block.count * 1000000 / I2S_SAMPLE_RATE);
+    frame_counter += block.count;
+
+    BaseType_t woken = pdFALSE;
+    if (xQueueSendFromISR(dmaQueue, &block, &woken) != pdTRUE) dmaOverruns.add();
+    return woken == pdTRUE;
+}
+
+// Produtor (Core 1): DSP sobre os buffers do DMA, nunca espera pelo BLE. Se a
+// fila estiver cheia o bloco é descartado e contado como overflow. A captura
+// roda mesmo sem conexão, alimentando o histórico pré-gatilho.
+//
+// Zero cópia até a fila: o filtro escreve o int16 direto na entrada do FIR
+// do decimador e a decimação escreve direto no slot da fila (a 20 kHz o
+// filtro já escreve no slot). A única cópia do caminho é a montagem do
+// pacote pelo empacotador.
+void audioCaptureTask(void *) {
+    Serial.println("Tarefa de captura de áudio iniciada.");
+
+    // Destino sem conexão ou com a fila cheia (só vai para o histórico)
+    int16_t history_samples[CAPTURE_CHANNELS * (I2S_BUFFER_SAMPLES + 1)];
+    // O bloco na escala fixa, para o histórico e as features, quando o stream tem expoente
+    int16_t fixed_samples[I2S_BUFFER_SAMPLES + 1];
+#if CAPTURE_CHANNELS == 2
+    int16_t reference_samples[I2S_BUFFER_SAMPLES + 1];
+#endif
+    // Índice da próxima amostra do stream; avança também nos blocos descartados
+    uint32_t sample_index = 0;
+    uint32_t next_frame = 0;
+    uint32_t history_rate_hz = 0;
+    uint32_t features_rate_hz = 0;
+    size_t channels = 1;
 
     while (true) { // Loop infinito da tarefa
-        if (deviceConnected) {
-            // 1. LER UM BLOCO DE DADOS DO MICROFONE
-            esp_err_t result = i2s_read(I2S_PORT, &raw_samples, sizeof(raw_samples), &bytes_read, portMAX_DELAY);
-
-            if (result == ESP_OK && bytes_read > 0) {
-                int samples_read = bytes_read / sizeof(int32_t);
-
-                // 2. PROCESSAR OS DADOS (AGORA COM FILTRO)
-                for (int i = 0; i < samples_read; i++) {
-                    
-                    // --- FILTRO ---
-                    // Aplica o filtro IIR de primeira ordem
-                    // y[n] = a * x[n] + (1 - a) * y[n-1]
-                    // Onde 'a' é FILTER_ALPHA, x[n] é a amostra atual, y[n-1] é o último valor filtrado
-                    
-                    // Convertemos a amostra bruta para float para o cálculo
-                    float current_sample = (float)raw_samples[i]; 
-                    
-                    // Aplica a fórmula do filtro
-                    filtered_value = (FILTER_ALPHA * current_sample) + ((1.0f - FILTER_ALPHA) * filtered_value);
-                    // --- FIM FILTRO ---
-
-
-                    // 3. CONVERTER PARA 16-BIT APÓS O FILTRO
-                    // Nós convertemos o 'filtered_value' (que é float) de volta
-                    // para int32_t antes de fazer o shift.
-                    processed_samples[i] = (int16_t)((int32_t)filtered_value >> 14);
+        // 1. ESPERAR O PRÓXIMO BUFFER DO DMA
+        DmaBlock dma;
+        uint32_t wait_start = stetho::cycleCount();
+        BaseType_t got = xQueueReceive(dmaQueue, &dma, portMAX_DELAY);
+        uint32_t dsp_start = stetho::cycleCount();
+        i2sWaitStats.record(dsp_start - wait_start);
+
+        if (got == pdTRUE && dma.count > 0) {
+            int samples_read = dma.count;
+            if (captureRestarted.exchange(false)) {
+                history_rate_hz = 0;
+                features_rate_hz = 0;
+                sampleClock.reset(); // o tempo saltou com o índice contínuo
+            }
+            // Relógio da amostragem: uma janela fechada por segundo atualiza a medida
+            if (sampleClock.update(dma.first_frame, dma.timestamp_us)) {
+                measuredRateMilliHz.store(sampleClock.rateMilliHz());
+                clockOffsetUs.store(sampleClock.offsetUs());
+            }
+            uint32_t timestamp_us = sampleClock.timestampUs(dma.first_frame, dma.timestamp_us);
+            // Buffers perdidos na ISR viram um salto de índice na taxa de saída
+            if (dma.first_frame != next_frame) {
+                sample_index += (uint32_t)((uint64_t)(dma.first_frame - next_frame) * decimator.rateHz() / I2S_SAMPLE_RATE *
+                                           channels);
+            }
+            next_frame = dma.first_frame + dma.count;
+
+            // 2. FILTRAR E DECIMAR DIRETO NO SLOT DA FILA
+            AudioBlock *block = linkConnected() ? audioRing.beginWrite() : nullptr;
+            int16_t *dst = block ? block->samples : history_samples;
+            size_t samples_out = capture.process(dma.words, dst, samples_read);
+            int gain_exp = capture.scaling().gainExp();
+            size_t block_channels = 1;
+#if CAPTURE_CHANNELS == 2
+            // 2.1 MICROFONE DE FORA: sempre pelo mesmo caminho, no stream só
+            // no modo intercalado (peito sem o cancelador, escala fixa)
+            referenceCapture.requestMode(capture.mode());
+            referenceDecimator.requestRate(decimator.rate());
+            size_t reference_out = referenceCapture.process(capture.conditioning().reference(), reference_samples,
+                                                            samples_read);
+            if (capture.conditioning().mode() == stetho::StereoMode::Interleaved) {
+                if (gain_exp != 0) {
+                    stetho::toFixedScale(dst, dst, samples_out, gain_exp);
+                    gain_exp = 0;
                 }
+                if (reference_out < samples_out) samples_out = reference_out;
+                stetho::interleavePairs(dst, reference_samples, samples_out);
+                samples_out *= 2;
+                block_channels = 2;
+            }
+#endif
+            if (block_channels != channels) {
+                channels = block_channels;
+                streamChannels.store((uint8_t)channels);
+            }
+            const int16_t *fixed = dst;
+            if (gain_exp != 0) {
+                stetho::toFixedScale(dst, fixed_samples, samples_out, gain_exp);
+                fixed = fixed_samples;
+            }
+
+            // 3. GUARDAR NO HISTÓRICO (antes de entregar: a tarefa de envio usa isso na passagem)
+            if (history) {
+                // Amostras numa taxa ou com canais antigos não combinam com o stream novo
+                if (streamRateHz() != history_rate_hz) {
+                    history_rate_hz = streamRateHz();
+                    history->clear();
+                    history->setSampleRate(history_rate_hz);
+                }
+                history->write(fixed, samples_out, sample_index, timestamp_us);
+            }
 
-                // 4. ENVIAR OS DADOS PROCESSADOS VIA BLE
-                pCharacteristic->setValue((uint8_t*)processed_samples, samples_read * sizeof(int16_t));
-                pCharacteristic->notify();
+            // 3.1 FEATURES CARDÍACAS (custo fixo por bloco; relatório a cada 250 ms).
+            // Param no modo intercalado, cujos índices contam os dois canais.
+            if (channels == 1) {
+                if (decimator.rateHz() != features_rate_hz) {
+                    features_rate_hz = decimator.rateHz();
+                    heartFeatures.configure(features_rate_hz);
+                }
+                heartFeatures.process(fixed, samples_out, sample_index, timestamp_us);
+                stetho::HeartFeatures report;
+                if (heartFeatures.poll(report) && linkConnected()) {
+                    stetho::HeartFeatures *slot = featureRing.beginWrite();
+                    if (slot) {
+                        *slot = report;
+                        featureRing.commitWrite();
+                    }
+                }
+            } else {
+                features_rate_hz = 0; // recomeça ao voltar para um canal
             }
-        } else {
-            // Se não estiver conectado, aguarda um pouco
-            vTaskDelay(pdMS_TO_TICKS(100));
+
+            // 4. ENTREGAR O BLOCO PARA A TAREFA DE ENVIO
+            if (block && samples_out > 0) {
+                block->count = (uint16_t)samples_out;
+                block->first_sample = sample_index;
+                block->timestamp_us = timestamp_us;
+                block->gain_exp = (int8_t)gain_exp;
+                block->channels = (uint8_t)channels;
+                audioRing.commitWrite();
+                xTaskNotifyGive(notifyTaskHandle);
+            }
+            sample_index += samples_out;
+            samplesRead.add(samples_read);
+
+            uint32_t dsp_cycles = stetho::cycleCount() - dsp_start;
+            dspStats.record(dsp_cycles);
+#if STATS_SERIAL_TRACE
+            stetho::TraceRecord *rec = traceRing.beginWrite();
+            if (rec) {
+                *rec = {(uint8_t)stetho::Stage::I2sWait, wait_start, dsp_start - wait_start};
+                traceRing.commitWrite();
+            }
+            rec = traceRing.beginWrite();
+            if (rec) {
+                *rec = {(uint8_t)stetho::Stage::Dsp, dsp_start, dsp_cycles};
+                traceRing.commitWrite();
+            }
+#endif
         }
     }
 }
 
+// Envia uma notificação já montada pelo empacotador direto do buffer do
+// pacote; a pilha BLE faz a única cópia que falta
+static void sendPacket(const uint8_t *packet, size_t len) {
+    if (!pAudioCccd->getNotifications() || gattsIf.load() == ESP_GATT_IF_NONE) return;
+    stetho::StageTimer timer(notifyStats);
+    esp_err_t err = esp_ble_gatts_send_indicate(gattsIf.load(), connId.load(), pCharacteristic->getHandle(),
+                                                len, (uint8_t*)packet, false);
+    if (err != ESP_OK) notifyFailures.add();
+    else connectLatency.firstSample(esp_timer_get_time());
+}
+
+static void publishPacketizerStats() {
+    const stetho::PacketizerStats &ps = packetizer.stats();
+    packetsSent.store(ps.packets, std::memory_order_relaxed);
+    packetEfficiencyPermille.store(ps.capacity_bytes ? (uint16_t)(ps.payload_bytes * 1000 / ps.capacity_bytes) : 0,
+                                   std::memory_order_relaxed);
+}
+
+// Esvazia o empacotador se MTU, codec ou enquadramento mudaram e aplica a configuração atual
+static void configurePacketizer(uint8_t *packet) {
+    stetho::StreamCodec codec = (stetho::StreamCodec)streamCodec.load();
+    uint16_t mtu = negotiatedMtu.load();
+    bool framed = framingEnabled.load();
+    size_t packet_len = 0;
+    if (mtu != packetizer.mtu() || codec != packetizer.codec() || framed != packetizer.framed()) {
+        while (packetizer.flush(packet, packet_len)) sendPacket(packet, packet_len);
+        publishPacketizerStats();
+    }
+    packetizer.configure(mtu, codec, framed, streamRateHz());
+}
+
+static void sendReadyPackets(uint8_t *packet) {
+    size_t packet_len = 0;
+    while (packetizer.nextPacket(packet, packet_len)) sendPacket(packet, packet_len);
+    publishPacketizerStats();
+}
+
+// Relatórios de features pendentes; eventos que não cabem no MTU ficam de fora
+static void sendFeatureReports() {
+    uint8_t payload[stetho::HEART_FEATURES_MAX_SIZE];
+    const stetho::HeartFeatures *report;
+    while ((report = featureRing.beginRead()) != nullptr) {
+        size_t len = stetho::serializeHeartFeatures(*report, payload,
+                                                    negotiatedMtu.load() - stetho::Packetizer::ATT_OVERHEAD);
+        featureRing.commitRead();
+        pFeatureCharacteristic->setValue(payload, len);
+        pFeatureCharacteristic->notify();
+    }
+}
+
+// Aplica a configuração do espectrograma pedida pelo app; devolve se está ligado
+static bool configureSpectrogram() {
+    static uint8_t applied = 0;
+    uint8_t value = spectrogramConfig.load();
+    if (value != applied) {
+        stetho::SpectrogramConfig config;
+        stetho::decodeSpectrogramConfig(value, config);
+        if (config.enabled) spectrogram.configure(config.log2n, config.overlap);
+        applied = value;
+    }
+    return applied != 0;
+}
+
+// Passa um bloco ao vivo pelo espectrograma e notifica cada quadro que fechar
+static void feedSpectrogram(const int16_t *samples, size_t count, uint32_t first_sample, uint8_t *packet) {
+    while (count > 0) {
+        size_t used = spectrogram.feed(samples, count, first_sample);
+        samples += used;
+        count -= used;
+        first_sample += (uint32_t)used;
+        if (spectrogram.hasFrame()) {
+            size_t len = spectrogram.takeFrame(packet, negotiatedMtu.load() - stetho::Packetizer::ATT_OVERHEAD);
+            pSpectrogramCharacteristic->setValue(packet, len);
+            pSpectrogramCharacteristic->notify();
+        }
+    }
+}
+
+// Reconfigura a prévia quando a taxa pedida, a taxa de saída ou o MTU mudam;
+// devolve se está ligada
+static bool configurePreview() {
+    static uint8_t applied = 0;
+    static uint32_t applied_rate = 0;
+    static size_t applied_pairs = 0;
+    uint8_t value = previewConfig.load();
+    if (value == 0) {
+        applied = 0;
+        return false;
+    }
+    uint32_t rate = decimator.rateHz();
+    size_t pairs = (negotiatedMtu.load() - stetho::Packetizer::ATT_OVERHEAD - stetho::PREVIEW_HEADER) /
+                   stetho::PREVIEW_PAIR_BYTES;
+    if (pairs > PREVIEW_PAIRS_PER_PACKET) pairs = PREVIEW_PAIRS_PER_PACKET;
+    if (value != applied || rate != applied_rate || pairs != applied_pairs) {
+        preview.configure(rate / stetho::previewPairsPerSecond(value), pairs);
+        applied = value;
+        applied_rate = rate;
+        applied_pairs = pairs;
+    }
+    return true;
+}
+
+// Passa um bloco ao vivo pela prévia e notifica cada pacote de pares que fechar
+static void feedPreview(const int16_t *samples, size_t count, uint32_t first_sample, uint8_t *packet) {
+    while (count > 0) {
+        size_t used = preview.feed(samples, count, first_sample);
+        samples += used;
+        count -= used;
+        first_sample += (uint32_t)used;
+        if (preview.hasPacket()) {
+            size_t len = preview.takePacket(packet);
+            pPreviewCharacteristic->setValue(packet, len);
+            pPreviewCharacteristic->notify();
+        }
+    }
+}
+
+// Consumidor (Core 0, junto da pilha BLE): empacota e notifica os blocos da fila.
+// Logo após conectar, manda antes o histórico pré-gatilho em rajada.
+void bleNotifyTask(void *) {
+    Serial.println("Tarefa de envio BLE iniciada.");
+
+    // Uma notificação: cabeçalho opcional + áudio codificado, até MTU - 3 bytes
+    uint8_t packet[stetho::Packetizer::MAX_PAYLOAD];
+    // Bloco na escala fixa para o espectrograma e a prévia
+    int16_t fixed_samples[I2S_BUFFER_SAMPLES + 1];
+    uint32_t connection = connectionCount.load();
+
+    stetho::BackfillCursor backfill;
+    stetho::HistoryRing::Chunk chunk;
+    int64_t burst_start_us = 0;
+    uint64_t burst_samples = 0;
+
+    while (true) {
+        // Dorme até o produtor avisar que há blocos novos (a rajada não espera)
+        if (!backfill.active()) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Nova conexão: o que sobrou da anterior não interessa ao app novo
+        if (connectionCount.load() != connection) {
+            connection = connectionCount.load();
+            packetizer.reset();
+            if (history) {
+                backfill.start(*history);
+                burst_start_us = esp_timer_get_time();
+                burst_samples = 0;
+            }
+        }
+        backfillActive.store(backfill.active());
+        configurePacketizer(packet);
+        updateStreamInfo();
+        sendFeatureReports();
+        bool spectrogramOn = configureSpectrogram();
+        bool previewOn = configurePreview();
+
+        AudioBlock *block;
+        if (backfill.active()) {
+            // RAJADA: um bloco do histórico por volta, no máximo BACKFILL_SPEEDUP x o tempo real
+            if (backfill.next(*history, chunk)) {
+                packetizer.push(chunk.samples, chunk.count, chunk.first_sample, chunk.timestamp_us);
+                sendReadyPackets(packet);
+
+                burst_samples += chunk.count;
+                int64_t due_us = (int64_t)(burst_samples * 1000000 / ((uint64_t)streamRateHz() * BACKFILL_SPEEDUP));
+                int64_t ahead_us = due_us - (esp_timer_get_time() - burst_start_us);
+                if (ahead_us > 0) vTaskDelay(pdMS_TO_TICKS(ahead_us / 1000) + 1);
+            }
+            // Blocos ao vivo que o histórico já cobre saem da fila para ela não encher
+            while ((block = audioRing.beginRead()) != nullptr &&
+                   stetho::BackfillCursor::coveredByHistory(*history, block->first_sample, block->count)) {
+                audioRing.commitRead();
+            }
+            if (backfill.active()) continue;
+            backfillActive.store(false);
+            updateStreamInfo();
+        }
+
+        // AO VIVO: o começo do primeiro bloco pode já ter saído pelo histórico
+        while ((block = audioRing.beginRead()) != nullptr) {
+            // Sem cabeçalho não há onde mandar o expoente: volta à escala fixa
+            if (block->gain_exp != 0 && !packetizer.framed()) {
+                stetho::toFixedScale(block->samples, block->samples, block->count, block->gain_exp);
+                block->gain_exp = 0;
+            }
+            size_t skip = backfill.liveSkip(block->first_sample, block->count);
+            if (skip < block->count) {
+                uint32_t ts = block->timestamp_us + (uint32_t)((uint64_t)skip * 1000000 / streamRateHz());
+                packetizer.push(block->samples + skip, block->count - skip, block->first_sample + skip, ts,
+                                block->gain_exp);
+            }
+            sendReadyPackets(packet);
+            // Só o stream ao vivo de um canal; um salto de índice reinicia a janela
+            if ((spectrogramOn || previewOn) && block->channels == 1) {
+                const int16_t *samples = block->samples;
+                if (block->gain_exp != 0) {
+                    stetho::toFixedScale(block->samples, fixed_samples, block->count, block->gain_exp);
+                    samples = fixed_samples;
+                }
+                if (spectrogramOn) feedSpectrogram(samples, block->count, block->first_sample, packet);
+                if (previewOn) feedPreview(samples, block->count, block->first_sample, packet);
+            }
+            audioRing.commitRead();
+        }
+    }
+}
+
+//================================================================
+// --- OTIMIZAÇÃO 10: GRAVAÇÃO NA FLASH E TRANSFERÊNCIA EM MASSA ---
+//================================================================
+// Core 0, prioridade baixa. A gravação segue o histórico pré-gatilho (o mesmo
+// stream já decimado), então a captura não ganha nenhum trabalho novo e a
+// escrita na flash, que pode travar por dezenas de ms, nunca atrasa o I2S.
+// Se a tarefa atrasar mais que o histórico inteiro, o trecho perdido vira
+// um salto de índice no arquivo. Tudo que toca o LittleFS roda aqui, então
+// não há trava.
+static uint16_t nextRecordingId() {
+    uint16_t ids[stetho::BULK_MAX_RECORDINGS];
+    size_t n = stetho::listRecordings(flashStorage, ids, stetho::BULK_MAX_RECORDINGS);
+    return n > 0 ? (uint16_t)(ids[n - 1] + 1) : 1;
+}
+
+void storageTask(void *) {
+    Serial.println("Tarefa de armazenamento iniciada.");
+
+    static stetho::RecordingWriter writer(flashStorage);
+    static stetho::BulkSender sender(flashStorage);
+    static stetho::HistoryRing::Chunk chunk;
+    uint8_t packet[stetho::Packetizer::MAX_PAYLOAD];
+    uint16_t recording_id = 0;
+    uint32_t recording_rate_hz = 0;
+    uint8_t recording_channels = 0;
+    uint64_t cursor = 0;
+    uint32_t lost_chunks = 0;
+    uint32_t bulk_dequeued = 0;
+    uint32_t bulk_refused = 0;
+    bool was_connected = false;
+
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(STORAGE_TASK_PERIOD_MS));
+
+        // 1. INICIAR / PARAR A GRAVAÇÃO (nova gravação também quando a taxa ou os canais mudam)
+        bool want = recordingRequested.load() && history != nullptr;
+        if (writer.isOpen() &&
+            (!want || decimator.rateHz() != recording_rate_hz || streamChannels.load() != recording_channels)) {
+            writer.end();
+            Serial.printf("Gravação %u encerrada: %u blocos, %u bytes, %u perdidos\n", recording_id,
+                          writer.stats().chunks, (unsigned)writer.stats().bytes, lost_chunks);
+        }
+        if (want && !writer.isOpen()) {
+            stetho::RecordingHeader header;
+            header.codec = stetho::StreamCodec::Rice;
+            header.filter_mode = (uint8_t)capture.mode();
+            header.sample_rate_hz = decimator.rateHz();
+            header.channels = streamChannels.load();
+            recording_id = nextRecordingId();
+            if (writer.begin(recording_id, header)) {
+                recording_rate_hz = header.sample_rate_hz;
+                recording_channels = header.channels;
+                cursor = history->newest();
+                lost_chunks = 0;
+                Serial.printf("Gravação %u iniciada\n", recording_id);
+            } else {
+                recordingRequested.store(false);
+                Serial.println("Falha ao criar a gravação na flash");
+            }
+        }
+        if (writer.isOpen() != recordingActive.load()) {
+            recordingActive.store(writer.isOpen());
+            signalPowerTask();
+        }
+        // A tarefa de envio publica o flag no StreamInfo no próximo bloco
+        sender.setActiveRecording(writer.isOpen(), recording_id);
+
+        // 2. COPIAR DO HISTÓRICO PARA A FLASH
+        if (writer.isOpen()) {
+            uint64_t oldest = history->oldest();
+            if (cursor < oldest) {
+                lost_chunks += (uint32_t)(oldest - cursor);
+                cursor = oldest;
+            }
+            for (; cursor < history->newest(); cursor++) {
+                if (history->read(cursor, chunk)) writer.write(chunk.samples, chunk.count, chunk.first_sample, chunk.timestamp_us);
+                else lost_chunks++;
+            }
+            if (!writer.isOpen()) {
+                // Append falhou (flash cheia): a gravação fecha sozinha
+                recordingRequested.store(false);
+                Serial.println("Gravação interrompida: erro de escrita na flash");
+            }
+        }
+
+        // 3. TRANSFERÊNCIA EM MASSA
+        if (!linkConnected()) {
+            if (was_connected) {
+                // Conexão caiu: aborta e descarta o que o central deixou na fila
+                sender.request(nullptr, 0);
+                while (bulkRequests.beginRead() != nullptr) {
+                    bulkRequests.commitRead();
+                    bulk_dequeued++;
+                }
+                bulkAbortRequested.store(false, std::memory_order_relaxed);
+                bulk_refused = bulkRequests.overflowCount();
+            }
+            was_connected = false;
+            // Sem gravação, nada a fazer até a próxima conexão (SetRecording só
+            // chega com um central): dorme no event group em vez de acordar a cada 20 ms
+            if (!writer.isOpen() && !recordingRequested.load()) {
+                xEventGroupWaitBits(linkEvents, LINK_CONNECTED_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+            }
+            continue;
+        }
+        was_connected = true;
+        if (bulkAbortRequested.exchange(false, std::memory_order_acquire)) {
+            // Os pedidos anteriores ao ABORT são descartados sem resposta
+            const uint32_t queued = bulkAbortQueued.load(std::memory_order_relaxed);
+            while ((int32_t)(queued - bulk_dequeued) > 0 && bulkRequests.beginRead() != nullptr) {
+                bulkRequests.commitRead();
+                bulk_dequeued++;
+            }
+            const uint8_t abort[] = {(uint8_t)stetho::BulkRequest::Abort};
+            sender.request(abort, sizeof(abort));
+        } else if (const BulkRequestMsg *msg = bulkRequests.beginRead()) {
+            sender.request(msg->data, msg->len);
+            bulkRequests.commitRead();
+            bulk_dequeued++;
+        }
+        // Um BUSY por pedido recusado com a fila cheia
+        const uint32_t refused = bulkRequests.overflowCount();
+        if (refused != bulk_refused) {
+            bulk_refused++;
+            const size_t len = stetho::encodeBulkStatus(packet, 0, stetho::BulkStatus::Busy);
+            pBulkCharacteristic->setValue(packet, len);
+            pBulkCharacteristic->notify();
+        }
+        size_t capacity = negotiatedMtu.load() - stetho::Packetizer::ATT_OVERHEAD;
+        if (capacity > sizeof(packet)) capacity = sizeof(packet);
+        for (int i = 0; i < BULK_PACKETS_PER_TICK && sender.busy(); i++) {
+            size_t len = sender.next(packet, capacity);
+            if (len == 0) break;
+            pBulkCharacteristic->setValue(packet, len);
+            pBulkCharacteristic->notify();
+        }
+    }
+}
+
+//================================================================
+// --- OTIMIZAÇÃO 20: I2S PARADO E LIGHT SLEEP SEM CENTRAL ---
+//================================================================
+// Core 0, prioridade baixa. Dorme no event group do enlace até uma conexão,
+// desconexão ou mudança da gravação, ou até o fim do Linger (o único prazo
+// da política), e aplica o que core/power_policy.h decidir. Parar o I2S
+// também para o clock do microfone; o índice do stream segue contínuo e a
+// captura recomeça o histórico, que ficou com o áudio de antes da parada.
+void powerTask(void *) {
+    Serial.println("Tarefa de energia iniciada.");
+    stetho::CapturePowerPolicy policy(IDLE_CAPTURE_SECONDS * 1000, millis());
+
+    while (true) {
+        uint32_t wait_ms = policy.msUntilDeadline(millis());
+        TickType_t ticks = wait_ms == stetho::CapturePowerPolicy::NO_DEADLINE ? portMAX_DELAY : pdMS_TO_TICKS(wait_ms) + 1;
+        xEventGroupWaitBits(linkEvents, LINK_CHANGED_BIT, pdTRUE, pdFALSE, ticks);
+
+        uint32_t now_ms = millis();
+        bool recording = recordingRequested.load() || recordingActive.load();
+        switch (policy.update(linkConnected(), recording, now_ms)) {
+        case stetho::PowerAction::StopCapture:
+            i2s_channel_disable(i2sRxHandle);
+            esp_pm_lock_release(capturePmLock);
+            captureIdleSince.store(now_ms);
+            Serial.println("Sem central nem gravação: I2S parado");
+            break;
+        case stetho::PowerAction::StartCapture:
+            esp_pm_lock_acquire(capturePmLock);
+            captureRestarted.store(true);
+            i2s_channel_enable(i2sRxHandle);
+            Serial.printf("I2S religado após %u ms parado\n", (unsigned)(now_ms - captureIdleSince.load()));
+            break;
+        case stetho::PowerAction::None:
+            break;
+        }
+        if (policy.state() != stetho::PowerState::Idle) captureIdleMs.store((uint32_t)policy.idleMs(now_ms));
+        captureStops.store(policy.stops());
+        powerState.store((uint8_t)policy.state());
+    }
+}
+
+// Locks e frequências do gerenciador de energia: a captura segura a CPU no
+// máximo enquanto roda, e sem ela o chip pode dormir entre os eventos BLE
+static void setupPowerManagement() {
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "captura", &capturePmLock);
+    esp_pm_lock_acquire(capturePmLock); // a captura começa ligada
+
+    esp_pm_config_t pm_config = {};
+    pm_config.max_freq_mhz = (int)getCpuFrequencyMhz();
+    pm_config.min_freq_mhz = PM_MIN_CPU_MHZ;
+    pm_config.light_sleep_enable = true;
+    esp_err_t err = esp_pm_configure(&pm_config);
+    if (err != ESP_OK) Serial.printf("Gerenciador de energia indisponível (erro 0x%x): só o I2S para sem conexão\n", err);
+}
+
+void setupStorage() {
+    if (!LittleFS.begin(true)) {
+        Serial.println("Falha ao montar o LittleFS; gravação na flash desativada");
+        return;
+    }
+    LittleFS.mkdir(stetho::RECORDING_DIR);
+    flashMounted = true;
+
+    // Gravações interrompidas por falta de energia: corta o final rasgado e refaz o índice
+    uint16_t ids[stetho::BULK_MAX_RECORDINGS];
+    size_t n = stetho::listRecordings(flashStorage, ids, stetho::BULK_MAX_RECORDINGS);
+    for (size_t i = 0; i < n; i++) {
+        stetho::RecoveryResult r = stetho::recoverRecording(flashStorage, ids[i]);
+        if (r.truncated_bytes > 0 || r.index_rebuilt) {
+            Serial.printf("Gravação %u recuperada: %u blocos, %u bytes cortados\n",
+                          ids[i], r.chunks, r.truncated_bytes);
+        }
+    }
+    Serial.printf("LittleFS: %u gravações, %u/%u bytes usados\n", (unsigned)n,
+                  (unsigned)LittleFS.usedBytes(), (unsigned)LittleFS.totalBytes());
+}
+
 
 void setupI2S() {
     Serial.println("Configurando I2S...");
-    i2s_config_t i2s_config = {
-        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
-        .sample_rate = I2S_SAMPLE_RATE,
-        .bits_per_sample = I2S_SAMPLE_BITS,
-        .channel_format = I2S_CHANNEL_FMT,
-        .communication_format = I2S_COMM_FORMAT_STAND_I2S,
-        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 8,
-        .dma_buf_len = 256, // Ajuste para acomodar o novo tamanho de buffer
-        .use_apll = false
-    };
+    dmaQueue = xQueueCreate(I2S_DMA_BUFFERS - 2, sizeof(DmaBlock));
+
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_PORT, I2S_ROLE_MASTER);
+    chan_cfg.dma_desc_num = I2S_DMA_BUFFERS;
+    chan_cfg.dma_frame_num = I2S_BUFFER_SAMPLES;
+    i2s_new_channel(&chan_cfg, NULL, &i2sRxHandle);
 
-    i2s_pin_config_t pin_config = {
-        .bck_io_num = I2S_SCK_PIN,
-        .ws_io_num = I2S_WS_PIN,
-        .data_out_num = I2S_PIN_NO_CHANGE,
-        .data_in_num = I2S_SD_PIN
+    // INMP441: palavra de 32 bits com 24 úteis; o peito no canal esquerdo e,
+    // com dois microfones, o de fora no direito (quadros L/R no DMA)
+    i2s_std_config_t std_cfg = {
+        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(I2S_SAMPLE_RATE),
+        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_32BIT,
+                                                        CAPTURE_CHANNELS == 2 ? I2S_SLOT_MODE_STEREO : I2S_SLOT_MODE_MONO),
+        .gpio_cfg = {
+            .mclk = I2S_GPIO_UNUSED,
+            .bclk = (gpio_num_t)I2S_SCK_PIN,
+            .ws = (gpio_num_t)I2S_WS_PIN,
+            .dout = I2S_GPIO_UNUSED,
+            .din = (gpio_num_t)I2S_SD_PIN,
+            .invert_flags = {
+                .mclk_inv = false,
+                .bclk_inv = false,
+                .ws_inv = false,
+            },
+        },
     };
+    std_cfg.slot_cfg.slot_mask = CAPTURE_CHANNELS == 2 ? I2S_STD_SLOT_BOTH : I2S_STD_SLOT_LEFT;
+#if I2S_USE_APLL
+    std_cfg.clk_cfg.clk_src = I2S_CLK_SRC_APLL;
+#endif
+    i2s_channel_init_std_mode(i2sRxHandle, &std_cfg);
 
-    i2s_driver_install(I2S_PORT, &i2s_config, 0, NULL);
-    i2s_set_pin(I2S_PORT, &pin_config);
+    i2s_event_callbacks_t callbacks = {};
+    callbacks.on_recv = onI2sReceive;
+    i2s_channel_register_event_callback(i2sRxHandle, &callbacks, NULL);
+    i2s_channel_enable(i2sRxHandle);
     Serial.println("Driver I2S configurado com sucesso.");
 }
 
@@ -146,23 +1225,95 @@ void setup() {
     Serial.begin(115200);
     Serial.println("Iniciando o dispositivo...");
 
+    // Antes do BLE: os callbacks de conexão escrevem nele
+    linkEvents = xEventGroupCreate();
+    setupPowerManagement();
     setupI2S();
+    setupStorage();
+#if CAPTURE_CHANNELS == 2
+    capture.conditioning().requestMode((stetho::StereoMode)stereoMode.load());
+#endif
+    applyScalingMode();
+
+    // Histórico pré-gatilho: Pcm16 na PSRAM se houver, senão ADPCM (4:1) na RAM interna
+    stetho::HistoryFormat history_format = stetho::HistoryFormat::Pcm16;
+    size_t history_bytes = stetho::HistoryRing::bytesFor(PRETRIGGER_SECONDS, I2S_SAMPLE_RATE, history_format);
+    uint8_t *history_mem = (uint8_t*)heap_caps_malloc(history_bytes, MALLOC_CAP_SPIRAM);
+    if (!history_mem) {
+        history_format = stetho::HistoryFormat::ImaAdpcm;
+        history_bytes = stetho::HistoryRing::bytesFor(PRETRIGGER_SECONDS, I2S_SAMPLE_RATE, history_format);
+        history_mem = (uint8_t*)heap_caps_malloc(history_bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (history_mem) {
+        history = new stetho::HistoryRing(history_mem, history_bytes, history_format);
+        Serial.printf("Histórico pré-gatilho: %u bytes (%s)\n", (unsigned)history_bytes,
+                      history_format == stetho::HistoryFormat::Pcm16 ? "PSRAM, Pcm16" : "RAM interna, ADPCM");
+    } else {
+        Serial.println("Sem memória para o histórico pré-gatilho");
+    }
 
     BLEDevice::init("ESP32_Audio_Stream");
     // Opcional: Define o MTU que o ESP32 pode suportar. A negociação final é iniciada pelo cliente.
     BLEDevice::setMTU(517); 
     
+    BLEDevice::setCustomGattsHandler(gattsEventHandler);
     pServer = BLEDevice::createServer();
     pServer->setCallbacks(new MyServerCallbacks());
 
-    BLEService *pService = pServer->createService(SERVICE_UUID);
+    // 15 handles (o padrão) já não bastam para oito características com descritor
+    BLEService *pService = pServer->createService(BLEUUID(SERVICE_UUID), 32);
 
     pCharacteristic = pService->createCharacteristic(
                           CHARACTERISTIC_UUID,
                           BLECharacteristic::PROPERTY_NOTIFY
                       );
     
-    pCharacteristic->addDescriptor(new BLE2902());
+    pAudioCccd = new BLE2902();
+    pCharacteristic->addDescriptor(pAudioCccd);
+
+    pControlCharacteristic = pService->createCharacteristic(
+                          CONTROL_CHARACTERISTIC_UUID,
+                          BLECharacteristic::PROPERTY_WRITE
+                      );
+    pControlCharacteristic->setCallbacks(new ControlCallbacks());
+
+    pStreamInfoCharacteristic = pService->createCharacteristic(
+                          STREAM_INFO_CHARACTERISTIC_UUID,
+                          BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY
+                      );
+    pStreamInfoCharacteristic->addDescriptor(new BLE2902());
+
+    pBulkCharacteristic = pService->createCharacteristic(
+                          BULK_CHARACTERISTIC_UUID,
+                          BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_NOTIFY
+                      );
+    pBulkCharacteristic->addDescriptor(new BLE2902());
+    pBulkCharacteristic->setCallbacks(new BulkCallbacks());
+
+    pFeatureCharacteristic = pService->createCharacteristic(
+                          FEATURES_CHARACTERISTIC_UUID,
+                          BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY
+                      );
+    pFeatureCharacteristic->addDescriptor(new BLE2902());
+
+    pSpectrogramCharacteristic = pService->createCharacteristic(
+                          SPECTROGRAM_CHARACTERISTIC_UUID,
+                          BLECharacteristic::PROPERTY_NOTIFY
+                      );
+    pSpectrogramCharacteristic->addDescriptor(new BLE2902());
+
+    pPreviewCharacteristic = pService->createCharacteristic(
+                          PREVIEW_CHARACTERISTIC_UUID,
+                          BLECharacteristic::PROPERTY_NOTIFY
+                      );
+    pPreviewCharacteristic->addDescriptor(new BLE2902());
+
+    pDiagnosticsCharacteristic = pService->createCharacteristic(
+                          DIAGNOSTICS_CHARACTERISTIC_UUID,
+                          BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY
+                      );
+    pDiagnosticsCharacteristic->addDescriptor(new BLE2902());
+    updateStreamInfo(true);
     pService->start();
 
     BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
@@ -175,22 +1326,123 @@ void setup() {
     
     Serial.println("Servidor BLE iniciado. Aguardando conexões...");
 
-    // Inicia a tarefa dedicada para o áudio no Core 1, deixando o Core 0 para WiFi/BLE
+    // Tarefa de envio no Core 0, junto da pilha BLE
     xTaskCreatePinnedToCore(
-        audioStreamingTask,    // Função da tarefa
-        "AudioStreamTask",     // Nome da tarefa
-        10000,                 // Tamanho da pilha
+        bleNotifyTask,         // Função da tarefa
+        "BleNotifyTask",       // Nome da tarefa
+        8192,                  // Tamanho da pilha
         NULL,                  // Parâmetros da tarefa
         1,                     // Prioridade da tarefa
-        NULL,                  // Handle da tarefa
+        &notifyTaskHandle,     // Handle da tarefa (usado pelo produtor)
+        0                      // Core onde a tarefa irá rodar
+    );
+
+    // Tarefa de captura no Core 1, com prioridade maior para nunca atrasar o I2S
+    xTaskCreatePinnedToCore(
+        audioCaptureTask,      // Função da tarefa
+        "AudioCaptureTask",    // Nome da tarefa
+        10000,                 // Tamanho da pilha
+        NULL,                  // Parâmetros da tarefa
+        2,                     // Prioridade da tarefa
+        &captureTaskHandle,    // Handle da tarefa (pilha livre no diagnóstico)
         1                      // Core onde a tarefa irá rodar
     );
+
+    // Gravação e transferência em massa no Core 0, abaixo do envio ao vivo
+    if (flashMounted) {
+        xTaskCreatePinnedToCore(storageTask, "StorageTask", 8192, NULL, 1, &storageTaskHandle, 0);
+    }
+
+    // Parada do I2S e light sleep sem central, também no Core 0
+    xTaskCreatePinnedToCore(powerTask, "PowerTask", 4096, NULL, 1, &powerTaskHandle, 0);
 }
 
+// Monta o bloco de diagnóstico da última janela (só o loop() chama)
+static void publishDiagnostics() {
+    static stetho::StageSnapshot prev[stetho::STAGE_COUNT];
+    static uint32_t prev_samples = 0;
+    static uint32_t prev_ms = 0;
+    stetho::StageStats *stages[stetho::STAGE_COUNT] = {&i2sWaitStats, &dspStats, &notifyStats};
+    TaskHandle_t tasks[3] = {captureTaskHandle, notifyTaskHandle, storageTaskHandle};
+
+    stetho::Diagnostics d;
+    uint32_t now_ms = millis();
+    d.cpu_mhz = (uint16_t)getCpuFrequencyMhz();
+    d.uptime_ms = now_ms;
+    uint32_t samples = samplesRead.load();
+    if (now_ms != prev_ms) d.samples_per_sec = (uint32_t)((uint64_t)(samples - prev_samples) * 1000 / (now_ms - prev_ms));
+    prev_samples = samples;
+    prev_ms = now_ms;
+    for (size_t s = 0; s < stetho::STAGE_COUNT; s++) {
+        stetho::StageSnapshot snap;
+        stages[s]->snapshot(snap);
+        d.stages[s] = stetho::stageWindow(snap, prev[s]);
+        prev[s] = snap;
+    }
+    d.dma_overruns = dmaOverruns.load();
+    d.ring_overflows = audioRing.overflowCount();
+    d.notify_failures = notifyFailures.load();
+    for (size_t t = 0; t < 3; t++) d.stack_free[t] = tasks[t] ? (uint16_t)uxTaskGetStackHighWaterMark(tasks[t]) : 0;
+    d.free_heap = esp_get_free_heap_size();
+    d.min_free_heap = esp_get_minimum_free_heap_size();
+    d.power_state = powerState.load();
+    uint32_t idle_ms = captureIdleMs.load();
+    if (d.power_state == (uint8_t)stetho::PowerState::Idle) idle_ms += now_ms - captureIdleSince.load();
+    d.capture_idle_s = idle_ms / 1000;
+    d.capture_stops = (uint16_t)captureStops.load();
+    d.connect_latency_us = connectLatency.lastUs();
+    d.last_connect_cold = connectLatency.lastCold();
+    d.connect_latency_max_warm_us = connectLatency.maxUs(false);
+    d.connect_latency_max_cold_us = connectLatency.maxUs(true);
+
+    uint8_t payload[stetho::DIAGNOSTICS_SIZE];
+    size_t len = stetho::serializeDiagnostics(d, payload);
+    pDiagnosticsCharacteristic->setValue(payload, len);
+    if (linkConnected()) pDiagnosticsCharacteristic->notify();
+
+#if !STATS_SERIAL_TRACE
+    Serial.printf("Captura: %u amostras/s, espera %u, DSP %u (p99 %u) ciclos/bloco; pilha livre %u/%u/%u bytes\n",
+                  d.samples_per_sec, d.stages[0].avg, d.stages[1].avg, d.stages[1].p99,
+                  d.stack_free[0], d.stack_free[1], d.stack_free[2]);
+    Serial.printf("Overruns DMA %u, notify falhos %u, heap livre %u (mín %u)\n",
+                  d.dma_overruns, d.notify_failures, d.free_heap, d.min_free_heap);
+#endif
+}
+
+#if STATS_SERIAL_TRACE
+// Esvazia o trace binário na serial
+static void drainTrace() {
+    uint8_t record[stetho::TRACE_RECORD_SIZE];
+    const stetho::TraceRecord *rec;
+    while ((rec = traceRing.beginRead()) != nullptr) {
+        stetho::serializeTraceRecord(*rec, record);
+        traceRing.commitRead();
+        Serial.write(record, sizeof(record));
+    }
+}
+#endif
+
 // O loop principal agora está livre. Ele pode ser usado para outras tarefas de baixa prioridade
 // ou simplesmente ficar vazio, já que o trabalho pesado está na tarefa dedicada.
 void loop() {
     // A lógica de reconexão foi movida para o callback onDisconnect
     // O loop pode ser usado para tarefas não críticas, como piscar um LED de status.
-    delay(2000); 
+#if STATS_SERIAL_TRACE
+    // Fatias curtas para o anel do trace não encher entre duas passagens
+    for (int i = 0; i < STATS_PERIOD_MS / 100; i++) {
+        delay(100);
+        drainTrace();
+    }
+#else
+    delay(STATS_PERIOD_MS);
+#endif
+    publishDiagnostics();
+
+    // Ocupação máxima e descartes da fila entre captura e envio
+    if (linkConnected() && !STATS_SERIAL_TRACE) {
+        Serial.printf("Fila: max %u/%u blocos, overflows %u\n",
+                      audioRing.highWaterMark(), (unsigned)audioRing.capacity(), audioRing.overflowCount());
+        Serial.printf("MTU %u: %u pacotes, eficiência %.1f%%\n",
+                      negotiatedMtu.load(), packetsSent.load(), packetEfficiencyPermille.load() / 10.0);
+    }
 }
\ No newline at end of file
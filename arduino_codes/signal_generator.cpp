@@ -0,0 +1,427 @@
+#include <Arduino.h>
+#include <BLEDevice.h>
+#include <BLEServer.h>
+#include <BLEUtils.h>
+#include <BLE2902.h>
+#include <esp_gatts_api.h>
+#include <esp_timer.h>
+#include <atomic>
+
+#include "core/control_protocol.h"
+#include "core/frame.h"
+#include "core/packetizer.h"
+#include "core/signal_generator.h"
+#include "core/stream_format.h"
+
+//================================================================
+// --- FIRMWARE DE BANCADA: GERADOR DE SINAIS E DE CARGA ---
+//================================================================
+// Substitui o antigo sine_wave: o mesmo serviço BLE do firmware principal
+// (áudio, controle e informações do stream), mas com o áudio vindo de
+// core/signal_generator.h em vez do microfone. O ritmo vem do esp_timer e
+// do relógio absoluto (SamplePacer), então a taxa é exatamente 20 kHz por
+// horas e o timestamp de cada quadro é o instante ideal da amostra, o que
+// serve para medir latência no app.
+//
+// Comandos pela serial (115200, uma linha por comando; ver
+// parseGeneratorCommand):
+//
+//   sine 60 10000 | tones 50 120 300 | chirp 20 1000 2 | impulse 500
+//   heart 75 | prbs 1234 | amp 8000 | saturate | paced
+//
+// 'saturate' manda blocos o mais rápido que a pilha BLE aceitar e relata a
+// vazão alcançada a cada segundo; 'paced' volta ao ritmo nominal.
+
+//================================================================
+// --- CONFIGURAÇÕES DE BLE (mesmas do firmware principal) ---
+//================================================================
+#define SERVICE_UUID        "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
+#define CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26a8"
+#define CONTROL_CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26a9" // Escrita: SetCodec e SetFraming
+#define STREAM_INFO_CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26aa" // Leitura: metadados do stream
+
+//================================================================
+// --- PARÂMETROS DE GERAÇÃO ---
+//================================================================
+#define GEN_SAMPLE_RATE    20000   // 20 kHz, a taxa do firmware principal
+#define GEN_BLOCK_SAMPLES  250     // 12,5 ms por despertar do timer
+#define GEN_TIMER_PERIOD_US (1000000LL * GEN_BLOCK_SAMPLES / GEN_SAMPLE_RATE)
+#define REPORT_PERIOD_MS   1000
+
+// Enquadramento e codec começam como no firmware principal; o app liga o
+// enquadramento para conferir índices e timestamps
+#define DEFAULT_FRAMING false
+#define DEFAULT_STREAM_CODEC stetho::StreamCodec::Pcm16
+
+//================================================================
+// --- VARIÁVEIS GLOBAIS ---
+//================================================================
+BLEServer *pServer = nullptr;
+BLECharacteristic *pCharacteristic = nullptr;
+BLECharacteristic *pControlCharacteristic = nullptr;
+BLECharacteristic *pStreamInfoCharacteristic = nullptr;
+BLE2902 *pAudioCccd = nullptr;
+std::atomic<bool> deviceConnected(false);
+std::atomic<uint16_t> negotiatedMtu(stetho::Packetizer::DEFAULT_MTU);
+std::atomic<uint16_t> gattsIf(ESP_GATT_IF_NONE);
+std::atomic<uint16_t> connId(0);
+// A pilha BLE sinaliza quando a fila de notificações enche (ESP_GATTS_CONGEST_EVT)
+std::atomic<bool> linkCongested(false);
+
+std::atomic<uint8_t> streamCodec((uint8_t)DEFAULT_STREAM_CODEC);
+std::atomic<bool> framingEnabled(DEFAULT_FRAMING);
+std::atomic<bool> saturateMode(false);
+
+// Nova configuração vinda da serial; a tarefa de geração aplica na borda do bloco
+stetho::GeneratorConfig pendingConfig;
+std::atomic<bool> configPending(false);
+
+stetho::SignalGenerator generator;
+stetho::Packetizer packetizer;
+TaskHandle_t generatorTaskHandle = nullptr;
+esp_timer_handle_t paceTimer = nullptr;
+
+// Contadores do relatório (escritos só pela tarefa de geração)
+std::atomic<uint32_t> samplesGenerated(0);
+std::atomic<uint32_t> samplesSent(0);
+std::atomic<uint32_t> bytesSent(0);
+std::atomic<uint32_t> packetsSent(0);
+std::atomic<uint32_t> sendFailures(0);
+
+//================================================================
+// --- CALLBACKS DE CONEXÃO BLE ---
+//================================================================
+class MyServerCallbacks: public BLEServerCallbacks {
+    void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t *param) override {
+      negotiatedMtu.store(stetho::Packetizer::DEFAULT_MTU);
+      connId.store(param->connect.conn_id);
+      linkCongested.store(false);
+      deviceConnected.store(true);
+      Serial.println("Dispositivo conectado.");
+    }
+
+    void onDisconnect(BLEServer* pServer) override {
+      deviceConnected.store(false);
+      linkCongested.store(false);
+      Serial.println("Dispositivo desconectado.");
+      BLEDevice::startAdvertising();
+    }
+
+    void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) override {
+      negotiatedMtu.store(param->mtu.mtu);
+      Serial.printf("MTU alterado para: %d\n", param->mtu.mtu);
+    }
+};
+
+static void gattsEventHandler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param) {
+    if (event == ESP_GATTS_CONNECT_EVT) gattsIf.store(gatts_if);
+    if (event == ESP_GATTS_CONGEST_EVT) {
+        linkCongested.store(param->congest.congested);
+        if (!param->congest.congested && generatorTaskHandle) xTaskNotifyGive(generatorTaskHandle);
+    }
+}
+
+// Só os comandos que mudam o formato do stream fazem sentido aqui
+class ControlCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic* pCharacteristic) override {
+      stetho::ControlMessage msg;
+      if (!stetho::parseControlMessage(pCharacteristic->getData(), pCharacteristic->getLength(), msg)) return;
+      switch (msg.command) {
+        case stetho::ControlCommand::SetCodec:
+          if (msg.value < stetho::STREAM_CODEC_COUNT) streamCodec.store(msg.value);
+          break;
+        case stetho::ControlCommand::SetFraming:
+          framingEnabled.store(msg.value != 0);
+          break;
+        default:
+          Serial.printf("Comando %d ignorado pelo gerador\n", (int)msg.command);
+          break;
+      }
+    }
+};
+
+//================================================================
+// --- ENVIO ---
+//================================================================
+
+// Publica codec, enquadramento e amostras por notificação quando mudam
+static void updateStreamInfo(bool force = false) {
+    static stetho::StreamInfo published;
+    stetho::StreamInfo info;
+    info.codec = (stetho::StreamCodec)streamCodec.load();
+    info.flags = framingEnabled.load() ? stetho::STREAM_FLAG_FRAMED : 0;
+    info.sample_rate_hz = GEN_SAMPLE_RATE;
+    size_t per_packet = stetho::Packetizer::fixedSamplesFor(info.codec, packetizer.payloadCapacity());
+    if (per_packet > stetho::Packetizer::MAX_PACKET_SAMPLES) per_packet = stetho::Packetizer::MAX_PACKET_SAMPLES;
+    info.block_samples = info.codec == stetho::StreamCodec::Rice ? 0 : (uint16_t)per_packet;
+    if (!force && info.codec == published.codec && info.flags == published.flags &&
+        info.block_samples == published.block_samples) {
+        return;
+    }
+    published = info;
+    uint8_t payload[stetho::STREAM_INFO_SIZE];
+    size_t len = stetho::serializeStreamInfo(info, payload);
+    pStreamInfoCharacteristic->setValue(payload, len);
+    pStreamInfoCharacteristic->notify();
+}
+
+// No ritmo nominal um pacote recusado é contado e perdido (o receptor vê o
+// buraco pelo índice). No modo saturate o pacote espera a pilha BLE
+// descongestionar, para medir a vazão que o enlace sustenta sem perda.
+static bool sendPacket(const uint8_t *packet, size_t len) {
+    while (deviceConnected.load() && pAudioCccd->getNotifications() && gattsIf.load() != ESP_GATT_IF_NONE) {
+        const bool saturate = saturateMode.load();
+        if (saturate && linkCongested.load()) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(5));
+            continue;
+        }
+        esp_err_t err = esp_ble_gatts_send_indicate(gattsIf.load(), connId.load(), pCharacteristic->getHandle(),
+                                                    len, (uint8_t*)packet, false);
+        if (err == ESP_OK) {
+            packetsSent.fetch_add(1, std::memory_order_relaxed);
+            bytesSent.fetch_add(len, std::memory_order_relaxed);
+            return true;
+        }
+        sendFailures.fetch_add(1, std::memory_order_relaxed);
+        if (!saturate) return false;
+        vTaskDelay(1);
+    }
+    return false;
+}
+
+static void configurePacketizer(uint8_t *packet) {
+    stetho::StreamCodec codec = (stetho::StreamCodec)streamCodec.load();
+    uint16_t mtu = negotiatedMtu.load();
+    bool framed = framingEnabled.load();
+    size_t packet_len = 0;
+    if (mtu != packetizer.mtu() || codec != packetizer.codec() || framed != packetizer.framed()) {
+        while (packetizer.flush(packet, packet_len)) sendPacket(packet, packet_len);
+    }
+    packetizer.configure(mtu, codec, framed, GEN_SAMPLE_RATE);
+}
+
+//================================================================
+// --- TAREFA DE GERAÇÃO ---
+//================================================================
+
+// O timer só acorda a tarefa; quantas amostras gerar vem do SamplePacer
+static void onPaceTimer(void *) {
+    xTaskNotifyGive(generatorTaskHandle);
+}
+
+static void printSignal(const stetho::GeneratorConfig &c, uint32_t first_index) {
+    Serial.printf("Sinal: %s a partir da amostra %u", stetho::signalKindName(c.kind), first_index);
+    if (c.kind == stetho::SignalKind::Prbs) {
+        Serial.printf(" (semente %u; CRC-32 de 1 s a partir daí: 0x%08X)\n", c.seed,
+                      stetho::prbsCrc(c.seed, first_index, GEN_SAMPLE_RATE));
+    } else {
+        Serial.printf(" (amplitude %d)\n", c.amplitude);
+    }
+}
+
+void generatorTask(void *pvParameters) {
+    int16_t block[GEN_BLOCK_SAMPLES];
+    uint8_t packet[stetho::Packetizer::MAX_PAYLOAD];
+    // Índice da próxima amostra do stream: nunca volta, mesmo trocando de sinal
+    uint32_t index = 0;
+    stetho::SamplePacer pacer;
+    uint64_t paced_samples = 0;
+    bool was_saturating = false;
+
+    generator.configure(stetho::GeneratorConfig(), GEN_SAMPLE_RATE, index);
+    packetizer.configure(negotiatedMtu.load(), (stetho::StreamCodec)streamCodec.load(), framingEnabled.load(),
+                         GEN_SAMPLE_RATE);
+    pacer.start(esp_timer_get_time(), GEN_SAMPLE_RATE);
+
+    while (true) {
+        const bool saturate = saturateMode.load();
+        if (saturate) {
+            // Sem esperar o timer: um bloco por volta, limitado só pelo envio
+            ulTaskNotifyTake(pdTRUE, 0);
+            if (!deviceConnected.load()) vTaskDelay(pdMS_TO_TICKS(100));
+        } else {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            if (was_saturating) {
+                // Recomeça a contagem do ritmo a partir de agora
+                pacer.start(esp_timer_get_time(), GEN_SAMPLE_RATE);
+                paced_samples = 0;
+            }
+        }
+        was_saturating = saturate;
+
+        if (configPending.load(std::memory_order_acquire)) {
+            generator.configure(pendingConfig, GEN_SAMPLE_RATE, index);
+            configPending.store(false, std::memory_order_release);
+            printSignal(generator.config(), index);
+        }
+        configurePacketizer(packet);
+        updateStreamInfo();
+
+        // Quantas amostras gerar nesta volta e o instante ideal da primeira
+        uint64_t due = GEN_BLOCK_SAMPLES;
+        if (!saturate) due = pacer.due(esp_timer_get_time()) - paced_samples;
+        while (due > 0) {
+            const size_t n = due < GEN_BLOCK_SAMPLES ? (size_t)due : GEN_BLOCK_SAMPLES;
+            const uint32_t timestamp = saturate ? (uint32_t)esp_timer_get_time()
+                                                : (uint32_t)pacer.timeOf(paced_samples);
+            generator.generate(block, n);
+            samplesGenerated.fetch_add(n, std::memory_order_relaxed);
+            if (deviceConnected.load()) {
+                packetizer.push(block, n, index, timestamp);
+                size_t packet_len = 0;
+                uint64_t before = packetizer.stats().samples;
+                while (packetizer.nextPacket(packet, packet_len)) {
+                    // Amostras do pacote pela contagem do empacotador (vale também para o Rice)
+                    const uint64_t after = packetizer.stats().samples;
+                    if (sendPacket(packet, packet_len))
+                        samplesSent.fetch_add((uint32_t)(after - before), std::memory_order_relaxed);
+                    before = after;
+                }
+            }
+            index += (uint32_t)n;
+            if (!saturate) paced_samples += n;
+            due -= n;
+        }
+    }
+}
+
+//================================================================
+// --- CONFIGURAÇÃO PRINCIPAL ---
+//================================================================
+void setup() {
+    Serial.begin(115200);
+    Serial.println("Iniciando gerador de sinais BLE...");
+
+    BLEDevice::init("ESP32_Audio_Stream");  // mesmo nome usado pelo app
+    BLEDevice::setMTU(517);
+    BLEDevice::setCustomGattsHandler(gattsEventHandler);
+
+    pServer = BLEDevice::createServer();
+    pServer->setCallbacks(new MyServerCallbacks());
+
+    BLEService *pService = pServer->createService(SERVICE_UUID);
+
+    pCharacteristic = pService->createCharacteristic(
+        CHARACTERISTIC_UUID,
+        BLECharacteristic::PROPERTY_NOTIFY
+    );
+    pAudioCccd = new BLE2902();
+    pCharacteristic->addDescriptor(pAudioCccd);
+
+    pControlCharacteristic = pService->createCharacteristic(
+        CONTROL_CHARACTERISTIC_UUID,
+        BLECharacteristic::PROPERTY_WRITE
+    );
+    pControlCharacteristic->setCallbacks(new ControlCallbacks());
+
+    pStreamInfoCharacteristic = pService->createCharacteristic(
+        STREAM_INFO_CHARACTERISTIC_UUID,
+        BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY
+    );
+    pStreamInfoCharacteristic->addDescriptor(new BLE2902());
+    updateStreamInfo(true);
+    pService->start();
+
+    BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
+    pAdvertising->addServiceUUID(SERVICE_UUID);
+    pAdvertising->setScanResponse(true);
+    pAdvertising->setMinPreferred(0x06);
+    pAdvertising->setMaxPreferred(0x0C);
+    BLEDevice::startAdvertising();
+
+    Serial.println("Servidor BLE iniciado. Aguardando conexões...");
+    printSignal(stetho::GeneratorConfig(), 0);
+
+    xTaskCreatePinnedToCore(
+        generatorTask,
+        "GeneratorTask",
+        6144,
+        NULL,
+        5,
+        &generatorTaskHandle,
+        1
+    );
+
+    // Periódico de 12,5 ms; um despertar atrasado não acumula erro porque a
+    // tarefa gera o que o relógio absoluto manda
+    const esp_timer_create_args_t timer_args = {
+        .callback = onPaceTimer,
+        .arg = nullptr,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "gen_pace",
+        .skip_unhandled_events = true,
+    };
+    esp_timer_create(&timer_args, &paceTimer);
+    esp_timer_start_periodic(paceTimer, GEN_TIMER_PERIOD_US);
+}
+
+//================================================================
+// --- LOOP: COMANDOS DA SERIAL E RELATÓRIO DE VAZÃO ---
+//================================================================
+static void handleCommand(const char *line) {
+    // Última configuração pedida (a do gerador é da tarefa de geração)
+    static stetho::GeneratorConfig requested;
+    switch (stetho::parseGeneratorCommand(line, requested)) {
+        case stetho::GeneratorCommand::Signal:
+          // Comandos digitados à mão: a tarefa aplica bem antes do próximo
+          while (configPending.load(std::memory_order_acquire)) delay(1);
+          pendingConfig = requested;
+          configPending.store(true, std::memory_order_release);
+          break;
+        case stetho::GeneratorCommand::Saturate:
+          saturateMode.store(true);
+          Serial.println("Modo saturate: enviando o mais rápido que o enlace aceitar");
+          break;
+        case stetho::GeneratorCommand::Paced:
+          saturateMode.store(false);
+          Serial.printf("Ritmo nominal: %d amostras/s\n", GEN_SAMPLE_RATE);
+          break;
+        case stetho::GeneratorCommand::Invalid:
+          Serial.printf("Comando inválido: %s\n", line);
+          break;
+    }
+}
+
+static void readSerialCommands() {
+    static char line[64];
+    static size_t len = 0;
+    while (Serial.available()) {
+        char c = (char)Serial.read();
+        if (c == '\n' || c == '\r') {
+            if (len > 0) {
+                line[len] = '\0';
+                handleCommand(line);
+            }
+            len = 0;
+        } else if (len + 1 < sizeof(line)) {
+            line[len++] = c;
+        }
+    }
+}
+
+static void report() {
+    static uint32_t prev_ms = 0, prev_generated = 0, prev_sent = 0, prev_bytes = 0, prev_packets = 0;
+    const uint32_t now_ms = millis();
+    const uint32_t elapsed = now_ms - prev_ms;
+    if (elapsed < REPORT_PERIOD_MS) return;
+    const uint32_t generated = samplesGenerated.load(), sent = samplesSent.load();
+    const uint32_t bytes = bytesSent.load(), packets = packetsSent.load();
+    Serial.printf("%s: geradas %u amostras/s, enviadas %u amostras/s, %.1f kB/s em %u notificações/s "
+                  "(MTU %u), falhas %u\n",
+                  saturateMode.load() ? "Saturate" : "Ritmo",
+                  (unsigned)((uint64_t)(generated - prev_generated) * 1000 / elapsed),
+                  (unsigned)((uint64_t)(sent - prev_sent) * 1000 / elapsed),
+                  (double)(bytes - prev_bytes) / elapsed, (unsigned)((uint64_t)(packets - prev_packets) * 1000 / elapsed),
+                  negotiatedMtu.load(), sendFailures.load());
+    prev_ms = now_ms;
+    prev_generated = generated;
+    prev_sent = sent;
+    prev_bytes = bytes;
+    prev_packets = packets;
+}
+
+void loop() {
+    readSerialCommands();
+    report();
+    delay(10);
+}
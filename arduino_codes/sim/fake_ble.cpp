@@ -0,0 +1,392 @@
+// Pilha BLE simulada: a biblioteca BLE do Arduino, o esp_ble_gatts_send_indicate
+// e um enlace com vazão limitada pelo intervalo de conexão, fila de
+// transmissão finita e perda. Uma thread faz o papel do rádio: a cada evento
+// de conexão tira até 'per_event' notificações da fila e as entrega ao
+// central (o sink do sim_main) e à saída em arquivo ou socket UNIX.
+
+#include <BLEDevice.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <thread>
+
+#include "sim/sim.h"
+
+namespace {
+
+constexpr esp_gatt_if_t SIM_GATTS_IF = 3;
+constexpr uint16_t SIM_CONN_ID = 0;
+constexpr size_t ATT_OVERHEAD = 3;
+
+struct Packet {
+    uint8_t characteristic;
+    std::vector<uint8_t> data;
+};
+
+struct Link {
+    std::mutex mutex;
+    std::condition_variable cv;
+    sim::LinkConfig config;
+    sim::LinkStats stats;
+    sim::LinkSink sink;
+    std::deque<Packet> queue;
+    bool connected = false;
+    bool congested = false;
+    uint32_t generation = 0; // muda a cada conexão e desconexão
+    uint16_t mtu = 23;
+    uint32_t random = 1;
+    bool radio_running = false;
+    std::FILE *file = nullptr;
+    int socket_fd = -1;
+    sockaddr_un socket_addr = {};
+};
+
+Link air;
+
+// Registro da pilha (só mexido no setup() e pelo central)
+std::vector<BLECharacteristic *> characteristics;
+BLEServer *server = nullptr;
+BLEAdvertising advertising;
+esp_gatts_cb_t customHandler = nullptr;
+uint16_t serverMtu = 23;
+
+// Último byte do UUID ("...26a8" -> 0xa8)
+uint8_t characteristicId(const std::string &uuid) {
+    if (uuid.size() < 2) return 0;
+    return (uint8_t)std::strtoul(uuid.substr(uuid.size() - 2).c_str(), nullptr, 16);
+}
+
+BLECharacteristic *findCharacteristic(uint8_t id) {
+    for (BLECharacteristic *c : characteristics)
+        if (characteristicId(c->getUUID().toString()) == id) return c;
+    return nullptr;
+}
+
+uint32_t nextRandom() {
+    uint32_t x = air.random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return air.random = x;
+}
+
+// Eventos do GATT: primeiro o handler cru do firmware, depois os callbacks
+// do BLEServer, na mesma ordem do BLEDevice do Arduino
+void dispatch(esp_gatts_cb_event_t event, esp_ble_gatts_cb_param_t &param) {
+    if (customHandler) customHandler(event, SIM_GATTS_IF, &param);
+    BLEServerCallbacks *cb = server ? server->getCallbacks() : nullptr;
+    if (!cb) return;
+    switch (event) {
+    case ESP_GATTS_CONNECT_EVT:
+        cb->onConnect(server);
+        cb->onConnect(server, &param);
+        break;
+    case ESP_GATTS_DISCONNECT_EVT:
+        cb->onDisconnect(server);
+        cb->onDisconnect(server, &param);
+        break;
+    case ESP_GATTS_MTU_EVT:
+        cb->onMtuChanged(server, &param);
+        break;
+    default:
+        break;
+    }
+}
+
+void dispatchCongestion(bool congested) {
+    esp_ble_gatts_cb_param_t param = {};
+    param.congest.conn_id = SIM_CONN_ID;
+    param.congest.congested = congested;
+    dispatch(ESP_GATTS_CONGEST_EVT, param);
+}
+
+void writeRecord(const Packet &p, int64_t t_us, uint8_t flags) {
+    if (!air.file && air.socket_fd < 0) return;
+    uint8_t record[sim::LINK_RECORD_HEADER + 517];
+    const size_t len = p.data.size();
+    record[0] = (uint8_t)len;
+    record[1] = (uint8_t)(len >> 8);
+    record[2] = p.characteristic;
+    record[3] = flags;
+    for (int i = 0; i < 8; i++) record[4 + i] = (uint8_t)((uint64_t)t_us >> (8 * i));
+    std::memcpy(record + sim::LINK_RECORD_HEADER, p.data.data(), len);
+    const size_t total = sim::LINK_RECORD_HEADER + len;
+    if (air.file) {
+        std::fwrite(record, 1, total, air.file);
+    } else {
+        // Sem ninguém escutando o datagrama se perde, como um sniffer desligado
+        sendto(air.socket_fd, record, total, MSG_DONTWAIT, (const sockaddr *)&air.socket_addr,
+               sizeof(air.socket_addr));
+    }
+}
+
+// O rádio: eventos de conexão a cada intervalo, ancorados na conexão
+void radioThread() {
+    std::vector<Packet> burst;
+    while (true) {
+        uint32_t generation;
+        int64_t anchor_us;
+        {
+            std::unique_lock<std::mutex> lock(air.mutex);
+            air.cv.wait(lock, [] { return air.connected; });
+            generation = air.generation;
+            anchor_us = sim::nowUs();
+        }
+        for (uint64_t event = 1;; event++) {
+            const int64_t t_us = anchor_us + (int64_t)((double)event * air.config.interval_ms * 1000.0);
+            sim::sleepUntilUs(t_us);
+
+            burst.clear();
+            bool released = false;
+            {
+                std::lock_guard<std::mutex> lock(air.mutex);
+                if (air.generation != generation) break;
+                for (uint32_t i = 0; i < air.config.per_event && !air.queue.empty(); i++) {
+                    burst.push_back(std::move(air.queue.front()));
+                    air.queue.pop_front();
+                }
+                if (air.congested && air.queue.size() <= air.config.queue_packets / 2) {
+                    air.congested = false;
+                    released = true;
+                }
+            }
+            for (const Packet &p : burst) {
+                bool lost;
+                {
+                    std::lock_guard<std::mutex> lock(air.mutex);
+                    lost = air.config.loss > 0.0 && (double)nextRandom() / 4294967296.0 < air.config.loss;
+                    if (lost) {
+                        air.stats.lost++;
+                    } else {
+                        air.stats.delivered++;
+                        air.stats.bytes += p.data.size();
+                    }
+                    writeRecord(p, t_us, lost ? sim::LINK_FLAG_LOST : 0);
+                }
+                if (!lost && air.sink) air.sink(p.characteristic, p.data.data(), p.data.size(), t_us);
+            }
+            if (released) dispatchCongestion(false);
+        }
+    }
+}
+
+// Fila de transmissão da pilha; chamado por qualquer tarefa do firmware
+esp_err_t linkSend(uint8_t characteristic, const uint8_t *data, size_t len) {
+    bool congested_now = false;
+    {
+        std::lock_guard<std::mutex> lock(air.mutex);
+        if (!air.connected) {
+            air.stats.rejected++;
+            return ESP_FAIL;
+        }
+        if (air.queue.size() >= air.config.queue_packets) {
+            air.stats.rejected++;
+            if (!air.congested) {
+                air.congested = congested_now = true;
+                air.stats.congestions++;
+            }
+        } else {
+            const size_t max_len = air.mtu - ATT_OVERHEAD;
+            if (len > max_len) {
+                air.stats.truncated++;
+                len = max_len;
+            }
+            air.queue.push_back(Packet{characteristic, std::vector<uint8_t>(data, data + len)});
+            air.stats.sent++;
+            if (air.queue.size() > air.stats.max_queue) air.stats.max_queue = (uint32_t)air.queue.size();
+            return ESP_OK;
+        }
+    }
+    if (congested_now) dispatchCongestion(true);
+    return ESP_FAIL;
+}
+
+} // namespace
+
+//================================================================
+// --- LADO DO SIMULADOR ---
+//================================================================
+namespace sim {
+
+bool configureLink(const LinkConfig &config) {
+    std::lock_guard<std::mutex> lock(air.mutex);
+    air.config = config;
+    if (air.config.per_event == 0) air.config.per_event = 1;
+    if (air.config.queue_packets == 0) air.config.queue_packets = 1;
+    if (air.config.interval_ms < 7.5) air.config.interval_ms = 7.5;
+    air.random = config.seed ? config.seed : 1;
+    if (!config.output.empty()) {
+        if (config.output.compare(0, 5, "unix:") == 0) {
+            const std::string path = config.output.substr(5);
+            air.socket_fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+            if (air.socket_fd < 0 || path.size() >= sizeof(air.socket_addr.sun_path)) return false;
+            air.socket_addr.sun_family = AF_UNIX;
+            std::strcpy(air.socket_addr.sun_path, path.c_str());
+        } else {
+            air.file = std::fopen(config.output.c_str(), "wb");
+            if (!air.file) return false;
+        }
+    }
+    if (!air.radio_running) {
+        air.radio_running = true;
+        std::thread(radioThread).detach();
+    }
+    return true;
+}
+
+LinkStats linkStats() {
+    std::lock_guard<std::mutex> lock(air.mutex);
+    if (air.file) std::fflush(air.file);
+    return air.stats;
+}
+
+void setLinkSink(LinkSink sink) {
+    std::lock_guard<std::mutex> lock(air.mutex);
+    air.sink = std::move(sink);
+}
+
+void connect() {
+    uint16_t mtu;
+    {
+        std::lock_guard<std::mutex> lock(air.mutex);
+        if (air.connected) return;
+        air.connected = true;
+        air.congested = false;
+        air.queue.clear();
+        air.generation++;
+        air.mtu = 23;
+        mtu = air.config.mtu < serverMtu ? air.config.mtu : serverMtu;
+    }
+    air.cv.notify_all();
+
+    esp_ble_gatts_cb_param_t param = {};
+    param.connect.conn_id = SIM_CONN_ID;
+    dispatch(ESP_GATTS_CONNECT_EVT, param);
+
+    // Troca de MTU pedida pelo central logo depois de conectar
+    {
+        std::lock_guard<std::mutex> lock(air.mutex);
+        air.mtu = mtu;
+    }
+    param = {};
+    param.mtu.conn_id = SIM_CONN_ID;
+    param.mtu.mtu = mtu;
+    dispatch(ESP_GATTS_MTU_EVT, param);
+
+    // O app liga as notificações de tudo que assina
+    for (BLECharacteristic *c : characteristics)
+        if (c->cccd()) c->cccd()->setNotifications(true);
+}
+
+void disconnect() {
+    {
+        std::lock_guard<std::mutex> lock(air.mutex);
+        if (!air.connected) return;
+        air.connected = false;
+        air.queue.clear();
+        air.generation++;
+    }
+    // Sem bonding o estado dos CCCDs não sobrevive à conexão
+    for (BLECharacteristic *c : characteristics)
+        if (c->cccd()) c->cccd()->setNotifications(false);
+    esp_ble_gatts_cb_param_t param = {};
+    param.disconnect.conn_id = SIM_CONN_ID;
+    param.disconnect.reason = 0x13; // desconexão pedida pelo central
+    dispatch(ESP_GATTS_DISCONNECT_EVT, param);
+}
+
+bool connected() {
+    std::lock_guard<std::mutex> lock(air.mutex);
+    return air.connected;
+}
+
+bool writeCharacteristic(uint8_t id, const uint8_t *data, size_t len) {
+    BLECharacteristic *c = findCharacteristic(id);
+    if (!c || !(c->getProperties() & (BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR))) {
+        return false;
+    }
+    c->setValue(data, len);
+    if (c->getCallbacks()) c->getCallbacks()->onWrite(c);
+    return true;
+}
+
+std::string readCharacteristic(uint8_t id) {
+    BLECharacteristic *c = findCharacteristic(id);
+    if (!c) return std::string();
+    if (c->getCallbacks()) c->getCallbacks()->onRead(c);
+    return c->getValue();
+}
+
+} // namespace sim
+
+//================================================================
+// --- LADO DO FIRMWARE ---
+//================================================================
+esp_err_t esp_ble_gatts_send_indicate(esp_gatt_if_t gatts_if, uint16_t conn_id, uint16_t attr_handle,
+                                      uint16_t value_len, uint8_t *value, bool) {
+    if (gatts_if != SIM_GATTS_IF || conn_id != SIM_CONN_ID || attr_handle >= characteristics.size()) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return linkSend(characteristicId(characteristics[attr_handle]->getUUID().toString()), value, value_len);
+}
+
+BLECharacteristic::BLECharacteristic(const BLEUUID &uuid, uint32_t properties, uint16_t handle)
+    : uuid_(uuid), properties_(properties), handle_(handle) {}
+
+void BLECharacteristic::addDescriptor(BLEDescriptor *descriptor) {
+    descriptors_.push_back(descriptor);
+    if (descriptor->getUUID().toString() == "2902") cccd_ = static_cast<BLE2902 *>(descriptor);
+}
+
+void BLECharacteristic::setValue(const uint8_t *data, size_t len) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    value_.assign(data, data + len);
+}
+
+std::string BLECharacteristic::getValue() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::string(value_.begin(), value_.end());
+}
+
+void BLECharacteristic::notify(bool) {
+    if (!cccd_ || !cccd_->getNotifications()) return;
+    std::vector<uint8_t> value;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        value = value_;
+    }
+    // Como no Arduino, o valor maior que o MTU sai truncado
+    linkSend(characteristicId(uuid_.toString()), value.data(), value.size());
+}
+
+BLECharacteristic *BLEService::createCharacteristic(const char *uuid, uint32_t properties) {
+    BLECharacteristic *c = new BLECharacteristic(BLEUUID(uuid), properties, (uint16_t)characteristics.size());
+    characteristics.push_back(c);
+    return c;
+}
+
+BLEService *BLEServer::createService(const BLEUUID &uuid, uint32_t, uint8_t) { return new BLEService(uuid); }
+
+uint32_t BLEServer::getConnectedCount() const { return sim::connected() ? 1 : 0; }
+
+void BLEDevice::init(const char *) {}
+
+void BLEDevice::setMTU(uint16_t mtu) { serverMtu = mtu; }
+
+uint16_t BLEDevice::getMTU() { return serverMtu; }
+
+void BLEDevice::setCustomGattsHandler(esp_gatts_cb_t handler) { customHandler = handler; }
+
+BLEServer *BLEDevice::createServer() {
+    if (!server) server = new BLEServer();
+    return server;
+}
+
+BLEAdvertising *BLEDevice::getAdvertising() { return &advertising; }
@@ -0,0 +1,185 @@
+// Canal RX do i2s_std simulado. Uma thread faz o papel do DMA: preenche os
+// buffers do anel em sequência com a fonte configurada e, no instante
+// virtual em que cada um ficaria cheio, chama o on_recv do firmware com o
+// ponteiro do buffer. Como no ESP32, o DMA não espera por ninguém: se a
+// captura demorar mais que o anel, ela vê o buffer já sobrescrito.
+//
+// O canal pode ser desligado e religado (a tarefa de energia do firmware):
+// a fonte só avança com ele ligado, então o firmware vê o mesmo sinal em
+// sequência, e um lock do esp_pm fica segurado enquanto ele está ligado.
+//
+// Com setI2sClockPpm() o divisor sai da nominal e os buffers chegam nesse
+// ritmo no relógio virtual (o esp_timer); com o APLL a taxa é exata.
+
+#include <driver/i2s_std.h>
+#include <esp_pm.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "sim/sim.h"
+
+struct i2s_channel_obj_t {
+    uint32_t desc_num = 6;
+    uint32_t frame_num = 240;
+    uint32_t sample_rate_hz = 0;
+    bool apll = false;
+    uint32_t channels = 1; // palavras por quadro
+    i2s_event_callbacks_t callbacks = {};
+    void *user_data = nullptr;
+    std::atomic<bool> enabled{false};
+    std::atomic<uint32_t> generation{0}; // a thread de um enable antigo sai sozinha
+    esp_pm_lock_handle_t pm_lock = nullptr;
+    int64_t enabled_at_us = 0;
+};
+
+namespace {
+
+sim::I2sSource source;
+std::mutex gateMutex;
+std::condition_variable gateCv;
+bool started = false;
+std::atomic<uint64_t> framesDelivered(0);
+std::atomic<double> clockPpm(0.0);
+std::mutex statsMutex;
+sim::I2sStats stats;
+i2s_channel_obj_t *channel = nullptr; // o último criado, para o i2sStats()
+// Os buffers do anel sobrevivem ao disable, como a memória de DMA do driver
+std::vector<std::vector<int32_t>> buffers;
+size_t nextBuffer = 0;
+std::mutex droppedMutex;
+std::set<uint64_t> dropped; // primeiro quadro dos buffers recusados
+
+void dmaThread(i2s_channel_obj_t *ch, uint32_t generation) {
+    {
+        std::unique_lock<std::mutex> lock(gateMutex);
+        gateCv.wait(lock, [] { return started; });
+    }
+    if (buffers.empty()) buffers.assign(ch->desc_num, std::vector<int32_t>(ch->frame_num * ch->channels));
+    const int64_t t0 = sim::nowUs();
+    const double rate = ch->sample_rate_hz * (ch->apll ? 1.0 : 1.0 + clockPpm.load() * 1e-6);
+    uint64_t frames = 0;
+    for (;; nextBuffer = (nextBuffer + 1) % buffers.size()) {
+        frames += ch->frame_num;
+        // O buffer fica cheio quando a última amostra chega; desligado antes
+        // disso, a fonte não anda
+        sim::sleepUntilUs(t0 + (int64_t)((double)frames * 1e6 / rate));
+        if (!ch->enabled || ch->generation.load() != generation) break;
+        std::vector<int32_t> &buf = buffers[nextBuffer];
+        if (source) source(buf.data(), buf.size());
+        else std::fill(buf.begin(), buf.end(), 0);
+
+        i2s_event_data_t event = {};
+        event.data = &event.dma_buf;
+        event.dma_buf = buf.data();
+        event.size = buf.size() * sizeof(int32_t);
+        const uint64_t refused = sim::isrSendsRefused();
+        if (ch->callbacks.on_recv) ch->callbacks.on_recv(ch, &event, ch->user_data);
+        if (sim::isrSendsRefused() != refused) {
+            std::lock_guard<std::mutex> lock(droppedMutex);
+            dropped.insert(framesDelivered.load());
+        }
+        framesDelivered.fetch_add(ch->frame_num);
+    }
+}
+
+} // namespace
+
+namespace sim {
+
+void setI2sSource(I2sSource s) { source = std::move(s); }
+
+void setI2sClockPpm(double ppm) { clockPpm.store(ppm); }
+
+void startI2s() {
+    {
+        std::lock_guard<std::mutex> lock(gateMutex);
+        started = true;
+    }
+    gateCv.notify_all();
+}
+
+uint64_t i2sFramesDelivered() { return framesDelivered.load(); }
+
+bool i2sBlockDropped(uint64_t first_frame) {
+    std::lock_guard<std::mutex> lock(droppedMutex);
+    return dropped.count(first_frame) != 0;
+}
+
+I2sStats i2sStats() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    I2sStats s = stats;
+    // Canal ligado agora: o trecho aberto também conta
+    if (channel && channel->enabled) s.on_us += nowUs() - channel->enabled_at_us;
+    return s;
+}
+
+} // namespace sim
+
+esp_err_t i2s_new_channel(const i2s_chan_config_t *chan_cfg, i2s_chan_handle_t *ret_tx_handle,
+                          i2s_chan_handle_t *ret_rx_handle) {
+    if (ret_tx_handle || !ret_rx_handle || chan_cfg->dma_desc_num < 2 || chan_cfg->dma_frame_num == 0) {
+        return ESP_ERR_INVALID_ARG; // só há o microfone
+    }
+    i2s_channel_obj_t *ch = new i2s_channel_obj_t();
+    ch->desc_num = chan_cfg->dma_desc_num;
+    ch->frame_num = chan_cfg->dma_frame_num;
+    // O driver segura o APB em 80 MHz enquanto o canal está ligado
+    esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "i2s", &ch->pm_lock);
+    channel = ch;
+    *ret_rx_handle = ch;
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_init_std_mode(i2s_chan_handle_t handle, const i2s_std_config_t *std_cfg) {
+    if (!handle || std_cfg->clk_cfg.sample_rate_hz == 0) return ESP_ERR_INVALID_ARG;
+    // 32 bits: mono com o INMP441 no canal esquerdo, ou estéreo com os dois
+    // canais (quadros L/R intercalados no buffer)
+    const bool mono = std_cfg->slot_cfg.slot_mode == I2S_SLOT_MODE_MONO &&
+                      std_cfg->slot_cfg.slot_mask == I2S_STD_SLOT_LEFT;
+    const bool stereo = std_cfg->slot_cfg.slot_mode == I2S_SLOT_MODE_STEREO &&
+                        std_cfg->slot_cfg.slot_mask == I2S_STD_SLOT_BOTH;
+    if (std_cfg->slot_cfg.data_bit_width != I2S_DATA_BIT_WIDTH_32BIT || (!mono && !stereo)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    handle->sample_rate_hz = std_cfg->clk_cfg.sample_rate_hz;
+    handle->apll = std_cfg->clk_cfg.clk_src == I2S_CLK_SRC_APLL;
+    handle->channels = stereo ? 2 : 1;
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_register_event_callback(i2s_chan_handle_t handle, const i2s_event_callbacks_t *callbacks,
+                                              void *user_data) {
+    if (!handle || handle->enabled) return ESP_ERR_INVALID_STATE;
+    handle->callbacks = *callbacks;
+    handle->user_data = user_data;
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_enable(i2s_chan_handle_t handle) {
+    if (!handle || handle->enabled || handle->sample_rate_hz == 0) return ESP_ERR_INVALID_STATE;
+    esp_pm_lock_acquire(handle->pm_lock);
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        handle->enabled_at_us = sim::nowUs();
+        handle->enabled = true;
+    }
+    std::thread(dmaThread, handle, ++handle->generation).detach();
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_disable(i2s_chan_handle_t handle) {
+    if (!handle || !handle->enabled) return ESP_ERR_INVALID_STATE;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        handle->enabled = false;
+        stats.stops++;
+        stats.on_us += sim::nowUs() - handle->enabled_at_us;
+    }
+    esp_pm_lock_release(handle->pm_lock);
+    return ESP_OK;
+}
@@ -0,0 +1,155 @@
+// LittleFS simulado sobre um diretório do host. Só o que o LittleFsStorage
+// do firmware usa: open/exists/remove/mkdir, File com leitura, append,
+// seek e listagem de diretório.
+
+#include <LittleFS.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "sim/sim.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::mutex rootMutex;
+std::string fsRoot = "/tmp/stetho_sim_fs";
+
+std::string root() {
+    std::lock_guard<std::mutex> lock(rootMutex);
+    return fsRoot;
+}
+
+std::string resolve(const char *path) { return root() + (path[0] == '/' ? "" : "/") + path; }
+
+} // namespace
+
+struct SimFileImpl {
+    std::FILE *file = nullptr;
+    bool directory = false;
+    std::string name;
+    std::string path;                 // caminho do firmware
+    std::vector<std::string> entries; // diretório: nomes ainda não visitados
+
+    ~SimFileImpl() {
+        if (file) std::fclose(file);
+    }
+};
+
+namespace sim {
+
+void setFsRoot(const std::string &dir) {
+    std::lock_guard<std::mutex> lock(rootMutex);
+    fsRoot = dir;
+}
+
+} // namespace sim
+
+LittleFSFS LittleFS;
+
+bool LittleFSFS::begin(bool format_on_fail) {
+    std::error_code ec;
+    fs::create_directories(root(), ec);
+    return (!ec || format_on_fail) && fs::is_directory(root());
+}
+
+const char *LittleFSFS::mountPoint() const {
+    static std::string mount;
+    mount = root();
+    return mount.c_str();
+}
+
+File LittleFSFS::open(const char *path, const char *mode, bool create) {
+    const std::string full = resolve(path);
+    auto impl = std::make_shared<SimFileImpl>();
+    impl->path = path;
+    impl->name = fs::path(full).filename().string();
+    std::error_code ec;
+    if (fs::is_directory(full, ec)) {
+        impl->directory = true;
+        for (const auto &e : fs::directory_iterator(full, ec)) impl->entries.push_back(e.path().filename().string());
+        std::sort(impl->entries.begin(), impl->entries.end());
+        return File(impl);
+    }
+    if (mode[0] != 'r' && create) fs::create_directories(fs::path(full).parent_path(), ec);
+    const char *fmode = mode[0] == 'a' ? "ab+" : mode[0] == 'w' ? "wb+" : "rb";
+    impl->file = std::fopen(full.c_str(), fmode);
+    if (!impl->file) return File();
+    return File(impl);
+}
+
+bool LittleFSFS::exists(const char *path) {
+    std::error_code ec;
+    return fs::exists(resolve(path), ec);
+}
+
+bool LittleFSFS::remove(const char *path) { return std::remove(resolve(path).c_str()) == 0; }
+
+bool LittleFSFS::mkdir(const char *path) {
+    std::error_code ec;
+    fs::create_directories(resolve(path), ec);
+    return !ec;
+}
+
+bool LittleFSFS::rmdir(const char *path) {
+    std::error_code ec;
+    return fs::remove(resolve(path), ec);
+}
+
+// Partição de 1,5 MB, como a do ESP32 com o esquema padrão
+size_t LittleFSFS::totalBytes() { return 1536 * 1024; }
+
+size_t LittleFSFS::usedBytes() {
+    size_t used = 0;
+    std::error_code ec;
+    for (const auto &e : fs::recursive_directory_iterator(root(), ec))
+        if (e.is_regular_file(ec)) used += (size_t)e.file_size(ec);
+    return used;
+}
+
+File::operator bool() const { return impl_ && (impl_->file || impl_->directory); }
+
+size_t File::write(const uint8_t *data, size_t len) {
+    if (!impl_ || !impl_->file) return 0;
+    return std::fwrite(data, 1, len, impl_->file);
+}
+
+size_t File::read(uint8_t *out, size_t len) {
+    if (!impl_ || !impl_->file) return 0;
+    return std::fread(out, 1, len, impl_->file);
+}
+
+bool File::seek(uint32_t pos) {
+    if (!impl_ || !impl_->file) return false;
+    return std::fseek(impl_->file, (long)pos, SEEK_SET) == 0;
+}
+
+size_t File::size() const {
+    if (!impl_ || !impl_->file) return 0;
+    std::fflush(impl_->file);
+    std::error_code ec;
+    const auto n = fs::file_size(resolve(impl_->path.c_str()), ec);
+    return ec ? 0 : (size_t)n;
+}
+
+void File::flush() {
+    if (impl_ && impl_->file) std::fflush(impl_->file);
+}
+
+void File::close() { impl_.reset(); }
+
+bool File::isDirectory() const { return impl_ && impl_->directory; }
+
+File File::openNextFile() {
+    if (!impl_ || !impl_->directory || impl_->entries.empty()) return File();
+    const std::string child = impl_->path + (impl_->path.back() == '/' ? "" : "/") + impl_->entries.front();
+    impl_->entries.erase(impl_->entries.begin());
+    return LittleFS.open(child.c_str(), FILE_READ);
+}
+
+const char *File::name() const { return impl_ ? impl_->name.c_str() : ""; }
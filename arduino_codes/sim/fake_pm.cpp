@@ -0,0 +1,84 @@
+// Gerenciador de energia simulado (esp_pm.h): locks contados e o tempo
+// virtual em que nenhum estava segurado com o light sleep ligado, que é
+// quando o ESP32 de verdade poderia dormir entre duas interrupções.
+
+#include <esp_pm.h>
+
+#include <mutex>
+#include <string>
+
+#include "sim/sim.h"
+
+struct esp_pm_lock {
+    esp_pm_lock_type_t type;
+    std::string name;
+    int count = 0;
+};
+
+namespace {
+
+std::mutex pmMutex;
+bool lightSleep = false;
+int held = 0;            // locks segurados, somando todos
+int64_t freeSinceUs = 0; // desde quando nenhum está segurado
+int64_t sleepUs = 0;     // acumulado até freeSinceUs
+
+// Fecha o trecho livre até agora (com pmMutex)
+void account(int64_t now_us) {
+    if (held == 0 && lightSleep) sleepUs += now_us - freeSinceUs;
+    freeSinceUs = now_us;
+}
+
+} // namespace
+
+esp_err_t esp_pm_configure(const void *config) {
+    if (!config) return ESP_ERR_INVALID_ARG;
+    const esp_pm_config_t *c = (const esp_pm_config_t *)config;
+    if (c->min_freq_mhz <= 0 || c->max_freq_mhz < c->min_freq_mhz) return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::mutex> lock(pmMutex);
+    account(sim::nowUs());
+    lightSleep = c->light_sleep_enable;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t lock_type, int, const char *name, esp_pm_lock_handle_t *out_handle) {
+    if (!out_handle) return ESP_ERR_INVALID_ARG;
+    esp_pm_lock *l = new esp_pm_lock();
+    l->type = lock_type;
+    l->name = name ? name : "";
+    *out_handle = l;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle) {
+    if (!handle) return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::mutex> lock(pmMutex);
+    if (held == 0) account(sim::nowUs());
+    held++;
+    handle->count++;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle) {
+    if (!handle) return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::mutex> lock(pmMutex);
+    if (handle->count == 0) return ESP_ERR_INVALID_STATE;
+    handle->count--;
+    if (--held == 0) freeSinceUs = sim::nowUs();
+    return ESP_OK;
+}
+
+namespace sim {
+
+PowerStats powerStats() {
+    std::lock_guard<std::mutex> lock(pmMutex);
+    PowerStats s;
+    s.light_sleep = lightSleep;
+    s.sleep_us = sleepUs + (held == 0 && lightSleep ? nowUs() - freeSinceUs : 0);
+    const I2sStats i2s = i2sStats();
+    s.i2s_on_us = i2s.on_us;
+    s.i2s_stops = i2s.stops;
+    return s;
+}
+
+} // namespace sim
@@ -0,0 +1,78 @@
+#pragma once
+
+// Subconjunto do core Arduino-ESP32 que os firmwares usam, sobre o runtime
+// do simulador (sim/sim.h). Tempo é sempre o relógio virtual.
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+#include "esp_err.h"
+#include "esp_idf_version.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// Frequência do contador de ciclos do host (stetho::cycleCount), para o
+// diagnóstico converter ciclos em µs como no ESP32
+uint32_t getCpuFrequencyMhz();
+// O simulador não mede o heap: sempre 0
+uint32_t esp_get_free_heap_size();
+uint32_t esp_get_minimum_free_heap_size();
+
+class String {
+public:
+    String() = default;
+    String(const char *s) : s_(s ? s : "") {}
+    String(const std::string &s) : s_(s) {}
+    String(int v) : s_(std::to_string(v)) {}
+    String(unsigned v) : s_(std::to_string(v)) {}
+
+    const char *c_str() const { return s_.c_str(); }
+    size_t length() const { return s_.size(); }
+    bool isEmpty() const { return s_.empty(); }
+
+    String &operator+=(const String &o) {
+        s_ += o.s_;
+        return *this;
+    }
+    friend String operator+(String a, const String &b) { return a += b; }
+    friend String operator+(String a, const char *b) { return a += String(b); }
+    bool operator==(const String &o) const { return s_ == o.s_; }
+    bool operator==(const char *o) const { return s_ == (o ? o : ""); }
+    bool operator!=(const String &o) const { return s_ != o.s_; }
+    bool operator!=(const char *o) const { return !(*this == o); }
+
+private:
+    std::string s_;
+};
+
+// Serial: vai para o stdout, a menos que a simulação rode com --quiet
+class HardwareSerial {
+public:
+    void begin(unsigned long) {}
+    size_t print(const char *s);
+    size_t print(const String &s) { return print(s.c_str()); }
+    size_t println(const char *s = "");
+    size_t println(const String &s) { return println(s.c_str()); }
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    size_t write(const uint8_t *data, size_t len);
+    size_t write(uint8_t b) { return write(&b, 1); }
+    void flush();
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,168 @@
+#pragma once
+
+// Biblioteca BLE do Arduino-ESP32 (BLEDevice, BLEServer, BLECharacteristic,
+// BLE2902) sobre o enlace simulado. BLEServer.h, BLEUtils.h e BLE2902.h
+// incluem este cabeçalho.
+//
+// Cada característica ganha como handle o seu índice de criação e é
+// identificada no enlace pelo último byte do UUID (0xa8 = áudio, ...).
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "esp_gatts_api.h"
+
+class BLEServer;
+class BLECharacteristic;
+
+class BLEUUID {
+public:
+    BLEUUID() = default;
+    BLEUUID(const char *uuid) : value_(uuid ? uuid : "") {}
+    const std::string &toString() const { return value_; }
+
+private:
+    std::string value_;
+};
+
+class BLEDescriptor {
+public:
+    explicit BLEDescriptor(const char *uuid) : uuid_(uuid) {}
+    virtual ~BLEDescriptor() = default;
+    const BLEUUID &getUUID() const { return uuid_; }
+
+private:
+    BLEUUID uuid_;
+};
+
+// CCCD: o central liga as notificações escrevendo nele (na thread do
+// sim_main) e as tarefas do firmware leem
+class BLE2902 : public BLEDescriptor {
+public:
+    BLE2902() : BLEDescriptor("2902") {}
+    bool getNotifications() const { return notifications_.load(std::memory_order_relaxed); }
+    bool getIndications() const { return indications_.load(std::memory_order_relaxed); }
+    void setNotifications(bool on) { notifications_.store(on, std::memory_order_relaxed); }
+    void setIndications(bool on) { indications_.store(on, std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> notifications_{false};
+    std::atomic<bool> indications_{false};
+};
+
+class BLECharacteristicCallbacks {
+public:
+    virtual ~BLECharacteristicCallbacks() = default;
+    virtual void onRead(BLECharacteristic *) {}
+    virtual void onWrite(BLECharacteristic *) {}
+};
+
+class BLECharacteristic {
+public:
+    static constexpr uint32_t PROPERTY_READ = 1 << 0;
+    static constexpr uint32_t PROPERTY_WRITE = 1 << 1;
+    static constexpr uint32_t PROPERTY_NOTIFY = 1 << 2;
+    static constexpr uint32_t PROPERTY_BROADCAST = 1 << 3;
+    static constexpr uint32_t PROPERTY_INDICATE = 1 << 4;
+    static constexpr uint32_t PROPERTY_WRITE_NR = 1 << 5;
+
+    BLECharacteristic(const BLEUUID &uuid, uint32_t properties, uint16_t handle);
+
+    void addDescriptor(BLEDescriptor *descriptor);
+    void setCallbacks(BLECharacteristicCallbacks *callbacks) { callbacks_ = callbacks; }
+    BLECharacteristicCallbacks *getCallbacks() const { return callbacks_; }
+
+    // O valor é protegido por uma trava: o central pode ler enquanto uma
+    // tarefa do firmware escreve
+    void setValue(const uint8_t *data, size_t len);
+    void setValue(const std::string &value) { setValue((const uint8_t *)value.data(), value.size()); }
+    std::string getValue() const;
+    // Válidos até o próximo setValue (uso nos callbacks de escrita)
+    uint8_t *getData() { return value_.empty() ? nullptr : value_.data(); }
+    size_t getLength() const { return value_.size(); }
+
+    // Manda o valor atual se o central ligou as notificações no CCCD
+    void notify(bool is_notification = true);
+    void indicate() { notify(false); }
+
+    uint16_t getHandle() const { return handle_; }
+    const BLEUUID &getUUID() const { return uuid_; }
+    uint32_t getProperties() const { return properties_; }
+    const std::vector<BLEDescriptor *> &descriptors() const { return descriptors_; }
+    BLE2902 *cccd() const { return cccd_; }
+
+private:
+    BLEUUID uuid_;
+    uint32_t properties_;
+    uint16_t handle_;
+    mutable std::mutex mutex_;
+    std::vector<uint8_t> value_;
+    std::vector<BLEDescriptor *> descriptors_;
+    BLE2902 *cccd_ = nullptr;
+    BLECharacteristicCallbacks *callbacks_ = nullptr;
+};
+
+class BLEService {
+public:
+    explicit BLEService(const BLEUUID &uuid) : uuid_(uuid) {}
+    BLECharacteristic *createCharacteristic(const char *uuid, uint32_t properties);
+    BLECharacteristic *createCharacteristic(const BLEUUID &uuid, uint32_t properties) {
+        return createCharacteristic(uuid.toString().c_str(), properties);
+    }
+    void start() {}
+    const BLEUUID &getUUID() const { return uuid_; }
+
+private:
+    BLEUUID uuid_;
+};
+
+class BLEServerCallbacks {
+public:
+    virtual ~BLEServerCallbacks() = default;
+    virtual void onConnect(BLEServer *) {}
+    virtual void onConnect(BLEServer *, esp_ble_gatts_cb_param_t *) {}
+    virtual void onDisconnect(BLEServer *) {}
+    virtual void onDisconnect(BLEServer *, esp_ble_gatts_cb_param_t *) {}
+    virtual void onMtuChanged(BLEServer *, esp_ble_gatts_cb_param_t *) {}
+};
+
+class BLEServer {
+public:
+    void setCallbacks(BLEServerCallbacks *callbacks) { callbacks_ = callbacks; }
+    BLEServerCallbacks *getCallbacks() const { return callbacks_; }
+    BLEService *createService(const BLEUUID &uuid, uint32_t num_handles = 15, uint8_t inst_id = 0);
+    BLEService *createService(const char *uuid) { return createService(BLEUUID(uuid)); }
+    uint32_t getConnectedCount() const;
+    void startAdvertising() {}
+
+private:
+    BLEServerCallbacks *callbacks_ = nullptr;
+};
+
+class BLEAdvertising {
+public:
+    void addServiceUUID(const char *) {}
+    void addServiceUUID(const BLEUUID &) {}
+    void setScanResponse(bool) {}
+    void setMinPreferred(uint16_t) {}
+    void setMaxPreferred(uint16_t) {}
+    void start() {}
+    void stop() {}
+};
+
+class BLEDevice {
+public:
+    static void init(const char *name);
+    static void init(const std::string &name) { init(name.c_str()); }
+    static void setMTU(uint16_t mtu);
+    static uint16_t getMTU();
+    static void setCustomGattsHandler(esp_gatts_cb_t handler);
+    static BLEServer *createServer();
+    static BLEAdvertising *getAdvertising();
+    static void startAdvertising() {}
+    static void stopAdvertising() {}
+};
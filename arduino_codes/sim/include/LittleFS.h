@@ -0,0 +1,57 @@
+#pragma once
+
+// LittleFS do Arduino-ESP32 sobre um diretório comum do host (--fs). O
+// caminho "/rec/00001.dat" do firmware vira <raiz>/rec/00001.dat.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "Arduino.h"
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+// Onde o firmware acha o sistema de arquivos pelo VFS (truncate() POSIX)
+#define LITTLEFS_MOUNT_POINT LittleFS.mountPoint()
+
+struct SimFileImpl;
+
+// Como no Arduino, cópias de um File apontam para o mesmo arquivo aberto
+class File {
+public:
+    File() = default;
+    explicit File(std::shared_ptr<SimFileImpl> impl) : impl_(std::move(impl)) {}
+
+    explicit operator bool() const;
+    size_t write(const uint8_t *data, size_t len);
+    size_t read(uint8_t *out, size_t len);
+    bool seek(uint32_t pos);
+    size_t size() const;
+    void flush();
+    void close();
+    bool isDirectory() const;
+    File openNextFile();
+    // Só o nome, sem o diretório
+    const char *name() const;
+
+private:
+    std::shared_ptr<SimFileImpl> impl_;
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool format_on_fail = false);
+    void end() {}
+    File open(const char *path, const char *mode = FILE_READ, bool create = false);
+    bool exists(const char *path);
+    bool remove(const char *path);
+    bool mkdir(const char *path);
+    bool rmdir(const char *path);
+    size_t totalBytes();
+    size_t usedBytes();
+    const char *mountPoint() const;
+};
+
+extern LittleFSFS LittleFS;
@@ -0,0 +1,49 @@
+#pragma once
+
+// Eventos e envio do GATT server do Bluedroid, com os campos que os
+// firmwares leem. O "enlace" por trás é o do simulador (sim/fake_ble.cpp).
+
+#include <cstdint>
+
+#include "esp_err.h"
+
+typedef uint8_t esp_gatt_if_t;
+#define ESP_GATT_IF_NONE 0xff
+
+typedef enum {
+    ESP_GATTS_REG_EVT = 0,
+    ESP_GATTS_READ_EVT = 1,
+    ESP_GATTS_WRITE_EVT = 2,
+    ESP_GATTS_MTU_EVT = 4,
+    ESP_GATTS_CONF_EVT = 5,
+    ESP_GATTS_CONNECT_EVT = 14,
+    ESP_GATTS_DISCONNECT_EVT = 15,
+    ESP_GATTS_CONGEST_EVT = 18,
+} esp_gatts_cb_event_t;
+
+typedef union {
+    struct gatts_connect_evt_param {
+        uint16_t conn_id;
+        uint8_t remote_bda[6];
+    } connect;
+    struct gatts_disconnect_evt_param {
+        uint16_t conn_id;
+        uint8_t remote_bda[6];
+        int reason;
+    } disconnect;
+    struct gatts_mtu_evt_param {
+        uint16_t conn_id;
+        uint16_t mtu;
+    } mtu;
+    struct gatts_congest_evt_param {
+        uint16_t conn_id;
+        bool congested;
+    } congest;
+} esp_ble_gatts_cb_param_t;
+
+typedef void (*esp_gatts_cb_t)(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
+
+// Enfileira a notificação no enlace simulado; ESP_FAIL sem conexão ou com a
+// fila de transmissão cheia (o que também dispara ESP_GATTS_CONGEST_EVT)
+esp_err_t esp_ble_gatts_send_indicate(esp_gatt_if_t gatts_if, uint16_t conn_id, uint16_t attr_handle,
+                                      uint16_t value_len, uint8_t *value, bool need_confirm);
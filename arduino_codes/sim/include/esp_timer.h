@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+// Microssegundos do relógio virtual desde o boot
+int64_t esp_timer_get_time();
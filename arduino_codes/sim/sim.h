@@ -0,0 +1,133 @@
+#pragma once
+
+//================================================================
+// --- SIMULADOR DO FIRMWARE NO LINUX ---
+//================================================================
+// O current.cpp é compilado sem mudanças contra os cabeçalhos falsos de
+// sim/include (Arduino, FreeRTOS, i2s_std, BLE, LittleFS). Este cabeçalho é
+// o lado de fora: o sim_main controla o relógio, a fonte do microfone, o
+// enlace BLE e faz o papel do celular.
+//
+// Relógio virtual: µs desde o boot, andando 'speed' vezes mais rápido que o
+// relógio do host. millis(), esp_timer_get_time(), vTaskDelay() e os ticks
+// usam esse relógio, então o firmware inteiro roda acelerado.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace sim {
+
+//================================================================
+// --- RELÓGIO VIRTUAL E RUNTIME ---
+//================================================================
+void setSpeed(double speed); // antes de qualquer tarefa começar
+double speed();
+int64_t nowUs();
+void sleepUntilUs(int64_t t_us);
+void sleepForUs(int64_t us);
+
+// Com PSRAM o histórico pré-gatilho fica em Pcm16, sem ela em ADPCM
+void setPsram(bool present);
+// Serial do firmware desligada (--quiet)
+void setSerialEnabled(bool enabled);
+// Diretório do host que faz o papel do LittleFS
+void setFsRoot(const std::string &root);
+// xQueueSendFromISR recusados com a fila cheia (só o on_recv do I2S usa)
+uint64_t isrSendsRefused();
+
+//================================================================
+// --- MICROFONE I2S FALSO ---
+//================================================================
+// A fonte preenche 'n' palavras de 32 bits na ordem do stream, como o
+// INMP441 entregaria (com dois microfones, quadros L/R: n par). O DMA só
+// começa em startI2s(), para o sim_main
+// mandar os comandos de controle antes da primeira amostra.
+using I2sSource = std::function<void(int32_t *words, size_t n)>;
+void setI2sSource(I2sSource source);
+void startI2s();
+uint64_t i2sFramesDelivered();
+// O buffer que começa no quadro 'first_frame' da fonte foi recusado pelo
+// on_recv (fila da captura cheia: overrun do DMA). O firmware pula esses
+// quadros com um salto no índice, e o verificador pula junto.
+bool i2sBlockDropped(uint64_t first_frame);
+// Erro do divisor do clock do I2S contra o esp_timer, em ppm (positivo: mais
+// rápido). O APLL (clk_src = I2S_CLK_SRC_APLL) fica exato.
+void setI2sClockPpm(double ppm);
+
+struct I2sStats {
+    uint32_t stops = 0; // i2s_channel_disable com o canal ligado
+    int64_t on_us = 0;  // tempo virtual com o canal ligado
+};
+I2sStats i2sStats();
+
+//================================================================
+// --- GERENCIADOR DE ENERGIA FALSO ---
+//================================================================
+// Tempo em que o firmware deixaria o chip em light sleep: esp_pm_configure
+// com light sleep e nenhum lock do esp_pm segurado (sim/include/esp_pm.h)
+struct PowerStats {
+    bool light_sleep = false;
+    int64_t sleep_us = 0;
+    int64_t i2s_on_us = 0;
+    uint32_t i2s_stops = 0;
+};
+PowerStats powerStats();
+
+//================================================================
+// --- ENLACE BLE FALSO ---
+//================================================================
+// Modelo de vazão: a cada evento de conexão saem até 'per_event'
+// notificações da fila de transmissão da pilha. Com a fila cheia o envio
+// falha (ESP_FAIL) e o firmware recebe ESP_GATTS_CONGEST_EVT; quando ela
+// esvazia pela metade, o evento de descongestionamento. 'loss' é a
+// probabilidade de uma notificação enviada não chegar ao central.
+struct LinkConfig {
+    uint16_t mtu = 517;          // pedido pelo central; vale o menor com o do servidor
+    double interval_ms = 7.5;    // intervalo de conexão
+    uint32_t per_event = 6;      // notificações por evento de conexão
+    uint32_t queue_packets = 20; // fila de transmissão da pilha
+    double loss = 0.0;
+    uint32_t seed = 1;
+    // Cópia de tudo que chega ao central: arquivo, ou "unix:/caminho" para
+    // um socket UNIX de datagramas (um registro por datagrama)
+    std::string output;
+};
+
+// Registro da saída: u16 tamanho da carga | u8 característica (último byte
+// do UUID) | u8 flags | u64 instante da entrega em µs | carga. Tudo LE.
+constexpr size_t LINK_RECORD_HEADER = 12;
+constexpr uint8_t LINK_FLAG_LOST = 0x01; // a notificação não chegou ao central
+
+struct LinkStats {
+    uint64_t sent = 0;      // aceitas na fila
+    uint64_t delivered = 0;
+    uint64_t lost = 0;      // sorteadas pela perda do enlace
+    uint64_t rejected = 0;  // fila cheia ou sem conexão
+    uint64_t truncated = 0; // maiores que MTU - 3
+    uint64_t bytes = 0;     // carga entregue
+    uint32_t congestions = 0;
+    uint32_t max_queue = 0;
+};
+
+bool configureLink(const LinkConfig &config);
+LinkStats linkStats();
+
+// Chamado na thread do rádio a cada notificação entregue
+using LinkSink = std::function<void(uint8_t characteristic, const uint8_t *data, size_t len, int64_t t_us)>;
+void setLinkSink(LinkSink sink);
+
+//================================================================
+// --- O CENTRAL (CELULAR) ---
+//================================================================
+// Conecta, negocia o MTU e liga as notificações de todos os CCCDs
+void connect();
+void disconnect();
+bool connected();
+// Escrita do central numa característica (chama o onWrite do firmware)
+bool writeCharacteristic(uint8_t characteristic, const uint8_t *data, size_t len);
+// Leitura do valor atual (vazio se a característica não existe)
+std::string readCharacteristic(uint8_t characteristic);
+
+} // namespace sim
@@ -0,0 +1,755 @@
+// Simulação do firmware de streaming (current.cpp) no Linux, de ponta a
+// ponta: microfone falso -> setup()/tarefas do firmware -> enlace BLE
+// simulado -> receptor no lugar do app, que mede vazão, latência e perdas
+// e, com --verify, confere cada amostra contra o mesmo DSP rodado à parte.
+//
+// Uso: stetho_sim [opções]
+//   --seconds S        duração em segundos virtuais (padrão 10)
+//   --speed X          relógio virtual X vezes mais rápido que o real (padrão 1)
+//   --connect-after S  o central conecta depois de S segundos (padrão 1)
+//   --reconnect S      desconecta e reconecta a cada S segundos (padrão: nunca)
+//   --away S           tempo desconectado em cada reconexão (padrão 0,2); acima
+//                      do IDLE_CAPTURE_SECONDS do firmware o I2S para no meio
+//   --clock-ppm P      erro do clock do I2S contra o esp_timer (padrão 0); o
+//                      relatório mostra a taxa que o firmware mediu
+//   --signal CMD       fonte gerada, no formato da serial do signal_generator
+//                      ("heart 75", "sine 440", "chirp 20 1000 2", "prbs 7",
+//                      "amp 8000"...); pode repetir, padrão "heart 75"
+//   --wav ARQ          arquivo WAV em laço no lugar do gerador
+//   --ambient CMD      só no stetho_sim_stereo: ruído ambiente no microfone de
+//                      fora, que chega ao do peito por um caminho fixo; mesmo
+//                      formato do --signal, padrão "prbs" e "amp 4000"
+//   --stereo cancel|bypass|interleaved  modo dos dois microfones (stetho_sim_stereo)
+//   --mtu N --interval MS --per-event N --queue N --loss P --seed N
+//                      enlace (padrão 517, 7.5 ms, 6, 20, 0, 1)
+//   --out ARQ | --out unix:/CAMINHO
+//                      cópia de cada notificação entregue (registros de sim/sim.h)
+//   --codec pcm16|rice|adpcm  --rate 20000|10000|8000|4000
+//   --filter wideband|heart|lung  --legacy (sem enquadramento)
+//   --scaling fixed|bfp|agc  escala do stream (expoente de ganho por quadro)
+//   --fs DIR           diretório que faz o papel do LittleFS
+//   --record ARQ       WAV gravado pelo receptor portátil (core/stream_receiver.h)
+//                      enquanto as notificações chegam
+//   --no-psram         histórico pré-gatilho em ADPCM na RAM interna
+//   --quiet            sem a serial do firmware
+//   --verify           confere as amostras recebidas (falha com código 1)
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/biquad.h"
+#include "core/block_float.h"
+#include "core/control_protocol.h"
+#include "core/frame.h"
+#include "core/noise_canceller.h"
+#include "core/pipeline.h"
+#include "core/reassembler.h"
+#include "core/resampler.h"
+#include "core/stream_receiver.h"
+#include "core/signal_generator.h"
+#include "core/stats.h"
+#include "core/stream_format.h"
+#include "sim/sim.h"
+#include "sim/wav_source.h"
+
+void setup();
+void loop();
+
+namespace {
+
+// Mesma taxa e mesmo bloco do I2S do current.cpp (I2S_SAMPLE_RATE e
+// I2S_BUFFER_SAMPLES): a troca de filtro é feita ao longo de um bloco, e a
+// referência precisa ver os mesmos blocos
+constexpr uint32_t I2S_RATE_HZ = 20000;
+constexpr size_t I2S_BLOCK = 250;
+// MAINS_FREQUENCY_HZ do current.cpp: a referência condiciona o buffer igual
+constexpr int MAINS_HZ = 60;
+
+// Compilado junto com o current.cpp: 2 no alvo stetho_sim_stereo
+#ifndef CAPTURE_CHANNELS
+#define CAPTURE_CHANNELS 1
+#endif
+
+constexpr uint8_t CHR_AUDIO = 0xa8;
+constexpr uint8_t CHR_CONTROL = 0xa9;
+constexpr uint8_t CHR_STREAM_INFO = 0xaa;
+constexpr uint8_t CHR_DIAGNOSTICS = 0xaf;
+
+struct Options {
+    double seconds = 10.0;
+    double speed = 1.0;
+    double connect_after = 1.0;
+    double reconnect = 0.0;
+    double away = 0.2;
+    double clock_ppm = 0.0;
+    std::vector<std::string> signal;
+    std::vector<std::string> ambient;
+    std::string wav;
+    sim::LinkConfig link;
+    stetho::StreamCodec codec = stetho::StreamCodec::Pcm16;
+    stetho::OutputRate rate = stetho::OutputRate::Hz20000;
+    stetho::FilterMode filter = stetho::FilterMode::Wideband;
+    stetho::ScalingMode scaling = stetho::ScalingMode::Fixed;
+    stetho::StereoMode stereo = stetho::StereoMode::Cancel;
+    bool framed = true;
+    std::string fs = "/tmp/stetho_sim_fs";
+    std::string record;
+    bool psram = true;
+    bool quiet = false;
+    bool verify = false;
+};
+
+//================================================================
+// --- FONTE DO MICROFONE ---
+//================================================================
+// O firmware e a referência do --verify precisam de cópias independentes da
+// mesma fonte, então ela é criada por uma fábrica
+struct SourceFactory {
+    stetho::GeneratorConfig generator;
+    stetho::GeneratorConfig ambient;
+    std::shared_ptr<const sim::WavSource> wav;
+
+    sim::I2sSource make() const {
+        sim::I2sSource chest = makeChest();
+#if CAPTURE_CHANNELS == 2
+        return makeStereo(std::move(chest));
+#else
+        return chest;
+#endif
+    }
+
+private:
+    sim::I2sSource makeChest() const {
+        if (wav) {
+            auto state = std::make_shared<sim::WavSource>(*wav);
+            return [state](int32_t *words, size_t n) { state->fill(words, n); };
+        }
+        auto gen = std::make_shared<stetho::SignalGenerator>();
+        gen->configure(generator, I2S_RATE_HZ);
+        return [gen](int32_t *words, size_t n) {
+            int16_t pcm[I2S_BLOCK];
+            while (n > 0) {
+                const size_t len = n < I2S_BLOCK ? n : I2S_BLOCK;
+                gen->generate(pcm, len);
+                // Escala do stream: o >> 14 do firmware devolve a amostra gerada
+                for (size_t i = 0; i < len; i++) words[i] = (int32_t)pcm[i] * (1 << stetho::I2S_TO_INT16_SHIFT);
+                words += len;
+                n -= len;
+            }
+        };
+    }
+
+    // Quadros L/R: o peito recebe o próprio sinal mais o ambiente pelo
+    // caminho AMBIENT_PATH (atraso e eco curtos); o de fora, só o ambiente
+    static constexpr size_t AMBIENT_TAPS = 6;
+    static constexpr double AMBIENT_PATH[AMBIENT_TAPS] = {0.0, 0.0, 0.0, 0.5, 0.3, -0.2};
+
+    sim::I2sSource makeStereo(sim::I2sSource chest) const {
+        struct State {
+            sim::I2sSource chest;
+            stetho::SignalGenerator gen;
+            int32_t history[AMBIENT_TAPS - 1] = {}; // ambiente mais recente primeiro
+        };
+        auto state = std::make_shared<State>();
+        state->chest = std::move(chest);
+        state->gen.configure(ambient, I2S_RATE_HZ);
+        return [state](int32_t *words, size_t n) {
+            int32_t left[I2S_BLOCK];
+            int16_t pcm[I2S_BLOCK];
+            size_t frames = n / 2;
+            while (frames > 0) {
+                const size_t len = frames < I2S_BLOCK ? frames : I2S_BLOCK;
+                state->chest(left, len);
+                state->gen.generate(pcm, len);
+                for (size_t i = 0; i < len; i++) {
+                    int32_t *h = state->history;
+                    double coupled = AMBIENT_PATH[0] * pcm[i];
+                    for (size_t k = 1; k < AMBIENT_TAPS; k++) coupled += AMBIENT_PATH[k] * h[k - 1];
+                    for (size_t k = AMBIENT_TAPS - 2; k > 0; k--) h[k] = h[k - 1];
+                    h[0] = pcm[i];
+                    words[2 * i] = left[i] + (int32_t)std::lround(coupled) * (1 << stetho::I2S_TO_INT16_SHIFT);
+                    words[2 * i + 1] = (int32_t)pcm[i] * (1 << stetho::I2S_TO_INT16_SHIFT);
+                }
+                words += 2 * len;
+                frames -= len;
+            }
+        };
+    }
+};
+
+//================================================================
+// --- REFERÊNCIA DO --verify ---
+//================================================================
+// O mesmo pipeline da tarefa de captura (DC e rede, filtro no buffer, decimação,
+// escala), a partir do mesmo modo, taxa e escala iniciais e com os mesmos
+// pedidos de troca. Guarda o expoente de cada amostra: a rajada do histórico
+// chega na escala fixa (g = 0) mesmo com o ao vivo em ponto flutuante.
+// Com dois microfones, também o cancelador e, no modo intercalado, o
+// caminho do microfone de fora. Os buffers que a captura perdeu (overrun do
+// DMA) são pulados como no firmware: a fonte anda, o pipeline não vê o
+// bloco e o índice salta do mesmo tanto.
+class Verifier {
+public:
+    Verifier(const SourceFactory &factory, stetho::FilterMode mode, stetho::OutputRate rate,
+             stetho::ScalingMode scaling, stetho::StereoMode stereo, bool lossless)
+        : source_(factory.make()), pipeline_(I2S_RATE_HZ, stetho::FilterMode::Wideband, dec_),
+#if CAPTURE_CHANNELS == 2
+          reference_(I2S_RATE_HZ, stetho::FilterMode::Wideband, reference_dec_),
+#endif
+          lossless_(lossless) {
+        pipeline_.requestMode(mode);
+        dec_.requestRate(rate);
+#if CAPTURE_CHANNELS == 2
+        pipeline_.conditioning().requestMode(stereo);
+        // O firmware fixa a escala no modo intercalado
+        if (stereo == stetho::StereoMode::Interleaved) scaling = stetho::ScalingMode::Fixed;
+#else
+        (void)stereo;
+#endif
+        pipeline_.scaling().requestMode(scaling);
+    }
+
+    void check(uint64_t index, const int16_t *samples, size_t n, int gain_exp) {
+        // Trecho já conferido (rajada do histórico depois de reconectar)
+        if (index < first_) {
+            const uint64_t skip = first_ - index;
+            if (skip >= n) return;
+            index += skip;
+            samples += skip;
+            n -= (size_t)skip;
+        }
+        while (first_ + ref_.size() < index + n) produceBlock();
+        ref_.erase(ref_.begin(), ref_.begin() + (size_t)(index - first_));
+        first_ = index;
+        for (size_t i = 0; i < n; i++) {
+            int16_t ref = ref_[i].sample;
+            if (gain_exp != ref_[i].gain_exp) {
+                // Só a escala fixa do histórico difere da referência
+                if (gain_exp != 0) gain_mismatches_++;
+                stetho::toFixedScale(&ref, &ref, 1, ref_[i].gain_exp);
+            }
+            const double e = (double)samples[i] - (double)ref;
+            if (e != 0.0) mismatches_++;
+            err_energy_ += e * e;
+            ref_energy_ += (double)ref * ref;
+        }
+        checked_ += n;
+        ref_.erase(ref_.begin(), ref_.begin() + n);
+        first_ += n;
+    }
+
+    uint64_t checked() const { return checked_; }
+    uint64_t mismatches() const { return mismatches_ + gain_mismatches_; }
+    uint64_t droppedBlocks() const { return dropped_blocks_; }
+    bool lossless() const { return lossless_; }
+    double snrDb() const {
+        if (err_energy_ == 0.0) return INFINITY;
+        return 10.0 * std::log10(ref_energy_ / err_energy_);
+    }
+
+private:
+    struct RefSample {
+        int16_t sample;
+        int8_t gain_exp;
+    };
+
+    void produceBlock() {
+        int32_t dma[CAPTURE_CHANNELS * I2S_BLOCK];
+        int16_t out[I2S_BLOCK + 1];
+        uint64_t skipped = 0;
+        while (sim::i2sBlockDropped(frame_)) {
+            source_(dma, CAPTURE_CHANNELS * I2S_BLOCK);
+            frame_ += I2S_BLOCK;
+            skipped += I2S_BLOCK;
+            dropped_blocks_++;
+        }
+        if (skipped > 0) {
+            // O salto do audioCaptureTask, com a taxa e os canais do último bloco
+            const uint64_t jump = skipped * dec_.rateHz() / I2S_RATE_HZ * channels_;
+            ref_.insert(ref_.end(), (size_t)jump, RefSample{0, 0});
+        }
+        source_(dma, CAPTURE_CHANNELS * I2S_BLOCK);
+        frame_ += I2S_BLOCK;
+        size_t n = pipeline_.process(dma, out, I2S_BLOCK);
+        const int8_t g = (int8_t)pipeline_.scaling().gainExp();
+#if CAPTURE_CHANNELS == 2
+        // Como a tarefa de captura: o caminho de fora roda em todo bloco
+        int16_t outside[I2S_BLOCK + 1];
+        reference_.requestMode(pipeline_.mode());
+        reference_dec_.requestRate(dec_.rate());
+        const size_t m = reference_.process(pipeline_.conditioning().reference(), outside, I2S_BLOCK);
+        if (pipeline_.conditioning().mode() == stetho::StereoMode::Interleaved) {
+            if (m < n) n = m;
+            for (size_t i = 0; i < n; i++) {
+                ref_.push_back({out[i], 0});
+                ref_.push_back({outside[i], 0});
+            }
+            channels_ = 2;
+            return;
+        }
+#endif
+        channels_ = 1;
+        for (size_t i = 0; i < n; i++) ref_.push_back({out[i], g});
+    }
+
+    sim::I2sSource source_;
+    stetho::Decimator dec_;
+#if CAPTURE_CHANNELS == 2
+    stetho::CapturePipeline<stetho::FilterBank, stetho::Decimated, stetho::BlockScaling,
+                            stetho::DualMicConditioning<stetho::MainsConditioning<MAINS_HZ>>>
+        pipeline_;
+    stetho::Decimator reference_dec_;
+    stetho::CapturePipeline<stetho::FilterBank, stetho::Decimated> reference_;
+#else
+    stetho::CapturePipeline<stetho::FilterBank, stetho::Decimated, stetho::BlockScaling,
+                            stetho::MainsConditioning<MAINS_HZ>>
+        pipeline_;
+#endif
+    std::deque<RefSample> ref_;
+    uint64_t first_ = 0; // índice de ref_[0]
+    uint64_t frame_ = 0; // próximo quadro da fonte
+    uint64_t channels_ = 1;
+    uint64_t dropped_blocks_ = 0;
+    bool lossless_;
+    uint64_t checked_ = 0;
+    uint64_t mismatches_ = 0;
+    uint64_t gain_mismatches_ = 0;
+    double err_energy_ = 0.0;
+    double ref_energy_ = 0.0;
+};
+
+//================================================================
+// --- O APP ---
+//================================================================
+// Recebe as notificações na thread do rádio: StreamInfo, diagnóstico e
+// áudio (enquadrado pelo Reassembler, ou só contado no stream legado)
+class Receiver : public stetho::ReassemblerSink {
+public:
+    // Com perda no enlace a notificação do StreamInfo também pode sumir; aí,
+    // como o app, o receptor lê a característica enquanto não sabe se o
+    // stream é enquadrado ou se a rajada acabou. Sem perda vale só a
+    // notificação, que chega na ordem certa em relação ao áudio.
+    Receiver(Verifier *verifier, bool poll_info) : verifier_(verifier), poll_info_(poll_info) {}
+
+    // O app com o receptor portátil: mesmo caminho das notificações, WAV no disco
+    void record(const std::string &path) {
+        recorder_.reset(new stetho::StreamReceiver(nullptr));
+        record_path_ = path;
+    }
+
+    void onConnect() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Cada conexão é um stream novo para o app (sequência recomeça)
+        if (reassembler_) {
+            reassembler_->flush();
+            accumulate(reassembler_->stats());
+        }
+        reassembler_.reset(new stetho::Reassembler(*this));
+        gain_exp_ = 0;
+        backfill_ = true; // até o StreamInfo dizer o contrário
+        connect_us_ = sim::nowUs();
+        if (recorder_) recorder_->onConnect();
+    }
+
+    void onPacket(uint8_t characteristic, const uint8_t *data, size_t len, int64_t t_us) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (characteristic == CHR_STREAM_INFO) {
+            stetho::StreamInfo info;
+            if (stetho::parseStreamInfo(data, len, info)) {
+                info_ = info;
+                has_info_ = true;
+                backfill_ = (info.flags & stetho::STREAM_FLAG_BACKFILL) != 0;
+            }
+            if (recorder_) recorder_->onStreamInfo(data, len);
+            return;
+        }
+        if (characteristic != CHR_AUDIO) return;
+        if (poll_info_ && (backfill_ || !has_info_ || !(info_.flags & stetho::STREAM_FLAG_FRAMED))) {
+            const std::string v = sim::readCharacteristic(CHR_STREAM_INFO);
+            stetho::StreamInfo info;
+            if (stetho::parseStreamInfo((const uint8_t *)v.data(), v.size(), info)) {
+                info_ = info;
+                has_info_ = true;
+                backfill_ = (info.flags & stetho::STREAM_FLAG_BACKFILL) != 0;
+            }
+            if (recorder_) recorder_->onStreamInfo((const uint8_t *)v.data(), v.size());
+        }
+        if (recorder_) {
+            // O formato do WAV sai do primeiro StreamInfo
+            if (!recorder_->wav().isOpen() && has_info_ && !recorder_->startWav(record_path_.c_str())) {
+                std::fprintf(stderr, "stetho_sim: não abriu %s\n", record_path_.c_str());
+                recorder_.reset();
+            }
+            if (recorder_ && has_info_) recorder_->onAudio(data, len);
+        }
+
+        if (first_audio_us_ < 0) first_audio_us_ = t_us;
+        if (connect_us_ >= 0) {
+            connect_latency_us_.push_back(t_us - connect_us_);
+            connect_us_ = -1;
+        }
+        last_audio_us_ = t_us;
+        packets_++;
+        bytes_ += len;
+        if (!has_info_ || !(info_.flags & stetho::STREAM_FLAG_FRAMED)) {
+            legacy_samples_ += len / 2;
+            return;
+        }
+        stetho::FrameHeader h;
+        int16_t samples[stetho::Reassembler::MAX_FRAME_SAMPLES];
+        if (stetho::readFrameHeader(data, len, h)) {
+            const int n = stetho::Reassembler::decodePayload(h.codec, data + stetho::FRAME_HEADER_SIZE,
+                                                             len - stetho::FRAME_HEADER_SIZE, samples);
+            if (n > 0 && !backfill_ && info_.sample_rate_hz > 0) {
+                // Da captura da última amostra do quadro até a entrega ao app
+                const uint32_t last_us = h.timestamp_us + (uint32_t)((uint64_t)(n - 1) * 1000000 / info_.sample_rate_hz);
+                latency_us_.push_back((int32_t)((uint32_t)t_us - last_us));
+            }
+            if (n > 0 && backfill_) backfill_samples_ += (uint64_t)n;
+        }
+        reassembler_->push(data, len);
+    }
+
+    void onSamples(uint64_t index, const int16_t *samples, size_t n, bool gap) override {
+        samples_ += n;
+        if (gap) return;
+        if (verifier_) verifier_->check(index, samples, n, gain_exp_);
+    }
+
+    void onGain(uint64_t, int gain_exp) override { gain_exp_ = gain_exp; }
+
+    void report(int64_t connected_us, int64_t end_us) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (reassembler_) {
+            reassembler_->flush();
+            accumulate(reassembler_->stats());
+            reassembler_.reset();
+        }
+        const bool framed = has_info_ && (info_.flags & stetho::STREAM_FLAG_FRAMED);
+        const double span_s = (double)(end_us - connected_us) / 1e6;
+        const uint64_t samples = framed ? samples_ - totals_.gap_samples : legacy_samples_;
+        std::printf("áudio: %llu notificações, %.1f kB/s de carga, %.0f amostras/s (%llu do histórico, taxa %u Hz)\n",
+                    (unsigned long long)packets_, span_s > 0 ? (double)bytes_ / 1000.0 / span_s : 0.0,
+                    span_s > 0 ? (double)samples / span_s : 0.0, (unsigned long long)backfill_samples_,
+                    has_info_ ? info_.sample_rate_hz : 0);
+        if (!framed) {
+            std::printf("latência: sem enquadramento não há timestamp no stream\n");
+            return;
+        }
+        if (latency_us_.empty()) {
+            std::printf("latência: nenhum quadro ao vivo (a rajada do histórico não terminou)\n");
+        } else {
+            std::vector<int32_t> v = latency_us_;
+            std::sort(v.begin(), v.end());
+            double sum = 0.0;
+            for (int32_t x : v) sum += x;
+            auto pct = [&](double p) { return v[std::min(v.size() - 1, (size_t)(p * (double)v.size()))] / 1000.0; };
+            std::printf("latência captura -> app (ao vivo): média %.1f ms, p50 %.1f, p99 %.1f, máx %.1f (%zu quadros)\n",
+                        sum / (double)v.size() / 1000.0, pct(0.50), pct(0.99), v.back() / 1000.0, v.size());
+        }
+        std::printf("reassembler: %u quadros, %u buracos (%llu amostras), %u duplicados, %u fora de ordem, %u inválidos\n",
+                    totals_.frames, totals_.gaps, (unsigned long long)totals_.gap_samples, totals_.duplicates,
+                    totals_.reordered, totals_.invalid);
+        if (!connect_latency_us_.empty()) {
+            int64_t sum = 0, max = 0;
+            for (int64_t x : connect_latency_us_) {
+                sum += x;
+                max = std::max(max, x);
+            }
+            std::printf("conexão -> primeiro áudio no app: média %.1f ms, máx %.1f ms (%zu conexões)\n",
+                        (double)sum / (double)connect_latency_us_.size() / 1000.0, (double)max / 1000.0,
+                        connect_latency_us_.size());
+        }
+        if (recorder_) {
+            const bool closed = recorder_->stopWav();
+            const stetho::ReceiverStats &s = recorder_->stats();
+            const uint32_t channels = recorder_->wav().channels();
+            std::printf("gravação: %s, %.1f s em %u canal(is) a %.3f Hz, %llu amostras de silêncio, "
+                        "%llu repetidas, %u quebras%s\n",
+                        record_path_.c_str(), (double)recorder_->position() / channels / info_.sample_rate_hz,
+                        channels,
+                        info_.measured_rate_mhz ? info_.measured_rate_mhz / 1000.0 : (double)info_.sample_rate_hz,
+                        (unsigned long long)s.gap_samples, (unsigned long long)s.overlap_samples, s.jumps,
+                        closed ? "" : " (FALHOU ao fechar)");
+        }
+    }
+
+    uint64_t audioSamples() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return samples_ + legacy_samples_;
+    }
+
+private:
+    void accumulate(const stetho::ReassemblerStats &s) {
+        totals_.frames += s.frames;
+        totals_.invalid += s.invalid;
+        totals_.duplicates += s.duplicates;
+        totals_.reordered += s.reordered;
+        totals_.gaps += s.gaps;
+        totals_.gap_samples += s.gap_samples;
+        totals_.samples_out += s.samples_out;
+    }
+
+    std::mutex mutex_;
+    Verifier *verifier_;
+    bool poll_info_;
+    std::unique_ptr<stetho::Reassembler> reassembler_;
+    std::unique_ptr<stetho::StreamReceiver> recorder_;
+    std::string record_path_;
+    stetho::ReassemblerStats totals_;
+    stetho::StreamInfo info_;
+    bool has_info_ = false;
+    bool backfill_ = true;
+    int64_t first_audio_us_ = -1;
+    int64_t last_audio_us_ = 0;
+    uint64_t packets_ = 0;
+    uint64_t bytes_ = 0;
+    uint64_t samples_ = 0;
+    uint64_t legacy_samples_ = 0;
+    uint64_t backfill_samples_ = 0;
+    int gain_exp_ = 0; // expoente das amostras entregues pelo Reassembler
+    std::vector<int32_t> latency_us_;
+    int64_t connect_us_ = -1; // conexão ainda sem áudio
+    std::vector<int64_t> connect_latency_us_;
+};
+
+//================================================================
+// --- LINHA DE COMANDO ---
+//================================================================
+[[noreturn]] void usage(const char *error) {
+    std::fprintf(stderr, "stetho_sim: %s\n(veja o comentário no início de sim/sim_main.cpp)\n", error);
+    std::exit(2);
+}
+
+template <typename T>
+bool pickName(const char *value, std::initializer_list<const char *> names, T &out) {
+    size_t i = 0;
+    for (const char *n : names) {
+        if (std::strcmp(value, n) == 0) {
+            out = (T)i;
+            return true;
+        }
+        i++;
+    }
+    return false;
+}
+
+Options parseArgs(int argc, char **argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> const char * {
+            if (i + 1 >= argc) usage(("falta o valor de " + arg).c_str());
+            return argv[++i];
+        };
+        if (arg == "--seconds") opt.seconds = std::atof(value());
+        else if (arg == "--speed") opt.speed = std::atof(value());
+        else if (arg == "--connect-after") opt.connect_after = std::atof(value());
+        else if (arg == "--reconnect") opt.reconnect = std::atof(value());
+        else if (arg == "--away") opt.away = std::atof(value());
+        else if (arg == "--clock-ppm") opt.clock_ppm = std::atof(value());
+        else if (arg == "--signal") opt.signal.push_back(value());
+        else if (arg == "--wav") opt.wav = value();
+        else if (arg == "--ambient") opt.ambient.push_back(value());
+        else if (arg == "--mtu") opt.link.mtu = (uint16_t)std::atoi(value());
+        else if (arg == "--interval") opt.link.interval_ms = std::atof(value());
+        else if (arg == "--per-event") opt.link.per_event = (uint32_t)std::atoi(value());
+        else if (arg == "--queue") opt.link.queue_packets = (uint32_t)std::atoi(value());
+        else if (arg == "--loss") opt.link.loss = std::atof(value());
+        else if (arg == "--seed") opt.link.seed = (uint32_t)std::strtoul(value(), nullptr, 10);
+        else if (arg == "--out") opt.link.output = value();
+        else if (arg == "--codec") {
+            if (!pickName(value(), {"pcm16", "rice", "adpcm"}, opt.codec)) usage("codec inválido");
+        } else if (arg == "--rate") {
+            if (!pickName(value(), {"20000", "10000", "8000", "4000"}, opt.rate)) usage("taxa inválida");
+        } else if (arg == "--filter") {
+            if (!pickName(value(), {"wideband", "heart", "lung"}, opt.filter)) usage("filtro inválido");
+        } else if (arg == "--scaling") {
+            if (!pickName(value(), {"fixed", "bfp", "agc"}, opt.scaling)) usage("escala inválida");
+        } else if (arg == "--stereo") {
+            if (!pickName(value(), {"cancel", "bypass", "interleaved"}, opt.stereo)) usage("modo estéreo inválido");
+        } else if (arg == "--legacy") opt.framed = false;
+        else if (arg == "--fs") opt.fs = value();
+        else if (arg == "--record") opt.record = value();
+        else if (arg == "--psram") opt.psram = true;
+        else if (arg == "--no-psram") opt.psram = false;
+        else if (arg == "--quiet") opt.quiet = true;
+        else if (arg == "--verify") opt.verify = true;
+        else usage(("opção desconhecida: " + arg).c_str());
+    }
+    if (opt.seconds <= 0 || opt.speed <= 0) usage("--seconds e --speed precisam ser positivos");
+    if (opt.away < 0 || (opt.reconnect > 0 && opt.away >= opt.reconnect)) usage("--away precisa ficar entre 0 e o --reconnect");
+    if (opt.link.mtu < 23) usage("MTU mínimo é 23");
+    if (opt.verify && !opt.framed) usage("--verify precisa do stream enquadrado");
+    if (CAPTURE_CHANNELS != 2 && (!opt.ambient.empty() || opt.stereo != stetho::StereoMode::Cancel)) {
+        usage("--ambient e --stereo são do stetho_sim_stereo");
+    }
+    if (opt.signal.empty()) opt.signal.push_back("heart 75");
+    if (opt.ambient.empty()) opt.ambient = {"prbs", "amp 4000"};
+    return opt;
+}
+
+void writeControl(stetho::ControlCommand command, uint8_t value) {
+    const uint8_t msg[2] = {(uint8_t)command, value};
+    sim::writeCharacteristic(CHR_CONTROL, msg, sizeof(msg));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const Options opt = parseArgs(argc, argv);
+    sim::setSpeed(opt.speed);
+    sim::setPsram(opt.psram);
+    sim::setSerialEnabled(!opt.quiet);
+    sim::setFsRoot(opt.fs);
+
+    SourceFactory factory;
+    for (const std::string &cmd : opt.signal) {
+        if (stetho::parseGeneratorCommand(cmd.c_str(), factory.generator) != stetho::GeneratorCommand::Signal) {
+            usage(("sinal inválido: " + cmd).c_str());
+        }
+    }
+    for (const std::string &cmd : opt.ambient) {
+        if (stetho::parseGeneratorCommand(cmd.c_str(), factory.ambient) != stetho::GeneratorCommand::Signal) {
+            usage(("ambiente inválido: " + cmd).c_str());
+        }
+    }
+    if (!opt.wav.empty()) {
+        auto wav = std::make_shared<sim::WavSource>();
+        std::string error;
+        if (!wav->load(opt.wav, I2S_RATE_HZ, error)) usage(error.c_str());
+        factory.wav = wav;
+    }
+    if (!sim::configureLink(opt.link)) usage(("não abriu a saída " + opt.link.output).c_str());
+    sim::setI2sSource(factory.make());
+    sim::setI2sClockPpm(opt.clock_ppm);
+
+    std::unique_ptr<Verifier> verifier;
+    if (opt.verify) {
+        verifier.reset(new Verifier(factory, opt.filter, opt.rate, opt.scaling, opt.stereo,
+                                    opt.codec != stetho::StreamCodec::ImaAdpcm));
+    }
+    Receiver receiver(verifier.get(), opt.link.loss > 0.0);
+    if (!opt.record.empty()) receiver.record(opt.record);
+    sim::setLinkSink([&receiver](uint8_t chr, const uint8_t *data, size_t len, int64_t t_us) {
+        receiver.onPacket(chr, data, len, t_us);
+    });
+
+    setup();
+    // Configuração do stream antes da primeira amostra (o app mandaria ao
+    // conectar, mas assim a referência do --verify começa igual)
+    writeControl(stetho::ControlCommand::SetFilterMode, (uint8_t)opt.filter);
+    writeControl(stetho::ControlCommand::SetFraming, opt.framed ? 1 : 0);
+    writeControl(stetho::ControlCommand::SetScaling, (uint8_t)opt.scaling);
+    if (CAPTURE_CHANNELS == 2) writeControl(stetho::ControlCommand::SetStereo, (uint8_t)opt.stereo);
+    writeControl(stetho::ControlCommand::SetCodec, (uint8_t)opt.codec);
+    writeControl(stetho::ControlCommand::SetOutputRate, (uint8_t)opt.rate);
+    const int64_t boot_us = sim::nowUs();
+    sim::startI2s();
+    std::thread([] {
+        while (true) loop();
+    }).detach();
+
+    // O central: conecta, e opcionalmente cai e volta periodicamente
+    const auto real_start = std::chrono::steady_clock::now();
+    const int64_t end_us = boot_us + (int64_t)(opt.seconds * 1e6);
+    int64_t connected_us = boot_us + (int64_t)(opt.connect_after * 1e6);
+    sim::sleepUntilUs(connected_us);
+    receiver.onConnect();
+    sim::connect();
+    uint32_t reconnects = 0;
+    if (opt.reconnect > 0) {
+        const int64_t away_us = (int64_t)(opt.away * 1e6);
+        for (int64_t t = connected_us + (int64_t)(opt.reconnect * 1e6); t + away_us < end_us;
+             t += (int64_t)(opt.reconnect * 1e6)) {
+            sim::sleepUntilUs(t);
+            sim::disconnect();
+            sim::sleepForUs(away_us);
+            receiver.onConnect();
+            sim::connect();
+            reconnects++;
+        }
+    }
+    sim::sleepUntilUs(end_us);
+    const double real_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - real_start).count();
+
+    // Contadores do firmware pela leitura da característica de diagnóstico
+    stetho::Diagnostics diag;
+    const std::string d = sim::readCharacteristic(CHR_DIAGNOSTICS);
+    const bool has_diag = stetho::parseDiagnostics((const uint8_t *)d.data(), d.size(), diag);
+    stetho::StreamInfo info;
+    const std::string si = sim::readCharacteristic(CHR_STREAM_INFO);
+    const bool has_info = stetho::parseStreamInfo((const uint8_t *)si.data(), si.size(), info);
+    const sim::LinkStats link = sim::linkStats();
+
+    sim::setSerialEnabled(false);
+    std::fflush(stdout);
+    std::printf("\n=== stetho_sim: %.1f s virtuais em %.1f s (x%.1f), conexão em %.1f s, %u reconexões ===\n",
+                opt.seconds, real_s, opt.seconds / real_s, opt.connect_after, reconnects);
+    std::printf("enlace: MTU %u, intervalo %.2f ms, %u notificações/evento, fila %u, perda %.3f\n", opt.link.mtu,
+                opt.link.interval_ms, opt.link.per_event, opt.link.queue_packets, opt.link.loss);
+    std::printf("        %llu enviadas, %llu entregues, %llu perdidas, %llu recusadas, %llu truncadas, "
+                "%u congestionamentos, fila máx %u\n",
+                (unsigned long long)link.sent, (unsigned long long)link.delivered, (unsigned long long)link.lost,
+                (unsigned long long)link.rejected, (unsigned long long)link.truncated, link.congestions,
+                link.max_queue);
+    receiver.report(connected_us, end_us);
+    if (has_diag) {
+        std::printf("firmware: overruns DMA %u, fila cheia %u, notify falhos %u, DSP %u ciclos/bloco (p99 %u)\n",
+                    diag.dma_overruns, diag.ring_overflows, diag.notify_failures, diag.stages[1].avg,
+                    diag.stages[1].p99);
+        const sim::PowerStats power = sim::powerStats();
+        const double total_us = (double)(sim::nowUs() - boot_us);
+        std::printf("energia: I2S ligado %.1f%% (%u paradas, %u s parado), light sleep possível %.1f%% do tempo%s\n",
+                    100.0 * (double)power.i2s_on_us / total_us, power.i2s_stops, diag.capture_idle_s,
+                    100.0 * (double)power.sleep_us / total_us, power.light_sleep ? "" : " (desligado)");
+        std::printf("        conexão -> primeiro áudio no firmware: última %.1f ms (%s), máx %.1f ms quente, "
+                    "%.1f ms fria\n",
+                    diag.connect_latency_us / 1000.0, diag.last_connect_cold ? "fria" : "quente",
+                    diag.connect_latency_max_warm_us / 1000.0, diag.connect_latency_max_cold_us / 1000.0);
+    }
+    // Só relatório: a medida precisa de alguns segundos de captura contínua
+    // e, no relógio virtual, a ISR atrasa com o escalonamento do host
+    if (has_info && info.measured_rate_mhz > 0) {
+        const double measured_ppm = ((double)info.measured_rate_mhz / 1000.0 / info.sample_rate_hz - 1.0) * 1e6;
+        std::printf("relógio: taxa medida %.3f Hz (%+.1f ppm, configurado %+.1f), offset %d µs\n",
+                    info.measured_rate_mhz / 1000.0, measured_ppm, opt.clock_ppm, info.clock_offset_us);
+    } else if (has_info) {
+        std::printf("relógio: ainda sem medida da taxa\n");
+    }
+
+    bool ok = receiver.audioSamples() > 0;
+    if (!ok) std::printf("FALHOU: nenhuma amostra de áudio chegou ao app\n");
+    if (verifier) {
+        std::printf("verificação: %llu amostras conferidas, %llu diferentes", (unsigned long long)verifier->checked(),
+                    (unsigned long long)verifier->mismatches());
+        if (verifier->droppedBlocks() > 0) {
+            std::printf(", %llu buffers do DMA pulados", (unsigned long long)verifier->droppedBlocks());
+        }
+        if (!verifier->lossless()) std::printf(", SNR %.1f dB (codec com perdas)", verifier->snrDb());
+        std::printf("\n");
+        if (verifier->checked() == 0) ok = false;
+        if (verifier->lossless() && verifier->mismatches() > 0) {
+            ok = false;
+            // Depois de um overrun o DMA pode sobrescrever um buffer que a
+            // captura ainda está lendo: isso é erro de verdade no stream
+            if (verifier->droppedBlocks() > 0) std::printf("(houve overrun do DMA: tente um --speed menor)\n");
+        }
+    }
+    std::printf("%s\n", ok ? "OK" : "FALHOU");
+    std::fflush(stdout);
+    // As tarefas do firmware não terminam; sai sem destruir nada
+    std::_Exit(ok ? 0 : 1);
+}
@@ -0,0 +1,327 @@
+// Runtime do simulador: relógio virtual, tarefas e filas do FreeRTOS sobre
+// std::thread (com event groups), Serial, heap e o resto do core Arduino que os firmwares usam.
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <freertos/event_groups.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/stats.h"
+#include "sim/sim.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const Clock::time_point bootTime = Clock::now();
+std::atomic<double> clockSpeed(1.0);
+std::atomic<bool> psramPresent(true);
+std::atomic<bool> serialEnabled(true);
+std::atomic<uint64_t> isrRefused(0);
+
+// Instante do host em que o relógio virtual chega a 't_us'
+Clock::time_point realTimeOf(int64_t t_us) {
+    const double real_us = (double)t_us / clockSpeed.load();
+    return bootTime + std::chrono::microseconds((int64_t)real_us);
+}
+
+Clock::time_point realDeadline(TickType_t ticks) {
+    return realTimeOf(sim::nowUs() + (int64_t)ticks * 1000 * portTICK_PERIOD_MS);
+}
+
+} // namespace
+
+namespace sim {
+
+void setSpeed(double speed) {
+    if (speed > 0.0) clockSpeed.store(speed);
+}
+
+double speed() { return clockSpeed.load(); }
+
+int64_t nowUs() {
+    const auto real = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - bootTime).count();
+    return (int64_t)((double)real * clockSpeed.load());
+}
+
+void sleepUntilUs(int64_t t_us) { std::this_thread::sleep_until(realTimeOf(t_us)); }
+
+void sleepForUs(int64_t us) { sleepUntilUs(nowUs() + us); }
+
+void setPsram(bool present) { psramPresent.store(present); }
+
+void setSerialEnabled(bool enabled) { serialEnabled.store(enabled); }
+
+uint64_t isrSendsRefused() { return isrRefused.load(); }
+
+} // namespace sim
+
+//================================================================
+// --- TAREFAS ---
+//================================================================
+// Cada tarefa tem o seu contador de notificação. Threads que não foram
+// criadas por xTaskCreate (o loop() do sim_main, o rádio) ganham um na
+// primeira vez que precisam.
+
+struct SimTask {
+    const char *name = "";
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t notify = 0;
+};
+
+namespace {
+
+std::mutex tasksMutex;
+std::vector<std::unique_ptr<SimTask>> tasks;
+thread_local SimTask *currentTask = nullptr;
+
+SimTask *newTask(const char *name) {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    tasks.emplace_back(new SimTask());
+    tasks.back()->name = name;
+    return tasks.back().get();
+}
+
+} // namespace
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t, void *param, UBaseType_t,
+                                   TaskHandle_t *handle, BaseType_t) {
+    SimTask *task = newTask(name);
+    if (handle) *handle = task;
+    std::thread([task, fn, param] {
+        currentTask = task;
+        fn(param);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *param,
+                       UBaseType_t priority, TaskHandle_t *handle) {
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, param, priority, handle, 0);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    if (!currentTask) currentTask = newTask("thread");
+    return currentTask;
+}
+
+void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_until(realDeadline(ticks)); }
+
+TickType_t xTaskGetTickCount() { return (TickType_t)(sim::nowUs() / 1000 / portTICK_PERIOD_MS); }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    if (!task) return pdFAIL;
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->notify++;
+    }
+    task->cv.notify_one();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+    xTaskNotifyGive(task);
+    if (woken) *woken = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    SimTask *task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    if (ticks == portMAX_DELAY) {
+        task->cv.wait(lock, [task] { return task->notify > 0; });
+    } else {
+        task->cv.wait_until(lock, realDeadline(ticks), [task] { return task->notify > 0; });
+    }
+    const uint32_t value = task->notify;
+    if (value > 0) task->notify = clear_on_exit ? 0 : value - 1;
+    return value;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+//================================================================
+// --- FILAS ---
+//================================================================
+struct SimQueue {
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    size_t item_size;
+    size_t capacity;
+    size_t head = 0;
+    size_t count = 0;
+    std::vector<uint8_t> storage;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    SimQueue *q = new SimQueue();
+    q->item_size = item_size;
+    q->capacity = length;
+    q->storage.resize((size_t)length * item_size);
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(q->mutex);
+    auto has_room = [q] { return q->count < q->capacity; };
+    if (ticks == portMAX_DELAY) q->not_full.wait(lock, has_room);
+    else if (!q->not_full.wait_until(lock, realDeadline(ticks), has_room)) return pdFAIL;
+    const size_t tail = (q->head + q->count) % q->capacity;
+    std::memcpy(&q->storage[tail * q->item_size], item, q->item_size);
+    q->count++;
+    lock.unlock();
+    q->not_empty.notify_one();
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken) {
+    const BaseType_t ok = xQueueSend(q, item, 0);
+    if (woken && ok == pdPASS) *woken = pdTRUE;
+    if (ok != pdPASS) isrRefused.fetch_add(1);
+    return ok;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(q->mutex);
+    auto has_item = [q] { return q->count > 0; };
+    if (ticks == portMAX_DELAY) q->not_empty.wait(lock, has_item);
+    else if (!q->not_empty.wait_until(lock, realDeadline(ticks), has_item)) return pdFAIL;
+    std::memcpy(item, &q->storage[q->head * q->item_size], q->item_size);
+    q->head = (q->head + 1) % q->capacity;
+    q->count--;
+    lock.unlock();
+    q->not_full.notify_one();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+    std::lock_guard<std::mutex> lock(q->mutex);
+    return (UBaseType_t)q->count;
+}
+
+//================================================================
+// --- EVENT GROUPS ---
+//================================================================
+struct SimEventGroup {
+    std::mutex mutex;
+    std::condition_variable changed;
+    EventBits_t bits = 0;
+};
+
+EventGroupHandle_t xEventGroupCreate() { return new SimEventGroup(); }
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t g, EventBits_t bits) {
+    EventBits_t now;
+    {
+        std::lock_guard<std::mutex> lock(g->mutex);
+        now = g->bits |= bits;
+    }
+    g->changed.notify_all();
+    return now;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t g, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(g->mutex);
+    const EventBits_t before = g->bits;
+    g->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t g) {
+    std::lock_guard<std::mutex> lock(g->mutex);
+    return g->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(g->mutex);
+    auto satisfied = [&] { return wait_for_all ? (g->bits & bits) == bits : (g->bits & bits) != 0; };
+    bool ok;
+    if (ticks == portMAX_DELAY) {
+        g->changed.wait(lock, satisfied);
+        ok = true;
+    } else {
+        ok = g->changed.wait_until(lock, realDeadline(ticks), satisfied);
+    }
+    const EventBits_t result = g->bits;
+    if (ok && clear_on_exit) g->bits &= ~bits;
+    return result;
+}
+
+//================================================================
+// --- CORE ARDUINO ---
+//================================================================
+int64_t esp_timer_get_time() { return sim::nowUs(); }
+
+uint32_t millis() { return (uint32_t)(sim::nowUs() / 1000); }
+
+uint32_t micros() { return (uint32_t)sim::nowUs(); }
+
+void delay(uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms)); }
+
+void delayMicroseconds(uint32_t us) { sim::sleepForUs(us); }
+
+uint32_t getCpuFrequencyMhz() {
+    // Mede o contador de ciclos do host uma vez (TSC no x86)
+    static const uint32_t mhz = [] {
+        const auto t0 = Clock::now();
+        const uint32_t c0 = stetho::cycleCount();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const uint32_t c1 = stetho::cycleCount();
+        const double us = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count() / 1000.0;
+        return (uint32_t)((double)(c1 - c0) / us + 0.5);
+    }();
+    return mhz;
+}
+
+uint32_t esp_get_free_heap_size() { return 0; }
+
+uint32_t esp_get_minimum_free_heap_size() { return 0; }
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+    if ((caps & MALLOC_CAP_SPIRAM) && !psramPresent.load()) return nullptr;
+    return std::malloc(size);
+}
+
+void heap_caps_free(void *ptr) { std::free(ptr); }
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::print(const char *s) {
+    if (!serialEnabled.load()) return 0;
+    return std::fputs(s, stdout) < 0 ? 0 : std::strlen(s);
+}
+
+size_t HardwareSerial::println(const char *s) {
+    if (!serialEnabled.load()) return 0;
+    const size_t n = print(s);
+    std::fputc('\n', stdout);
+    return n + 1;
+}
+
+size_t HardwareSerial::printf(const char *fmt, ...) {
+    if (!serialEnabled.load()) return 0;
+    char buf[512];
+    va_list args;
+    va_start(args, fmt);
+    int n = std::vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (n < 0) return 0;
+    if ((size_t)n >= sizeof(buf)) n = (int)sizeof(buf) - 1;
+    return std::fwrite(buf, 1, (size_t)n, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t len) {
+    if (!serialEnabled.load()) return 0;
+    return std::fwrite(data, 1, len, stdout);
+}
+
+void HardwareSerial::flush() { std::fflush(stdout); }
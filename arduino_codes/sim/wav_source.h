@@ -0,0 +1,130 @@
+#pragma once
+
+// Arquivo WAV como microfone do simulador. Aceita PCM de 16, 24 e 32 bits
+// e float de 32 bits; usa só o primeiro canal e reamostra linearmente para a
+// taxa do I2S se precisar. O arquivo é lido na escala do stream (int16 do
+// app): uma gravação feita pelo próprio app volta com a mesma amplitude.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "core/sample_kernels.h"
+
+namespace sim {
+
+class WavSource {
+public:
+    // Carrega o arquivo inteiro; devolve false com a razão em 'error'
+    bool load(const std::string &path, uint32_t target_rate_hz, std::string &error) {
+        std::FILE *f = std::fopen(path.c_str(), "rb");
+        if (!f) {
+            error = "não abriu " + path;
+            return false;
+        }
+        std::vector<uint8_t> bytes;
+        uint8_t buf[65536];
+        size_t n;
+        while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) bytes.insert(bytes.end(), buf, buf + n);
+        std::fclose(f);
+
+        if (bytes.size() < 12 || std::string((const char *)bytes.data(), 4) != "RIFF" ||
+            std::string((const char *)bytes.data() + 8, 4) != "WAVE") {
+            error = "não é um arquivo WAV";
+            return false;
+        }
+        uint16_t format = 0, channels = 0, bits = 0;
+        uint32_t rate = 0;
+        const uint8_t *data = nullptr;
+        size_t data_len = 0;
+        for (size_t pos = 12; pos + 8 <= bytes.size();) {
+            const std::string id((const char *)&bytes[pos], 4);
+            const size_t len = le32(&bytes[pos + 4]);
+            const uint8_t *body = &bytes[pos + 8];
+            const size_t avail = bytes.size() - pos - 8;
+            if (id == "fmt " && len >= 16 && avail >= 16) {
+                format = le16(body);
+                channels = le16(body + 2);
+                rate = le32(body + 4);
+                bits = le16(body + 14);
+                // WAVE_FORMAT_EXTENSIBLE: o formato real está no subformato
+                if (format == 0xFFFE && len >= 26 && avail >= 26) format = le16(body + 24);
+            } else if (id == "data") {
+                data = body;
+                data_len = len < avail ? len : avail;
+            }
+            pos += 8 + len + (len & 1);
+        }
+        const bool pcm = format == 1 && (bits == 16 || bits == 24 || bits == 32);
+        const bool flt = format == 3 && bits == 32;
+        if (!data || channels == 0 || rate == 0 || (!pcm && !flt)) {
+            error = "formato não suportado (PCM 16/24/32 bits ou float 32 bits)";
+            return false;
+        }
+
+        const size_t frame_bytes = (size_t)channels * bits / 8;
+        std::vector<double> x(data_len / frame_bytes);
+        for (size_t i = 0; i < x.size(); i++) x[i] = toStreamScale(data + i * frame_bytes, bits, flt);
+        if (x.empty()) {
+            error = "arquivo sem amostras";
+            return false;
+        }
+        rate_hz_ = rate;
+        resample(x, rate, target_rate_hz);
+        return true;
+    }
+
+    // Palavras de 32 bits como o INMP441 entregaria, em laço
+    void fill(int32_t *words, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            words[i] = words_[pos_];
+            if (++pos_ == words_.size()) pos_ = 0;
+        }
+    }
+
+    uint32_t fileRateHz() const { return rate_hz_; }
+    size_t samples() const { return words_.size(); }
+
+private:
+    static uint16_t le16(const uint8_t *p) { return (uint16_t)(p[0] | p[1] << 8); }
+    static uint32_t le32(const uint8_t *p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+
+    // Amostra do arquivo na escala int16
+    static double toStreamScale(const uint8_t *p, uint16_t bits, bool flt) {
+        if (flt) {
+            float f;
+            std::memcpy(&f, p, sizeof(f));
+            return (double)f * 32768.0;
+        }
+        if (bits == 16) return (double)(int16_t)le16(p);
+        if (bits == 24) return (double)((int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8) / 256.0;
+        return (double)(int32_t)le32(p) / 65536.0;
+    }
+
+    void resample(const std::vector<double> &x, uint32_t from_hz, uint32_t to_hz) {
+        const size_t n = (size_t)((double)x.size() * to_hz / from_hz);
+        words_.resize(n ? n : 1);
+        const double step = (double)from_hz / (double)to_hz;
+        const double scale = (double)(1 << stetho::I2S_TO_INT16_SHIFT);
+        for (size_t i = 0; i < words_.size(); i++) {
+            const double t = (double)i * step;
+            const size_t k = (size_t)t;
+            const double frac = t - (double)k;
+            const double a = x[k < x.size() ? k : x.size() - 1];
+            const double b = x[k + 1 < x.size() ? k + 1 : x.size() - 1];
+            double v = std::round((a + frac * (b - a)) * scale);
+            if (v > 2147483647.0) v = 2147483647.0;
+            if (v < -2147483648.0) v = -2147483648.0;
+            words_[i] = (int32_t)v;
+        }
+    }
+
+    std::vector<int32_t> words_;
+    size_t pos_ = 0;
+    uint32_t rate_hz_ = 0;
+};
+
+} // namespace sim
@@ -15,7 +15,14 @@ import { Base64 } from 'js-base64'; // js-base64 para decodificar
 import { styles } from './_layout'; // Supondo que seus estilos estão aqui
 import { MaterialIcons } from '@expo/vector-icons';
 import { defaultTheme } from '@/themes/default'; // Supondo que seu tema está aqui
-import { requestPermissions } from '@/utils/bleUtils';
+import {
+    ControlCommand,
+    FILTER_MODES,
+    encodeControlMessage,
+    requestPermissions,
+    decodeStreamInfo,
+} from '@/utils/bleUtils';
+import type { StreamInfo } from '@/utils/bleUtils';
 import { convertInt16SampleToPascal } from '@/utils/audioUtils';
 
 interface SettingsModalProps {
@@ -24,11 +31,15 @@ interface SettingsModalProps {
     onDeviceConnected: (device: Device) => void;
     handleDataStream: (newSamples: number[]) => void;
     handleRawAudioStream: (rawSamples: number[]) => void;
+    /** Metadados do stream (taxa nominal e medida), na conexão e a cada mudança */
+    handleStreamInfo?: (info: StreamInfo) => void;
 }
 
 // UUIDs do seu ESP32 (conforme o firmware da senoide)
 const SERVICE_UUID = '4fafc201-1fb5-459e-8fcc-c5c9c331914b';
 const CHARACTERISTIC_UUID = 'beb5483e-36e1-4688-b7f5-ea07361b26a8'; // Renomeado para clareza
+const CONTROL_CHARACTERISTIC_UUID = 'beb5483e-36e1-4688-b7f5-ea07361b26a9'; // Comandos para o ESP32
+const STREAM_INFO_CHARACTERISTIC_UUID = 'beb5483e-36e1-4688-b7f5-ea07361b26aa'; // Metadados do stream
 const TARGET_DEVICE_NAME = 'ESP32_Audio_Stream'; // Nome do seu dispositivo ESP32
 
 // Instância única do BleManager
@@ -40,12 +51,14 @@ export default function SettingsModal({
     onDeviceConnected,
     handleDataStream,
     handleRawAudioStream,
+    handleStreamInfo,
 }: SettingsModalProps) {
     const [connectedDevice, setConnectedDevice] = useState<Device | null>(null);
     const [isConnected, setIsConnected] = useState(false);
     const [lastSampleValue, setLastSampleValue] = useState(0);
     const [isLoading, setIsLoading] = useState(false);
     const [isScanning, setIsScanning] = useState(false);
+    const [filterMode, setFilterMode] = useState(0);
 
     // Efeito para lidar com a desconexão do dispositivo
     useEffect(() => {
@@ -60,6 +73,7 @@ export default function SettingsModal({
                     setIsConnected(false);
                     setConnectedDevice(null);
                     setLastSampleValue(0);
+                    setFilterMode(0);
                 }
             );
             return () => subscription.remove();
@@ -177,6 +191,31 @@ export default function SettingsModal({
                         `monitor-${CHARACTERISTIC_UUID}` // ID da transação
                     );
                     console.log(`Monitoramento iniciado com ID: ${subscriptionId}`);
+
+                    // Taxa do stream (a medida vai para o cabeçalho do .wav): lê
+                    // uma vez e acompanha as notificações de mudança
+                    if (handleStreamInfo) {
+                        try {
+                            const info = await connectedDev.readCharacteristicForService(
+                                SERVICE_UUID,
+                                STREAM_INFO_CHARACTERISTIC_UUID
+                            );
+                            const decoded = info.value ? decodeStreamInfo(info.value) : null;
+                            if (decoded) handleStreamInfo(decoded);
+                        } catch (readError) {
+                            console.warn('Falha ao ler a informação do stream:', readError);
+                        }
+                        connectedDev.monitorCharacteristicForService(
+                            SERVICE_UUID,
+                            STREAM_INFO_CHARACTERISTIC_UUID,
+                            (err, characteristic) => {
+                                if (err || !characteristic?.value) return;
+                                const decoded = decodeStreamInfo(characteristic.value);
+                                if (decoded) handleStreamInfo(decoded);
+                            },
+                            `monitor-${STREAM_INFO_CHARACTERISTIC_UUID}`
+                        );
+                    }
                 } catch (connectionError) {
                     console.error('Erro na conexão ou descoberta:', connectionError);
                     setIsLoading(false); // Para o loading em caso de erro
@@ -208,6 +247,24 @@ export default function SettingsModal({
         }, 15000);
     }
 
+    /**
+     * Troca o banco de filtros do firmware (banda larga, coração ou pulmão)
+     * @param mode O modo de filtro (ver FILTER_MODES)
+     */
+    async function changeFilterMode(mode: number) {
+        if (!connectedDevice) return;
+        try {
+            await connectedDevice.writeCharacteristicWithResponseForService(
+                SERVICE_UUID,
+                CONTROL_CHARACTERISTIC_UUID,
+                encodeControlMessage(ControlCommand.SetFilterMode, mode)
+            );
+            setFilterMode(mode);
+        } catch (error) {
+            console.warn('Falha ao trocar o modo de filtro:', error);
+        }
+    }
+
     async function disconnectFromDevice() {
         console.log('Tentando desconectar...');
         if (connectedDevice) {
@@ -264,6 +321,29 @@ export default function SettingsModal({
                             >
                                 Valor: {lastSampleValue.toFixed(2)}
                             </Text>
+                            <View style={styles.filterModeRow}>
+                                {FILTER_MODES.map((mode) => (
+                                    <Pressable
+                                        key={mode.value}
+                                        style={[
+                                            styles.filterModeButton,
+                                            filterMode === mode.value &&
+                                                styles.filterModeButtonActive,
+                                        ]}
+                                        onPress={() => changeFilterMode(mode.value)}
+                                    >
+                                        <Text
+                                            style={
+                                                filterMode === mode.value
+                                                    ? styles.filterModeTextActive
+                                                    : undefined
+                                            }
+                                        >
+                                            {mode.label}
+                                        </Text>
+                                    </Pressable>
+                                ))}
+                            </View>
                             <Button
                                 title="Desconectar do ESP32"
                                 onPress={disconnectFromDevice}
@@ -43,6 +43,26 @@ export const styles = StyleSheet.create({
         padding: 10,
         marginTop: 10,
     },
+    filterModeRow: {
+        flexDirection: 'row',
+        justifyContent: 'space-between',
+        gap: 6,
+        marginBottom: 10,
+    },
+    filterModeButton: {
+        flex: 1,
+        alignItems: 'center',
+        borderWidth: 1,
+        borderRadius: 8,
+        borderColor: defaultTheme.colors.primary,
+        paddingVertical: 6,
+    },
+    filterModeButtonActive: {
+        backgroundColor: defaultTheme.colors.primary,
+    },
+    filterModeTextActive: {
+        color: defaultTheme.colors.text.inverse,
+    },
     activtyIndicator: {
         alignSelf: 'center',
         width: '100%',
@@ -13,6 +13,7 @@ import * as FileSystem from 'expo-file-system';
 import SettingsModal from '@/components/SettingsModal/SettingsModal';
 import { Device } from 'react-native-ble-plx';
 import { convertInt16SampleToPascal, createWavFile } from '@/utils/audioUtils';
+import type { StreamInfo } from '@/utils/bleUtils';
 
 // Defina a janela de tempo que você quer exibir. 1 segundos é um bom começo.
 const SAMPLE_RATE = 20000; // Taxa de amostragem, conforme definido no ESP32
@@ -39,6 +40,7 @@ export default function Metering() {
 
     const isRecordingRef = useRef(isRecording);
     const fullRecordingDataRef = useRef<number[]>([]);
+    const streamInfoRef = useRef<StreamInfo | null>(null);
 
     useEffect(() => {
         if (!sound) {
@@ -134,7 +136,12 @@ export default function Metering() {
             try {
                 console.log('Criando arquivo .wav...');
                 // 1. Cria o arquivo .wav com os dados completos
-                const fileUri = await createWavFile(fullRecordingDataRef.current);
+                // Taxa medida pelo firmware; sem ela, a nominal
+                const info = streamInfoRef.current;
+                const fileUri = await createWavFile(
+                    fullRecordingDataRef.current,
+                    info?.measuredRateHz ?? info?.sampleRateHz
+                );
                 const fileInfo = await FileSystem.getInfoAsync(fileUri);
                 if (fileInfo.exists) {
                     console.log(
@@ -237,6 +244,10 @@ export default function Metering() {
         fullRecordingDataRef.current.push(...newRawSamples);
     };
 
+    const handleStreamInfo = (info: StreamInfo) => {
+        streamInfoRef.current = info;
+    };
+
     const recordingDurationSeconds = isRecording
         ? fullRecordingDataRef.current.length / SAMPLE_RATE
         : undefined;
@@ -369,6 +380,7 @@ export default function Metering() {
                 onDeviceConnected={handleDeviceConnected}
                 handleDataStream={handleDataStream}
                 handleRawAudioStream={handleRawAudioStream}
+                handleStreamInfo={handleStreamInfo}
             />
         </View>
     );
@@ -35,10 +35,11 @@ export function convertInt16SampleToPascal(sampleInt16: any) {
 /**
  * Cria um arquivo .wav a partir de dados PCM brutos (Int16)
  * @param pcmData O array de amostras de áudio (números Int16)
+ * @param measuredRateHz A taxa medida do StreamInfo (decodeStreamInfo), se houver
  * @returns A URI do arquivo .wav criado
  */
-export async function createWavFile(pcmData: number[]): Promise<string> {
-    const sampleRate = 20000; // Do seu ESP32
+export async function createWavFile(pcmData: number[], measuredRateHz = 20000): Promise<string> {
+    const sampleRate = Math.round(measuredRateHz); // O cabeçalho só guarda Hz inteiros
     const numChannels = 1; // Do seu ESP32 (I2S_CHANNEL_FMT_ONLY_LEFT)
     const bitsPerSample = 16; // Do seu ESP32 (int16_t)
 
@@ -1,4 +1,5 @@
 import { PermissionsAndroid, Platform } from 'react-native';
+import { Base64 } from 'js-base64';
 
 /**
  * Solicita permissões necessárias para BLE no Android
@@ -36,3 +37,281 @@ export async function requestPermissions() {
     }
     return true;
 }
+
+/**
+ * Comandos aceitos pela característica de controle do firmware
+ * (ver arduino_codes/core/control_protocol.h)
+ */
+export const ControlCommand = {
+    SetFilterMode: 0x01,
+    SetCodec: 0x02,
+    SetOutputRate: 0x03,
+    SetFraming: 0x04,
+    SetRecording: 0x05,
+    SetSpectrogram: 0x06,
+    SetPreview: 0x07,
+    SetScaling: 0x08,
+    SetStereo: 0x09,
+} as const;
+
+/**
+ * Modos do banco de filtros do firmware (ver arduino_codes/core/biquad.h)
+ */
+export const FILTER_MODES = [
+    { value: 0, label: 'Banda larga' },
+    { value: 1, label: 'Coração' },
+    { value: 2, label: 'Pulmão' },
+];
+
+/**
+ * Monta uma mensagem [comando, valor] em Base64 para escrita via BLE
+ * @param command O código do comando (ControlCommand)
+ * @param value O valor do comando (0 a 255)
+ * @returns A mensagem codificada em Base64
+ */
+export function encodeControlMessage(command: number, value: number): string {
+    return Base64.fromUint8Array(new Uint8Array([command & 0xff, value & 0xff]));
+}
+
+/**
+ * Tipos de som cardíaco nos eventos de features (ver arduino_codes/core/heart_features.h)
+ */
+export const HeartSound = {
+    Unknown: 0,
+    S1: 1,
+    S2: 2,
+} as const;
+
+export interface HeartEvent {
+    type: number;
+    firstSample: number;
+    timestampUs: number;
+    durationMs: number;
+}
+
+export interface HeartFeatures {
+    hrValid: boolean;
+    bpm: number;
+    confidence: number;
+    envelope: number;
+    events: HeartEvent[];
+}
+
+/**
+ * Decodifica uma notificação da característica de features (BPM + S1/S2)
+ * @param base64 O valor recebido via BLE
+ * @returns As features, ou null se o layout não for reconhecido
+ */
+export function decodeHeartFeatures(base64: string): HeartFeatures | null {
+    const b = Base64.toUint8Array(base64);
+    if (b.length < 8 || b[0] !== 1) return null;
+    const view = new DataView(b.buffer, b.byteOffset, b.byteLength);
+    const count = b[5];
+    if (b.length < 8 + count * 11) return null;
+    const events: HeartEvent[] = [];
+    for (let i = 0; i < count; i++) {
+        const p = 8 + i * 11;
+        events.push({
+            type: b[p],
+            firstSample: view.getUint32(p + 1, true),
+            timestampUs: view.getUint32(p + 5, true),
+            durationMs: view.getUint16(p + 9, true),
+        });
+    }
+    return {
+        hrValid: (b[1] & 0x1) !== 0,
+        bpm: view.getUint16(2, true) / 10,
+        confidence: b[4],
+        envelope: view.getUint16(6, true),
+        events,
+    };
+}
+
+export interface SpectrogramFrame {
+    log2n: number;
+    seq: number;
+    firstSample: number;
+    hop: number;
+    binsPerLevel: number;
+    /** Níveis em dBFS (0,5 dB por passo; 0 = -127,5 dBFS ou menos) */
+    levelsDb: number[];
+}
+
+/**
+ * Monta o valor do comando SetSpectrogram
+ * @param log2n Tamanho da FFT (7, 9 ou 11)
+ * @param overlap Salto = N >> overlap (0 a 3)
+ */
+export function encodeSpectrogramConfig(log2n: number, overlap: number): number {
+    return (log2n & 0x0f) | ((overlap & 0x03) << 4);
+}
+
+/**
+ * Decodifica uma notificação da característica de espectrograma
+ * (ver arduino_codes/core/spectrogram.h)
+ * @param base64 O valor recebido via BLE
+ * @returns O quadro, ou null se o layout não for reconhecido
+ */
+export function decodeSpectrogramFrame(base64: string): SpectrogramFrame | null {
+    const b = Base64.toUint8Array(base64);
+    if (b.length < 12 || b[0] !== 1) return null;
+    const view = new DataView(b.buffer, b.byteOffset, b.byteLength);
+    const levelsDb: number[] = [];
+    for (let i = 12; i < b.length; i++) levelsDb.push((b[i] - 255) / 2);
+    return {
+        log2n: b[1],
+        seq: view.getUint16(2, true),
+        firstSample: view.getUint32(4, true),
+        hop: view.getUint16(8, true),
+        binsPerLevel: b[10],
+        levelsDb,
+    };
+}
+
+export interface MinMaxPreview {
+    firstSample: number;
+    samplesPerPair: number;
+    min: number[];
+    max: number[];
+}
+
+/**
+ * Decodifica uma notificação da característica de prévia min/max: cada par
+ * vira uma linha vertical no gráfico ao vivo (ver arduino_codes/core/minmax_preview.h)
+ * @param base64 O valor recebido via BLE
+ * @returns Os pares, ou null se o layout não for reconhecido
+ */
+export function decodeMinMaxPreview(base64: string): MinMaxPreview | null {
+    const b = Base64.toUint8Array(base64);
+    if (b.length < 8 || b[0] !== 1 || (b.length - 8) % 4 !== 0) return null;
+    const view = new DataView(b.buffer, b.byteOffset, b.byteLength);
+    const min: number[] = [];
+    const max: number[] = [];
+    for (let p = 8; p < b.length; p += 4) {
+        min.push(view.getInt16(p, true));
+        max.push(view.getInt16(p + 2, true));
+    }
+    return {
+        firstSample: view.getUint32(4, true),
+        samplesPerPair: view.getUint16(2, true),
+        min,
+        max,
+    };
+}
+
+export interface StageStats {
+    count: number;
+    avgCycles: number;
+    p99Cycles: number;
+    maxCycles: number;
+}
+
+export interface DeviceDiagnostics {
+    cpuMhz: number;
+    uptimeMs: number;
+    samplesPerSec: number;
+    /** Espera do i2s_read, DSP e notify, nesta ordem */
+    stages: StageStats[];
+    dmaOverruns: number;
+    ringOverflows: number;
+    notifyFailures: number;
+    /** Pilha livre em bytes: captura, envio e armazenamento */
+    stackFree: number[];
+    freeHeap: number;
+    minFreeHeap: number;
+    /** Ausente em firmwares sem a política de energia (payload de 86 bytes) */
+    power?: PowerDiagnostics;
+}
+
+/** Estado da captura: 0 = ativa, 1 = aguardando reconexão, 2 = I2S parado */
+export interface PowerDiagnostics {
+    state: number;
+    /** A última conexão encontrou o I2S parado */
+    lastConnectCold: boolean;
+    /** Da conexão até a primeira notificação de áudio, em µs */
+    connectLatencyUs: number;
+    connectLatencyMaxWarmUs: number;
+    connectLatencyMaxColdUs: number;
+    captureIdleS: number;
+    captureStops: number;
+}
+
+/**
+ * Decodifica o valor da característica de diagnóstico (ver arduino_codes/core/stats.h).
+ * Com MTU 23 a notificação chega truncada; nesse caso leia a característica.
+ * @param base64 O valor recebido via BLE
+ * @returns As estatísticas, ou null se o layout não for reconhecido
+ */
+export function decodeDiagnostics(base64: string): DeviceDiagnostics | null {
+    const b = Base64.toUint8Array(base64);
+    if (b.length < 86 || b[0] !== 1) return null;
+    const view = new DataView(b.buffer, b.byteOffset, b.byteLength);
+    const stages: StageStats[] = [];
+    for (let s = 0; s < 3; s++) {
+        const p = 12 + s * 16;
+        stages.push({
+            count: view.getUint32(p, true),
+            avgCycles: view.getUint32(p + 4, true),
+            p99Cycles: view.getUint32(p + 8, true),
+            maxCycles: view.getUint32(p + 12, true),
+        });
+    }
+    return {
+        cpuMhz: view.getUint16(2, true),
+        uptimeMs: view.getUint32(4, true),
+        samplesPerSec: view.getUint32(8, true),
+        stages,
+        dmaOverruns: view.getUint32(60, true),
+        ringOverflows: view.getUint32(64, true),
+        notifyFailures: view.getUint32(68, true),
+        stackFree: [view.getUint16(72, true), view.getUint16(74, true), view.getUint16(76, true)],
+        freeHeap: view.getUint32(78, true),
+        minFreeHeap: view.getUint32(82, true),
+        power: b.length < 106 ? undefined : {
+            state: b[86],
+            lastConnectCold: b[87] !== 0,
+            connectLatencyUs: view.getUint32(88, true),
+            connectLatencyMaxWarmUs: view.getUint32(92, true),
+            connectLatencyMaxColdUs: view.getUint32(96, true),
+            captureIdleS: view.getUint32(100, true),
+            captureStops: view.getUint16(104, true),
+        },
+    };
+}
+
+export interface StreamInfo {
+    codec: number;
+    filterMode: number;
+    flags: number;
+    /** Taxa efetiva nominal do stream */
+    sampleRateHz: number;
+    /** Amostras por notificação (0 = variável) */
+    blockSamples: number;
+    /** Taxa medida contra o relógio do ESP32; ausente em firmwares antigos ou antes da primeira medida */
+    measuredRateHz?: number;
+    /** Tempo real menos índice / taxa nominal desde o início da medida, em µs */
+    clockOffsetUs?: number;
+}
+
+/**
+ * Decodifica o valor da característica de informação do stream (ver
+ * arduino_codes/core/stream_format.h). Para o .wav e o eixo do tempo use
+ * measuredRateHz quando presente.
+ * @param base64 O valor recebido via BLE
+ * @returns A informação, ou null se o layout não for reconhecido
+ */
+export function decodeStreamInfo(base64: string): StreamInfo | null {
+    const b = Base64.toUint8Array(base64);
+    if (b.length < 10 || b[0] !== 1) return null;
+    const view = new DataView(b.buffer, b.byteOffset, b.byteLength);
+    const measuredMilliHz = b.length < 18 ? 0 : view.getUint32(10, true);
+    return {
+        codec: b[1],
+        filterMode: b[2],
+        flags: b[3],
+        sampleRateHz: view.getUint32(4, true),
+        blockSamples: view.getUint16(8, true),
+        measuredRateHz: measuredMilliHz > 0 ? measuredMilliHz / 1000 : undefined,
+        clockOffsetUs: measuredMilliHz > 0 ? view.getInt32(14, true) : undefined,
+    };
+}